@@ -38,6 +38,7 @@ struct {
   {"prioritize", cmd_prioritize,
    "Reorder the priority of all kernel partitions"},
   {"legacy", cmd_legacy, "Switch between GPT and Legacy GPT"},
+  {"batch", cmd_batch, "Apply several commands with a single write"},
 };
 
 static void Usage(void) {
@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "cgpt_endian.h"
+#include "cgpt_params.h"
 #include "cgptlib.h"
 #include "gpt.h"
 
@@ -48,6 +49,15 @@ struct drive {
   GptData gpt;
   struct pmbr pmbr;
   int fd;       /* file descriptor */
+
+  /* Primary entries changed since their CRC was last known to be good, so
+   * UpdateAllEntries() can patch the CRC instead of recomputing it. See
+   * MarkEntryDirty(). */
+  uint32_t num_dirty_entries;
+  int entries_crc_patchable;
+  uint32_t clean_entries_crc32;     /* entries_crc32 before the changes */
+  uint8_t dirty_entries[128 / 8];   /* bitmap, MAX_NUMBER_OF_ENTRIES */
+  uint8_t *clean_entries;           /* dirty entries before they changed */
 };
 
 // Opens a block device or file, loads raw GPT data from it.
@@ -157,6 +167,10 @@ int GetErrorCounter(struct drive *drive, int secondary, uint32_t entry_index);
 void SetRaw(struct drive *drive, int secondary, uint32_t entry_index,
            uint32_t raw);
 
+// Records that a primary entry is about to change. The Set*() helpers above
+// do this themselves; code writing through GetEntry() must call it first.
+void MarkEntryDirty(struct drive *drive, uint32_t entry_index);
+
 void UpdateAllEntries(struct drive *drive);
 
 uint8_t RepairHeader(GptData *gpt, const uint32_t valid_headers);
@@ -167,6 +181,15 @@ int IsSynonymous(const GptHeader* a, const GptHeader* b);
 int IsUnused(struct drive *drive, int secondary, uint32_t index);
 int IsKernel(struct drive *drive, int secondary, uint32_t index);
 
+// The work of CgptAdd(), CgptPrioritize(), CgptBoot() and CgptLegacy() on a
+// drive that is already open, for CgptBatch(). These only change the drive in
+// memory: the caller decides whether to write it out with DriveClose(), and
+// CgptBootOnDrive() expects the caller to have read the PMBR and to write it.
+int CgptAddOnDrive(struct drive *drive, CgptAddParams *params);
+int CgptPrioritizeOnDrive(struct drive *drive, CgptPrioritizeParams *params);
+int CgptBootOnDrive(struct drive *drive, CgptBootParams *params);
+int CgptLegacyOnDrive(struct drive *drive, CgptLegacyParams *params);
+
 // Optional. Applications that need this must provide an implementation.
 //
 // Explanation:
@@ -193,6 +216,15 @@ int cmd_find(int argc, char *argv[]);
 int cmd_edit(int argc, char *argv[]);
 int cmd_prioritize(int argc, char *argv[]);
 int cmd_legacy(int argc, char *argv[]);
+int cmd_batch(int argc, char *argv[]);
+
+// Argument parsers behind the commands above, so "cgpt batch" can reuse them.
+// These return CGPT_USAGE_SHOWN if -h printed the usage instead.
+#define CGPT_USAGE_SHOWN -1
+int cmd_add_parse(int argc, char *argv[], CgptAddParams *params);
+int cmd_prioritize_parse(int argc, char *argv[], CgptPrioritizeParams *params);
+int cmd_boot_parse(int argc, char *argv[], CgptBootParams *params);
+int cmd_legacy_parse(int argc, char *argv[], CgptLegacyParams *params);
 
 #define ARRAY_COUNT(array) (sizeof(array)/sizeof((array)[0]))
 const char *GptError(int errnum);
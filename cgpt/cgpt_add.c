@@ -53,6 +53,7 @@ static int GptSetEntryAttributes(struct drive *drive,
                                  CgptAddParams *params) {
   GptEntry *entry;
 
+  MarkEntryDirty(drive, index);
   entry = GetEntry(&drive->gpt, PRIMARY, index);
   if (params->set_begin)
     entry->starting_lba = params->begin;
@@ -256,6 +257,7 @@ static int GptAdd(struct drive *drive, CgptAddParams *params, uint32_t index) {
   GptEntry *entry, backup;
   int rv;
 
+  MarkEntryDirty(drive, index);
   entry = GetEntry(&drive->gpt, PRIMARY, index);
   memcpy(&backup, entry, sizeof(backup));
 
@@ -272,6 +274,7 @@ static int GptAdd(struct drive *drive, CgptAddParams *params, uint32_t index) {
 
   if (0 != rv) {
     // If the modified entry is illegal, recover it and return error.
+    MarkEntryDirty(drive, index);
     memcpy(entry, &backup, sizeof(*entry));
     Error("%s\n", GptErrorText(rv));
     Error("");
@@ -282,9 +285,23 @@ static int GptAdd(struct drive *drive, CgptAddParams *params, uint32_t index) {
   return 0;
 }
 
+int CgptAddOnDrive(struct drive *drive, CgptAddParams *params) {
+  uint32_t index;
+
+  if (CgptCheckAddValidity(drive))
+    return CGPT_FAILED;
+
+  if (CgptGetUnusedPartition(drive, &index, params))
+    return CGPT_FAILED;
+
+  if (GptAdd(drive, params, index))
+    return CGPT_FAILED;
+
+  return CGPT_OK;
+}
+
 int CgptAdd(CgptAddParams *params) {
   struct drive drive;
-  uint32_t index;
 
   if (params == NULL)
     return CGPT_FAILED;
@@ -293,15 +310,7 @@ int CgptAdd(CgptAddParams *params) {
                            params->drive_size))
     return CGPT_FAILED;
 
-  if (CgptCheckAddValidity(&drive)) {
-    goto bad;
-  }
-
-  if (CgptGetUnusedPartition(&drive, &index, params)) {
-    goto bad;
-  }
-
-  if (GptAdd(&drive, params, index))
+  if (CGPT_OK != CgptAddOnDrive(&drive, params))
     goto bad;
 
   // Write it all out.
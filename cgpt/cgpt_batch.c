@@ -0,0 +1,75 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <string.h>
+
+#include "cgpt.h"
+#include "cgptlib_internal.h"
+#include "vboot_host.h"
+
+static int RunBatchOp(struct drive *drive, CgptBatchOp *op, int *pmbr_dirty) {
+  switch (op->type) {
+  case CGPT_BATCH_ADD:
+    return CgptAddOnDrive(drive, &op->add);
+  case CGPT_BATCH_PRIORITIZE:
+    return CgptPrioritizeOnDrive(drive, &op->prioritize);
+  case CGPT_BATCH_BOOT:
+    if (op->boot.create_pmbr || op->boot.partition || op->boot.bootfile)
+      *pmbr_dirty = 1;
+    return CgptBootOnDrive(drive, &op->boot);
+  case CGPT_BATCH_LEGACY:
+    return CgptLegacyOnDrive(drive, &op->legacy);
+  }
+
+  Error("unknown batch operation %d\n", op->type);
+  return CGPT_FAILED;
+}
+
+int CgptBatch(CgptBatchParams *params) {
+  struct drive drive;
+  int pmbr_dirty = 0;
+  int gpt_retval;
+  int i;
+
+  if (params == NULL)
+    return CGPT_FAILED;
+
+  params->failed_op = -1;
+
+  if (CGPT_OK != DriveOpen(params->drive_name, &drive, O_RDWR,
+                           params->drive_size))
+    return CGPT_FAILED;
+
+  if (CGPT_OK != ReadPMBR(&drive)) {
+    Error("Unable to read PMBR\n");
+    goto bad;
+  }
+
+  // Nothing reaches the drive until every step has succeeded.
+  for (i = 0; i < params->num_ops; i++) {
+    if (CGPT_OK != RunBatchOp(&drive, &params->ops[i], &pmbr_dirty)) {
+      params->failed_op = i;
+      goto bad;
+    }
+  }
+
+  if (GPT_SUCCESS != (gpt_retval = GptValidityCheck(&drive.gpt))) {
+    Error("GptValidityCheck() returned %d: %s\n",
+          gpt_retval, GptError(gpt_retval));
+    goto bad;
+  }
+
+  if (pmbr_dirty && CGPT_OK != WritePMBR(&drive)) {
+    Error("Cannot write PMBR\n");
+    goto bad;
+  }
+
+  // Write it all out
+  return DriveClose(&drive, 1);
+
+bad:
+  (void) DriveClose(&drive, 0);
+  return CGPT_FAILED;
+}
@@ -381,6 +381,8 @@ int DriveClose(struct drive *drive, int update_as_needed) {
   drive->gpt.secondary_header = NULL;
   free(drive->gpt.secondary_entries);
   drive->gpt.secondary_entries = NULL;
+  free(drive->clean_entries);
+  drive->clean_entries = NULL;
 
   // Sync early! Only sync file descriptor here, and leave the whole system sync
   // outside cgpt because whole system sync would trigger tons of disk accesses
@@ -772,6 +774,8 @@ void SetRequired(struct drive *drive, int secondary, uint32_t entry_index,
                  int required) {
   require(required >= 0 && required <= CGPT_ATTRIBUTE_MAX_REQUIRED);
   GptEntry *entry;
+  if (secondary != SECONDARY)
+    MarkEntryDirty(drive, entry_index);
   entry = GetEntry(&drive->gpt, secondary, entry_index);
   SetEntryRequired(entry, required);
 }
@@ -786,6 +790,8 @@ void SetLegacyBoot(struct drive *drive, int secondary, uint32_t entry_index,
                    int legacy_boot) {
   require(legacy_boot >= 0 && legacy_boot <= CGPT_ATTRIBUTE_MAX_LEGACY_BOOT);
   GptEntry *entry;
+  if (secondary != SECONDARY)
+    MarkEntryDirty(drive, entry_index);
   entry = GetEntry(&drive->gpt, secondary, entry_index);
   SetEntryLegacyBoot(entry, legacy_boot);
 }
@@ -800,6 +806,8 @@ void SetPriority(struct drive *drive, int secondary, uint32_t entry_index,
                  int priority) {
   require(priority >= 0 && priority <= CGPT_ATTRIBUTE_MAX_PRIORITY);
   GptEntry *entry;
+  if (secondary != SECONDARY)
+    MarkEntryDirty(drive, entry_index);
   entry = GetEntry(&drive->gpt, secondary, entry_index);
   SetEntryPriority(entry, priority);
 }
@@ -814,6 +822,8 @@ void SetTries(struct drive *drive, int secondary, uint32_t entry_index,
               int tries) {
   require(tries >= 0 && tries <= CGPT_ATTRIBUTE_MAX_TRIES);
   GptEntry *entry;
+  if (secondary != SECONDARY)
+    MarkEntryDirty(drive, entry_index);
   entry = GetEntry(&drive->gpt, secondary, entry_index);
   SetEntryTries(entry, tries);
 }
@@ -828,6 +838,8 @@ void SetSuccessful(struct drive *drive, int secondary, uint32_t entry_index,
                    int success) {
   require(success >= 0 && success <= CGPT_ATTRIBUTE_MAX_SUCCESSFUL);
   GptEntry *entry;
+  if (secondary != SECONDARY)
+    MarkEntryDirty(drive, entry_index);
   entry = GetEntry(&drive->gpt, secondary, entry_index);
   SetEntrySuccessful(entry, success);
 }
@@ -843,6 +855,8 @@ void SetErrorCounter(struct drive *drive, int secondary, uint32_t entry_index,
   require(error_counter >= 0 &&
           error_counter <= CGPT_ATTRIBUTE_MAX_ERROR_COUNTER);
   GptEntry *entry;
+  if (secondary != SECONDARY)
+    MarkEntryDirty(drive, entry_index);
   entry = GetEntry(&drive->gpt, secondary, entry_index);
   SetEntryErrorCounter(entry, error_counter);
 }
@@ -856,17 +870,115 @@ int GetErrorCounter(struct drive *drive, int secondary, uint32_t entry_index) {
 void SetRaw(struct drive *drive, int secondary, uint32_t entry_index,
             uint32_t raw) {
   GptEntry *entry;
+  if (secondary != SECONDARY)
+    MarkEntryDirty(drive, entry_index);
   entry = GetEntry(&drive->gpt, secondary, entry_index);
   entry->attrs.fields.gpt_att = (uint16_t)raw;
 }
 
-void UpdateAllEntries(struct drive *drive) {
-  RepairEntries(&drive->gpt, MASK_PRIMARY);
-  RepairHeader(&drive->gpt, MASK_PRIMARY);
+/*  Update header CRC values if necessary.  */
+static void UpdateHeaderCrc(GptData *gpt) {
+  GptHeader *primary_header, *secondary_header;
+
+  primary_header = (GptHeader*)gpt->primary_header;
+  secondary_header = (GptHeader*)gpt->secondary_header;
 
-  drive->gpt.modified |= (GPT_MODIFIED_HEADER1 | GPT_MODIFIED_ENTRIES1 |
-                          GPT_MODIFIED_HEADER2 | GPT_MODIFIED_ENTRIES2);
-  UpdateCrc(&drive->gpt);
+  if (gpt->modified & GPT_MODIFIED_HEADER1) {
+    primary_header->header_crc32 = 0;
+    primary_header->header_crc32 = Crc32(
+        (const uint8_t *)primary_header, sizeof(GptHeader));
+  }
+  if (gpt->modified & GPT_MODIFIED_HEADER2) {
+    secondary_header->header_crc32 = 0;
+    secondary_header->header_crc32 = Crc32(
+        (const uint8_t *)secondary_header, sizeof(GptHeader));
+  }
+}
+
+_Static_assert(sizeof(((struct drive *)0)->dirty_entries) * 8 >=
+               MAX_NUMBER_OF_ENTRIES, "dirty_entries bitmap too small");
+
+void MarkEntryDirty(struct drive *drive, uint32_t entry_index) {
+  GptData *gpt = &drive->gpt;
+  GptHeader *header = (GptHeader *)gpt->primary_header;
+  uint8_t bit = 1 << (entry_index % 8);
+
+  if (drive->dirty_entries[entry_index / 8] & bit)
+    return;
+
+  // The first change starts from the CRC that the last validity check
+  // confirmed; if it didn't, UpdateAllEntries() will just recompute it.
+  if (!drive->num_dirty_entries) {
+    drive->entries_crc_patchable =
+        (gpt->valid_headers & MASK_PRIMARY) &&
+        (gpt->valid_entries & MASK_PRIMARY);
+    drive->clean_entries_crc32 = header->entries_crc32;
+    if (!drive->clean_entries)
+      drive->clean_entries = malloc(GPT_ENTRIES_ALLOC_SIZE);
+    if (!drive->clean_entries)
+      drive->entries_crc_patchable = 0;
+  }
+
+  if (drive->entries_crc_patchable)
+    memcpy(drive->clean_entries + entry_index * header->size_of_entry,
+           GetEntry(gpt, PRIMARY, entry_index), header->size_of_entry);
+  drive->dirty_entries[entry_index / 8] |= bit;
+  drive->num_dirty_entries++;
+}
+
+static void ClearDirtyEntries(struct drive *drive) {
+  memset(drive->dirty_entries, 0, sizeof(drive->dirty_entries));
+  drive->num_dirty_entries = 0;
+}
+
+// Works out the primary entries CRC from the entries marked dirty, without
+// reading the rest of the table. Returns 0 if it has to be recomputed.
+static int PatchEntriesCrc(struct drive *drive, uint32_t *crc) {
+  GptHeader *header = (GptHeader *)drive->gpt.primary_header;
+  uint32_t stride = header->size_of_entry;
+  uint32_t count = header->number_of_entries;
+  uint32_t value = drive->clean_entries_crc32;
+  uint32_t i;
+
+  // With nothing marked we can't tell whether anything changed.
+  if (!drive->num_dirty_entries || !drive->entries_crc_patchable ||
+      header->entries_crc32 != drive->clean_entries_crc32)
+    return 0;
+
+  for (i = 0; i < count; i++) {
+    if (!(drive->dirty_entries[i / 8] & (1 << (i % 8))))
+      continue;
+    value = Crc32Patch(value, drive->clean_entries + i * stride,
+                       GetEntry(&drive->gpt, PRIMARY, i), stride,
+                       (count - 1 - i) * stride);
+  }
+
+  *crc = value;
+  return 1;
+}
+
+void UpdateAllEntries(struct drive *drive) {
+  GptData *gpt = &drive->gpt;
+  uint32_t entries_crc = 0;
+  int patched = PatchEntriesCrc(drive, &entries_crc);
+  int copied;
+
+  ClearDirtyEntries(drive);
+  copied = RepairEntries(gpt, MASK_PRIMARY);
+  RepairHeader(gpt, MASK_PRIMARY);
+
+  gpt->modified |= (GPT_MODIFIED_HEADER1 | GPT_MODIFIED_ENTRIES1 |
+                    GPT_MODIFIED_HEADER2 | GPT_MODIFIED_ENTRIES2);
+
+  // RepairEntries() made the secondary entries a copy of the primary ones,
+  // so they share a CRC.
+  if (patched && copied) {
+    ((GptHeader *)gpt->primary_header)->entries_crc32 = entries_crc;
+    ((GptHeader *)gpt->secondary_header)->entries_crc32 = entries_crc;
+    UpdateHeaderCrc(gpt);
+  } else {
+    UpdateCrc(gpt);
+  }
 }
 
 int IsUnused(struct drive *drive, int secondary, uint32_t index) {
@@ -919,17 +1031,9 @@ void UpdateCrc(GptData *gpt) {
     secondary_header->entries_crc32 =
         Crc32(gpt->secondary_entries, entries_size);
   }
-  if (gpt->modified & GPT_MODIFIED_HEADER1) {
-    primary_header->header_crc32 = 0;
-    primary_header->header_crc32 = Crc32(
-        (const uint8_t *)primary_header, sizeof(GptHeader));
-  }
-  if (gpt->modified & GPT_MODIFIED_HEADER2) {
-    secondary_header->header_crc32 = 0;
-    secondary_header->header_crc32 = Crc32(
-        (const uint8_t *)secondary_header, sizeof(GptHeader));
-  }
+  UpdateHeaderCrc(gpt);
 }
+
 /* Two headers are NOT bitwise identical. For example, my_lba pointers to header
  * itself so that my_lba in primary and secondary is definitely different.
  * Only the following fields should be identical.
@@ -4,6 +4,7 @@
  */
 
 #include <ctype.h>
+#include <pthread.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -16,22 +17,20 @@
 
 #define BUFSIZE 1024
 
-// fill comparebuf with the data to be examined, returning true on success.
-static int FillBuffer(CgptFindParams *params, int fd, uint64_t pos,
-                       uint64_t count) {
-  uint8_t *bufptr = params->comparebuf;
-
-  if (-1 == lseek(fd, pos, SEEK_SET))
-    return 0;
+// Most devices searched at once by search_devs().
+#define MAX_FIND_JOBS 64
 
+// fill buf with the data to be examined, returning true on success.
+static int FillBuffer(uint8_t *buf, int fd, uint64_t pos, uint64_t count) {
   // keep reading until done or error
   while (count) {
-    ssize_t bytes_read = read(fd, bufptr, count);
+    ssize_t bytes_read = pread(fd, buf, count, pos);
     // negative means error, 0 means (unexpected) EOF
     if (bytes_read <= 0)
       return 0;
     count -= bytes_read;
-    bufptr += bytes_read;
+    buf += bytes_read;
+    pos += bytes_read;
   }
 
   return 1;
@@ -39,7 +38,7 @@ static int FillBuffer(CgptFindParams *params, int fd, uint64_t pos,
 
 // check partition data content. return true for match, 0 for no match or error
 static int match_content(CgptFindParams *params, struct drive *drive,
-                             GptEntry *entry) {
+                         GptEntry *entry, uint8_t *comparebuf) {
   uint64_t part_size;
 
   if (!params->matchlen)
@@ -53,7 +52,7 @@ static int match_content(CgptFindParams *params, struct drive *drive,
   }
 
   // Read the partition data.
-  if (!FillBuffer(params, drive->fd,
+  if (!FillBuffer(comparebuf, drive->fd,
     (drive->gpt.sector_bytes * entry->starting_lba) + params->matchoffset,
                   params->matchlen)) {
     Error("unable to read partition data\n");
@@ -61,7 +60,7 @@ static int match_content(CgptFindParams *params, struct drive *drive,
   }
 
   // Compare it
-  if (0 == memcmp(params->matchbuf, params->comparebuf, params->matchlen)) {
+  if (0 == memcmp(params->matchbuf, comparebuf, params->matchlen)) {
     return 1;
   }
 
@@ -96,12 +95,25 @@ static void showmatch(CgptFindParams *params, const char *filename,
     EntryDetails(entry, partnum - 1, params->numeric);
 }
 
-// This returns true if a GPT partition matches the search criteria. If a match
-// isn't found (or if the file doesn't contain a GPT), it returns false. The
-// filename and partition number that matched is left in a global, since we
-// could have multiple hits.
+// Records a hit on 'filename', unless we already have the one we want.
+static void record_hit(CgptFindParams *params, const char *filename,
+                       int partnum, GptEntry *entry) {
+  if (params->first_hit && params->match_partnum)
+    return;
+
+  params->hits++;
+  showmatch(params, filename, partnum, entry);
+  if (!params->match_partnum)
+    params->match_partnum = partnum;
+}
+
+// Calls found() for each GPT partition that matches the search criteria,
+// stopping after the first if params->first_hit is set. Returns the number of
+// matches; 0 if there are none or the drive doesn't contain a GPT.
 static int gpt_search(CgptFindParams *params, struct drive *drive,
-                      const char *filename) {
+                      uint8_t *comparebuf,
+                      void (*found)(void *arg, int partnum, GptEntry *entry),
+                      void *arg) {
   int i;
   GptEntry *entry;
   int retval = 0;
@@ -117,46 +129,223 @@ static int gpt_search(CgptFindParams *params, struct drive *drive,
     if (GuidIsZero(&entry->type))
       continue;
 
-    int found = 0;
+    int found_entry = 0;
     if ((params->set_unique && GuidEqual(&params->unique_guid, &entry->unique))
         || (params->set_type && GuidEqual(&params->type_guid, &entry->type))) {
-      found = 1;
+      found_entry = 1;
     } else if (params->set_label) {
       if (CGPT_OK != UTF16ToUTF8(entry->name,
                                  sizeof(entry->name) / sizeof(entry->name[0]),
                                  (uint8_t *)partlabel, sizeof(partlabel))) {
         Error("The label cannot be converted from UTF16, so abort.\n");
-        return 0;
+        return retval;
       }
       if (!strncmp(params->label, partlabel, sizeof(partlabel)))
-        found = 1;
+        found_entry = 1;
     }
-    if (found && match_content(params, drive, entry)) {
-      params->hits++;
+    if (found_entry && match_content(params, drive, entry, comparebuf)) {
       retval++;
-      showmatch(params, filename, i+1, entry);
-      if (!params->match_partnum)
-        params->match_partnum = i+1;
+      found(arg, i+1, entry);
+      if (params->first_hit)
+        break;
     }
   }
 
   return retval;
 }
 
+struct show_arg {
+  CgptFindParams *params;
+  const char *filename;
+};
+
+static void show_found(void *arg, int partnum, GptEntry *entry) {
+  struct show_arg *show = arg;
+
+  record_hit(show->params, show->filename, partnum, entry);
+}
+
 static int do_search(CgptFindParams *params, const char *fileName) {
   int retval;
   struct drive drive;
+  struct show_arg show = { params, fileName };
+
+  if (params->first_hit && params->match_partnum)
+    return 0;
 
   if (CGPT_OK != DriveOpen(fileName, &drive, O_RDONLY, params->drive_size))
     return 0;
 
-  retval = gpt_search(params, &drive, fileName);
+  retval = gpt_search(params, &drive, params->comparebuf, show_found, &show);
 
   (void) DriveClose(&drive, 0);
 
   return retval;
 }
 
+// One device for the scan_real_devs() workers, and what they found on it.
+struct find_job {
+  char *pathname;
+  int num_hits;
+  int *partnums;
+  GptEntry *entries;
+};
+
+struct find_pool {
+  CgptFindParams *params;
+  struct find_job *jobs;
+  int num_jobs;
+  pthread_mutex_t lock;
+  int next_job;       // next job to hand out
+  int first_hit_job;  // lowest job with a hit, when params->first_hit
+};
+
+static void job_found(void *arg, int partnum, GptEntry *entry) {
+  struct find_job *job = arg;
+
+  job->partnums = realloc(job->partnums,
+                          (job->num_hits + 1) * sizeof(*job->partnums));
+  job->entries = realloc(job->entries,
+                         (job->num_hits + 1) * sizeof(*job->entries));
+  require(job->partnums && job->entries);
+  job->partnums[job->num_hits] = partnum;
+  memcpy(&job->entries[job->num_hits], entry, sizeof(*entry));
+  job->num_hits++;
+}
+
+// Searches devices until there are none left. The hits are kept with each job
+// and shown by the caller in device order, so the output doesn't depend on
+// which worker finishes first.
+static void *find_worker(void *arg) {
+  struct find_pool *pool = arg;
+  CgptFindParams *params = pool->params;
+  uint8_t *comparebuf = NULL;
+
+  if (params->matchlen) {
+    comparebuf = malloc(params->matchlen);
+    require(comparebuf);
+  }
+
+  for (;;) {
+    struct find_job *job;
+    struct drive drive;
+    int index;
+
+    pthread_mutex_lock(&pool->lock);
+    index = pool->next_job++;
+    // With first_hit, devices after one that already matched don't matter.
+    if (index >= pool->num_jobs || index > pool->first_hit_job) {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    job = &pool->jobs[index];
+    if (CGPT_OK != DriveOpen(job->pathname, &drive, O_RDONLY,
+                             params->drive_size))
+      continue;
+    gpt_search(params, &drive, comparebuf, job_found, job);
+    (void) DriveClose(&drive, 0);
+
+    if (params->first_hit && job->num_hits) {
+      pthread_mutex_lock(&pool->lock);
+      if (index < pool->first_hit_job)
+        pool->first_hit_job = index;
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+
+  free(comparebuf);
+  return NULL;
+}
+
+// Searches 'num_jobs' devices using up to params->jobs threads. Returns the
+// number of devices with a match.
+static int search_devs(CgptFindParams *params, struct find_job *jobs,
+                       int num_jobs) {
+  struct find_pool pool = {
+    .params = params,
+    .jobs = jobs,
+    .num_jobs = num_jobs,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .first_hit_job = num_jobs,
+  };
+  pthread_t threads[MAX_FIND_JOBS];
+  int num_threads = params->jobs;
+  int found = 0;
+  int i, j;
+
+  if (num_threads > MAX_FIND_JOBS)
+    num_threads = MAX_FIND_JOBS;
+  if (num_threads > num_jobs)
+    num_threads = num_jobs;
+
+  for (i = 0; i < num_threads; i++) {
+    if (pthread_create(&threads[i], NULL, find_worker, &pool))
+      break;
+  }
+  num_threads = i;
+  // If no thread could be started, do the work here.
+  if (!num_threads)
+    find_worker(&pool);
+  for (i = 0; i < num_threads; i++)
+    pthread_join(threads[i], NULL);
+
+  for (i = 0; i < num_jobs; i++) {
+    for (j = 0; j < jobs[i].num_hits; j++)
+      record_hit(params, jobs[i].pathname, jobs[i].partnums[j],
+                 &jobs[i].entries[j]);
+    if (jobs[i].num_hits)
+      found++;
+    if (params->first_hit && params->match_partnum)
+      break;
+  }
+
+  return found;
+}
+
+static void add_job(struct find_job **jobs, int *num_jobs,
+                    const char *pathname) {
+  *jobs = realloc(*jobs, (*num_jobs + 1) * sizeof(**jobs));
+  require(*jobs);
+  memset(&(*jobs)[*num_jobs], 0, sizeof(**jobs));
+  (*jobs)[*num_jobs].pathname = strdup(pathname);
+  require((*jobs)[*num_jobs].pathname);
+  (*num_jobs)++;
+}
+
+static void free_jobs(struct find_job *jobs, int num_jobs) {
+  int i;
+
+  for (i = 0; i < num_jobs; i++) {
+    free(jobs[i].pathname);
+    free(jobs[i].partnums);
+    free(jobs[i].entries);
+  }
+  free(jobs);
+}
+
+// Searches the drives named in params->drive_names, in parallel with -j.
+// Matches are shown in the order the drives were named either way.
+static void search_named_devs(CgptFindParams *params) {
+  struct find_job *jobs = NULL;
+  int num_jobs = 0;
+  int i;
+
+  if (params->jobs <= 1) {
+    for (i = 0; i < params->num_drive_names; i++) {
+      do_search(params, params->drive_names[i]);
+      if (params->first_hit && params->match_partnum)
+        break;
+    }
+    return;
+  }
+
+  for (i = 0; i < params->num_drive_names; i++)
+    add_job(&jobs, &num_jobs, params->drive_names[i]);
+  search_devs(params, jobs, num_jobs);
+  free_jobs(jobs, num_jobs);
+}
 
 #define PROC_MTD "/proc/mtd"
 #define PROC_PARTITIONS "/proc/partitions"
@@ -294,6 +483,8 @@ static int scan_real_devs(CgptFindParams *params) {
 
   size_t line_length = 0;
   char *line = NULL;
+  struct find_job *jobs = NULL;
+  int num_jobs = 0;
   partname_prev[0] = '\0';
   while (getline(&line, &line_length, fp) != -1) {
     int ma, mi;
@@ -308,7 +499,10 @@ static int scan_real_devs(CgptFindParams *params) {
     if (!strncmp(partname_prev, partname, strlen(partname_prev)) &&
         strlen(partname_prev)) {
       if ((pathname = is_wholedev(partname_prev))) {
-        if (do_search(params, pathname)) {
+        if (params->jobs > 1) {
+          // Collect them to search in parallel below.
+          add_job(&jobs, &num_jobs, pathname);
+        } else if (do_search(params, pathname)) {
           found++;
         }
       }
@@ -320,6 +514,10 @@ static int scan_real_devs(CgptFindParams *params) {
   fclose(fp);
   free(line);
 
+  if (num_jobs)
+    found += search_devs(params, jobs, num_jobs);
+  free_jobs(jobs, num_jobs);
+
   found += scan_spi_gpt(params);
 
   return found;
@@ -332,6 +530,8 @@ void CgptFind(CgptFindParams *params) {
 
   if (params->drive_name != NULL)
     do_search(params, params->drive_name);
+  else if (params->num_drive_names)
+    search_named_devs(params);
   else
     scan_real_devs(params);
 }
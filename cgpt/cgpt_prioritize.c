@@ -92,9 +92,7 @@ static void SortGroups(group_list_t *gl) {
   }
 }
 
-int CgptPrioritize(CgptPrioritizeParams *params) {
-  struct drive drive;
-
+int CgptPrioritizeOnDrive(struct drive *drive, CgptPrioritizeParams *params) {
   int priority;
 
   int gpt_retval;
@@ -104,45 +102,37 @@ int CgptPrioritize(CgptPrioritizeParams *params) {
   int i,j;
   group_list_t *groups;
 
-  if (params == NULL)
-    return CGPT_FAILED;
-
-  if (CGPT_OK != DriveOpen(params->drive_name, &drive, O_RDWR,
-                           params->drive_size))
-    return CGPT_FAILED;
-
-  if (GPT_SUCCESS != (gpt_retval = GptValidityCheck(&drive.gpt))) {
+  if (GPT_SUCCESS != (gpt_retval = GptValidityCheck(&drive->gpt))) {
     Error("GptValidityCheck() returned %d: %s\n",
           gpt_retval, GptError(gpt_retval));
-    goto bad;
+    return CGPT_FAILED;
   }
 
-  if (CGPT_OK != CheckValid(&drive)) {
+  if (CGPT_OK != CheckValid(drive)) {
     Error("please run 'cgpt repair' before reordering the priority.\n");
-    (void) DriveClose(&drive, 0);
-    return CGPT_OK;
+    return CGPT_FAILED;
   }
 
-  max_part = GetNumberOfEntries(&drive);
+  max_part = GetNumberOfEntries(drive);
 
   if (params->set_partition) {
     if (params->set_partition < 1 || params->set_partition > max_part) {
       Error("invalid partition number: %d (must be between 1 and %d\n",
             params->set_partition, max_part);
-      goto bad;
+      return CGPT_FAILED;
     }
     index = params->set_partition - 1;
     // it must be a kernel
-    if (!IsKernel(&drive, PRIMARY, index)) {
+    if (!IsKernel(drive, PRIMARY, index)) {
       Error("partition %d is not a ChromeOS kernel\n", params->set_partition);
-      goto bad;
+      return CGPT_FAILED;
     }
   }
 
   // How many kernel partitions do I have?
   num_kernels = 0;
   for (i = 0; i < max_part; i++) {
-    if (IsKernel(&drive, PRIMARY, i))
+    if (IsKernel(drive, PRIMARY, i))
       num_kernels++;
   }
 
@@ -150,10 +140,10 @@ int CgptPrioritize(CgptPrioritizeParams *params) {
     // Determine the current priority groups
     groups = NewGroupList(num_kernels);
     for (i = 0; i < max_part; i++) {
-      if (!IsKernel(&drive, PRIMARY, i))
+      if (!IsKernel(drive, PRIMARY, i))
         continue;
 
-      priority = GetPriority(&drive, PRIMARY, i);
+      priority = GetPriority(drive, PRIMARY, i);
 
       // Is this partition special?
       if (params->set_partition && (i+1 == params->set_partition)) {
@@ -198,18 +188,39 @@ int CgptPrioritize(CgptPrioritizeParams *params) {
     // Now apply the ranking to the GPT
     for (i=0; i<groups->num_groups; i++)
       for (j=0; j<groups->group[i].num_parts; j++)
-        SetPriority(&drive, PRIMARY,
+        SetPriority(drive, PRIMARY,
                     groups->group[i].part[j], groups->group[i].priority);
 
     FreeGroups(groups);
   }
 
-  // Write it all out
-  UpdateAllEntries(&drive);
+  UpdateAllEntries(drive);
+  return CGPT_OK;
+}
 
-  return DriveClose(&drive, 1);
+int CgptPrioritize(CgptPrioritizeParams *params) {
+  struct drive drive;
 
-bad:
-  (void) DriveClose(&drive, 0);
-  return CGPT_FAILED;
+  if (params == NULL)
+    return CGPT_FAILED;
+
+  if (CGPT_OK != DriveOpen(params->drive_name, &drive, O_RDWR,
+                           params->drive_size))
+    return CGPT_FAILED;
+
+  // Not an error on its own, but there is nothing to write.
+  if (GPT_SUCCESS == GptValidityCheck(&drive.gpt) &&
+      CGPT_OK != CheckValid(&drive)) {
+    Error("please run 'cgpt repair' before reordering the priority.\n");
+    (void) DriveClose(&drive, 0);
+    return CGPT_OK;
+  }
+
+  if (CGPT_OK != CgptPrioritizeOnDrive(&drive, params)) {
+    (void) DriveClose(&drive, 0);
+    return CGPT_FAILED;
+  }
+
+  // Write it all out
+  return DriveClose(&drive, 1);
 }
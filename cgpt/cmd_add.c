@@ -39,10 +39,8 @@ static void Usage(void)
   PrintTypes();
 }
 
-int cmd_add(int argc, char *argv[]) {
-
-  CgptAddParams params;
-  memset(&params, 0, sizeof(params));
+int cmd_add_parse(int argc, char *argv[], CgptAddParams *params) {
+  memset(params, 0, sizeof(*params));
 
   int c;
   int errorcnt = 0;
@@ -54,86 +52,86 @@ int cmd_add(int argc, char *argv[]) {
     switch (c)
     {
     case 'D':
-      params.drive_size = strtoull(optarg, &e, 0);
+      params->drive_size = strtoull(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 'i':
-      params.partition = (uint32_t)strtoul(optarg, &e, 0);
+      params->partition = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 'b':
-      params.set_begin = 1;
-      params.begin = strtoull(optarg, &e, 0);
+      params->set_begin = 1;
+      params->begin = strtoull(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 's':
-      params.set_size = 1;
-      params.size = strtoull(optarg, &e, 0);
+      params->set_size = 1;
+      params->size = strtoull(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 't':
-      params.set_type = 1;
-      if (CGPT_OK != SupportedType(optarg, &params.type_guid) &&
-          CGPT_OK != StrToGuid(optarg, &params.type_guid)) {
+      params->set_type = 1;
+      if (CGPT_OK != SupportedType(optarg, &params->type_guid) &&
+          CGPT_OK != StrToGuid(optarg, &params->type_guid)) {
         Error("invalid argument to -%c: %s\n", c, optarg);
         errorcnt++;
       }
       break;
     case 'u':
-      params.set_unique = 1;
-      if (CGPT_OK != StrToGuid(optarg, &params.unique_guid)) {
+      params->set_unique = 1;
+      if (CGPT_OK != StrToGuid(optarg, &params->unique_guid)) {
         Error("invalid argument to -%c: %s\n", c, optarg);
         errorcnt++;
       }
       break;
     case 'l':
-      params.label = optarg;
+      params->label = optarg;
       break;
     case 'E':
-      params.set_error_counter = 1;
-      params.error_counter = (uint32_t)strtoul(optarg, &e, 0);
+      params->set_error_counter = 1;
+      params->error_counter = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
-      errorcnt += check_int_limit(c, params.error_counter, 0, 1);
+      errorcnt += check_int_limit(c, params->error_counter, 0, 1);
       break;
     case 'S':
-      params.set_successful = 1;
-      params.successful = (uint32_t)strtoul(optarg, &e, 0);
+      params->set_successful = 1;
+      params->successful = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
-      errorcnt += check_int_limit(c, params.successful, 0, 1);
+      errorcnt += check_int_limit(c, params->successful, 0, 1);
       break;
     case 'T':
-      params.set_tries = 1;
-      params.tries = (uint32_t)strtoul(optarg, &e, 0);
+      params->set_tries = 1;
+      params->tries = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
-      errorcnt += check_int_limit(c, params.tries, 0, 15);
+      errorcnt += check_int_limit(c, params->tries, 0, 15);
       break;
     case 'P':
-      params.set_priority = 1;
-      params.priority = (uint32_t)strtoul(optarg, &e, 0);
+      params->set_priority = 1;
+      params->priority = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
-      errorcnt += check_int_limit(c, params.priority, 0, 15);
+      errorcnt += check_int_limit(c, params->priority, 0, 15);
       break;
     case 'R':
-      params.set_required = 1;
-      params.required = (uint32_t)strtoul(optarg, &e, 0);
+      params->set_required = 1;
+      params->required = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
-      errorcnt += check_int_limit(c, params.required, 0, 1);
+      errorcnt += check_int_limit(c, params->required, 0, 1);
       break;
     case 'B':
-      params.set_legacy_boot = 1;
-      params.legacy_boot = (uint32_t)strtoul(optarg, &e, 0);
+      params->set_legacy_boot = 1;
+      params->legacy_boot = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
-      errorcnt += check_int_limit(c, params.legacy_boot, 0, 1);
+      errorcnt += check_int_limit(c, params->legacy_boot, 0, 1);
       break;
     case 'A':
-      params.set_raw = 1;
-      params.raw_value = strtoull(optarg, &e, 0);
+      params->set_raw = 1;
+      params->raw_value = strtoull(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
 
     case 'h':
       Usage();
-      return CGPT_OK;
+      return CGPT_USAGE_SHOWN;
     case '?':
       Error("unrecognized option: -%c\n", optopt);
       errorcnt++;
@@ -159,7 +157,17 @@ int cmd_add(int argc, char *argv[]) {
     return CGPT_FAILED;
   }
 
-  params.drive_name = argv[optind];
+  params->drive_name = argv[optind];
+
+  return CGPT_OK;
+}
+
+int cmd_add(int argc, char *argv[]) {
+  CgptAddParams params;
+  int rv = cmd_add_parse(argc, argv, &params);
+
+  if (rv != CGPT_OK)
+    return rv == CGPT_USAGE_SHOWN ? CGPT_OK : rv;
 
   return CgptAdd(&params);
 }
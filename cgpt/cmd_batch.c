@@ -0,0 +1,250 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <getopt.h>
+#include <string.h>
+
+#include "cgpt.h"
+#include "vboot_host.h"
+
+extern const char* progname;
+
+// Most arguments a single batch line can have, including the command.
+#define MAX_BATCH_ARGS 64
+
+static void Usage(void)
+{
+  printf("\nUsage: %s batch [OPTIONS] DRIVE\n\n"
+         "Apply several add, prioritize, boot and legacy commands to DRIVE\n"
+         "at once. The GPT is read once, every command is applied in memory,\n"
+         "and DRIVE is only written if they all succeed.\n\n"
+         "Options:\n"
+         "  -D NUM       Size (in bytes) of the disk where partitions reside;\n"
+         "                 default 0, meaning partitions and GPT structs are\n"
+         "                 both on DRIVE\n"
+         "  -f FILE      Read commands from FILE instead of stdin\n"
+         "\n"
+         "Each line holds one command and its options, without the DRIVE\n"
+         "argument, e.g.:\n"
+         "\n"
+         "  add -i 2 -t kernel -b 20480 -s 32768 -l \"KERN-A\"\n"
+         "  prioritize -i 2\n"
+         "\n"
+         "Arguments may be quoted with ' or \". Lines starting with # and\n"
+         "blank lines are ignored.\n"
+         "\n", progname);
+}
+
+// Splits 'line' into arguments in place. Returns the number of arguments, or
+// -1 on unbalanced quotes or too many arguments.
+static int SplitLine(char *line, char *argv[], int max_args) {
+  char *in = line;
+  char *out = line;
+  int argc = 0;
+
+  for (;;) {
+    char quote = 0;
+
+    while (*in == ' ' || *in == '\t' || *in == '\r' || *in == '\n')
+      in++;
+    if (!*in || (*in == '#' && argc == 0))
+      break;
+    if (argc == max_args)
+      return -1;
+
+    argv[argc++] = out;
+    while (*in && (quote || !strchr(" \t\r\n", *in))) {
+      if (quote && *in == quote)
+        quote = 0;
+      else if (!quote && (*in == '"' || *in == '\''))
+        quote = *in;
+      else
+        *out++ = *in;
+      in++;
+    }
+    if (quote)
+      return -1;
+    if (*in)
+      in++;
+    *out++ = '\0';
+  }
+
+  return argc;
+}
+
+// Parses one batch line into 'op', reusing the option parser of the command.
+static int ParseBatchOp(int argc, char *argv[], const char *drive_name,
+                        CgptBatchOp *op) {
+  const char *drive = NULL;
+  uint64_t drive_size = 0;
+  int rv;
+
+  // The parsers expect the drive as their last argument.
+  argv[argc++] = (char *)drive_name;
+  argv[argc] = NULL;
+
+  // Restart getopt() for each line.
+  optind = 0;
+
+  memset(op, 0, sizeof(*op));
+  if (!strcmp(argv[0], "add")) {
+    op->type = CGPT_BATCH_ADD;
+    rv = cmd_add_parse(argc, argv, &op->add);
+    drive = op->add.drive_name;
+    drive_size = op->add.drive_size;
+  } else if (!strcmp(argv[0], "prioritize")) {
+    op->type = CGPT_BATCH_PRIORITIZE;
+    rv = cmd_prioritize_parse(argc, argv, &op->prioritize);
+    drive = op->prioritize.drive_name;
+    drive_size = op->prioritize.drive_size;
+  } else if (!strcmp(argv[0], "boot")) {
+    op->type = CGPT_BATCH_BOOT;
+    rv = cmd_boot_parse(argc, argv, &op->boot);
+    drive = op->boot.drive_name;
+    drive_size = op->boot.drive_size;
+  } else if (!strcmp(argv[0], "legacy")) {
+    op->type = CGPT_BATCH_LEGACY;
+    rv = cmd_legacy_parse(argc, argv, &op->legacy);
+    drive = op->legacy.drive_name;
+    drive_size = op->legacy.drive_size;
+  } else {
+    Error("unsupported batch command: %s\n", argv[0]);
+    return CGPT_FAILED;
+  }
+
+  if (rv != CGPT_OK)
+    return CGPT_FAILED;
+
+  if (drive != drive_name) {
+    Error("%s: the drive is given to 'batch', not to each line\n", argv[0]);
+    return CGPT_FAILED;
+  }
+  if (drive_size) {
+    Error("%s: -D is given to 'batch', not to each line\n", argv[0]);
+    return CGPT_FAILED;
+  }
+
+  return CGPT_OK;
+}
+
+int cmd_batch(int argc, char *argv[]) {
+  CgptBatchParams params;
+  memset(&params, 0, sizeof(params));
+
+  const char *script = NULL;
+  FILE *fp = stdin;
+  char **lines = NULL;
+  int *line_numbers = NULL;
+  char *line = NULL;
+  size_t line_size = 0;
+  int line_number = 0;
+  int rv = CGPT_FAILED;
+  int i;
+
+  int c;
+  int errorcnt = 0;
+  char *e = 0;
+
+  opterr = 0;                     // quiet, you
+  while ((c=getopt(argc, argv, ":hf:D:")) != -1)
+  {
+    switch (c)
+    {
+    case 'D':
+      params.drive_size = strtoull(optarg, &e, 0);
+      errorcnt += check_int_parse(c, e);
+      break;
+    case 'f':
+      script = optarg;
+      break;
+
+    case 'h':
+      Usage();
+      return CGPT_OK;
+    case '?':
+      Error("unrecognized option: -%c\n", optopt);
+      errorcnt++;
+      break;
+    case ':':
+      Error("missing argument to -%c\n", optopt);
+      errorcnt++;
+      break;
+    default:
+      errorcnt++;
+      break;
+    }
+  }
+  if (errorcnt)
+  {
+    Usage();
+    return CGPT_FAILED;
+  }
+
+  if (optind >= argc) {
+    Error("missing drive argument\n");
+    return CGPT_FAILED;
+  }
+
+  params.drive_name = argv[optind];
+
+  if (script) {
+    fp = fopen(script, "r");
+    if (!fp) {
+      Error("Can't read %s\n", script);
+      return CGPT_FAILED;
+    }
+  }
+
+  // Parse the whole script before touching the drive. The ops point into
+  // their lines, so those stay around until CgptBatch() is done.
+  while (getline(&line, &line_size, fp) != -1) {
+    char *op_argv[MAX_BATCH_ARGS + 2];
+    int op_argc;
+
+    line_number++;
+    op_argc = SplitLine(line, op_argv, MAX_BATCH_ARGS);
+    if (op_argc < 0) {
+      Error("line %d: can't parse arguments\n", line_number);
+      goto done;
+    }
+    if (op_argc == 0)
+      continue;
+
+    params.ops = realloc(params.ops,
+                         (params.num_ops + 1) * sizeof(CgptBatchOp));
+    lines = realloc(lines, (params.num_ops + 1) * sizeof(char *));
+    line_numbers = realloc(line_numbers, (params.num_ops + 1) * sizeof(int));
+    require(params.ops && lines && line_numbers);
+
+    if (CGPT_OK != ParseBatchOp(op_argc, op_argv, params.drive_name,
+                                &params.ops[params.num_ops])) {
+      Error("line %d: invalid command\n", line_number);
+      goto done;
+    }
+    lines[params.num_ops] = line;
+    line_numbers[params.num_ops] = line_number;
+    params.num_ops++;
+
+    // Take a fresh buffer for the next line.
+    line = NULL;
+    line_size = 0;
+  }
+
+  rv = CgptBatch(&params);
+  if (rv != CGPT_OK && params.failed_op >= 0)
+    Error("line %d failed, drive left unchanged\n",
+          line_numbers[params.failed_op]);
+
+done:
+  if (fp != stdin)
+    fclose(fp);
+  free(line);
+  for (i = 0; i < params.num_ops; i++)
+    free(lines[i]);
+  free(lines);
+  free(line_numbers);
+  free(params.ops);
+  return rv;
+}
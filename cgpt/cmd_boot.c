@@ -28,9 +28,8 @@ static void Usage(void)
 }
 
 
-int cmd_boot(int argc, char *argv[]) {
-  CgptBootParams params;
-  memset(&params, 0, sizeof(params));
+int cmd_boot_parse(int argc, char *argv[], CgptBootParams *params) {
+  memset(params, 0, sizeof(*params));
 
 
   int c;
@@ -43,23 +42,23 @@ int cmd_boot(int argc, char *argv[]) {
     switch (c)
     {
     case 'D':
-      params.drive_size = strtoull(optarg, &e, 0);
+      params->drive_size = strtoull(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 'i':
-      params.partition = (uint32_t)strtoul(optarg, &e, 0);
+      params->partition = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 'b':
-      params.bootfile = optarg;
+      params->bootfile = optarg;
       break;
     case 'p':
-      params.create_pmbr = 1;
+      params->create_pmbr = 1;
       break;
 
     case 'h':
       Usage();
-      return CGPT_OK;
+      return CGPT_USAGE_SHOWN;
     case '?':
       Error("unrecognized option: -%c\n", optopt);
       errorcnt++;
@@ -84,7 +83,17 @@ int cmd_boot(int argc, char *argv[]) {
     return CGPT_FAILED;
   }
 
-  params.drive_name = argv[optind];
+  params->drive_name = argv[optind];
+
+  return CGPT_OK;
+}
+
+int cmd_boot(int argc, char *argv[]) {
+  CgptBootParams params;
+  int rv = cmd_boot_parse(argc, argv, &params);
+
+  if (rv != CGPT_OK)
+    return rv == CGPT_USAGE_SHOWN ? CGPT_OK : rv;
 
   return CgptBoot(&params);
 }
@@ -26,6 +26,8 @@ static void Usage(void)
          "  -v           Be verbose in displaying matches (repeatable)\n"
          "  -n           Numeric output only\n"
          "  -1           Fail if more than one match is found\n"
+         "  -F           Stop at the first match\n"
+         "  -j NUM       Search up to NUM drives at once\n"
          "  -M FILE"
          "      Matching partition data must also contain FILE content\n"
          "  -O NUM"
@@ -75,13 +77,12 @@ int cmd_find(int argc, char *argv[]) {
   CgptFindParams params;
   memset(&params, 0, sizeof(params));
 
-  int i;
   int errorcnt = 0;
   char *e = 0;
   int c;
 
   opterr = 0;                     // quiet, you
-  while ((c=getopt(argc, argv, ":hv1nt:u:l:M:O:D:")) != -1)
+  while ((c=getopt(argc, argv, ":hv1Fnj:t:u:l:M:O:D:")) != -1)
   {
     switch (c)
     {
@@ -98,6 +99,14 @@ int cmd_find(int argc, char *argv[]) {
     case '1':
       params.oneonly = 1;
       break;
+    case 'F':
+      params.first_hit = 1;
+      break;
+    case 'j':
+      params.jobs = (int)strtol(optarg, &e, 0);
+      errorcnt += check_int_parse(c, e);
+      errorcnt += check_int_limit(c, params.jobs, 1, 64);
+      break;
     case 'l':
       params.set_label = 1;
       params.label = optarg;
@@ -156,20 +165,19 @@ int cmd_find(int argc, char *argv[]) {
     Error("You must specify at least one of -t, -u, or -l\n");
     errorcnt++;
   }
+  if (params.oneonly && params.first_hit) {
+    Error("-1 needs every match, so it can't be used with -F\n");
+    errorcnt++;
+  }
   if (errorcnt)
   {
     Usage();
     return CGPT_FAILED;
   }
 
-  if (optind < argc) {
-    for (i=optind; i<argc; i++) {
-      params.drive_name = argv[i];
-      CgptFind(&params);
-      }
-  } else {
-      CgptFind(&params);
-  }
+  params.drive_names = argv + optind;
+  params.num_drive_names = argc - optind;
+  CgptFind(&params);
 
   if (params.oneonly && params.hits != 1) {
     return CGPT_FAILED;
@@ -24,9 +24,8 @@ static void Usage(void)
          "\n", progname);
 }
 
-int cmd_legacy(int argc, char *argv[]) {
-  CgptLegacyParams params;
-  memset(&params, 0, sizeof(params));
+int cmd_legacy_parse(int argc, char *argv[], CgptLegacyParams *params) {
+  memset(params, 0, sizeof(*params));
 
   int c;
   char* e = 0;
@@ -38,26 +37,26 @@ int cmd_legacy(int argc, char *argv[]) {
     switch (c)
     {
     case 'D':
-      params.drive_size = strtoull(optarg, &e, 0);
+      params->drive_size = strtoull(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 'e':
-      if (params.mode) {
+      if (params->mode) {
         Error("Incompatible flags, pick either -e or -p\n");
         errorcnt++;
       }
-      params.mode = CGPT_LEGACY_MODE_EFIPART;
+      params->mode = CGPT_LEGACY_MODE_EFIPART;
       break;
     case 'p':
-      if (params.mode) {
+      if (params->mode) {
         Error("Incompatible flags, pick either -e or -p\n");
         errorcnt++;
       }
-      params.mode = CGPT_LEGACY_MODE_IGNORE_PRIMARY;
+      params->mode = CGPT_LEGACY_MODE_IGNORE_PRIMARY;
       break;
     case 'h':
       Usage();
-      return CGPT_OK;
+      return CGPT_USAGE_SHOWN;
     case '?':
       Error("unrecognized option: -%c\n", optopt);
       errorcnt++;
@@ -82,7 +81,17 @@ int cmd_legacy(int argc, char *argv[]) {
     return CGPT_FAILED;
   }
 
-  params.drive_name = argv[optind];
+  params->drive_name = argv[optind];
+
+  return CGPT_OK;
+}
+
+int cmd_legacy(int argc, char *argv[]) {
+  CgptLegacyParams params;
+  int rv = cmd_legacy_parse(argc, argv, &params);
+
+  if (rv != CGPT_OK)
+    return rv == CGPT_USAGE_SHOWN ? CGPT_OK : rv;
 
   return CgptLegacy(&params);
 }
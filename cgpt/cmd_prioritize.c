@@ -38,9 +38,8 @@ static void Usage(void)
          "\n", progname);
 }
 
-int cmd_prioritize(int argc, char *argv[]) {
-  CgptPrioritizeParams params;
-  memset(&params, 0, sizeof(params));
+int cmd_prioritize_parse(int argc, char *argv[], CgptPrioritizeParams *params) {
+  memset(params, 0, sizeof(*params));
 
   int c;
   int errorcnt = 0;
@@ -52,25 +51,25 @@ int cmd_prioritize(int argc, char *argv[]) {
     switch (c)
     {
     case 'D':
-      params.drive_size = strtoull(optarg, &e, 0);
+      params->drive_size = strtoull(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 'i':
-      params.set_partition = (uint32_t)strtoul(optarg, &e, 0);
+      params->set_partition = (uint32_t)strtoul(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
       break;
     case 'f':
-      params.set_friends = 1;
+      params->set_friends = 1;
       break;
     case 'P':
-      params.max_priority = (int)strtol(optarg, &e, 0);
+      params->max_priority = (int)strtol(optarg, &e, 0);
       errorcnt += check_int_parse(c, e);
-      errorcnt += check_int_limit(c, params.max_priority, 1, 15);
+      errorcnt += check_int_limit(c, params->max_priority, 1, 15);
       break;
 
     case 'h':
       Usage();
-      return CGPT_OK;
+      return CGPT_USAGE_SHOWN;
     case '?':
       Error("unrecognized option: -%c\n", optopt);
       errorcnt++;
@@ -90,7 +89,7 @@ int cmd_prioritize(int argc, char *argv[]) {
     return CGPT_FAILED;
   }
 
-  if (params.set_friends && !params.set_partition) {
+  if (params->set_friends && !params->set_partition) {
     Error("the -f option is only useful with the -i option\n");
     Usage();
     return CGPT_FAILED;
@@ -101,7 +100,17 @@ int cmd_prioritize(int argc, char *argv[]) {
     return CGPT_FAILED;
   }
 
-  params.drive_name = argv[optind];
+  params->drive_name = argv[optind];
+
+  return CGPT_OK;
+}
+
+int cmd_prioritize(int argc, char *argv[]) {
+  CgptPrioritizeParams params;
+  int rv = cmd_prioritize_parse(argc, argv, &params);
+
+  if (rv != CGPT_OK)
+    return rv == CGPT_USAGE_SHOWN ? CGPT_OK : rv;
 
   return CgptPrioritize(&params);
 }
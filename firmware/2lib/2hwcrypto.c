@@ -3,6 +3,10 @@
  * found in the LICENSE file.
  *
  * SHA256 implementation using the hardware crypto accelerator.
+ *
+ * Each digest keeps its state in its own vb2_hwcrypto_digest_context, so
+ * several can be in progress at once.  The single-state calls run on one
+ * static context.
  */
 
 #include "2common.h"
@@ -10,41 +14,44 @@
 #include "2sha_private.h"
 #include "2api.h"
 
-struct vb2_sha256_context vb2_sha_ctx;
-
-vb2_error_t vb2ex_hwcrypto_digest_init(enum vb2_hash_algorithm hash_alg,
-				       uint32_t data_size)
+vb2_error_t vb2ex_hwcrypto_digest_init_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	enum vb2_hash_algorithm hash_alg, uint32_t data_size)
 {
+	struct vb2_sha256_context *sha = &hc->sha256;
 	int i;
 
 	if (hash_alg != VB2_HASH_SHA256)
 		return VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED;
 
 	for (i = 0; i < ARRAY_SIZE(vb2_hash_seq); i++) {
-		VB2_ASSERT(vb2_hash_seq[i] < ARRAY_SIZE(vb2_sha_ctx.h));
-		vb2_sha_ctx.h[vb2_hash_seq[i]] = vb2_sha256_h0[i];
+		VB2_ASSERT(vb2_hash_seq[i] < ARRAY_SIZE(sha->h));
+		sha->h[vb2_hash_seq[i]] = vb2_sha256_h0[i];
 	}
 
-	vb2_sha_ctx.size = 0;
-	vb2_sha_ctx.total_size = 0;
-	memset(vb2_sha_ctx.block, 0, sizeof(vb2_sha_ctx.block));
+	sha->size = 0;
+	sha->total_size = 0;
+	memset(sha->block, 0, sizeof(sha->block));
 
 	return VB2_SUCCESS;
 }
 
-vb2_error_t vb2ex_hwcrypto_digest_extend(const uint8_t *buf, uint32_t size)
+vb2_error_t vb2ex_hwcrypto_digest_extend_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	const uint8_t *buf, uint32_t size)
 {
+	struct vb2_sha256_context *sha = &hc->sha256;
 	unsigned int remaining_blocks;
 	unsigned int new_size, rem_size, tmp_size;
 	const uint8_t *shifted_data;
 
-	tmp_size = VB2_SHA256_BLOCK_SIZE - vb2_sha_ctx.size;
+	tmp_size = VB2_SHA256_BLOCK_SIZE - sha->size;
 	rem_size = size < tmp_size ? size : tmp_size;
 
-	memcpy(&vb2_sha_ctx.block[vb2_sha_ctx.size], buf, rem_size);
+	memcpy(&sha->block[sha->size], buf, rem_size);
 
-	if (vb2_sha_ctx.size + size < VB2_SHA256_BLOCK_SIZE) {
-		vb2_sha_ctx.size += size;
+	if (sha->size + size < VB2_SHA256_BLOCK_SIZE) {
+		sha->size += size;
 		return VB2_SUCCESS;
 	}
 
@@ -53,24 +60,26 @@ vb2_error_t vb2ex_hwcrypto_digest_extend(const uint8_t *buf, uint32_t size)
 
 	shifted_data = buf + rem_size;
 
-	vb2_sha256_transform_hwcrypto(vb2_sha_ctx.block, 1);
+	vb2_sha256_transform_hwcrypto(sha->h, sha->block, 1);
 	if (remaining_blocks)
-		vb2_sha256_transform_hwcrypto(shifted_data, remaining_blocks);
+		vb2_sha256_transform_hwcrypto(sha->h, shifted_data, remaining_blocks);
 
 	rem_size = new_size % VB2_SHA256_BLOCK_SIZE;
 
-	memcpy(vb2_sha_ctx.block,
+	memcpy(sha->block,
 	       &shifted_data[remaining_blocks * VB2_SHA256_BLOCK_SIZE],
 	       rem_size);
 
-	vb2_sha_ctx.size = rem_size;
-	vb2_sha_ctx.total_size += (remaining_blocks + 1) * VB2_SHA256_BLOCK_SIZE;
+	sha->size = rem_size;
+	sha->total_size += (remaining_blocks + 1) * VB2_SHA256_BLOCK_SIZE;
 	return VB2_SUCCESS;
 }
 
-vb2_error_t vb2ex_hwcrypto_digest_finalize(uint8_t *digest,
-					   uint32_t digest_size)
+vb2_error_t vb2ex_hwcrypto_digest_finalize_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	uint8_t *digest, uint32_t digest_size)
 {
+	struct vb2_sha256_context *sha = &hc->sha256;
 	unsigned int block_nb;
 	unsigned int pm_size;
 	unsigned int size_b;
@@ -82,21 +91,42 @@ vb2_error_t vb2ex_hwcrypto_digest_finalize(uint8_t *digest,
 	}
 
 	block_nb = (1 + ((VB2_SHA256_BLOCK_SIZE - SHA256_MIN_PAD_LEN)
-			 < (vb2_sha_ctx.size % VB2_SHA256_BLOCK_SIZE)));
+			 < (sha->size % VB2_SHA256_BLOCK_SIZE)));
 
-	size_b = (vb2_sha_ctx.total_size + vb2_sha_ctx.size) * 8;
+	size_b = (sha->total_size + sha->size) * 8;
 	pm_size = block_nb * VB2_SHA256_BLOCK_SIZE;
 
-	memset(vb2_sha_ctx.block + vb2_sha_ctx.size, 0,
-	       pm_size - vb2_sha_ctx.size);
-	vb2_sha_ctx.block[vb2_sha_ctx.size] = SHA256_PAD_BEGIN;
-	UNPACK32(size_b, vb2_sha_ctx.block + pm_size - 4);
+	memset(sha->block + sha->size, 0,
+	       pm_size - sha->size);
+	sha->block[sha->size] = SHA256_PAD_BEGIN;
+	UNPACK32(size_b, sha->block + pm_size - 4);
 
-	vb2_sha256_transform_hwcrypto(vb2_sha_ctx.block, block_nb);
+	vb2_sha256_transform_hwcrypto(sha->h, sha->block, block_nb);
 
 	for (i = 0; i < ARRAY_SIZE(vb2_hash_seq); i++) {
-		VB2_ASSERT(vb2_hash_seq[i] < ARRAY_SIZE(vb2_sha_ctx.h));
-		UNPACK32(vb2_sha_ctx.h[vb2_hash_seq[i]], &digest[i * 4]);
+		VB2_ASSERT(vb2_hash_seq[i] < ARRAY_SIZE(sha->h));
+		UNPACK32(sha->h[vb2_hash_seq[i]], &digest[i * 4]);
 	}
 	return VB2_SUCCESS;
 }
+
+static struct vb2_hwcrypto_digest_context vb2_hwcrypto_ctx;
+
+vb2_error_t vb2ex_hwcrypto_digest_init(enum vb2_hash_algorithm hash_alg,
+				       uint32_t data_size)
+{
+	return vb2ex_hwcrypto_digest_init_ctx(&vb2_hwcrypto_ctx, hash_alg,
+					      data_size);
+}
+
+vb2_error_t vb2ex_hwcrypto_digest_extend(const uint8_t *buf, uint32_t size)
+{
+	return vb2ex_hwcrypto_digest_extend_ctx(&vb2_hwcrypto_ctx, buf, size);
+}
+
+vb2_error_t vb2ex_hwcrypto_digest_finalize(uint8_t *digest,
+					   uint32_t digest_size)
+{
+	return vb2ex_hwcrypto_digest_finalize_ctx(&vb2_hwcrypto_ctx, digest,
+						  digest_size);
+}
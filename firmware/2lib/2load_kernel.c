@@ -19,11 +19,12 @@
 #include "vboot_api.h"
 
 enum vb2_load_partition_flags {
-	VB2_LOAD_PARTITION_FLAG_VBLOCK_ONLY = (1 << 0),
 	VB2_LOAD_PARTITION_FLAG_MINIOS = (1 << 1),
 };
 
-#define KBUF_SIZE 65536  /* Bytes to read at start of kernel partition */
+#define KBUF_SIZE 65536  /* Maximum size of a kernel vblock */
+#define BODY_CHUNK_SIZE (256 * 1024)  /* Bytes of kernel body per read */
+#define VBLOCK_SCAN_BATCH 8  /* Partitions read at once in rollback scan */
 
 /* Minimum context work buffer size needed for vb2_load_partition() */
 #define VB2_LOAD_PARTITION_WORKBUF_BYTES	\
@@ -336,57 +337,140 @@ static vb2_error_t vb2_verify_kernel_vblock(
 	return VB2_SUCCESS;
 }
 
+/**
+ * Round a byte count up to a whole number of sectors.
+ *
+ * @param bytes		Byte count
+ * @param sector_bytes	Size of a disk sector in bytes
+ * @return The rounded-up byte count.
+ */
+static uint32_t round_up_to_sector(uint32_t bytes, uint32_t sector_bytes)
+{
+	return (bytes + sector_bytes - 1) / sector_bytes * sector_bytes;
+}
+
+/**
+ * Work out how much of a vblock is needed, given the start of it.
+ *
+ * @param kbuf		Buffer containing the start of the vblock
+ * @param have		Number of bytes in the buffer
+ * @return The number of bytes needed to see the next header, or the whole
+ *         vblock; no more than |have| once nothing more can be learned.
+ */
+static uint32_t vblock_bytes_wanted(uint8_t *kbuf, uint32_t have)
+{
+	if (have < sizeof(struct vb2_keyblock))
+		return sizeof(struct vb2_keyblock);
+
+	uint32_t keyblock_size = get_keyblock(kbuf)->keyblock_size;
+	if (keyblock_size > KBUF_SIZE)
+		return have;
+	if (have < keyblock_size + sizeof(struct vb2_kernel_preamble))
+		return keyblock_size + sizeof(struct vb2_kernel_preamble);
+
+	/* Neither size is verified yet, so don't let the sum wrap */
+	uint64_t body_offset = (uint64_t)keyblock_size +
+		get_preamble(kbuf)->preamble_size;
+	return VB2_MIN(body_offset, (uint64_t)KBUF_SIZE);
+}
+
+/**
+ * Read the kernel vblock from the start of the stream.
+ *
+ * Only the whole sectors covering the keyblock and the preamble are read,
+ * following the sizes in their headers.  Those sizes are not verified yet, so
+ * at most KBUF_SIZE bytes (rounded up to a whole sector) are ever read; a
+ * vblock claiming to be larger is left for vb2_verify_kernel_vblock() to
+ * reject.
+ *
+ * @param stream	Stream to read from
+ * @param sector_bytes	Size of a disk sector in bytes
+ * @param head		Data already read from the start of the stream, or
+ *			NULL if none
+ * @param head_size	Size of |head| in bytes; a multiple of |sector_bytes|
+ * @param kbuf_ptr	Destination for the vblock buffer, allocated from |wb|
+ * @param kbuf_size_ptr	Destination for the number of bytes in it
+ * @param wb		Work buffer
+ * @return VB2_SUCCESS, or non-zero error code.
+ */
+static vb2_error_t vb2_read_kernel_vblock(VbExStream_t stream,
+					  uint32_t sector_bytes,
+					  const uint8_t *head,
+					  uint32_t head_size,
+					  uint8_t **kbuf_ptr,
+					  uint32_t *kbuf_size_ptr,
+					  struct vb2_workbuf *wb)
+{
+	const uint32_t max_size = round_up_to_sector(KBUF_SIZE, sector_bytes);
+	uint32_t have = 0;
+	uint8_t *kbuf = NULL;
+
+	if (head_size) {
+		kbuf = vb2_workbuf_alloc(wb, head_size);
+		if (!kbuf)
+			return VB2_ERROR_LOAD_PARTITION_WORKBUF;
+		memcpy(kbuf, head, head_size);
+		have = head_size;
+	}
+
+	while (have < max_size) {
+		uint32_t want = vblock_bytes_wanted(kbuf, have);
+		if (want <= have)
+			break;
+
+		uint32_t size = VB2_MIN(round_up_to_sector(want, sector_bytes),
+					max_size);
+		if (size <= have)
+			break;
+		kbuf = vb2_workbuf_realloc(wb, have, size);
+		if (!kbuf)
+			return VB2_ERROR_LOAD_PARTITION_WORKBUF;
+
+		if (VbExStreamRead(stream, size - have, kbuf + have)) {
+			VB2_DEBUG("Unable to read start of partition.\n");
+			return VB2_ERROR_LOAD_PARTITION_READ_VBLOCK;
+		}
+		have = size;
+	}
+
+	*kbuf_ptr = kbuf;
+	*kbuf_size_ptr = have;
+	return VB2_SUCCESS;
+}
+
 /**
  * Load and verify a partition from the stream.
  *
  * @param ctx		Vboot context
  * @param params	Load-kernel parameters
  * @param stream	Stream to load kernel from
+ * @param sector_bytes	Size of a disk sector in bytes
  * @param lpflags	Flags (one or more of vb2_load_partition_flags)
  * @return VB2_SUCCESS, or non-zero error code.
  */
 static vb2_error_t vb2_load_partition(
 	struct vb2_context *ctx, struct vb2_kernel_params *params,
-	VbExStream_t stream, uint32_t lpflags)
+	VbExStream_t stream, uint32_t sector_bytes, uint32_t lpflags)
 {
 	uint32_t read_ms = 0, start_ts;
 	struct vb2_workbuf wb;
 
 	vb2_workbuf_from_ctx(ctx, &wb);
 
-	/* Allocate kernel header buffer in workbuf */
-	uint8_t *kbuf = vb2_workbuf_alloc(&wb, KBUF_SIZE);
-	if (!kbuf)
-		return VB2_ERROR_LOAD_PARTITION_WORKBUF;
-
+	/* Read just the vblock into the workbuf */
+	uint8_t *kbuf;
+	uint32_t kbuf_size;
 	start_ts = vb2ex_mtime();
-	if (VbExStreamRead(stream, KBUF_SIZE, kbuf)) {
-		VB2_DEBUG("Unable to read start of partition.\n");
-		return VB2_ERROR_LOAD_PARTITION_READ_VBLOCK;
-	}
+	VB2_TRY(vb2_read_kernel_vblock(stream, sector_bytes, NULL, 0,
+				       &kbuf, &kbuf_size, &wb));
 	read_ms += vb2ex_mtime() - start_ts;
 
-	if (vb2_verify_kernel_vblock(ctx, kbuf, KBUF_SIZE, lpflags, &wb))
+	if (vb2_verify_kernel_vblock(ctx, kbuf, kbuf_size, lpflags, &wb))
 		return VB2_ERROR_LOAD_PARTITION_VERIFY_VBLOCK;
 
-	if (lpflags & VB2_LOAD_PARTITION_FLAG_VBLOCK_ONLY)
-		return VB2_SUCCESS;
-
 	struct vb2_keyblock *keyblock = get_keyblock(kbuf);
 	struct vb2_kernel_preamble *preamble = get_preamble(kbuf);
-
-	/*
-	 * Make sure the kernel starts at or before what we already read into
-	 * kbuf.
-	 *
-	 * We could deal with a larger offset by reading and discarding the
-	 * data in between the vblock and the kernel data.
-	 */
 	uint32_t body_offset = get_body_offset(kbuf);
-	if (body_offset > KBUF_SIZE) {
-		VB2_DEBUG("Kernel body offset is %u > 64KB.\n", body_offset);
-		return VB2_ERROR_LOAD_PARTITION_BODY_OFFSET;
-	}
 
 	uint8_t *kernbuf = params->kernel_buffer;
 	uint32_t kernbuf_size = params->kernel_buffer_size;
@@ -399,46 +483,110 @@ static vb2_error_t vb2_load_partition(
 		return 	VB2_ERROR_LOAD_PARTITION_BODY_SIZE;
 	}
 
-	uint32_t body_toread = preamble->body_signature.data_size;
+	/* Get key for data verification from the keyblock. */
+	struct vb2_public_key data_key;
+	if (vb2_unpack_key(&data_key, &keyblock->data_key)) {
+		VB2_DEBUG("Unable to unpack kernel data key\n");
+		return VB2_ERROR_LOAD_PARTITION_DATA_KEY;
+	}
+
+	data_key.allow_hwcrypto = vb2api_hwcrypto_allowed(ctx);
+
+	uint32_t body_size = preamble->body_signature.data_size;
+	uint32_t body_toread = body_size;
 	uint8_t *body_readptr = kernbuf;
+	struct vb2_digest_context dc;
+
+	if (vb2_digest_init(&dc, data_key.allow_hwcrypto, data_key.hash_alg,
+			    body_size)) {
+		VB2_DEBUG("Unable to initialize kernel data digest.\n");
+		return VB2_ERROR_LOAD_PARTITION_VERIFY_BODY;
+	}
 
 	/*
-	 * If we've already read part of the kernel, copy that to the beginning
-	 * of the kernel buffer.
+	 * The vblock read normally stops exactly where the body starts, so
+	 * the body is read straight into the kernel buffer.  If the body
+	 * starts partway into the last sector of the vblock, copy the part we
+	 * already have; if it starts further on, skip ahead to it by reading
+	 * the gap into the kernel buffer, which the body then overwrites.
+	 */
+	uint32_t body_copied = 0;
+	if (body_offset < kbuf_size) {
+		body_copied = VB2_MIN(kbuf_size - body_offset, body_toread);
+		memcpy(body_readptr, kbuf + body_offset, body_copied);
+		body_toread -= body_copied;
+		body_readptr += body_copied;
+	}
+
+	uint32_t skip = body_offset > kbuf_size ? body_offset - kbuf_size : 0;
+	uint32_t skip_chunk = kernbuf_size / sector_bytes * sector_bytes;
+	if (skip)
+		VB2_DEBUG("Skipping %u bytes to kernel body.\n", skip);
+	while (skip) {
+		uint32_t chunk = VB2_MIN(skip, skip_chunk);
+
+		if (!chunk) {
+			VB2_DEBUG("Kernel body offset %u out of reach.\n",
+				  body_offset);
+			return VB2_ERROR_LOAD_PARTITION_BODY_OFFSET;
+		}
+		if (VbExStreamRead(stream, chunk, kernbuf)) {
+			VB2_DEBUG("Unable to skip to kernel data.\n");
+			return VB2_ERROR_LOAD_PARTITION_READ_BODY;
+		}
+		skip -= chunk;
+	}
+
+	/*
+	 * Read the rest of the kernel data, hashing each chunk as soon as it
+	 * lands so that it is still in cache, rather than making a second pass
+	 * over the whole body once it has been read.  The next chunk is
+	 * already being read while the current one is hashed.
 	 */
-	uint32_t body_copied = KBUF_SIZE - body_offset;
-	if (body_copied > body_toread)
-		body_copied = body_toread;  /* Don't over-copy tiny kernel */
-	memcpy(body_readptr, kbuf + body_offset, body_copied);
-	body_toread -= body_copied;
-	body_readptr += body_copied;
-
-	/* Read the kernel data */
 	start_ts = vb2ex_mtime();
-	if (body_toread && VbExStreamRead(stream, body_toread, body_readptr)) {
+	VbExStreamToken_t token;
+	uint32_t chunk = VB2_MIN(body_toread, BODY_CHUNK_SIZE);
+	if (chunk && VbExStreamReadSubmit(stream, chunk, body_readptr,
+					  &token)) {
 		VB2_DEBUG("Unable to read kernel data.\n");
 		return VB2_ERROR_LOAD_PARTITION_READ_BODY;
 	}
+	if (vb2_digest_extend(&dc, kernbuf, body_copied))
+		return VB2_ERROR_LOAD_PARTITION_VERIFY_BODY;
+	while (chunk) {
+		if (VbExStreamReadWait(stream, token)) {
+			VB2_DEBUG("Unable to read kernel data.\n");
+			return VB2_ERROR_LOAD_PARTITION_READ_BODY;
+		}
+
+		uint8_t *chunk_ptr = body_readptr;
+		uint32_t chunk_size = chunk;
+		body_toread -= chunk;
+		body_readptr += chunk;
+
+		chunk = VB2_MIN(body_toread, BODY_CHUNK_SIZE);
+		if (chunk && VbExStreamReadSubmit(stream, chunk, body_readptr,
+						  &token)) {
+			VB2_DEBUG("Unable to read kernel data.\n");
+			return VB2_ERROR_LOAD_PARTITION_READ_BODY;
+		}
+
+		if (vb2_digest_extend(&dc, chunk_ptr, chunk_size))
+			return VB2_ERROR_LOAD_PARTITION_VERIFY_BODY;
+	}
 	read_ms += vb2ex_mtime() - start_ts;
 	if (read_ms == 0)  /* Avoid division by 0 in speed calculation */
 		read_ms = 1;
-	VB2_DEBUG("read %u KB in %u ms at %u KB/s.\n",
-		  (body_toread + KBUF_SIZE) / 1024, read_ms,
-		  (uint32_t)(((body_toread + KBUF_SIZE) * VB2_MSEC_PER_SEC) /
+	VB2_DEBUG("read and hashed %u KB in %u ms at %u KB/s.\n",
+		  (body_size + body_offset) / 1024, read_ms,
+		  (uint32_t)(((body_size + body_offset) * VB2_MSEC_PER_SEC) /
 			     (read_ms * 1024)));
 
-	/* Get key for preamble/data verification from the keyblock. */
-	struct vb2_public_key data_key;
-	if (vb2_unpack_key(&data_key, &keyblock->data_key)) {
-		VB2_DEBUG("Unable to unpack kernel data key\n");
-		return VB2_ERROR_LOAD_PARTITION_DATA_KEY;
-	}
-
-	data_key.allow_hwcrypto = vb2api_hwcrypto_allowed(ctx);
-
 	/* Verify kernel data */
-	if (vb2_verify_data(kernbuf, kernbuf_size, &preamble->body_signature,
-			    &data_key, &wb)) {
+	struct vb2_hash hash;
+	if (vb2_digest_finalize(&dc, hash.raw, vb2_digest_size(dc.hash_alg)) ||
+	    vb2_verify_digest(&data_key, &preamble->body_signature, hash.raw,
+			      &wb)) {
 		VB2_DEBUG("Kernel data verification failed.\n");
 		return VB2_ERROR_LOAD_PARTITION_VERIFY_BODY;
 	}
@@ -459,6 +607,165 @@ static vb2_error_t vb2_load_partition(
 	return VB2_SUCCESS;
 }
 
+/* A kernel partition being checked by vb2_scan_kernel_vblocks() */
+struct vblock_scan_entry {
+	/* Index of the partition's GPT entry */
+	int gpt_index;
+
+	/* Stream the vblock is read from, and its first-sector read */
+	VbExStream_t stream;
+	VbExStreamToken_t token;
+
+	/* Result of checking the vblock so far */
+	vb2_error_t rv;
+};
+
+/**
+ * Read and verify the rest of a kernel vblock whose first sector was read.
+ *
+ * @param ctx		Vboot context
+ * @param stream	Stream to continue reading from
+ * @param sector_bytes	Size of a disk sector in bytes
+ * @param head		First sector of the partition
+ * @param wb		Work buffer
+ * @return VB2_SUCCESS, or non-zero error code.
+ */
+static vb2_error_t vb2_check_kernel_vblock(struct vb2_context *ctx,
+					   VbExStream_t stream,
+					   uint32_t sector_bytes,
+					   const uint8_t *head,
+					   const struct vb2_workbuf *wb)
+{
+	struct vb2_workbuf wblocal = *wb;
+	uint8_t *kbuf;
+	uint32_t kbuf_size;
+
+	VB2_TRY(vb2_read_kernel_vblock(stream, sector_bytes, head,
+				       sector_bytes, &kbuf, &kbuf_size,
+				       &wblocal));
+
+	if (vb2_verify_kernel_vblock(ctx, kbuf, kbuf_size, 0, &wblocal))
+		return VB2_ERROR_LOAD_PARTITION_VERIFY_VBLOCK;
+
+	return VB2_SUCCESS;
+}
+
+/**
+ * Check the vblocks of the remaining kernel partitions for rollback.
+ *
+ * Once a good kernel has been found, the other kernel partitions only need
+ * their vblocks checked to find the lowest kernel version on the disk.  On
+ * disks with VB2_DISK_FLAG_CONCURRENT_STREAMS, the first sectors of up to
+ * VBLOCK_SCAN_BATCH partitions are requested together so that per-command
+ * latency overlaps; otherwise only one stream is open at a time.  Each vblock
+ * is then completed and verified in GPT order.  Partitions which fail are
+ * marked bad.
+ *
+ * @param ctx		Vboot context
+ * @param gpt		GPT data, positioned at the good kernel
+ * @param disk_info	Disk the partitions are on
+ * @param lowest_version	Lowest kernel version seen in a validly
+ *				signed vblock; updated by this function
+ * @return The number of kernel partitions looked at.
+ */
+static int vb2_scan_kernel_vblocks(struct vb2_context *ctx, GptData *gpt,
+				   struct vb2_disk_info *disk_info,
+				   uint32_t *lowest_version)
+{
+	struct vb2_shared_data *sd = vb2_get_sd(ctx);
+	const uint32_t sector_bytes = disk_info->bytes_per_lba;
+	struct vblock_scan_entry batch[VBLOCK_SCAN_BATCH];
+	struct vblock_scan_entry *e;
+	uint64_t part_start, part_size;
+	int found_partitions = 0;
+	int more = 1;
+	int batch_size = 1;
+
+	if (disk_info->flags & VB2_DISK_FLAG_CONCURRENT_STREAMS)
+		batch_size = VBLOCK_SCAN_BATCH;
+
+	while (more) {
+		struct vb2_workbuf wb;
+		int count = 0;
+		int i;
+
+		vb2_workbuf_from_ctx(ctx, &wb);
+		uint8_t *heads = vb2_workbuf_alloc(&wb, batch_size *
+						   sector_bytes);
+
+		/* Start reading the first sector of the next few partitions */
+		while (count < batch_size) {
+			if (GptNextKernelEntry(gpt, &part_start, &part_size) !=
+			    GPT_SUCCESS) {
+				more = 0;
+				break;
+			}
+
+			VB2_DEBUG("Found kernel entry at %"
+				  PRIu64 " size %" PRIu64 "\n",
+				  part_start, part_size);
+			found_partitions++;
+
+			e = &batch[count];
+			e->gpt_index = gpt->current_kernel;
+			e->stream = NULL;
+			if (!heads) {
+				e->rv = VB2_ERROR_LOAD_PARTITION_WORKBUF;
+			} else if (VbExStreamOpen(disk_info->handle, part_start,
+						  part_size, &e->stream)) {
+				VB2_DEBUG("Partition error getting stream.\n");
+				e->stream = NULL;
+				e->rv = VB2_ERROR_LOAD_PARTITION_READ_VBLOCK;
+			} else {
+				e->rv = VbExStreamReadSubmit(
+					e->stream, sector_bytes,
+					heads + count * sector_bytes,
+					&e->token);
+				if (e->rv)
+					e->rv =
+					    VB2_ERROR_LOAD_PARTITION_READ_VBLOCK;
+			}
+			count++;
+		}
+
+		/* Finish and verify each vblock, in GPT order */
+		for (i = 0; i < count; i++) {
+			e = &batch[i];
+			if (!e->rv && VbExStreamReadWait(e->stream, e->token))
+				e->rv = VB2_ERROR_LOAD_PARTITION_READ_VBLOCK;
+			if (!e->rv)
+				e->rv = vb2_check_kernel_vblock(
+					ctx, e->stream, sector_bytes,
+					heads + i * sector_bytes, &wb);
+			if (e->stream)
+				VbExStreamClose(e->stream);
+
+			if (e->rv) {
+				int current_kernel = gpt->current_kernel;
+
+				VB2_DEBUG("Marking kernel as invalid "
+					  "(err=%x).\n", e->rv);
+				gpt->current_kernel = e->gpt_index;
+				GptUpdateKernelEntry(gpt, GPT_UPDATE_ENTRY_BAD);
+				gpt->current_kernel = current_kernel;
+				continue;
+			}
+
+			int keyblock_valid = sd->flags &
+					     VB2_SD_FLAG_KERNEL_SIGNED;
+			/* Track lowest version from a valid header. */
+			if (keyblock_valid &&
+			    *lowest_version > sd->kernel_version)
+				*lowest_version = sd->kernel_version;
+			VB2_DEBUG("Keyblock valid: %d\n", keyblock_valid);
+			VB2_DEBUG("Combined version: %u\n",
+				  sd->kernel_version);
+		}
+	}
+
+	return found_partitions;
+}
+
 static vb2_error_t try_minios_kernel(struct vb2_context *ctx,
 				     struct vb2_kernel_params *params,
 				     struct vb2_disk_info *disk_info,
@@ -475,7 +782,8 @@ static vb2_error_t try_minios_kernel(struct vb2_context *ctx,
 		return rv;
 	}
 
-	rv = vb2_load_partition(ctx, params, stream, lpflags);
+	rv = vb2_load_partition(ctx, params, stream,
+				disk_info->bytes_per_lba, lpflags);
 	VB2_DEBUG("vb2_load_partition returned: %d\n", rv);
 
 	VbExStreamClose(stream);
@@ -652,16 +960,8 @@ vb2_error_t vb2api_load_kernel(struct vb2_context *ctx,
 			continue;
 		}
 
-		uint32_t lpflags = 0;
-		if (params->partition_number > 0) {
-			/*
-			 * If we already have a good kernel, we only needed to
-			 * look at the vblock versions to check for rollback.
-			 */
-			lpflags |= VB2_LOAD_PARTITION_FLAG_VBLOCK_ONLY;
-		}
-
-		rv = vb2_load_partition(ctx, params, stream, lpflags);
+		rv = vb2_load_partition(ctx, params, stream,
+					disk_info->bytes_per_lba, 0);
 		VbExStreamClose(stream);
 
 		if (rv) {
@@ -678,13 +978,6 @@ vb2_error_t vb2api_load_kernel(struct vb2_context *ctx,
 		VB2_DEBUG("Keyblock valid: %d\n", keyblock_valid);
 		VB2_DEBUG("Combined version: %u\n", sd->kernel_version);
 
-		/*
-		 * If we're only looking at headers, we're done with this
-		 * partition.
-		 */
-		if (lpflags & VB2_LOAD_PARTITION_FLAG_VBLOCK_ONLY)
-			continue;
-
 		/*
 		 * Otherwise, we found a partition we like.
 		 *
@@ -729,6 +1022,15 @@ vb2_error_t vb2api_load_kernel(struct vb2_context *ctx,
 			VB2_DEBUG("Same kernel version\n");
 			break;
 		}
+
+		/*
+		 * We only need to look at the vblock versions of the rest of
+		 * the kernels to check for rollback.
+		 */
+		found_partitions += vb2_scan_kernel_vblocks(ctx, &gpt,
+							    disk_info,
+							    &lowest_version);
+		break;
 	} /* while(GptNextKernelEntry) */
 
  gpt_done:
@@ -10,6 +10,10 @@
 #include "2rsa.h"
 #include "2sysincludes.h"
 
+#ifdef CHROMEOS_ENVIRONMENT
+bool vb2_host_keys_allow_hwcrypto;
+#endif
+
 test_mockable
 vb2_error_t vb2_unpack_key_buffer(struct vb2_public_key *key,
 				  const uint8_t *buf, uint32_t size)
@@ -58,7 +62,11 @@ vb2_error_t vb2_unpack_key_buffer(struct vb2_public_key *key,
 	key->rr = buf32 + 2 + key->arrsize;
 
 	/* disable hwcrypto for RSA by default */
+#ifdef CHROMEOS_ENVIRONMENT
+	key->allow_hwcrypto = vb2_host_keys_allow_hwcrypto;
+#else
 	key->allow_hwcrypto = 0;
+#endif
 
 #ifdef __COVERITY__
 	__coverity_tainted_data_sanitize__(key);
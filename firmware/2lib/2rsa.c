@@ -133,7 +133,7 @@ static void montMul1(const struct vb2_public_key *key,
  *			(3 * key->arrsize) elements long.
  * @param exp		RSA public exponent: either 65537 (F4) or 3
  */
-static void modpow(const struct vb2_public_key *key, uint8_t *inout,
+void vb2_modpow(const struct vb2_public_key *key, uint8_t *inout,
 		uint32_t *workbuf32, int exp)
 {
 	uint32_t *a = workbuf32;
@@ -381,7 +381,10 @@ vb2_error_t vb2_rsa_verify_digest(const struct vb2_public_key *key,
 	}
 
 	if (rv != VB2_SUCCESS) {
-		modpow(key, sig, workbuf32, exp);
+#ifdef RSA_MONT64
+		if (!vb2_modpow_accel(key, sig, workbuf32, exp))
+#endif
+		vb2_modpow(key, sig, workbuf32, exp);
 	}
 
 	vb2_workbuf_free(&wblocal, 3 * key_bytes);
@@ -0,0 +1,358 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * RSA public exponentiation on 64-bit limbs, for 64-bit host builds.
+ *
+ * The key's n[] and rr[] are arrays of little-endian 32-bit words, so on a
+ * little-endian machine each pair of words already is a 64-bit limb, and
+ * R = 2^(32 * arrsize) is the same for either limb size.  Only n0inv has to
+ * be extended to 64 bits.  Halving the number of limbs quarters the number
+ * of multiplications in each Montgomery product.
+ *
+ * The portable code uses unsigned __int128, which compiles to MUL/UMULH on
+ * AArch64.  On x86-64 CPUs with BMI2 and ADX, the inner loops instead use
+ * MULX with two independent carry chains (ADCX/ADOX), so adding the low and
+ * high halves of each product doesn't serialize on one carry flag.
+ */
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "2common.h"
+#include "2rsa.h"
+#include "2rsa_private.h"
+#include "2sysincludes.h"
+
+/* The key arrays are only guaranteed to be 32-bit aligned */
+typedef uint64_t limb_t __attribute__ ((may_alias, aligned(4)));
+typedef unsigned __int128 dlimb_t;
+
+struct mont64 {
+	const limb_t *n;
+	uint64_t n0inv;		/* -1 / n[0] mod 2^64 */
+	uint32_t len;		/* Number of 64-bit limbs */
+	int adx;		/* Use the MULX/ADX inner loops */
+};
+
+/**
+ * a[] -= mod
+ */
+static void subM64(const struct mont64 *m, limb_t *a)
+{
+	uint64_t borrow = 0;
+	uint32_t i;
+
+	for (i = 0; i < m->len; i++) {
+		dlimb_t A = (dlimb_t)a[i] - m->n[i] - borrow;
+		a[i] = (uint64_t)A;
+		borrow = (uint64_t)(A >> 64) & 1;
+	}
+}
+
+/**
+ * Return a[] >= mod
+ */
+static int mont64_ge(const struct mont64 *m, const limb_t *a)
+{
+	uint32_t i;
+
+	for (i = m->len; i;) {
+		--i;
+		if (a[i] < m->n[i])
+			return 0;
+		if (a[i] > m->n[i])
+			return 1;
+	}
+	return 1;  /* equal */
+}
+
+#if defined(__x86_64__)
+
+/**
+ * dst[i] = src[i] + x * v[i] + carries, for i = -count .. -1
+ *
+ * The pointers point one past the end of their arrays.  'hi' is added in at
+ * the first limb.  dst may be src, or src - 1 limb to shift as it goes.
+ *
+ * @return The final carry limb.
+ */
+static inline uint64_t mulx_row(limb_t *dst_end, const limb_t *src_end,
+				const limb_t *v_end, uint64_t x, uint64_t hi,
+				uint32_t count)
+{
+	int64_t i = -(int64_t)count;
+	uint64_t lo, nhi;
+
+	/* LEA and JRCXZ leave CF and OF alone for the two carry chains */
+	asm ("xor %k[lo], %k[lo]\n\t"
+	     "1:\n\t"
+	     "mulx (%[v],%[i],8), %[lo], %[nhi]\n\t"
+	     "adcx (%[s],%[i],8), %[lo]\n\t"
+	     "adox %[hi], %[lo]\n\t"
+	     "mov %[lo], (%[d],%[i],8)\n\t"
+	     "mov %[nhi], %[hi]\n\t"
+	     "lea 1(%[i]), %[i]\n\t"
+	     "jrcxz 2f\n\t"
+	     "jmp 1b\n"
+	     "2:\n\t"
+	     "mov $0, %k[lo]\n\t"
+	     "adcx %[lo], %[hi]\n\t"
+	     "adox %[lo], %[hi]"
+	     : [hi] "+&r"(hi), [i] "+&c"(i), [lo] "=&r"(lo), [nhi] "=&r"(nhi)
+	     : [d] "r"(dst_end), [s] "r"(src_end), [v] "r"(v_end), "d"(x)
+	     : "cc", "memory");
+	return hi;
+}
+
+/**
+ * c[] = (c[] + d0 * mod) / 2^64, for d0 = c[0] * n0inv
+ *
+ * @return The top limb of c[] before adding 'hi', with 'hi' added in;
+ *	   *overflow is set if that addition carries out.
+ */
+static uint64_t mont64_reduce_adx(const struct mont64 *m, limb_t *c,
+				  uint64_t hi, int *overflow)
+{
+	uint64_t d0 = c[0] * m->n0inv;
+	/* The low limb of this is zero by the choice of d0 */
+	dlimb_t B = (dlimb_t)d0 * m->n[0] + c[0];
+	uint64_t top;
+
+	top = mulx_row(c + m->len - 1, c + m->len, m->n + m->len, d0,
+		       (uint64_t)(B >> 64), m->len - 1);
+	top += hi;
+	*overflow = top < hi;
+	return top;
+}
+
+/**
+ * Montgomery c[] += a * b[] / R % mod, using MULX/ADX
+ */
+static void montMulAdd64_adx(const struct mont64 *m, limb_t *c,
+			     const uint64_t a, const limb_t *b)
+{
+	uint64_t hi = mulx_row(c + m->len, c + m->len, b + m->len, a, 0,
+			       m->len);
+	int overflow;
+
+	c[m->len - 1] = mont64_reduce_adx(m, c, hi, &overflow);
+	if (overflow)
+		subM64(m, c);
+}
+
+static int cpu_has_adx(void)
+{
+	/* Probing twice from racing threads is harmless */
+	static int probed, has_adx;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!probed) {
+		if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+			has_adx = (ebx & bit_BMI2) && (ebx & bit_ADX);
+		probed = 1;
+	}
+	return has_adx;
+}
+
+#else
+
+static int cpu_has_adx(void)
+{
+	return 0;
+}
+
+#endif
+
+/**
+ * Montgomery c[] += a * b[] / R % mod
+ */
+static void montMulAdd64(const struct mont64 *m, limb_t *c,
+			 const uint64_t a, const limb_t *b)
+{
+	dlimb_t A;
+	dlimb_t B;
+	uint64_t d0;
+	uint32_t i;
+
+#if defined(__x86_64__)
+	if (m->adx) {
+		montMulAdd64_adx(m, c, a, b);
+		return;
+	}
+#endif
+
+	A = (dlimb_t)a * b[0] + c[0];
+	d0 = (uint64_t)A * m->n0inv;
+	B = (dlimb_t)d0 * m->n[0] + (uint64_t)A;
+
+	for (i = 1; i < m->len; ++i) {
+		A = (A >> 64) + (dlimb_t)a * b[i] + c[i];
+		B = (B >> 64) + (dlimb_t)d0 * m->n[i] + (uint64_t)A;
+		c[i - 1] = (uint64_t)B;
+	}
+
+	A = (A >> 64) + (B >> 64);
+
+	c[i - 1] = (uint64_t)A;
+
+	if (A >> 64)
+		subM64(m, c);
+}
+
+/**
+ * Montgomery c[] += 0 * b[] / R % mod
+ */
+static void montMulAdd064(const struct mont64 *m, limb_t *c)
+{
+	dlimb_t B;
+	uint64_t d0;
+	uint32_t i;
+
+#if defined(__x86_64__)
+	if (m->adx) {
+		int overflow;
+
+		c[m->len - 1] = mont64_reduce_adx(m, c, 0, &overflow);
+		return;
+	}
+#endif
+
+	d0 = c[0] * m->n0inv;
+	B = (dlimb_t)d0 * m->n[0] + c[0];
+
+	for (i = 1; i < m->len; ++i) {
+		B = (B >> 64) + (dlimb_t)d0 * m->n[i] + c[i];
+		c[i - 1] = (uint64_t)B;
+	}
+
+	c[i - 1] = (uint64_t)(B >> 64);
+}
+
+/**
+ * Montgomery c[] = a[] * b[] / R % mod
+ */
+static void montMul64(const struct mont64 *m, limb_t *c, const limb_t *a,
+		      const limb_t *b)
+{
+	uint32_t i;
+
+	for (i = 0; i < m->len; ++i)
+		c[i] = 0;
+	for (i = 0; i < m->len; ++i)
+		montMulAdd64(m, c, a[i], b);
+}
+
+/* Montgomery c[] = a[] * 1 / R % key. */
+static void montMul164(const struct mont64 *m, limb_t *c, const limb_t *a)
+{
+	uint32_t i;
+
+	for (i = 0; i < m->len; ++i)
+		c[i] = 0;
+
+	montMulAdd64(m, c, 1, a);
+	for (i = 1; i < m->len; ++i)
+		montMulAdd064(m, c);
+}
+
+static inline uint64_t load_be64(const uint8_t *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return __builtin_bswap64(v);
+}
+
+static inline void store_be64(uint8_t *p, uint64_t v)
+{
+	v = __builtin_bswap64(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+int vb2_mont64_supported(enum vb2_mont64_impl impl)
+{
+	switch (impl) {
+	case VB2_MONT64_C:
+		return 1;
+	case VB2_MONT64_ADX:
+		return cpu_has_adx();
+	default:
+		return 0;
+	}
+}
+
+int vb2_modpow64(const struct vb2_public_key *key, uint8_t *inout,
+		 uint32_t *workbuf32, int exp, enum vb2_mont64_impl impl)
+{
+	struct mont64 m;
+	limb_t *a = (limb_t *)workbuf32;
+	limb_t *aR;
+	limb_t *aaR;
+	limb_t *aaa;
+	const limb_t *rr = (const limb_t *)key->rr;
+	uint64_t inv;
+	int i;
+
+	/* 32-bit word pairs are only 64-bit limbs on little-endian machines */
+	if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__ || key->arrsize % 2 ||
+	    key->arrsize < 4 || !vb2_mont64_supported(impl))
+		return 0;
+
+	m.n = (const limb_t *)key->n;
+	m.len = key->arrsize / 2;
+	m.adx = impl == VB2_MONT64_ADX;
+
+	/*
+	 * -n0inv is 1 / n[0] mod 2^32.  One Newton step doubles the bits
+	 * that are correct, giving 1 / n[0] mod 2^64.
+	 */
+	inv = (uint32_t)-key->n0inv;
+	inv *= 2 - m.n[0] * inv;
+	m.n0inv = -inv;
+
+	aR = a + m.len;
+	aaR = aR + m.len;
+	aaa = aaR;  /* Re-use location. */
+
+	/* Convert from big endian byte array to little endian limb array. */
+	for (i = 0; i < (int)m.len; ++i)
+		a[i] = load_be64(inout + (m.len - 1 - i) * 8);
+
+	montMul64(&m, aR, a, rr);  /* aR = a * RR / R mod M   */
+	if (exp == 3) {
+		montMul64(&m, aaR, aR, aR); /* aaR = aR * aR / R mod M */
+		montMul64(&m, a, aaR, aR); /* a = aaR * aR / R mod M */
+		montMul164(&m, aaa, a); /* aaa = a * 1 / R mod M */
+	} else {
+		/* Exponent 65537 */
+		for (i = 0; i < 16; i += 2) {
+			montMul64(&m, aaR, aR, aR);  /* aaR = aR * aR / R mod M */
+			montMul64(&m, aR, aaR, aaR);  /* aR = aaR * aaR / R mod M */
+		}
+		montMul64(&m, aaa, aR, a);  /* aaa = aR * a / R mod M */
+	}
+
+	/* Make sure aaa < mod; aaa is at most 1x mod too large. */
+	if (mont64_ge(&m, aaa))
+		subM64(&m, aaa);
+
+	/* Convert to bigendian byte array */
+	for (i = (int)m.len - 1; i >= 0; --i, inout += 8)
+		store_be64(inout, aaa[i]);
+
+	return 1;
+}
+
+static enum vb2_mont64_impl best_impl;
+
+int vb2_modpow_accel(const struct vb2_public_key *key, uint8_t *inout,
+		     uint32_t *workbuf32, int exp)
+{
+	if (best_impl == VB2_MONT64_UNKNOWN)
+		best_impl = vb2_mont64_supported(VB2_MONT64_ADX) ?
+			VB2_MONT64_ADX : VB2_MONT64_C;
+
+	return vb2_modpow64(key, inout, workbuf32, exp, best_impl);
+}
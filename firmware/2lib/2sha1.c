@@ -8,6 +8,7 @@
 
 #include "2common.h"
 #include "2sha.h"
+#include "2sha_private.h"
 #include "2sysincludes.h"
 
 /*
@@ -43,6 +44,11 @@ static void sha1_transform(struct vb2_sha1_context *ctx)
 	register uint32_t A, B, C, D, E;
 	int t;
 
+#ifdef SHA_RUNTIME_DISPATCH
+	if (vb2_sha1_transform_accel(ctx->state, ctx->buf.b, 1))
+		return;
+#endif
+
 	A = ctx->state[0];
 	B = ctx->state[1];
 	C = ctx->state[2];
@@ -186,12 +192,11 @@ uint8_t *vb2_sha1_finalize(struct vb2_sha1_context *ctx)
 
 #define rol(bits, value) (((value) << (bits)) | ((value) >> (32 - (bits))))
 
-static void sha1_transform(struct vb2_sha1_context *ctx)
+static void sha1_transform(uint32_t *state, const uint8_t *p)
 {
 	/* Note that this array uses 80*4=320 bytes of stack */
 	uint32_t W[80];
 	uint32_t A, B, C, D, E;
-	uint8_t *p = ctx->buf;
 	int t;
 
 	for(t = 0; t < 16; ++t) {
@@ -206,11 +211,11 @@ static void sha1_transform(struct vb2_sha1_context *ctx)
 		W[t] = rol(1,W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
 	}
 
-	A = ctx->state[0];
-	B = ctx->state[1];
-	C = ctx->state[2];
-	D = ctx->state[3];
-	E = ctx->state[4];
+	A = state[0];
+	B = state[1];
+	C = state[2];
+	D = state[3];
+	E = state[4];
 
 	for(t = 0; t < 80; t++) {
 		uint32_t tmp = rol(5,A) + E + W[t];
@@ -231,29 +236,55 @@ static void sha1_transform(struct vb2_sha1_context *ctx)
 		A = tmp;
 	}
 
-	ctx->state[0] += A;
-	ctx->state[1] += B;
-	ctx->state[2] += C;
-	ctx->state[3] += D;
-	ctx->state[4] += E;
+	state[0] += A;
+	state[1] += B;
+	state[2] += C;
+	state[3] += D;
+	state[4] += E;
+}
+
+static void sha1_transform_blocks(uint32_t *state, const uint8_t *data,
+				  unsigned int block_nb)
+{
+	unsigned int i;
+
+#ifdef SHA_RUNTIME_DISPATCH
+	if (vb2_sha1_transform_accel(state, data, block_nb))
+		return;
+#endif
+
+	for (i = 0; i < block_nb; i++)
+		sha1_transform(state, data + i * VB2_SHA1_BLOCK_SIZE);
 }
 
 void vb2_sha1_update(struct vb2_sha1_context *ctx,
 		     const uint8_t *data,
 		     uint32_t size)
 {
-	int i = (int)(ctx->count % sizeof(ctx->buf));
-	const uint8_t* p = (const uint8_t*) data;
+	uint32_t i = ctx->count % sizeof(ctx->buf);
+	unsigned int block_nb;
 
 	ctx->count += size;
 
-	while (size--) {
-		ctx->buf[i++] = *p++;
-		if (i == sizeof(ctx->buf)) {
-			sha1_transform(ctx);
-			i = 0;
-		}
+	/* Top up a partial block first */
+	if (i) {
+		uint32_t fill = VB2_MIN(size, (uint32_t)sizeof(ctx->buf) - i);
+
+		memcpy(&ctx->buf[i], data, fill);
+		data += fill;
+		size -= fill;
+		if (i + fill < sizeof(ctx->buf))
+			return;
+		sha1_transform_blocks(ctx->state, ctx->buf, 1);
 	}
+
+	/* Hash whole blocks straight from the caller's buffer */
+	block_nb = size / VB2_SHA1_BLOCK_SIZE;
+	if (block_nb)
+		sha1_transform_blocks(ctx->state, data, block_nb);
+
+	memcpy(ctx->buf, data + block_nb * VB2_SHA1_BLOCK_SIZE,
+	       size % VB2_SHA1_BLOCK_SIZE);
 }
 
 void vb2_sha1_finalize(struct vb2_sha1_context *ctx, uint8_t *digest)
@@ -0,0 +1,63 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * SHA-1 transform using the ARMv8 SHA1 crypto extension.
+ */
+
+#include <arm_neon.h>
+
+#include "2common.h"
+#include "2sha.h"
+#include "2sha_private.h"
+
+static const uint32_t sha1_k[4] = {
+	0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6,
+};
+
+static inline uint32x4_t load_be32x4(const uint8_t *ptr)
+{
+	return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(ptr)));
+}
+
+void vb2_sha1_transform_armv8ce(uint32_t *state, const uint8_t *message,
+				unsigned int block_nb)
+{
+	uint32x4_t abcd = vld1q_u32(state);
+	uint32_t e = state[4];
+	uint32x4_t abcd_save, wk;
+	uint32x4_t w[20];
+	uint32_t e_save, e_next;
+	int i, j;
+
+	for (i = 0; i < (int)block_nb; i++, message += 64) {
+		abcd_save = abcd;
+		e_save = e;
+
+		/* w[j] holds W[4j..4j+3] */
+		for (j = 0; j < 4; j++)
+			w[j] = load_be32x4(message + j * 16);
+		for (j = 4; j < 20; j++)
+			w[j] = vsha1su1q_u32(
+				vsha1su0q_u32(w[j - 4], w[j - 3], w[j - 2]),
+				w[j - 1]);
+
+		for (j = 0; j < 20; j++) {
+			wk = vaddq_u32(w[j], vdupq_n_u32(sha1_k[j / 5]));
+			e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+			if (j < 5)
+				abcd = vsha1cq_u32(abcd, e, wk);
+			else if (j < 10 || j >= 15)
+				abcd = vsha1pq_u32(abcd, e, wk);
+			else
+				abcd = vsha1mq_u32(abcd, e, wk);
+			e = e_next;
+		}
+
+		abcd = vaddq_u32(abcd, abcd_save);
+		e += e_save;
+	}
+
+	vst1q_u32(state, abcd);
+	state[4] = e;
+}
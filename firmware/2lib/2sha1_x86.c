@@ -0,0 +1,142 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * SHA-1 transform using the x86 SHA extension.
+ * Structured after https://github.com/noloader/SHA-Intrinsics/blob/master/sha1-x86.c,
+ * Written and placed in public domain by Jeffrey Walton
+ * Based on code from Intel, and by Sean Gulley for
+ * the miTLS project.
+ */
+
+#include "2common.h"
+#include "2sha.h"
+#include "2sha_private.h"
+
+typedef int vb2_m128i __attribute__ ((vector_size(16)));
+
+static inline vb2_m128i vb2_loadu_si128(const uint8_t *ptr)
+{
+	vb2_m128i result;
+	asm ("movdqu %1, %0"
+	     : "=x"(result) : "m"(*(const uint8_t (*)[16])ptr));
+	return result;
+}
+
+static inline vb2_m128i vb2_shuffle_epi8(vb2_m128i value, vb2_m128i mask)
+{
+	asm ("pshufb %1, %0" : "+x"(value) : "xm"(mask));
+	return value;
+}
+
+static inline vb2_m128i vb2_shuffle_epi32(vb2_m128i value, int mask)
+{
+	vb2_m128i result;
+	asm ("pshufd %2, %1, %0" : "=x"(result) : "xm"(value), "i" (mask));
+	return result;
+}
+
+static inline vb2_m128i vb2_sha1msg1_epu32(vb2_m128i a, vb2_m128i b)
+{
+	asm ("sha1msg1 %1, %0" : "+x"(a) : "xm"(b));
+	return a;
+}
+
+static inline vb2_m128i vb2_sha1msg2_epu32(vb2_m128i a, vb2_m128i b)
+{
+	asm ("sha1msg2 %1, %0" : "+x"(a) : "xm"(b));
+	return a;
+}
+
+static inline vb2_m128i vb2_sha1nexte_epu32(vb2_m128i a, vb2_m128i b)
+{
+	asm ("sha1nexte %1, %0" : "+x"(a) : "xm"(b));
+	return a;
+}
+
+/* 'func' selects the round function and constant, so must be a constant */
+#define vb2_sha1rnds4_epu32(a, b, func)					\
+	({								\
+		vb2_m128i _a = (a);					\
+		asm ("sha1rnds4 %2, %1, %0"				\
+		     : "+x"(_a) : "xm"(b), "i"(func));			\
+		_a;							\
+	})
+
+/*
+ * Rounds 4j..4j+3.  'msg[j & 3]' holds W[4j..4j+3], and the next schedule
+ * words are worked out in the other three alongside the rounds.
+ */
+#define SHA1_X86_ROUNDS(j)						\
+	{								\
+		e = vb2_sha1nexte_epu32(e, msg[(j) & 3]);		\
+		e_next = abcd;						\
+		if ((j) >= 3 && (j) <= 18)				\
+			msg[((j) + 1) & 3] = vb2_sha1msg2_epu32(	\
+				msg[((j) + 1) & 3], msg[(j) & 3]);	\
+		abcd = vb2_sha1rnds4_epu32(abcd, e, (j) / 5);		\
+		if ((j) >= 1 && (j) <= 16)				\
+			msg[((j) - 1) & 3] = vb2_sha1msg1_epu32(	\
+				msg[((j) - 1) & 3], msg[(j) & 3]);	\
+		if ((j) >= 2 && (j) <= 17)				\
+			msg[((j) - 2) & 3] ^= msg[(j) & 3];		\
+		e = e_next;						\
+	}
+
+void vb2_sha1_transform_x86ext(uint32_t *state, const uint8_t *message,
+			       unsigned int block_nb)
+{
+	const vb2_m128i shuf_mask = {0x0c0d0e0f, 0x08090a0b,
+				     0x04050607, 0x00010203};
+	vb2_m128i abcd, e, e_next, abcd_save, e_save;
+	vb2_m128i msg[4];
+	int i, j;
+
+	/* The SHA-1 instructions want A in the top lane, E alone in its top */
+	abcd = vb2_shuffle_epi32(vb2_loadu_si128((const uint8_t *)state),
+				 0x1b);
+	e = (vb2_m128i){0, 0, 0, (int)state[4]};
+
+	for (i = 0; i < (int)block_nb; i++, message += 64) {
+		abcd_save = abcd;
+		e_save = e;
+
+		for (j = 0; j < 4; j++)
+			msg[j] = vb2_shuffle_epi8(
+				vb2_loadu_si128(message + j * 16), shuf_mask);
+
+		/* Rounds 0-3 take E from the state instead of SHA1NEXTE */
+		e += msg[0];
+		e_next = abcd;
+		abcd = vb2_sha1rnds4_epu32(abcd, e, 0);
+		e = e_next;
+
+		SHA1_X86_ROUNDS(1);
+		SHA1_X86_ROUNDS(2);
+		SHA1_X86_ROUNDS(3);
+		SHA1_X86_ROUNDS(4);
+		SHA1_X86_ROUNDS(5);
+		SHA1_X86_ROUNDS(6);
+		SHA1_X86_ROUNDS(7);
+		SHA1_X86_ROUNDS(8);
+		SHA1_X86_ROUNDS(9);
+		SHA1_X86_ROUNDS(10);
+		SHA1_X86_ROUNDS(11);
+		SHA1_X86_ROUNDS(12);
+		SHA1_X86_ROUNDS(13);
+		SHA1_X86_ROUNDS(14);
+		SHA1_X86_ROUNDS(15);
+		SHA1_X86_ROUNDS(16);
+		SHA1_X86_ROUNDS(17);
+		SHA1_X86_ROUNDS(18);
+		SHA1_X86_ROUNDS(19);
+
+		e = vb2_sha1nexte_epu32(e, e_save);
+		abcd += abcd_save;
+	}
+
+	abcd = vb2_shuffle_epi32(abcd, 0x1b);
+	for (j = 0; j < 4; j++)
+		state[j] = abcd[j];
+	state[4] = e[3];
+}
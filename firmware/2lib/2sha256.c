@@ -139,6 +139,11 @@ static void vb2_sha256_transform(struct vb2_sha256_context *ctx,
 	int j;
 #endif
 
+#ifdef SHA_RUNTIME_DISPATCH
+	if (vb2_sha256_transform_accel(ctx->h, message, block_nb))
+		return;
+#endif
+
 	for (i = 0; i < (int) block_nb; i++) {
 		sub_block = message + (i << 6);
 
@@ -12,11 +12,9 @@
 
 const uint32_t vb2_hash_seq[8] = {0, 1, 2, 3, 4, 5, 6, 7};
 
-int sha256_ce_transform(uint32_t *state, const unsigned char *buf, int blocks);
-
-void vb2_sha256_transform_hwcrypto(const uint8_t *message,
+void vb2_sha256_transform_hwcrypto(uint32_t *state, const uint8_t *message,
 				   unsigned int block_nb)
 {
 	if (block_nb)
-		sha256_ce_transform(vb2_sha_ctx.h, message, block_nb);
+		sha256_ce_transform(state, message, block_nb);
 }
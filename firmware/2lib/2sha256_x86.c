@@ -105,8 +105,10 @@ static inline vb2_m128i vb2_sha256rnds2_epu32(vb2_m128i a, vb2_m128i b,
 				msgtmp[k]);				\
 	}
 
-static void vb2_sha256_transform_x86ext(const uint8_t *message,
-					unsigned int block_nb)
+/* 'state' is in the vb2_hash_seq order, i.e. ABEF and CDGH */
+static void vb2_sha256_transform_state(uint32_t *state,
+				       const uint8_t *message,
+				       unsigned int block_nb)
 {
 	vb2_m128i state0, state1, msg, abef_save, cdgh_save;
 	vb2_m128i msgtmp[4];
@@ -114,8 +116,8 @@ static void vb2_sha256_transform_x86ext(const uint8_t *message,
 	int i;
 	const vb2_m128i shuf_mask = {0x00010203, 0x04050607, 0x08090a0b, 0x0c0d0e0f};
 
-	state0 = vb2_loadu_si128((vb2_m128i *)&vb2_sha_ctx.h[0]);
-	state1 = vb2_loadu_si128((vb2_m128i *)&vb2_sha_ctx.h[4]);
+	state0 = vb2_loadu_si128((vb2_m128i *)&state[0]);
+	state1 = vb2_loadu_si128((vb2_m128i *)&state[4]);
 	for (i = 0; i < (int) block_nb; i++) {
 		abef_save = state0;
 		cdgh_save = state1;
@@ -160,12 +162,25 @@ static void vb2_sha256_transform_x86ext(const uint8_t *message,
 
 	}
 
-	vb2_storeu_si128((vb2_m128i *)&vb2_sha_ctx.h[0], state0);
-	vb2_storeu_si128((vb2_m128i *)&vb2_sha_ctx.h[4], state1);
+	vb2_storeu_si128((vb2_m128i *)&state[0], state0);
+	vb2_storeu_si128((vb2_m128i *)&state[4], state1);
 }
 
-void vb2_sha256_transform_hwcrypto(const uint8_t *message,
+void vb2_sha256_transform_hwcrypto(uint32_t *state, const uint8_t *message,
 				   unsigned int block_nb)
 {
-	vb2_sha256_transform_x86ext(message, block_nb);
+	vb2_sha256_transform_state(state, message, block_nb);
+}
+
+void vb2_sha256_transform_x86ext(uint32_t *h, const uint8_t *message,
+				 unsigned int block_nb)
+{
+	uint32_t state[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		state[vb2_hash_seq[i]] = h[i];
+	vb2_sha256_transform_state(state, message, block_nb);
+	for (i = 0; i < 8; i++)
+		h[i] = state[vb2_hash_seq[i]];
 }
@@ -0,0 +1,76 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * SHA-512 transform using the ARMv8.2 SHA512 crypto extension.
+ *
+ * The state lives in four vectors, {a, b}, {c, d}, {e, f} and {g, h}, with
+ * the first of each pair in lane 0.  Each SHA512H / SHA512H2 pair does two
+ * rounds, after which the pairs rotate one place, as in the Linux kernel's
+ * sha512-ce-core.S.
+ */
+
+#include <arm_neon.h>
+
+#include "2common.h"
+#include "2sha.h"
+#include "2sha_private.h"
+
+static inline uint64x2_t load_be64x2(const uint8_t *ptr)
+{
+	return vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(ptr)));
+}
+
+void vb2_sha512_transform_armv8ce(uint64_t *h, const uint8_t *message,
+				  unsigned int block_nb)
+{
+	uint64x2_t ab = vld1q_u64(&h[0]);
+	uint64x2_t cd = vld1q_u64(&h[2]);
+	uint64x2_t ef = vld1q_u64(&h[4]);
+	uint64x2_t gh = vld1q_u64(&h[6]);
+	uint64x2_t ab_save, cd_save, ef_save, gh_save;
+	uint64x2_t w[40];
+	int i, j;
+
+	for (i = 0; i < (int)block_nb; i++, message += 128) {
+		ab_save = ab;
+		cd_save = cd;
+		ef_save = ef;
+		gh_save = gh;
+
+		/* w[j] holds W[2j] and W[2j+1] */
+		for (j = 0; j < 8; j++)
+			w[j] = load_be64x2(message + j * 16);
+		for (j = 8; j < 40; j++)
+			w[j] = vsha512su1q_u64(
+				vsha512su0q_u64(w[j - 8], w[j - 7]),
+				w[j - 1], vextq_u64(w[j - 4], w[j - 3], 1));
+
+		for (j = 0; j < 40; j++) {
+			uint64x2_t wk, fg, de, t, ab_next;
+
+			/* Rounds 2j and 2j+1, with W + K for 2j in lane 1 */
+			wk = vaddq_u64(w[j], vld1q_u64(&vb2_sha512_k[j * 2]));
+			wk = vextq_u64(wk, wk, 1);
+			fg = vextq_u64(ef, gh, 1);
+			de = vextq_u64(cd, ef, 1);
+
+			t = vsha512hq_u64(vaddq_u64(gh, wk), fg, de);
+			ab_next = vsha512h2q_u64(t, cd, ab);
+			gh = ef;
+			ef = vaddq_u64(cd, t);
+			cd = ab;
+			ab = ab_next;
+		}
+
+		ab = vaddq_u64(ab, ab_save);
+		cd = vaddq_u64(cd, cd_save);
+		ef = vaddq_u64(ef, ef_save);
+		gh = vaddq_u64(gh, gh_save);
+	}
+
+	vst1q_u64(&h[0], ab);
+	vst1q_u64(&h[2], cd);
+	vst1q_u64(&h[4], ef);
+	vst1q_u64(&h[6], gh);
+}
@@ -0,0 +1,248 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * SHA-512 transforms for x86 host builds.
+ *
+ * The AVX2 transform computes the message schedule (W[t] + K[t]) of two
+ * blocks at once, one block per 128-bit lane, and then runs the scalar
+ * rounds over each.  The rounds are inherently serial, so the schedule is
+ * the only part that vectorizes.
+ *
+ * The SHA512 extension transform (VSHA512RNDS2 and friends) follows the
+ * same structure as the SHA-NI transform in 2sha256_x86.c, with 256-bit
+ * state registers.  It is only built (X86_SHA512_EXT) when the toolchain
+ * knows -msha512.
+ */
+
+#include "2common.h"
+#include "2sha.h"
+#include "2sha_private.h"
+
+typedef uint64_t vb2_u64x4 __attribute__ ((vector_size(32)));
+
+#define ROR64X4(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define SIGMA0X4(x) (ROR64X4(x, 1) ^ ROR64X4(x, 8) ^ ((x) >> 7))
+#define SIGMA1X4(x) (ROR64X4(x, 19) ^ ROR64X4(x, 61) ^ ((x) >> 6))
+
+/* Swaps the bytes of each qword, since SHA-512 words are big-endian */
+static const vb2_u64x4 bswap64_mask = {
+	0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL,
+	0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL,
+};
+
+static inline vb2_u64x4 vb2_shuffle_epi8(vb2_u64x4 value, vb2_u64x4 mask)
+{
+	vb2_u64x4 result;
+	asm ("vpshufb %2, %1, %0" : "=x"(result) : "x"(value), "xm"(mask));
+	return result;
+}
+
+/* Loads 16 bytes from 'lo' into the low lane and 16 from 'hi' into the high */
+static inline vb2_u64x4 vb2_load_2x128(const uint8_t *lo, const uint8_t *hi)
+{
+	vb2_u64x4 result;
+	asm ("vmovdqu %1, %x0\n\t"
+	     "vinserti128 $1, %2, %0, %0"
+	     : "=&x"(result)
+	     : "m"(*(const uint8_t (*)[16])lo),
+	       "m"(*(const uint8_t (*)[16])hi));
+	return result;
+}
+
+/* Loads 16 bytes into both lanes */
+static inline vb2_u64x4 vb2_broadcast_128(const uint64_t *ptr)
+{
+	vb2_u64x4 result;
+	asm ("vbroadcasti128 %1, %0"
+	     : "=x"(result) : "m"(*(const uint64_t (*)[2])ptr));
+	return result;
+}
+
+/* Per 128-bit lane, the middle two qwords of {hi:lo} */
+static inline vb2_u64x4 vb2_alignr_8(vb2_u64x4 hi, vb2_u64x4 lo)
+{
+	vb2_u64x4 result;
+	asm ("vpalignr $8, %2, %1, %0" : "=x"(result) : "x"(hi), "xm"(lo));
+	return result;
+}
+
+/*
+ * Computes W[t] + K[t] for blocks 'b0' and 'b1'.  wk[i] holds words 2i and
+ * 2i+1 of b0 in its low lane and the same words of b1 in its high lane.
+ */
+static void sha512_schedule_avx2(vb2_u64x4 *wk, const uint8_t *b0,
+				 const uint8_t *b1)
+{
+	vb2_u64x4 w[8];
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		w[i] = vb2_shuffle_epi8(vb2_load_2x128(b0 + i * 16,
+						       b1 + i * 16),
+					bswap64_mask);
+		wk[i] = w[i] + vb2_broadcast_128(&vb2_sha512_k[i * 2]);
+	}
+
+	/* w[i & 7] holds W[2i-16] and W[2i-15] until it is replaced here */
+	for (i = 8; i < 40; i++) {
+		vb2_u64x4 w15 = vb2_alignr_8(w[(i - 7) & 7], w[(i - 8) & 7]);
+		vb2_u64x4 w7 = vb2_alignr_8(w[(i - 3) & 7], w[(i - 4) & 7]);
+		vb2_u64x4 w2 = w[(i - 1) & 7];
+
+		w[i & 7] += SIGMA0X4(w15) + w7 + SIGMA1X4(w2);
+		wk[i] = w[i & 7] + vb2_broadcast_128(&vb2_sha512_k[i * 2]);
+	}
+}
+
+#define ROR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define SHA512_S0(x) (ROR64(x, 28) ^ ROR64(x, 34) ^ ROR64(x, 39))
+#define SHA512_S1(x) (ROR64(x, 14) ^ ROR64(x, 18) ^ ROR64(x, 41))
+
+/* Word j of one block in a schedule written by sha512_schedule_avx2() */
+#define SHA512_WK(j) (wk[((j) >> 1) * 4 + ((j) & 1)])
+
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, j)				\
+	{								\
+		t1 = h + SHA512_S1(e) + ((e & f) ^ (~e & g))		\
+			+ SHA512_WK(j);					\
+		t2 = SHA512_S0(a) + ((a & b) ^ (a & c) ^ (b & c));	\
+		d += t1;						\
+		h = t1 + t2;						\
+	}
+
+/* 'wk' points at the first word of the block's lane in the schedule */
+static void sha512_rounds(uint64_t *state, const uint64_t *wk)
+{
+	uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+	uint64_t t1, t2;
+	int j;
+
+	for (j = 0; j < 80; j += 8) {
+		SHA512_ROUND(a, b, c, d, e, f, g, h, j);
+		SHA512_ROUND(h, a, b, c, d, e, f, g, j + 1);
+		SHA512_ROUND(g, h, a, b, c, d, e, f, j + 2);
+		SHA512_ROUND(f, g, h, a, b, c, d, e, j + 3);
+		SHA512_ROUND(e, f, g, h, a, b, c, d, j + 4);
+		SHA512_ROUND(d, e, f, g, h, a, b, c, j + 5);
+		SHA512_ROUND(c, d, e, f, g, h, a, b, j + 6);
+		SHA512_ROUND(b, c, d, e, f, g, h, a, j + 7);
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void vb2_sha512_transform_avx2(uint64_t *h, const uint8_t *message,
+			       unsigned int block_nb)
+{
+	vb2_u64x4 wk[40];
+
+	while (block_nb) {
+		/* A lone last block is scheduled in both lanes */
+		const uint8_t *next = block_nb > 1 ? message + 128 : message;
+
+		sha512_schedule_avx2(wk, message, next);
+		sha512_rounds(h, (const uint64_t *)wk);
+		if (block_nb == 1)
+			break;
+		sha512_rounds(h, (const uint64_t *)wk + 2);
+		message += 256;
+		block_nb -= 2;
+	}
+}
+
+#ifdef X86_SHA512_EXT
+
+static inline vb2_u64x4 vb2_loadu_si256(const void *ptr)
+{
+	vb2_u64x4 result;
+	asm ("vmovdqu %1, %0"
+	     : "=x"(result) : "m"(*(const uint8_t (*)[32])ptr));
+	return result;
+}
+
+/* The high 128 bits of 'x', in the low 128 bits of the result */
+static inline vb2_u64x4 vb2_extract_hi128(vb2_u64x4 x)
+{
+	vb2_u64x4 result;
+	asm ("vextracti128 $1, %1, %x0" : "=x"(result) : "x"(x));
+	return result;
+}
+
+/* {b1, b0, a3, a2} for a = {a3, a2, a1, a0} and b likewise */
+static inline vb2_u64x4 vb2_permute_21(vb2_u64x4 a, vb2_u64x4 b)
+{
+	vb2_u64x4 result;
+	asm ("vperm2i128 $0x21, %2, %1, %0"
+	     : "=x"(result) : "x"(a), "xm"(b));
+	return result;
+}
+
+static inline vb2_u64x4 vb2_sha512msg1(vb2_u64x4 a, vb2_u64x4 b)
+{
+	asm ("vsha512msg1 %x1, %0" : "+x"(a) : "x"(b));
+	return a;
+}
+
+static inline vb2_u64x4 vb2_sha512msg2(vb2_u64x4 a, vb2_u64x4 b)
+{
+	asm ("vsha512msg2 %1, %0" : "+x"(a) : "x"(b));
+	return a;
+}
+
+static inline vb2_u64x4 vb2_sha512rnds2(vb2_u64x4 a, vb2_u64x4 b,
+					 vb2_u64x4 k)
+{
+	asm ("vsha512rnds2 %x2, %1, %0" : "+x"(a) : "x"(b), "x"(k));
+	return a;
+}
+
+void vb2_sha512_transform_x86ext(uint64_t *h, const uint8_t *message,
+				 unsigned int block_nb)
+{
+	/* Qword 0 is the lowest, so these hold FEBA and HGDC */
+	vb2_u64x4 abef = {h[5], h[4], h[1], h[0]};
+	vb2_u64x4 cdgh = {h[7], h[6], h[3], h[2]};
+	vb2_u64x4 abef_save, cdgh_save, wk, msg[4];
+	int i, j;
+
+	for (i = 0; i < (int)block_nb; i++, message += 128) {
+		abef_save = abef;
+		cdgh_save = cdgh;
+
+		for (j = 0; j < 4; j++)
+			msg[j] = vb2_shuffle_epi8(
+				vb2_loadu_si256(message + j * 32),
+				bswap64_mask);
+
+		/* msg[j & 3] holds W[4j..4j+3] */
+		for (j = 0; j < 20; j++) {
+			vb2_u64x4 *w0 = &msg[j & 3];
+			vb2_u64x4 w1 = msg[(j + 1) & 3];
+			vb2_u64x4 w2 = msg[(j + 2) & 3];
+			vb2_u64x4 w3 = msg[(j + 3) & 3];
+
+			wk = *w0 + vb2_loadu_si256(&vb2_sha512_k[j * 4]);
+			cdgh = vb2_sha512rnds2(cdgh, abef, wk);
+			abef = vb2_sha512rnds2(abef, cdgh,
+					       vb2_extract_hi128(wk));
+
+			if (j < 16) {
+				/* W[4j+16..4j+19] */
+				*w0 = vb2_sha512msg1(*w0, w1) +
+				      vb2_alignr_8(vb2_permute_21(w2, w3), w2);
+				*w0 = vb2_sha512msg2(*w0, w3);
+			}
+		}
+
+		abef += abef_save;
+		cdgh += cdgh_save;
+	}
+
+	h[0] = abef[3]; h[1] = abef[2]; h[4] = abef[1]; h[5] = abef[0];
+	h[2] = cdgh[3]; h[3] = cdgh[2]; h[6] = cdgh[1]; h[7] = cdgh[0];
+}
+
+#endif  /* X86_SHA512_EXT */
@@ -0,0 +1,356 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Run-time selection of the SHA transforms for host builds, so that one
+ * binary uses the CPU's SHA and vector extensions where it has them and
+ * the C implementation everywhere else.  Firmware builds choose at compile
+ * time with X86_SHA_EXT / ARMV8_CRYPTO_EXT instead.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(__aarch64__)
+#include <sys/auxv.h>
+#endif
+
+#include "2common.h"
+#include "2sha.h"
+#include "2sha_private.h"
+
+struct cpu_features {
+	int sha1;
+	int sha256;
+	int sha512;
+	int avx2;
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#ifndef bit_SHA512
+#define bit_SHA512 (1 << 0)	/* CPUID.(7,1):EAX */
+#endif
+
+/* Whether the OS saves the YMM registers across context switches */
+static int os_saves_ymm(void)
+{
+	uint32_t lo, hi;
+
+	asm volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return (lo & 0x6) == 0x6;
+}
+
+static struct cpu_features probe_cpu(void)
+{
+	struct cpu_features f = {0};
+	unsigned int eax, ebx, ecx, edx;
+	unsigned int max_subleaf;
+	int ssse3, avx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return f;
+	ssse3 = !!(ecx & bit_SSSE3);
+	avx = (ecx & bit_AVX) && (ecx & bit_OSXSAVE) && os_saves_ymm();
+
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return f;
+	max_subleaf = eax;
+	/* SHA-NI covers both SHA-1 and SHA-256 */
+	f.sha1 = f.sha256 = ssse3 && (ebx & bit_SHA);
+	f.avx2 = avx && (ebx & bit_AVX2);
+
+	if (max_subleaf >= 1 && __get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx))
+		f.sha512 = f.avx2 && (eax & bit_SHA512);
+
+	return f;
+}
+
+#elif defined(__aarch64__)
+
+#ifndef HWCAP_SHA1
+#define HWCAP_SHA1 (1 << 5)
+#endif
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+#ifndef HWCAP_SHA512
+#define HWCAP_SHA512 (1 << 21)
+#endif
+
+static struct cpu_features probe_cpu(void)
+{
+	struct cpu_features f = {0};
+	unsigned long hwcap = getauxval(AT_HWCAP);
+
+	f.sha1 = !!(hwcap & HWCAP_SHA1);
+	f.sha256 = !!(hwcap & HWCAP_SHA2);
+	f.sha512 = !!(hwcap & HWCAP_SHA512);
+	return f;
+}
+
+#else
+
+static struct cpu_features probe_cpu(void)
+{
+	struct cpu_features f = {0};
+
+	return f;
+}
+
+#endif
+
+/* Probing twice from racing threads is harmless */
+static struct cpu_features features;
+static enum vb2_sha_engine sha1_engine;
+static enum vb2_sha_engine sha256_engine;
+static enum vb2_sha_engine sha512_engine;
+static enum vb2_sha_engine many_engine;
+/* Set when a test asked for many_engine, whatever the heuristics say */
+static int many_forced;
+
+/* Whether this build and CPU can run an algorithm on an engine */
+static int engine_available(enum vb2_hash_algorithm algo,
+			    enum vb2_sha_engine engine)
+{
+	switch (engine) {
+	case VB2_SHA_ENGINE_C:
+		return 1;
+#if defined(__x86_64__) || defined(__i386__)
+	case VB2_SHA_ENGINE_X86_SHA:
+		switch (algo) {
+		case VB2_HASH_SHA1:
+			return features.sha1;
+		case VB2_HASH_SHA224:
+		case VB2_HASH_SHA256:
+			return features.sha256;
+#ifdef X86_SHA512_EXT
+		case VB2_HASH_SHA384:
+		case VB2_HASH_SHA512:
+			return features.sha512;
+#endif
+		default:
+			return 0;
+		}
+	case VB2_SHA_ENGINE_X86_AVX2:
+		return (algo == VB2_HASH_SHA384 || algo == VB2_HASH_SHA512) &&
+			features.avx2;
+#elif defined(__aarch64__)
+	case VB2_SHA_ENGINE_ARMV8_CE:
+		switch (algo) {
+		case VB2_HASH_SHA1:
+			return features.sha1;
+		case VB2_HASH_SHA224:
+		case VB2_HASH_SHA256:
+			return features.sha256;
+#ifdef ARMV8_SHA512_EXT
+		case VB2_HASH_SHA384:
+		case VB2_HASH_SHA512:
+			return features.sha512;
+#endif
+		default:
+			return 0;
+		}
+#endif
+	default:
+		return 0;
+	}
+}
+
+/* The fastest engine available for an algorithm */
+static enum vb2_sha_engine best_engine(enum vb2_hash_algorithm algo)
+{
+	static const enum vb2_sha_engine preference[] = {
+		VB2_SHA_ENGINE_X86_SHA,
+		VB2_SHA_ENGINE_ARMV8_CE,
+		VB2_SHA_ENGINE_X86_AVX2,
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(preference); i++)
+		if (engine_available(algo, preference[i]))
+			return preference[i];
+	return VB2_SHA_ENGINE_C;
+}
+
+/* The multi-buffer engine vb2_hash_calculate_many_accel() may use */
+static enum vb2_sha_engine best_many_engine(void)
+{
+#if defined(__x86_64__)
+	if (features.avx2)
+		return VB2_SHA_ENGINE_X86_AVX2;
+#endif
+	return VB2_SHA_ENGINE_C;
+}
+
+static void probe_engines(void)
+{
+	features = probe_cpu();
+	sha1_engine = best_engine(VB2_HASH_SHA1);
+	sha256_engine = best_engine(VB2_HASH_SHA256);
+	sha512_engine = best_engine(VB2_HASH_SHA512);
+	many_engine = best_many_engine();
+}
+
+int vb2_sha_force_engine(enum vb2_hash_algorithm algo,
+			 enum vb2_sha_engine engine)
+{
+	enum vb2_sha_engine *selected;
+
+	if (sha1_engine == VB2_SHA_ENGINE_AUTO)
+		probe_engines();
+
+	switch (algo) {
+	case VB2_HASH_SHA1:
+		selected = &sha1_engine;
+		break;
+	case VB2_HASH_SHA224:
+	case VB2_HASH_SHA256:
+		selected = &sha256_engine;
+		break;
+	case VB2_HASH_SHA384:
+	case VB2_HASH_SHA512:
+		selected = &sha512_engine;
+		break;
+	default:
+		return 0;
+	}
+
+	if (engine == VB2_SHA_ENGINE_AUTO)
+		engine = best_engine(algo);
+	else if (!engine_available(algo, engine))
+		return 0;
+
+	*selected = engine;
+	return 1;
+}
+
+int vb2_sha1_transform_accel(uint32_t *state, const uint8_t *message,
+			     unsigned int block_nb)
+{
+	if (sha1_engine == VB2_SHA_ENGINE_AUTO)
+		probe_engines();
+
+	switch (sha1_engine) {
+#if defined(__x86_64__) || defined(__i386__)
+	case VB2_SHA_ENGINE_X86_SHA:
+		vb2_sha1_transform_x86ext(state, message, block_nb);
+		return 1;
+#elif defined(__aarch64__)
+	case VB2_SHA_ENGINE_ARMV8_CE:
+		vb2_sha1_transform_armv8ce(state, message, block_nb);
+		return 1;
+#endif
+	default:
+		return 0;
+	}
+}
+
+int vb2_sha256_transform_accel(uint32_t *h, const uint8_t *message,
+			       unsigned int block_nb)
+{
+	if (sha256_engine == VB2_SHA_ENGINE_AUTO)
+		probe_engines();
+
+	switch (sha256_engine) {
+#if defined(__x86_64__) || defined(__i386__)
+	case VB2_SHA_ENGINE_X86_SHA:
+		vb2_sha256_transform_x86ext(h, message, block_nb);
+		return 1;
+#elif defined(__aarch64__)
+	case VB2_SHA_ENGINE_ARMV8_CE:
+		if (block_nb)
+			sha256_ce_transform(h, message, block_nb);
+		return 1;
+#endif
+	default:
+		return 0;
+	}
+}
+
+int vb2_sha512_transform_accel(uint64_t *h, const uint8_t *message,
+			       unsigned int block_nb)
+{
+	if (sha512_engine == VB2_SHA_ENGINE_AUTO)
+		probe_engines();
+
+	switch (sha512_engine) {
+#if defined(__x86_64__) || defined(__i386__)
+#ifdef X86_SHA512_EXT
+	case VB2_SHA_ENGINE_X86_SHA:
+		vb2_sha512_transform_x86ext(h, message, block_nb);
+		return 1;
+#endif
+	case VB2_SHA_ENGINE_X86_AVX2:
+		vb2_sha512_transform_avx2(h, message, block_nb);
+		return 1;
+#elif defined(__aarch64__) && defined(ARMV8_SHA512_EXT)
+	case VB2_SHA_ENGINE_ARMV8_CE:
+		vb2_sha512_transform_armv8ce(h, message, block_nb);
+		return 1;
+#endif
+	default:
+		return 0;
+	}
+}
+
+int vb2_sha_force_many_engine(enum vb2_sha_engine engine)
+{
+	if (sha1_engine == VB2_SHA_ENGINE_AUTO)
+		probe_engines();
+
+	switch (engine) {
+	case VB2_SHA_ENGINE_AUTO:
+		many_engine = best_many_engine();
+		many_forced = 0;
+		return 1;
+	case VB2_SHA_ENGINE_C:
+		break;
+	case VB2_SHA_ENGINE_X86_AVX2:
+		if (best_many_engine() != VB2_SHA_ENGINE_X86_AVX2)
+			return 0;
+		break;
+	default:
+		return 0;
+	}
+
+	many_engine = engine;
+	many_forced = 1;
+	return 1;
+}
+
+int vb2_hash_calculate_many_accel(enum vb2_hash_algorithm algo,
+				  struct vb2_hash_job *jobs, uint32_t count)
+{
+#if defined(__x86_64__)
+	if (sha256_engine == VB2_SHA_ENGINE_AUTO)
+		probe_engines();
+
+	if (many_engine != VB2_SHA_ENGINE_X86_AVX2)
+		return 0;
+
+	switch (algo) {
+	case VB2_HASH_SHA224:
+	case VB2_HASH_SHA256:
+		/*
+		 * One buffer, or any number with SHA-NI, is faster through
+		 * the single-buffer transforms.
+		 */
+		if (!many_forced && (count < 2 ||
+				     sha256_engine == VB2_SHA_ENGINE_X86_SHA))
+			return 0;
+		vb2_sha256_mb_avx2(algo, jobs, count);
+		return 1;
+	case VB2_HASH_SHA384:
+	case VB2_HASH_SHA512:
+		if (!many_forced && (count < 2 ||
+				     sha512_engine == VB2_SHA_ENGINE_X86_SHA))
+			return 0;
+		vb2_sha512_mb_avx2(algo, jobs, count);
+		return 1;
+	default:
+		return 0;
+	}
+#else
+	return 0;
+#endif
+}
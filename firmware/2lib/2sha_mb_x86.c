@@ -0,0 +1,319 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Multi-buffer SHA-256 and SHA-512 for x86 host builds, using AVX2.
+ *
+ * SHA rounds are serial within one message, but independent messages can
+ * share a vector: each 32-bit (SHA-256) or 64-bit (SHA-512) lane of a YMM
+ * register carries the state of a different message, so one pass of the
+ * rounds advances eight SHA-256 or four SHA-512 messages by a block.  When
+ * a message ends, its lane picks up the next one from the job list.
+ */
+
+#include "2common.h"
+#include "2sha.h"
+#include "2sha_private.h"
+
+typedef uint32_t vb2_u32x8 __attribute__ ((vector_size(32)));
+typedef uint64_t vb2_u64x4 __attribute__ ((vector_size(32)));
+
+#define MB_MAX_LANES 8
+
+/* Where each lane is in its current job */
+struct mb_lane {
+	int job;		/* Index in the job list, or -1 if idle */
+	const uint8_t *data;	/* Next whole block of the message */
+	uint32_t blocks;	/* Whole blocks left at 'data' */
+	uint32_t tail_blocks;	/* Padded blocks left in 'tail' */
+	const uint8_t *tail_pos;
+	uint8_t tail[2 * VB2_SHA512_BLOCK_SIZE];
+};
+
+/* Hash-specific parts of the multi-buffer loop */
+struct mb_engine {
+	int lanes;
+	uint32_t block_size;
+	/* Size of the message length field at the end of the padding */
+	uint32_t length_size;
+	void (*init_lane)(void *state, int lane, enum vb2_hash_algorithm algo);
+	void (*transform)(void *state, const uint8_t *const *blocks);
+	void (*read_lane)(const void *state, int lane, uint8_t *digest,
+			  uint32_t digest_size);
+};
+
+/* Builds the padded final block(s) of a message in the lane */
+static void mb_pad_tail(const struct mb_engine *e, struct mb_lane *l,
+			const uint8_t *buf, uint32_t size)
+{
+	uint32_t rem = size % e->block_size;
+	uint64_t bits = (uint64_t)size << 3;
+	uint32_t tail_size;
+	int i;
+
+	l->data = buf;
+	l->blocks = size / e->block_size;
+	l->tail_blocks = rem + 1 + e->length_size > e->block_size ? 2 : 1;
+	tail_size = l->tail_blocks * e->block_size;
+
+	memset(l->tail, 0, tail_size);
+	if (rem)
+		memcpy(l->tail, buf + size - rem, rem);
+	l->tail[rem] = 0x80;
+	for (i = 0; i < 8; i++)
+		l->tail[tail_size - 1 - i] = (uint8_t)(bits >> (i * 8));
+	l->tail_pos = l->tail;
+}
+
+static void mb_run(const struct mb_engine *e, void *state,
+		   enum vb2_hash_algorithm algo, struct vb2_hash_job *jobs,
+		   uint32_t count)
+{
+	struct mb_lane lanes[MB_MAX_LANES];
+	const uint8_t *blocks[MB_MAX_LANES];
+	uint8_t idle_block[VB2_SHA512_BLOCK_SIZE] = {0};
+	uint32_t digest_size = vb2_digest_size(algo);
+	uint32_t next_job = 0;
+	int active = 0;
+	int i;
+
+	for (i = 0; i < e->lanes; i++) {
+		lanes[i].job = -1;
+		if (next_job < count) {
+			lanes[i].job = next_job++;
+			mb_pad_tail(e, &lanes[i], jobs[lanes[i].job].buf,
+				    jobs[lanes[i].job].size);
+			e->init_lane(state, i, algo);
+			active++;
+		}
+	}
+
+	while (active) {
+		for (i = 0; i < e->lanes; i++) {
+			struct mb_lane *l = &lanes[i];
+
+			if (l->job < 0)
+				blocks[i] = idle_block;
+			else if (l->blocks)
+				blocks[i] = l->data;
+			else
+				blocks[i] = l->tail_pos;
+		}
+
+		e->transform(state, blocks);
+
+		for (i = 0; i < e->lanes; i++) {
+			struct mb_lane *l = &lanes[i];
+			struct vb2_hash *hash;
+
+			if (l->job < 0)
+				continue;
+
+			if (l->blocks) {
+				l->data += e->block_size;
+				l->blocks--;
+				continue;
+			}
+			l->tail_pos += e->block_size;
+			if (--l->tail_blocks)
+				continue;
+
+			/* Message done; hand the lane to the next job */
+			hash = jobs[l->job].hash;
+			hash->algo = algo;
+			e->read_lane(state, i, hash->raw, digest_size);
+
+			l->job = -1;
+			if (next_job < count) {
+				l->job = next_job++;
+				mb_pad_tail(e, l, jobs[l->job].buf,
+					    jobs[l->job].size);
+				e->init_lane(state, i, algo);
+			} else {
+				active--;
+			}
+		}
+	}
+}
+
+#define ROR32X8(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROR64X4(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define CH(x, y, z)  (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+/* SHA-256, eight lanes.  state[i] holds word i of every lane's state. */
+
+static void sha256_mb_init_lane(void *state, int lane,
+				enum vb2_hash_algorithm algo)
+{
+	vb2_u32x8 *h = state;
+	struct vb2_sha256_context ctx;
+	int i;
+
+	vb2_sha256_init(&ctx, algo);
+	for (i = 0; i < 8; i++)
+		h[i][lane] = ctx.h[i];
+}
+
+static void sha256_mb_read_lane(const void *state, int lane, uint8_t *digest,
+				uint32_t digest_size)
+{
+	const vb2_u32x8 *h = state;
+	uint32_t i;
+
+	for (i = 0; i < digest_size; i++)
+		digest[i] = (uint8_t)(h[i / 4][lane] >> (24 - (i % 4) * 8));
+}
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+	       ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void sha256_mb_transform(void *state, const uint8_t *const *blocks)
+{
+	vb2_u32x8 *h = state;
+	vb2_u32x8 w[16];
+	vb2_u32x8 a = h[0], b = h[1], c = h[2], d = h[3];
+	vb2_u32x8 e = h[4], f = h[5], g = h[6], hh = h[7];
+	vb2_u32x8 t1, t2;
+	int i, j;
+
+	for (j = 0; j < 16; j++)
+		for (i = 0; i < 8; i++)
+			w[j][i] = load_be32(blocks[i] + j * 4);
+
+	for (j = 0; j < 64; j++) {
+		if (j >= 16) {
+			vb2_u32x8 w15 = w[(j - 15) & 15], w2 = w[(j - 2) & 15];
+
+			w[j & 15] += (ROR32X8(w15, 7) ^ ROR32X8(w15, 18) ^
+				      (w15 >> 3)) +
+				     w[(j - 7) & 15] +
+				     (ROR32X8(w2, 17) ^ ROR32X8(w2, 19) ^
+				      (w2 >> 10));
+		}
+
+		t1 = hh + (ROR32X8(e, 6) ^ ROR32X8(e, 11) ^ ROR32X8(e, 25)) +
+		     CH(e, f, g) + vb2_sha256_k[j] + w[j & 15];
+		t2 = (ROR32X8(a, 2) ^ ROR32X8(a, 13) ^ ROR32X8(a, 22)) +
+		     MAJ(a, b, c);
+		hh = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+	h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+static const struct mb_engine sha256_mb_engine = {
+	.lanes = 8,
+	.block_size = VB2_SHA256_BLOCK_SIZE,
+	.length_size = 8,
+	.init_lane = sha256_mb_init_lane,
+	.transform = sha256_mb_transform,
+	.read_lane = sha256_mb_read_lane,
+};
+
+/* SHA-512, four lanes.  state[i] holds word i of every lane's state. */
+
+static void sha512_mb_init_lane(void *state, int lane,
+				enum vb2_hash_algorithm algo)
+{
+	vb2_u64x4 *h = state;
+	struct vb2_sha512_context ctx;
+	int i;
+
+	vb2_sha512_init(&ctx, algo);
+	for (i = 0; i < 8; i++)
+		h[i][lane] = ctx.h[i];
+}
+
+static void sha512_mb_read_lane(const void *state, int lane, uint8_t *digest,
+				uint32_t digest_size)
+{
+	const vb2_u64x4 *h = state;
+	uint32_t i;
+
+	for (i = 0; i < digest_size; i++)
+		digest[i] = (uint8_t)(h[i / 8][lane] >> (56 - (i % 8) * 8));
+}
+
+static inline uint64_t load_be64(const uint8_t *p)
+{
+	return ((uint64_t)load_be32(p) << 32) | load_be32(p + 4);
+}
+
+static void sha512_mb_transform(void *state, const uint8_t *const *blocks)
+{
+	vb2_u64x4 *h = state;
+	vb2_u64x4 w[16];
+	vb2_u64x4 a = h[0], b = h[1], c = h[2], d = h[3];
+	vb2_u64x4 e = h[4], f = h[5], g = h[6], hh = h[7];
+	vb2_u64x4 t1, t2;
+	int i, j;
+
+	for (j = 0; j < 16; j++)
+		for (i = 0; i < 4; i++)
+			w[j][i] = load_be64(blocks[i] + j * 8);
+
+	for (j = 0; j < 80; j++) {
+		if (j >= 16) {
+			vb2_u64x4 w15 = w[(j - 15) & 15], w2 = w[(j - 2) & 15];
+
+			w[j & 15] += (ROR64X4(w15, 1) ^ ROR64X4(w15, 8) ^
+				      (w15 >> 7)) +
+				     w[(j - 7) & 15] +
+				     (ROR64X4(w2, 19) ^ ROR64X4(w2, 61) ^
+				      (w2 >> 6));
+		}
+
+		t1 = hh + (ROR64X4(e, 14) ^ ROR64X4(e, 18) ^ ROR64X4(e, 41)) +
+		     CH(e, f, g) + vb2_sha512_k[j] + w[j & 15];
+		t2 = (ROR64X4(a, 28) ^ ROR64X4(a, 34) ^ ROR64X4(a, 39)) +
+		     MAJ(a, b, c);
+		hh = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+	h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+static const struct mb_engine sha512_mb_engine = {
+	.lanes = 4,
+	.block_size = VB2_SHA512_BLOCK_SIZE,
+	.length_size = 16,
+	.init_lane = sha512_mb_init_lane,
+	.transform = sha512_mb_transform,
+	.read_lane = sha512_mb_read_lane,
+};
+
+void vb2_sha256_mb_avx2(enum vb2_hash_algorithm algo,
+			struct vb2_hash_job *jobs, uint32_t count)
+{
+	vb2_u32x8 state[8] = {0};
+
+	mb_run(&sha256_mb_engine, state, algo, jobs, count);
+}
+
+void vb2_sha512_mb_avx2(enum vb2_hash_algorithm algo,
+			struct vb2_hash_job *jobs, uint32_t count)
+{
+	vb2_u64x4 state[8] = {0};
+
+	mb_run(&sha512_mb_engine, state, algo, jobs, count);
+}
@@ -7,6 +7,7 @@
 
 #include "2common.h"
 #include "2sha.h"
+#include "2sha_private.h"
 #include "2sysincludes.h"
 
 size_t vb2_digest_size(enum vb2_hash_algorithm hash_alg)
@@ -61,11 +62,15 @@ vb2_error_t vb2_digest_init(struct vb2_digest_context *dc, bool allow_hwcrypto,
 {
 	const char msg[] = "%u bytes, hash algo %d, HW acceleration %s";
 
+	/* Whatever the context was doing before is abandoned */
+	vb2ex_hwcrypto_digest_release_ctx(&dc->hwcrypto);
+
 	dc->hash_alg = algo;
 	dc->using_hwcrypto = 0;
 
 	if (allow_hwcrypto) {
-		vb2_error_t rv = vb2ex_hwcrypto_digest_init(algo, data_size);
+		vb2_error_t rv = vb2ex_hwcrypto_digest_init_ctx(
+			&dc->hwcrypto, algo, data_size);
 		if (rv == VB2_SUCCESS) {
 			VB2_DEBUG(msg, data_size, algo, "enabled\n");
 			dc->using_hwcrypto = 1;
@@ -109,7 +114,8 @@ vb2_error_t vb2_digest_extend(struct vb2_digest_context *dc, const uint8_t *buf,
 			      uint32_t size)
 {
 	if (dc->using_hwcrypto)
-		return vb2ex_hwcrypto_digest_extend(buf, size);
+		return vb2ex_hwcrypto_digest_extend_ctx(&dc->hwcrypto, buf,
+							size);
 
 	switch (dc->hash_alg) {
 #if VB2_SUPPORT_SHA1
@@ -139,7 +145,8 @@ vb2_error_t vb2_digest_finalize(struct vb2_digest_context *dc, uint8_t *digest,
 				uint32_t digest_size)
 {
 	if (dc->using_hwcrypto)
-		return vb2ex_hwcrypto_digest_finalize(digest, digest_size);
+		return vb2ex_hwcrypto_digest_finalize_ctx(&dc->hwcrypto,
+							  digest, digest_size);
 
 	if (digest_size < vb2_digest_size(dc->hash_alg))
 		return VB2_ERROR_SHA_FINALIZE_DIGEST_SIZE;
@@ -180,6 +187,26 @@ vb2_error_t vb2_hash_calculate(bool allow_hwcrypto, const void *buf,
 	return vb2_digest_finalize(&dc, hash->raw, vb2_digest_size(algo));
 }
 
+vb2_error_t vb2_hash_calculate_many(enum vb2_hash_algorithm algo,
+				    struct vb2_hash_job *jobs, uint32_t count)
+{
+	uint32_t i;
+
+	if (!vb2_digest_size(algo))
+		return VB2_ERROR_SHA_INIT_ALGORITHM;
+
+#ifdef SHA_RUNTIME_DISPATCH
+	if (vb2_hash_calculate_many_accel(algo, jobs, count))
+		return VB2_SUCCESS;
+#endif
+
+	for (i = 0; i < count; i++)
+		VB2_TRY(vb2_hash_calculate(false, jobs[i].buf, jobs[i].size,
+					   algo, jobs[i].hash));
+
+	return VB2_SUCCESS;
+}
+
 vb2_error_t vb2_hash_verify(bool allow_hwcrypto, const void *buf, uint32_t size,
 			    const struct vb2_hash *hash)
 {
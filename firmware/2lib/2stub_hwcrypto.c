@@ -6,6 +6,7 @@
  */
 
 #include "2api.h"
+#include "2sha.h"
 
 #if !defined(X86_SHA_EXT) && !defined(ARMV8_CRYPTO_EXT)
 __attribute__((weak))
@@ -27,6 +28,92 @@ vb2_error_t vb2ex_hwcrypto_digest_finalize(uint8_t *digest,
 {
 	return VB2_ERROR_SHA_FINALIZE_ALGORITHM;  /* Should not be called. */
 }
+
+/*
+ * Engines that only implement the single-state calls above get these.
+ * The engine can only hold one digest, so a digest started while another
+ * is in progress is reported as unsupported and runs in software instead.
+ * The engine is free again once its digest is finalized, fails, or has its
+ * context reinitialized.  The owner is only changed atomically, so two
+ * threads can't both be given the engine.
+ */
+static struct vb2_hwcrypto_digest_context *single_state_owner;
+
+static bool take_single_state(struct vb2_hwcrypto_digest_context *hc)
+{
+	struct vb2_hwcrypto_digest_context *expected = NULL;
+
+	return __atomic_compare_exchange_n(&single_state_owner, &expected, hc,
+					   false, __ATOMIC_ACQUIRE,
+					   __ATOMIC_RELAXED) ||
+		expected == hc;
+}
+
+static void release_single_state(struct vb2_hwcrypto_digest_context *hc)
+{
+	__atomic_compare_exchange_n(&single_state_owner, &hc, NULL, false,
+				    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+__attribute__((weak))
+vb2_error_t vb2ex_hwcrypto_digest_init_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	enum vb2_hash_algorithm hash_alg, uint32_t data_size)
+{
+	vb2_error_t rv;
+
+	if (!take_single_state(hc))
+		return VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED;
+
+	rv = vb2ex_hwcrypto_digest_init(hash_alg, data_size);
+	if (rv != VB2_SUCCESS)
+		release_single_state(hc);
+	return rv;
+}
+
+__attribute__((weak))
+vb2_error_t vb2ex_hwcrypto_digest_extend_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	const uint8_t *buf, uint32_t size)
+{
+	vb2_error_t rv;
+
+	if (hc != __atomic_load_n(&single_state_owner, __ATOMIC_RELAXED))
+		return VB2_ERROR_SHA_EXTEND_ALGORITHM;
+
+	/* A digest that failed won't be finalized, so free the engine now */
+	rv = vb2ex_hwcrypto_digest_extend(buf, size);
+	if (rv != VB2_SUCCESS)
+		release_single_state(hc);
+	return rv;
+}
+
+__attribute__((weak))
+vb2_error_t vb2ex_hwcrypto_digest_finalize_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	uint8_t *digest, uint32_t digest_size)
+{
+	vb2_error_t rv;
+
+	if (hc != __atomic_load_n(&single_state_owner, __ATOMIC_RELAXED))
+		return VB2_ERROR_SHA_FINALIZE_ALGORITHM;
+
+	rv = vb2ex_hwcrypto_digest_finalize(digest, digest_size);
+	release_single_state(hc);
+	return rv;
+}
+
+__attribute__((weak))
+void vb2ex_hwcrypto_digest_release_ctx(struct vb2_hwcrypto_digest_context *hc)
+{
+	release_single_state(hc);
+}
+#else
+__attribute__((weak))
+void vb2ex_hwcrypto_digest_release_ctx(struct vb2_hwcrypto_digest_context *hc)
+{
+	/* The built-in engine keeps its whole state in the context */
+}
 #endif
 
 __attribute__((weak))
@@ -0,0 +1,25 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Default asynchronous stream read implementations, for platforms which only
+ * implement the blocking VbExStreamRead().
+ */
+
+#include "2common.h"
+#include "vboot_api.h"
+
+__attribute__((weak))
+vb2_error_t VbExStreamReadSubmit(VbExStream_t stream, uint32_t bytes,
+				 void *buffer, VbExStreamToken_t *token)
+{
+	/* Nothing to overlap with; do the read now and report it here. */
+	*token = NULL;
+	return VbExStreamRead(stream, bytes, buffer);
+}
+
+__attribute__((weak))
+vb2_error_t VbExStreamReadWait(VbExStream_t stream, VbExStreamToken_t token)
+{
+	return VB2_SUCCESS;
+}
@@ -642,6 +642,12 @@ struct vb2_kernel_params {
  */
 #define VB2_DISK_FLAG_EXTERNAL_GPT (1 << 16)
 
+/*
+ * The disk can have several streams open at once, each with a read
+ * outstanding.  Without this, vboot only opens one stream at a time.
+ */
+#define VB2_DISK_FLAG_CONCURRENT_STREAMS (1 << 17)
+
 /* Information on a single disk. */
 struct vb2_disk_info {
 	/* Disk handle. */
@@ -970,6 +976,11 @@ void vb2ex_printf(const char *func, const char *fmt, ...);
 /**
  * Initialize the hardware crypto engine to calculate a block-style digest.
  *
+ * The engine has a single digest state for these calls, so only one digest
+ * can be in progress at a time.  Engines that can run several should
+ * implement vb2ex_hwcrypto_digest_init_ctx() and friends instead; the
+ * default implementations of those call these.
+ *
  * @param hash_alg	Hash algorithm to use
  * @param data_size	Expected total size of data to hash, or 0. If 0, the
  *			total size is not known in advance. Implementations that
@@ -1000,6 +1011,61 @@ vb2_error_t vb2ex_hwcrypto_digest_extend(const uint8_t *buf, uint32_t size);
 vb2_error_t vb2ex_hwcrypto_digest_finalize(uint8_t *digest,
 					   uint32_t digest_size);
 
+struct vb2_hwcrypto_digest_context;
+
+/**
+ * Initialize a digest in the hardware crypto engine, like
+ * vb2ex_hwcrypto_digest_init(), but keeping its state in a caller-provided
+ * context so that several digests can be in progress at once.
+ *
+ * @param hc		Digest state to initialize
+ * @param hash_alg	Hash algorithm to use
+ * @param data_size	Expected total size of data to hash, or 0.  See
+ *			vb2ex_hwcrypto_digest_init().
+ * @return VB2_SUCCESS, or non-zero error code (HWCRYPTO_UNSUPPORTED not fatal).
+ */
+vb2_error_t vb2ex_hwcrypto_digest_init_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	enum vb2_hash_algorithm hash_alg, uint32_t data_size);
+
+/**
+ * Extend a digest started by vb2ex_hwcrypto_digest_init_ctx().
+ *
+ * @param hc		Digest state
+ * @param buf		Next data block to hash
+ * @param size		Length of data block in bytes
+ * @return VB2_SUCCESS, or non-zero error code.
+ */
+vb2_error_t vb2ex_hwcrypto_digest_extend_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	const uint8_t *buf, uint32_t size);
+
+/**
+ * Finalize a digest started by vb2ex_hwcrypto_digest_init_ctx().
+ *
+ * @param hc		Digest state
+ * @param digest	Destination buffer for resulting digest
+ * @param digest_size	Length of digest buffer in bytes
+ * @return VB2_SUCCESS, or non-zero error code.
+ */
+vb2_error_t vb2ex_hwcrypto_digest_finalize_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	uint8_t *digest, uint32_t digest_size);
+
+/**
+ * Drop whatever the hardware crypto engine still holds for a digest context
+ * that is about to be reused.
+ *
+ * vb2_digest_init() calls this before every (re)initialization, so a digest
+ * that was started in hc and then abandoned, without being finalized, does
+ * not keep engine resources.  hc may never have been passed to the engine
+ * before, so its contents must not be trusted; engines that keep nothing
+ * outside the context can leave this as the default, which does nothing.
+ *
+ * @param hc		Digest state about to be reinitialized
+ */
+void vb2ex_hwcrypto_digest_release_ctx(struct vb2_hwcrypto_digest_context *hc);
+
 /**
  * Verify a RSA PKCS1.5 signature in hardware crypto engine
  * against an expected hash digest.
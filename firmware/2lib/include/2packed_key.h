@@ -8,6 +8,14 @@
 #ifndef VBOOT_REFERENCE_2PACKED_KEY_H_
 #define VBOOT_REFERENCE_2PACKED_KEY_H_
 
+#ifdef CHROMEOS_ENVIRONMENT
+/*
+ * Whether keys unpacked on the host allow hwcrypto.  Host tools set this
+ * through vb2_set_crypto_backend() when a hwcrypto provider is linked in.
+ */
+extern bool vb2_host_keys_allow_hwcrypto;
+#endif
+
 /**
  * Unpack a vboot1-format key buffer for use in verification
  *
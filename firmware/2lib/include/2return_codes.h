@@ -852,6 +852,24 @@ enum vb2_return_code {
 	/* cbfstool exited with failure status */
 	VB2_ERROR_CBFSTOOL,
 
+	/* No FMAP area with the requested CBFS region name */
+	VB2_ERROR_CBFS_REGION,
+
+	/* No valid file headers in the CBFS region */
+	VB2_ERROR_CBFS_EMPTY,
+
+	/* File not found in the CBFS region */
+	VB2_ERROR_CBFS_FILE_NOT_FOUND,
+
+	/* CBFS file is compressed, so it can't be read in place */
+	VB2_ERROR_CBFS_COMPRESSED,
+
+	/* No CBFS metadata hash anchor in the bootblock */
+	VB2_ERROR_CBFS_NO_ANCHOR,
+
+	/* A CBFS file hash is missing or doesn't match the file */
+	VB2_ERROR_CBFS_FILE_HASH,
+
 	/**********************************************************************
 	 * Errors generated by host library key functions
 	 */
@@ -994,6 +1012,9 @@ enum vb2_return_code {
 	/* Not enough buffer space to hold signature in vb2_sign_object() */
 	VB2_SIGN_OBJECT_OVERFLOW,
 
+	/* External signer failed in vb2_external_signatures() */
+	VB2_ERROR_EXTERNAL_SIGNER,
+
 	/**********************************************************************
 	 * Errors generated by host library keyblock functions
 	 */
@@ -15,7 +15,47 @@
 
 struct vb2_public_key;
 int vb2_mont_ge(const struct vb2_public_key *key, uint32_t *a);
+void vb2_modpow(const struct vb2_public_key *key, uint8_t *inout,
+		uint32_t *workbuf32, int exp);
 vb2_error_t vb2_check_padding(const uint8_t *sig,
 			      const struct vb2_public_key *key);
 
+#ifdef RSA_MONT64
+/* Montgomery multiplication backends in 2rsa_mont64.c */
+enum vb2_mont64_impl {
+	VB2_MONT64_UNKNOWN = 0,
+	VB2_MONT64_C,		/* unsigned __int128 */
+	VB2_MONT64_ADX,		/* x86-64 MULX/ADCX/ADOX */
+};
+
+/**
+ * Check whether a 64-bit limb backend can run on this CPU.
+ *
+ * @param impl		Backend to check
+ * @return 1 if it can, 0 if not.
+ */
+int vb2_mont64_supported(enum vb2_mont64_impl impl);
+
+/**
+ * In-place public exponentiation on 64-bit limbs, like vb2_modpow().
+ *
+ * @param key		Key to use in signing
+ * @param inout		Input and output big-endian byte array
+ * @param workbuf32	Work buffer of (3 * key->arrsize) elements
+ * @param exp		RSA public exponent: either 65537 (F4) or 3
+ * @param impl		Backend to use
+ * @return 1 if done, 0 if the backend or key size isn't supported.
+ */
+int vb2_modpow64(const struct vb2_public_key *key, uint8_t *inout,
+		 uint32_t *workbuf32, int exp, enum vb2_mont64_impl impl);
+
+/**
+ * vb2_modpow64() with the fastest backend this CPU supports.
+ *
+ * @return 1 if done, 0 if vb2_modpow() must be used instead.
+ */
+int vb2_modpow_accel(const struct vb2_public_key *key, uint8_t *inout,
+		     uint32_t *workbuf32, int exp);
+#endif
+
 #endif  /* VBOOT_REFERENCE_2RSA_PRIVATE_H_ */
@@ -84,6 +84,20 @@ struct vb2_sha512_context {
 #define VB2_SHA384_DIGEST_SIZE 48
 #define VB2_SHA384_ALG_NAME "SHA384"
 
+/*
+ * State of one digest in the hardware crypto engine, for the
+ * vb2ex_hwcrypto_digest_*_ctx() calls.  vboot only provides the storage and
+ * passes it back to the engine, which decides what goes in it.
+ */
+struct vb2_hwcrypto_digest_context {
+	union {
+		/* For engines that hash on the CPU, like 2hwcrypto.c */
+		struct vb2_sha256_context sha256;
+		/* For engines that keep their state elsewhere */
+		void *handle;
+	};
+};
+
 /* Hash algorithm independent digest context; includes all of the above. */
 struct vb2_digest_context {
 	/* Context union for all algorithms */
@@ -97,6 +111,7 @@ struct vb2_digest_context {
 #if VB2_SUPPORT_SHA512
 		struct vb2_sha512_context sha512;
 #endif
+		struct vb2_hwcrypto_digest_context hwcrypto;
 	};
 
 	/* Current hash algorithm */
@@ -257,6 +272,28 @@ vb2_error_t vb2_hash_calculate(bool allow_hwcrypto, const void *buf,
 			       uint32_t size, enum vb2_hash_algorithm algo,
 			       struct vb2_hash *hash);
 
+/* One buffer for vb2_hash_calculate_many() */
+struct vb2_hash_job {
+	const void *buf;	/* Buffer to hash */
+	uint32_t size;		/* Size of |buf| in bytes */
+	struct vb2_hash *hash;	/* Filled with the hash of |buf| */
+};
+
+/**
+ * Fill vb2_hash structures with the hashes of several independent buffers.
+ *
+ * Gives the same results as calling vb2_hash_calculate() on each job, but
+ * host builds may hash several SHA-256 or SHA-512 buffers at once in SIMD
+ * lanes.  HW crypto is never used.
+ *
+ * @param algo		The hash algorithm to use (and store in each hash)
+ * @param jobs		Buffers to hash
+ * @param count		Number of entries in |jobs|
+ * @return VB2_SUCCESS, or non-zero on error.
+ */
+vb2_error_t vb2_hash_calculate_many(enum vb2_hash_algorithm algo,
+				    struct vb2_hash_job *jobs, uint32_t count);
+
 /**
  * Verify that a vb2_hash matches a buffer.
  *
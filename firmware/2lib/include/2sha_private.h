@@ -20,7 +20,7 @@
 extern const uint32_t vb2_sha256_h0[8];
 extern const uint32_t vb2_sha256_k[64];
 extern const uint32_t vb2_hash_seq[8];
-extern struct vb2_sha256_context vb2_sha_ctx;
+extern const uint64_t vb2_sha512_k[80];
 
 #define UNPACK32(x, str)				\
 	{						\
@@ -38,6 +38,132 @@ extern struct vb2_sha256_context vb2_sha_ctx;
 			| ((uint32_t) *((str) + 0) << 24);      \
 	}
 
-void vb2_sha256_transform_hwcrypto(const uint8_t *message,
+/* 'state' is in the vb2_hash_seq order */
+void vb2_sha256_transform_hwcrypto(uint32_t *state, const uint8_t *message,
 				   unsigned int block_nb);
+
+/* Transforms on a standard order state (struct vb2_sha256_context.h) */
+void vb2_sha256_transform_x86ext(uint32_t *h, const uint8_t *message,
+				 unsigned int block_nb);
+int sha256_ce_transform(uint32_t *state, const unsigned char *buf, int blocks);
+
+/**
+ * Run SHA-256 blocks through the fastest transform this CPU supports.
+ *
+ * Only in host builds with SHA_RUNTIME_DISPATCH; firmware picks its
+ * transform at compile time.
+ *
+ * @param h		State, in standard order
+ * @param message	Data to hash
+ * @param block_nb	Number of 64-byte blocks
+ * @return 1 if the blocks were hashed, 0 if the caller must use the C
+ * implementation.
+ */
+int vb2_sha256_transform_accel(uint32_t *h, const uint8_t *message,
+			       unsigned int block_nb);
+
+/* SHA-1 transforms on a standard order state (struct vb2_sha1_context.state) */
+void vb2_sha1_transform_x86ext(uint32_t *state, const uint8_t *message,
+			       unsigned int block_nb);
+void vb2_sha1_transform_armv8ce(uint32_t *state, const uint8_t *message,
+				unsigned int block_nb);
+
+/**
+ * Run SHA-1 blocks through the fastest transform this CPU supports.
+ *
+ * Like vb2_sha256_transform_accel(), only in host builds with
+ * SHA_RUNTIME_DISPATCH.
+ *
+ * @param state		State, in standard order
+ * @param message	Data to hash
+ * @param block_nb	Number of 64-byte blocks
+ * @return 1 if the blocks were hashed, 0 if the caller must use the C
+ * implementation.
+ */
+int vb2_sha1_transform_accel(uint32_t *state, const uint8_t *message,
+			     unsigned int block_nb);
+
+/* SHA-512 transforms on a standard order state (struct vb2_sha512_context.h) */
+void vb2_sha512_transform_avx2(uint64_t *h, const uint8_t *message,
+			       unsigned int block_nb);
+void vb2_sha512_transform_x86ext(uint64_t *h, const uint8_t *message,
+				 unsigned int block_nb);
+void vb2_sha512_transform_armv8ce(uint64_t *h, const uint8_t *message,
+				  unsigned int block_nb);
+
+/**
+ * Run SHA-512 blocks through the fastest transform this CPU supports.
+ *
+ * Like vb2_sha256_transform_accel(), only in host builds with
+ * SHA_RUNTIME_DISPATCH.
+ *
+ * @param h		State, in standard order
+ * @param message	Data to hash
+ * @param block_nb	Number of 128-byte blocks
+ * @return 1 if the blocks were hashed, 0 if the caller must use the C
+ * implementation.
+ */
+int vb2_sha512_transform_accel(uint64_t *h, const uint8_t *message,
+			       unsigned int block_nb);
+
+/* Transforms vb2_sha*_transform_accel() choose from */
+enum vb2_sha_engine {
+	/* Not probed yet; for vb2_sha_force_engine(), the fastest engine */
+	VB2_SHA_ENGINE_AUTO = 0,
+	VB2_SHA_ENGINE_C,
+	VB2_SHA_ENGINE_X86_SHA,
+	VB2_SHA_ENGINE_X86_AVX2,
+	VB2_SHA_ENGINE_ARMV8_CE,
+};
+
+/**
+ * Make vb2_sha*_transform_accel() use a particular engine for an algorithm.
+ *
+ * For tests and benchmarks, which need to reach engines that would not be
+ * picked on this CPU.  Only in host builds with SHA_RUNTIME_DISPATCH.
+ *
+ * @param algo		Hash algorithm; SHA-224 and SHA-384 share the
+ *			engine of SHA-256 and SHA-512
+ * @param engine	Engine to use, or VB2_SHA_ENGINE_AUTO for the
+ *			fastest one available
+ * @return 1 if the engine is now in use, 0 if it was not built in or this
+ * CPU lacks it, in which case the previous choice stays.
+ */
+int vb2_sha_force_engine(enum vb2_hash_algorithm algo,
+			 enum vb2_sha_engine engine);
+
+/* Multi-buffer hashing of whole jobs, 8 SHA-256 or 4 SHA-512 at a time */
+void vb2_sha256_mb_avx2(enum vb2_hash_algorithm algo,
+			struct vb2_hash_job *jobs, uint32_t count);
+void vb2_sha512_mb_avx2(enum vb2_hash_algorithm algo,
+			struct vb2_hash_job *jobs, uint32_t count);
+
+/**
+ * Hash several buffers at once in SIMD lanes, if this CPU benefits.
+ *
+ * Only in host builds with SHA_RUNTIME_DISPATCH.
+ *
+ * @param algo		Hash algorithm
+ * @param jobs		Buffers to hash
+ * @param count		Number of entries in |jobs|
+ * @return 1 if the jobs were hashed, 0 if the caller must hash them one
+ * by one.
+ */
+int vb2_hash_calculate_many_accel(enum vb2_hash_algorithm algo,
+				  struct vb2_hash_job *jobs, uint32_t count);
+
+/**
+ * Make vb2_hash_calculate_many_accel() use a particular multi-buffer engine.
+ *
+ * Like vb2_sha_force_engine(), for tests and benchmarks.  A forced engine is
+ * used for any number of jobs, even where the single-buffer transforms
+ * would be faster.
+ *
+ * @param engine	VB2_SHA_ENGINE_X86_AVX2, VB2_SHA_ENGINE_C to always
+ *			hash jobs one by one, or VB2_SHA_ENGINE_AUTO to
+ *			go back to choosing by CPU and job count
+ * @return 1 if the engine is now in use, 0 if it was not built in or this
+ * CPU lacks it, in which case the previous choice stays.
+ */
+int vb2_sha_force_many_engine(enum vb2_sha_engine engine);
 #endif  /* VBOOT_REFERENCE_2SHA_PRIVATE_H_ */
@@ -69,6 +69,9 @@ enum {
 /* If this bit is 1, the GPT is stored in another from the streaming data */
 #define GPT_FLAG_EXTERNAL	0x1
 
+/* Size of GptData.kernel_candidates; at least MAX_NUMBER_OF_ENTRIES */
+#define GPT_MAX_KERNEL_CANDIDATES 128
+
 /*
  * A note about stored_on_device and gpt_drive_sectors:
  *
@@ -113,6 +116,17 @@ typedef struct {
 	/* Internal variables */
 	uint8_t valid_headers, valid_entries, ignored;
 	int current_priority;
+	/*
+	 * Table indices of kernel entries with priority and tries or
+	 * successful set, highest priority first and in table order within a
+	 * priority.  Only indices are kept to keep GptData small; the
+	 * attributes are read from the entries themselves.  Built by
+	 * GptInit() and kept up to date by GptUpdateKernelWithEntry().
+	 */
+	uint8_t kernel_candidates[GPT_MAX_KERNEL_CANDIDATES];
+	uint8_t num_kernel_candidates;
+	/* Next kernel_candidates[] slot for GptNextKernelEntry() to look at */
+	uint8_t next_kernel_candidate;
 } GptData;
 
 /**
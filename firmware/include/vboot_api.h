@@ -83,6 +83,9 @@ typedef void *VbExStream_t;
  * This is used for access to the contents of the actual partitions on the
  * device. It is not used to access the GPT. The size of the content addressed
  * is within streaming_lba_count.
+ *
+ * Vboot only has one stream open on a disk at a time, unless the disk sets
+ * VB2_DISK_FLAG_CONCURRENT_STREAMS.
  */
 vb2_error_t VbExStreamOpen(vb2ex_disk_handle_t handle, uint64_t lba_start,
 			   uint64_t lba_count, VbExStream_t *stream_ptr);
@@ -109,6 +112,43 @@ vb2_error_t VbExStreamRead(VbExStream_t stream, uint32_t bytes, void *buffer);
  */
 void VbExStreamClose(VbExStream_t stream);
 
+/* Optional asynchronous extension to the streaming read interface */
+typedef void *VbExStreamToken_t;
+
+/**
+ * Start reading from a stream on a disk, without waiting for the data
+ *
+ * @param stream	Stream to read from
+ * @param bytes		Number of bytes to read
+ * @param buffer	Destination to read into; must not be touched by the
+ *			caller until VbExStreamReadWait() returns
+ * @param token		out-parameter for the completion token to pass to
+ *			VbExStreamReadWait()
+ *
+ * @return Error code, or VB2_SUCCESS.
+ *
+ * Reads are consumed from the stream in submission order, exactly as if
+ * VbExStreamRead() had been called.  Vboot keeps at most one read
+ * outstanding on a stream at a time.  Closing a stream must wait for or
+ * cancel any outstanding reads.
+ *
+ * Platforms which do not implement this get a default which simply calls
+ * VbExStreamRead() before returning.
+ */
+vb2_error_t VbExStreamReadSubmit(VbExStream_t stream, uint32_t bytes,
+				 void *buffer, VbExStreamToken_t *token);
+
+/**
+ * Wait for a read started by VbExStreamReadSubmit() to complete
+ *
+ * @param stream	Stream the read was submitted on
+ * @param token		Completion token returned by VbExStreamReadSubmit()
+ *
+ * @return Error code, or VB2_SUCCESS. Failure to read as much data as
+ * requested is an error.
+ */
+vb2_error_t VbExStreamReadWait(VbExStream_t stream, VbExStreamToken_t token);
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
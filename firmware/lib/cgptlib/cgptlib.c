@@ -11,6 +11,47 @@
 #include "gpt.h"
 #include "vboot_api.h"
 
+_Static_assert(GPT_MAX_KERNEL_CANDIDATES >= MAX_NUMBER_OF_ENTRIES,
+	       "Too few kernel candidate slots");
+
+/**
+ * Rebuild the list of kernel entries GptNextKernelEntry() walks through.
+ *
+ * Priorities are only 4 bits, so a counting sort gets them in order in two
+ * passes over the table while keeping table order within each priority.
+ */
+static void GptBuildKernelCandidates(GptData *gpt)
+{
+	GptHeader *header = (GptHeader *)gpt->primary_header;
+	GptEntry *entries = (GptEntry *)gpt->primary_entries;
+	uint8_t slot[CGPT_ATTRIBUTE_MAX_PRIORITY + 1] = {0};
+	GptEntry *e;
+	uint32_t i;
+	int prio, total = 0;
+
+	for (i = 0, e = entries; i < header->number_of_entries; i++, e++) {
+		if (IsKernelEntry(e) && GetEntryPriority(e) &&
+		    (GetEntrySuccessful(e) || GetEntryTries(e)))
+			slot[GetEntryPriority(e)]++;
+	}
+
+	/* Turn the counts into the first slot for each priority */
+	for (prio = CGPT_ATTRIBUTE_MAX_PRIORITY; prio > 0; prio--) {
+		int count = slot[prio];
+		slot[prio] = total;
+		total += count;
+	}
+
+	for (i = 0, e = entries; i < header->number_of_entries; i++, e++) {
+		if (IsKernelEntry(e) && GetEntryPriority(e) &&
+		    (GetEntrySuccessful(e) || GetEntryTries(e)))
+			gpt->kernel_candidates[slot[GetEntryPriority(e)]++] = i;
+	}
+
+	gpt->num_kernel_candidates = total;
+	gpt->next_kernel_candidate = 0;
+}
+
 int GptInit(GptData *gpt)
 {
 	int retval;
@@ -18,6 +59,8 @@ int GptInit(GptData *gpt)
 	gpt->modified = 0;
 	gpt->current_kernel = CGPT_KERNEL_ENTRY_NOT_FOUND;
 	gpt->current_priority = 999;
+	gpt->num_kernel_candidates = 0;
+	gpt->next_kernel_candidate = 0;
 
 	retval = GptValidityCheck(gpt);
 	if (GPT_SUCCESS != retval) {
@@ -26,86 +69,56 @@ int GptInit(GptData *gpt)
 	}
 
 	GptRepair(gpt);
+	GptBuildKernelCandidates(gpt);
+	VB2_DEBUG("GptInit() found %d kernel candidates\n",
+		  gpt->num_kernel_candidates);
 	return GPT_SUCCESS;
 }
 
 int GptNextKernelEntry(GptData *gpt, uint64_t *start_sector, uint64_t *size)
 {
-	GptHeader *header = (GptHeader *)gpt->primary_header;
 	GptEntry *entries = (GptEntry *)gpt->primary_entries;
-	GptEntry *e;
-	int new_kernel = CGPT_KERNEL_ENTRY_NOT_FOUND;
-	int new_prio = 0;
-	uint32_t i;
+	GptEntry *e = NULL;
+	int index = 0, priority = 0;
 
 	/*
-	 * If we already found a kernel, continue the scan at the current
-	 * kernel's priority, in case there is another kernel with the same
-	 * priority.
+	 * Candidates are sorted in the order we want to try them, so the next
+	 * kernel is the first one past the kernel we returned last time: the
+	 * same priority later in the table, or else the highest lower
+	 * priority.  The list may have been rebuilt since that call, so check
+	 * rather than trusting next_kernel_candidate alone.
 	 */
-	if (gpt->current_kernel != CGPT_KERNEL_ENTRY_NOT_FOUND) {
-		for (i = gpt->current_kernel + 1;
-		     i < header->number_of_entries; i++) {
-			e = entries + i;
-			if (!IsKernelEntry(e))
-				continue;
-			VB2_DEBUG("GptNextKernelEntry looking at same prio "
-				  "partition %d\n", i+1);
-			VB2_DEBUG("GptNextKernelEntry s%d t%d p%d\n",
-				  GetEntrySuccessful(e), GetEntryTries(e),
-				  GetEntryPriority(e));
-			if (!(GetEntrySuccessful(e) || GetEntryTries(e)))
-				continue;
-			if (GetEntryPriority(e) == gpt->current_priority) {
-				gpt->current_kernel = i;
-				*start_sector = e->starting_lba;
-				*size = e->ending_lba - e->starting_lba + 1;
-				VB2_DEBUG("GptNextKernelEntry likes it\n");
-				return GPT_SUCCESS;
-			}
-		}
-	}
-
-	/*
-	 * We're still here, so scan for the remaining kernel with the highest
-	 * priority less than the previous attempt.
-	 */
-	for (i = 0, e = entries; i < header->number_of_entries; i++, e++) {
-		int current_prio = GetEntryPriority(e);
-		if (!IsKernelEntry(e))
-			continue;
-		VB2_DEBUG("GptNextKernelEntry looking at new prio "
-			  "partition %d\n", i+1);
-		VB2_DEBUG("GptNextKernelEntry s%d t%d p%d\n",
-			  GetEntrySuccessful(e), GetEntryTries(e),
-			  GetEntryPriority(e));
-		if (!(GetEntrySuccessful(e) || GetEntryTries(e)))
+	for (; gpt->next_kernel_candidate < gpt->num_kernel_candidates;
+	     gpt->next_kernel_candidate++) {
+		index = gpt->kernel_candidates[gpt->next_kernel_candidate];
+		e = entries + index;
+		priority = GetEntryPriority(e);
+		if (priority > gpt->current_priority)
 			continue;
-		if (current_prio >= gpt->current_priority) {
-			/* Already returned this kernel in a previous call */
+		if (priority == gpt->current_priority &&
+		    (gpt->current_kernel == CGPT_KERNEL_ENTRY_NOT_FOUND ||
+		     index <= gpt->current_kernel))
 			continue;
-		}
-		if (current_prio > new_prio) {
-			new_kernel = i;
-			new_prio = current_prio;
-		}
+		break;
 	}
 
-	/*
-	 * Save what we found.  Note that if we didn't find a new kernel,
-	 * new_prio will still be -1, so future calls to this function will
-	 * also fail.
-	 */
-	gpt->current_kernel = new_kernel;
-	gpt->current_priority = new_prio;
-
-	if (CGPT_KERNEL_ENTRY_NOT_FOUND == new_kernel) {
+	if (gpt->next_kernel_candidate >= gpt->num_kernel_candidates) {
+		/*
+		 * Leave current_priority at 0 so future calls to this function
+		 * will also fail.
+		 */
+		gpt->current_kernel = CGPT_KERNEL_ENTRY_NOT_FOUND;
+		gpt->current_priority = 0;
 		VB2_DEBUG("GptNextKernelEntry no more kernels\n");
 		return GPT_ERROR_NO_VALID_KERNEL;
 	}
 
-	VB2_DEBUG("GptNextKernelEntry likes partition %d\n", new_kernel + 1);
-	e = entries + new_kernel;
+	gpt->current_kernel = index;
+	gpt->current_priority = priority;
+	gpt->next_kernel_candidate++;
+
+	VB2_DEBUG("GptNextKernelEntry likes partition %d (s%d t%d p%d)\n",
+		  index + 1, GetEntrySuccessful(e), GetEntryTries(e), priority);
 	*start_sector = e->starting_lba;
 	*size = e->ending_lba - e->starting_lba + 1;
 	return GPT_SUCCESS;
@@ -185,6 +198,7 @@ int GptUpdateKernelWithEntry(GptData *gpt, GptEntry *e, uint32_t update_type)
 
 	if (modified) {
 		GptModified(gpt);
+		GptBuildKernelCandidates(gpt);
 	}
 
 	return GPT_SUCCESS;
@@ -0,0 +1,34 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * CRC32 (IEEE 802.3, as used by GPT) using the AArch64 CRC32 instructions.
+ * These are optional in ARMv8.0 and mandatory from ARMv8.1, so only build
+ * this for CPUs known to have them.
+ */
+
+#include "2sysincludes.h"
+#include "crc32.h"
+
+static inline uint32_t vb2_crc32x(uint32_t crc, uint64_t value)
+{
+	asm ("crc32x %w0, %w0, %x1" : "+r"(crc) : "r"(value));
+	return crc;
+}
+
+uint32_t Crc32HwUpdate(uint32_t *crc, const uint8_t *buf, uint32_t len)
+{
+	uint32_t value = *crc;
+	uint32_t done;
+
+	/* crc32x takes the doubleword in little-endian byte order */
+	for (done = 0; len - done >= 8; done += 8) {
+		uint64_t word;
+
+		memcpy(&word, buf + done, sizeof(word));
+		value = vb2_crc32x(value, word);
+	}
+
+	*crc = value;
+	return done;
+}
@@ -0,0 +1,118 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * CRC32 (IEEE 802.3, as used by GPT) using the x86 PCLMULQDQ instruction.
+ *
+ * Folds the buffer 64 bytes at a time with carry-less multiplies, as in
+ * Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction", then reduces the remaining 128 bits of state to 32 with a
+ * Barrett reduction.  crc32.c handles any tail shorter than 16 bytes.
+ */
+
+#include <cpuid.h>
+
+#include "2sysincludes.h"
+#include "crc32.h"
+
+typedef long long vb2_m128i __attribute__ ((vector_size(16)));
+
+/*
+ * Fold constants: bit-reflected x^n mod P, shifted left by one.
+ * Low qword multiplies the older half of a block, high qword the newer.
+ */
+static const vb2_m128i fold_by_4 = {
+	0x154442bd4LL,	/* x^(4*128+32) mod P */
+	0x1c6e41596LL,	/* x^(4*128-32) mod P */
+};
+static const vb2_m128i fold_by_1 = {
+	0x1751997d0LL,	/* x^(128+32) mod P */
+	0x0ccaa009eLL,	/* x^(128-32) mod P */
+};
+#define FOLD_64		0x163cd6124ULL	/* x^64 mod P */
+#define BARRETT_P	0x1db710641ULL	/* P, bit-reflected */
+#define BARRETT_MU	0x1f7011641ULL	/* x^64 / P, bit-reflected */
+
+static inline vb2_m128i vb2_loadu_si128(const uint8_t *ptr)
+{
+	vb2_m128i result;
+	asm volatile ("movdqu %1, %0" : "=x"(result) : "m"(*ptr));
+	return result;
+}
+
+static inline vb2_m128i vb2_clmul_epi64(vb2_m128i a, vb2_m128i b, int imm8)
+{
+	asm ("pclmulqdq %2, %1, %0" : "+x"(a) : "xm"(b), "i"(imm8));
+	return a;
+}
+
+/* Fold a 16-byte block of state forward over 'k' bytes and add in 'next' */
+static inline vb2_m128i fold(vb2_m128i x, vb2_m128i k, vb2_m128i next)
+{
+	return vb2_clmul_epi64(x, k, 0x00) ^ vb2_clmul_epi64(x, k, 0x11) ^
+	       next;
+}
+
+/* Carry-less multiply of two values whose product fits in 64 bits */
+static inline uint64_t clmul64(uint64_t a, uint64_t b)
+{
+	vb2_m128i va = {(long long)a, 0};
+	vb2_m128i vb = {(long long)b, 0};
+
+	return (uint64_t)vb2_clmul_epi64(va, vb, 0x00)[0];
+}
+
+static int pclmul_supported(void)
+{
+	static int supported = -1;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (supported < 0)
+		supported = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+			    (ecx & bit_PCLMUL) && (edx & bit_SSE2);
+
+	return supported;
+}
+
+uint32_t Crc32HwUpdate(uint32_t *crc, const uint8_t *buf, uint32_t len)
+{
+	vb2_m128i x0, x1, x2, x3;
+	uint64_t lo, hi, t;
+	uint32_t done;
+
+	/* Not worth setting up for less than two rounds of folding */
+	if (len < 128 || !pclmul_supported())
+		return 0;
+
+	x0 = vb2_loadu_si128(buf);
+	x1 = vb2_loadu_si128(buf + 16);
+	x2 = vb2_loadu_si128(buf + 32);
+	x3 = vb2_loadu_si128(buf + 48);
+	x0[0] ^= *crc;
+
+	for (done = 64; len - done >= 64; done += 64) {
+		x0 = fold(x0, fold_by_4, vb2_loadu_si128(buf + done));
+		x1 = fold(x1, fold_by_4, vb2_loadu_si128(buf + done + 16));
+		x2 = fold(x2, fold_by_4, vb2_loadu_si128(buf + done + 32));
+		x3 = fold(x3, fold_by_4, vb2_loadu_si128(buf + done + 48));
+	}
+
+	x0 = fold(x0, fold_by_1, x1);
+	x0 = fold(x0, fold_by_1, x2);
+	x0 = fold(x0, fold_by_1, x3);
+
+	for (; len - done >= 16; done += 16)
+		x0 = fold(x0, fold_by_1, vb2_loadu_si128(buf + done));
+
+	/* Fold 128 bits down to 96, then 64 */
+	x1 = vb2_clmul_epi64(x0, fold_by_1, 0x10);
+	lo = (uint64_t)x1[0] ^ (uint64_t)x0[1];
+	hi = (uint64_t)x1[1];
+	t = (lo >> 32 | hi << 32) ^ clmul64(lo & 0xffffffff, FOLD_64);
+
+	/* Barrett reduction from 64 bits to 32 */
+	lo = clmul64(t & 0xffffffff, BARRETT_MU);
+	lo = clmul64(lo & 0xffffffff, BARRETT_P);
+	*crc = (uint32_t)((t ^ lo) >> 32);
+	return done;
+}
@@ -10,4 +10,33 @@
 
 uint32_t Crc32(const void *buffer, uint32_t len);
 
+/**
+ * Update the CRC32 of a buffer after some bytes in it changed, without
+ * looking at the rest of the buffer.
+ *
+ * @param crc		CRC32 of the whole buffer before the change
+ * @param old_data	Previous contents of the changed range
+ * @param new_data	New contents of the changed range
+ * @param len		Length of the changed range in bytes
+ * @param tail_len	Number of bytes in the buffer after the changed range
+ * @return The CRC32 of the whole buffer after the change.
+ */
+uint32_t Crc32Patch(uint32_t crc, const void *old_data, const void *new_data,
+		    uint32_t len, uint32_t tail_len);
+
+/**
+ * Feed the start of a buffer through a CPU-specific CRC32 engine.
+ *
+ * Implemented by crc32_x86.c (PCLMULQDQ) or crc32_arm.c (ARMv8 CRC32
+ * instructions) when built with X86_CRC32_EXT or ARMV8_CRC32_EXT.  Crc32()
+ * handles whatever is left over in software.
+ *
+ * @param crc		Raw CRC register (not inverted), updated in place
+ * @param buf		Data to checksum
+ * @param len		Length of data in bytes
+ * @return The number of bytes consumed from the start of buf, which may be
+ * zero if the CPU lacks the instructions needed.
+ */
+uint32_t Crc32HwUpdate(uint32_t *crc, const uint8_t *buf, uint32_t len);
+
 #endif  /* VBOOT_REFERENCE_CRC32_H_ */
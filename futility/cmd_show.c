@@ -30,6 +30,7 @@
 #include "futility_options.h"
 #include "host_common.h"
 #include "host_key21.h"
+#include "host_key_cache.h"
 #include "host_misc.h"
 #include "util_misc.h"
 #include "vb1_helper.h"
@@ -296,9 +297,9 @@ int show_fw_preamble_buf(const char *fname, uint8_t *buf, uint32_t len,
 	if (state) {
 		if (!sign_key &&
 		    state->rootkey.is_valid &&
-		    VB2_SUCCESS == vb2_unpack_key_buffer(&root_key,
-							 state->rootkey.buf,
-							 state->rootkey.len)) {
+		    VB2_SUCCESS == vb2_unpack_key_buffer_cached(
+				&root_key, state->rootkey.buf,
+				state->rootkey.len)) {
 			/* BIOS should have a rootkey in the GBB */
 			sign_key = &root_key;
 		}
@@ -321,7 +322,8 @@ int show_fw_preamble_buf(const char *fname, uint8_t *buf, uint32_t len,
 		retval = 1;
 
 	struct vb2_public_key data_key;
-	if (VB2_SUCCESS != vb2_unpack_key(&data_key, &keyblock->data_key)) {
+	if (VB2_SUCCESS != vb2_unpack_key_cached(&data_key,
+						 &keyblock->data_key)) {
 		ERROR("Parsing data key in %s\n", print_name);
 		FT_PARSEABLE_PRINT("data_key::invalid\n");
 		return 1;
@@ -477,7 +479,8 @@ int ft_show_kernel_preamble(const char *fname)
 	show_keyblock(keyblock, NULL, !!sign_key, good_sig);
 
 	struct vb2_public_key data_key;
-	if (VB2_SUCCESS != vb2_unpack_key(&data_key, &keyblock->data_key)) {
+	if (VB2_SUCCESS != vb2_unpack_key_cached(&data_key,
+						 &keyblock->data_key)) {
 		ERROR("Parsing data key in %s\n", fname);
 		goto done;
 	}
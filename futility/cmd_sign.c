@@ -13,8 +13,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "2common.h"
@@ -25,6 +27,7 @@
 #include "host_common.h"
 #include "host_common21.h"
 #include "host_key21.h"
+#include "host_keyblock.h"
 #include "kernel_blob.h"
 #include "util_misc.h"
 #include "vb1_helper.h"
@@ -47,6 +50,10 @@ struct sign_option_s sign_option = {
 	.sig_size = 1024,
 };
 
+/* Manifest to sign from, and how many files to sign at once (0 = CPUs) */
+static const char *batch_manifest;
+static uint32_t batch_jobs;
+
 /* Helper to complain about invalid args. Returns num errors discovered */
 static int no_opt_if(bool expr, const char *optname)
 {
@@ -67,6 +74,85 @@ static int bad_opt_if(bool expr, const char *optname)
 	return 0;
 }
 
+/*
+ * Keys read so far.  A batch signs many files with the same few keys, so
+ * each key file is read (and for private keys, decoded) only once.  The
+ * keys stay around until the command is done.
+ */
+enum key_kind {
+	KEY_PRIVATE,		/* .vbprivk */
+	KEY_PRIVATE_PEM,	/* .pem, for a given algorithm */
+	KEY_KEYBLOCK,		/* .keyblock */
+	KEY_PACKED,		/* .vbpubk */
+};
+
+struct key_cache_entry {
+	char *path;
+	enum key_kind kind;
+	uint32_t pem_algo;
+	void *key;
+	struct key_cache_entry *next;
+};
+
+static struct key_cache_entry *key_cache;
+
+static void *read_key_cached(const char *path, enum key_kind kind,
+			     uint32_t pem_algo)
+{
+	struct key_cache_entry *e;
+	void *key = NULL;
+
+	for (e = key_cache; e; e = e->next)
+		if (e->kind == kind && !strcmp(e->path, path) &&
+		    (kind != KEY_PRIVATE_PEM || e->pem_algo == pem_algo))
+			return e->key;
+
+	switch (kind) {
+	case KEY_PRIVATE:
+		key = vb2_read_private_key(path);
+		break;
+	case KEY_PRIVATE_PEM:
+		key = vb2_read_private_key_pem(path, pem_algo);
+		break;
+	case KEY_KEYBLOCK:
+		key = vb2_read_keyblock(path);
+		break;
+	case KEY_PACKED:
+		key = vb2_read_packed_key(path);
+		break;
+	}
+	if (!key)
+		return NULL;
+
+	e = malloc(sizeof(*e));
+	if (!e)
+		FATAL("Failed to allocate key cache entry\n");
+	e->path = strdup(path);
+	if (!e->path)
+		FATAL("Failed to allocate string\n");
+	e->kind = kind;
+	e->pem_algo = pem_algo;
+	e->key = key;
+	e->next = key_cache;
+	key_cache = e;
+	return key;
+}
+
+static void free_key_cache(void)
+{
+	struct key_cache_entry *e;
+
+	while ((e = key_cache)) {
+		key_cache = e->next;
+		if (e->kind == KEY_PRIVATE || e->kind == KEY_PRIVATE_PEM)
+			vb2_free_private_key(e->key);
+		else
+			free(e->key);
+		free(e->path);
+		free(e);
+	}
+}
+
 /* This wraps/signs a public key, producing a keyblock. */
 int ft_sign_pubkey(const char *fname)
 {
@@ -88,6 +174,8 @@ int ft_sign_pubkey(const char *fname)
 	if (sign_option.pem_signpriv) {
 		if (sign_option.pem_external) {
 			/* External signing uses the PEM file directly. */
+			vb2_set_external_signer_persistent(
+				sign_option.pem_external_persistent);
 			block = vb2_create_keyblock_external(
 				data_key,
 				sign_option.pem_signpriv,
@@ -95,8 +183,8 @@ int ft_sign_pubkey(const char *fname)
 				sign_option.flags,
 				sign_option.pem_external);
 		} else {
-			sign_option.signprivate = vb2_read_private_key_pem(
-				sign_option.pem_signpriv,
+			sign_option.signprivate = read_key_cached(
+				sign_option.pem_signpriv, KEY_PRIVATE_PEM,
 				sign_option.pem_algo);
 			if (!sign_option.signprivate) {
 				ERROR(
@@ -125,59 +213,44 @@ done:
 
 int ft_sign_raw_kernel(const char *fname)
 {
-	uint8_t *vmlinuz_data = NULL, *kblob_data = NULL, *vblock_data = NULL;
-	uint32_t vmlinuz_size, kblob_size, vblock_size;
+	uint8_t *vmlinuz_data = NULL;
+	uint32_t vmlinuz_size;
 	int rv = 1;
 	int fd = -1;
 
+	/* We should be creating a completely new output file.
+	 * If not, something's wrong. */
+	if (!sign_option.create_new_outfile)
+		FATAL("create_new_outfile should be selected\n");
+
 	if (futil_open_and_map_file(fname, &fd, FILE_MODE_SIGN(sign_option),
 				    &vmlinuz_data, &vmlinuz_size))
 		return 1;
 
-	kblob_data = CreateKernelBlob(
-		vmlinuz_data, vmlinuz_size,
-		sign_option.arch, sign_option.kloadaddr,
-		sign_option.config_data, sign_option.config_size,
-		sign_option.bootloader_data, sign_option.bootloader_size,
-		&kblob_size);
-	if (!kblob_data) {
-		ERROR("Unable to create kernel blob\n");
+	/* The kernel is read while the output is written */
+	if (futil_is_same_file(fd, sign_option.outfile)) {
+		ERROR("Can't write the kernel partition over %s\n", fname);
 		goto done;
 	}
-	VB2_DEBUG("kblob_size = %#x\n", kblob_size);
 
-	vblock_data = SignKernelBlob(kblob_data, kblob_size,
-				     sign_option.padding,
-				     sign_option.version,
-				     sign_option.kloadaddr,
-				     sign_option.keyblock,
-				     sign_option.signprivate,
-				     sign_option.flags, &vblock_size);
-	if (!vblock_data) {
-		ERROR("Unable to sign kernel blob\n");
-		goto done;
-	}
-	VB2_DEBUG("vblock_size = %#x\n", vblock_size);
-
-	/* We should be creating a completely new output file.
-	 * If not, something's wrong. */
-	if (!sign_option.create_new_outfile)
-		FATAL("create_new_outfile should be selected\n");
-
-	if (sign_option.vblockonly)
-		rv = WriteSomeParts(sign_option.outfile,
-				    vblock_data, vblock_size,
-				    NULL, 0);
-	else
-		rv = WriteSomeParts(sign_option.outfile,
-				    vblock_data, vblock_size,
-				    kblob_data, kblob_size);
+	rv = WriteKernelPartition(sign_option.outfile, sign_option.vblockonly,
+				  vmlinuz_data, vmlinuz_size,
+				  sign_option.arch, sign_option.kloadaddr,
+				  sign_option.config_data,
+				  sign_option.config_size,
+				  sign_option.bootloader_data,
+				  sign_option.bootloader_size,
+				  sign_option.padding,
+				  sign_option.version,
+				  sign_option.keyblock,
+				  sign_option.signprivate,
+				  sign_option.flags);
+	if (rv)
+		ERROR("Unable to create kernel partition\n");
 
 done:
 	futil_unmap_and_close_file(fd, FILE_MODE_SIGN(sign_option),
 				   vmlinuz_data, vmlinuz_size);
-	free(vblock_data);
-	free(kblob_data);
 	return rv;
 }
 
@@ -361,7 +434,7 @@ static int load_keyset(void)
 			     "vbprivk") <= 0)
 			FATAL("Failed to allocate string\n");
 		INFO("Loading private data key from default keyset: %s\n", buf);
-		sign_option.signprivate = vb2_read_private_key(buf);
+		sign_option.signprivate = read_key_cached(buf, KEY_PRIVATE, 0);
 		if (!sign_option.signprivate) {
 			ERROR("Reading %s\n", buf);
 			errorcnt++;
@@ -374,7 +447,7 @@ static int load_keyset(void)
 			     "keyblock") <= 0)
 			FATAL("Failed to allocate string\n");
 		INFO("Loading keyblock from default keyset: %s\n", buf);
-		sign_option.keyblock = vb2_read_keyblock(buf);
+		sign_option.keyblock = read_key_cached(buf, KEY_KEYBLOCK, 0);
 		if (!sign_option.keyblock) {
 			ERROR("Reading %s\n", buf);
 			errorcnt++;
@@ -387,7 +460,7 @@ static int load_keyset(void)
 			     "vbpubk") <= 0)
 			FATAL("Failed to allocate string\n");
 		INFO("Loading kernel subkey from default keyset: %s\n", buf);
-		sign_option.kernel_subkey = vb2_read_packed_key(buf);
+		sign_option.kernel_subkey = read_key_cached(buf, KEY_PACKED, 0);
 		if (!sign_option.kernel_subkey) {
 			ERROR("Reading %s\n", buf);
 			errorcnt++;
@@ -419,6 +492,10 @@ static const char usage_pubkey[] = "\n"
 	"  --pem_external   PROGRAM"
 	"         External program to compute the signature\n"
 	"                                     (requires a PEM signing key)\n"
+	"  --pem_external_persistent\n"
+	"                                   Start PROGRAM once, as \"PROGRAM\n"
+	"                                     --persistent FILE.pem\", and send\n"
+	"                                     it length-prefixed requests\n"
 	"\n";
 static void print_help_pubkey(int argc, char *argv[])
 {
@@ -676,6 +753,7 @@ static void (*help_type[NUM_FILE_TYPES])(int argc, char *argv[]) = {
 
 static const char usage_default[] = "\n"
 	"Usage:  " MYNAME " %s [PARAMS] INFILE [OUTFILE]\n"
+	"        " MYNAME " %s [PARAMS] --batch MANIFEST [--jobs NUM]\n"
 	"\n"
 	"The following signing operations are supported:\n"
 	"\n"
@@ -688,13 +766,19 @@ static const char usage_default[] = "\n"
 	"  usbpd1 firmware image               same, or signed in-place\n"
 	"  RW device image                     same, or signed in-place\n"
 	"\n"
+	"With --batch, each line of MANIFEST holds the [PARAMS] INFILE [OUTFILE]\n"
+	"for one file, added to the PARAMS on the command line. Each key is\n"
+	"read only once, NUM files (default: one per CPU) are signed at a time,\n"
+	"and the result for each line is printed. Lines starting with # are\n"
+	"ignored. No two lines may write the same file.\n"
+	"\n"
 	"For more information, use \"" MYNAME " help %s TYPE\", where\n"
 	"TYPE is one of:\n\n";
 static void print_help_default(int argc, char *argv[])
 {
 	enum futil_file_type type;
 
-	printf(usage_default, argv[0], argv[0]);
+	printf(usage_default, argv[0], argv[0], argv[0]);
 	for (type = 0; type < NUM_FILE_TYPES; type++)
 		if (help_type[type])
 			printf("  %s", futil_file_type_name(type));
@@ -736,6 +820,8 @@ enum no_short_opts {
 	OPT_SIG_SIZE,
 	OPT_PRIKEY,
 	OPT_ECRW_OUT,
+	OPT_BATCH,
+	OPT_JOBS,
 	OPT_HELP,
 };
 
@@ -763,6 +849,8 @@ static const struct option long_opts[] = {
 	{"pem",          1, NULL, OPT_PEM_SIGNPRIV}, /* alias */
 	{"pem_algo",     1, NULL, OPT_PEM_ALGO},
 	{"pem_external", 1, NULL, OPT_PEM_EXTERNAL},
+	{"pem_external_persistent", 0,
+	 &sign_option.pem_external_persistent, 1},
 	{"type",         1, NULL, OPT_TYPE},
 	{"vblockonly",   0, &sign_option.vblockonly, 1},
 	{"hash_alg",     1, NULL, OPT_HASH_ALG},
@@ -775,6 +863,8 @@ static const struct option long_opts[] = {
 	{"prikey",       1, NULL, OPT_PRIKEY},
 	{"privkey",      1, NULL, OPT_PRIKEY},	/* alias */
 	{"ecrw_out",     1, NULL, OPT_ECRW_OUT},
+	{"batch",        1, NULL, OPT_BATCH},
+	{"jobs",         1, NULL, OPT_JOBS},
 	{"help",         0, NULL, OPT_HELP},
 	{NULL,           0, NULL, 0},
 };
@@ -793,35 +883,49 @@ static int parse_number_opt(const char *arg, const char *name, uint32_t *dest)
 	return 0;
 }
 
-static int do_sign(int argc, char *argv[])
+/*
+ * Parse the options for one signing operation into sign_option.  Returns
+ * the number of errors.
+ */
+static int parse_sign_args(int argc, char *argv[], bool batch_item,
+			   char **infile, int *helpind)
 {
-	char *infile = 0;
 	int i;
 	int errorcnt = 0;
 	char *e = 0;
-	int helpind = 0;
 	int longindex;
 
 	opterr = 0;		/* quiet, you */
 	while ((i = getopt_long(argc, argv, short_opts, long_opts,
 				&longindex)) != -1) {
+		if (batch_item &&
+		    (i == OPT_BATCH || i == OPT_JOBS || i == OPT_HELP)) {
+			ERROR("--%s can't be used in a batch manifest\n",
+			      long_opts[longindex].name);
+			errorcnt++;
+			continue;
+		}
+
 		switch (i) {
 		case 's':
-			sign_option.signprivate = vb2_read_private_key(optarg);
+			sign_option.signprivate =
+				read_key_cached(optarg, KEY_PRIVATE, 0);
 			if (!sign_option.signprivate) {
 				ERROR("Reading %s\n", optarg);
 				errorcnt++;
 			}
 			break;
 		case 'b':
-			sign_option.keyblock = vb2_read_keyblock(optarg);
+			sign_option.keyblock =
+				read_key_cached(optarg, KEY_KEYBLOCK, 0);
 			if (!sign_option.keyblock) {
 				ERROR("Reading %s\n", optarg);
 				errorcnt++;
 			}
 			break;
 		case 'k':
-			sign_option.kernel_subkey = vb2_read_packed_key(optarg);
+			sign_option.kernel_subkey =
+				read_key_cached(optarg, KEY_PACKED, 0);
 			if (!sign_option.kernel_subkey) {
 				ERROR("Reading %s\n", optarg);
 				errorcnt++;
@@ -855,7 +959,7 @@ static int do_sign(int argc, char *argv[])
 			VBOOT_FALLTHROUGH;
 		case OPT_INFILE:
 			sign_option.inout_file_count++;
-			infile = optarg;
+			*infile = optarg;
 			break;
 		case OPT_OUTFILE:
 			sign_option.inout_file_count++;
@@ -970,8 +1074,15 @@ static int do_sign(int argc, char *argv[])
 		case OPT_ECRW_OUT:
 			sign_option.ecrw_out = optarg;
 			break;
+		case OPT_BATCH:
+			batch_manifest = optarg;
+			break;
+		case OPT_JOBS:
+			errorcnt += parse_number_opt(optarg, "jobs",
+						     &batch_jobs);
+			break;
 		case OPT_HELP:
-			helpind = optind - 1;
+			*helpind = optind - 1;
 			break;
 
 		case '?':
@@ -994,25 +1105,27 @@ static int do_sign(int argc, char *argv[])
 		}
 	}
 
-	if (helpind) {
-		/* Skip all the options we've already parsed */
-		optind--;
-		argv[optind] = argv[0];
-		argc -= optind;
-		argv += optind;
-		print_help(argc, argv);
-		return !!errorcnt;
-	}
+	return errorcnt;
+}
+
+/*
+ * Work out what to sign and check that sign_option has everything needed
+ * for it, loading keys from the keyset as required.  Returns the number of
+ * errors.
+ */
+static int prepare_sign(int argc, char *argv[], char **infile)
+{
+	int errorcnt = 0;
 
 	/* If we don't have an input file already, we need one */
-	if (!infile) {
+	if (!*infile) {
 		if (argc - optind <= 0) {
 			errorcnt++;
 			ERROR("Missing input filename\n");
-			goto done;
+			return errorcnt;
 		} else {
 			sign_option.inout_file_count++;
-			infile = argv[optind++];
+			*infile = argv[optind++];
 		}
 	}
 
@@ -1024,9 +1137,9 @@ static int do_sign(int argc, char *argv[])
 
 	/* What are we looking at? */
 	if (sign_option.type == FILE_TYPE_UNKNOWN &&
-	    futil_file_type(infile, &sign_option.type)) {
+	    futil_file_type(*infile, &sign_option.type)) {
 		errorcnt++;
-		goto done;
+		return errorcnt;
 	}
 
 	/* We may be able to infer the type based on the other args */
@@ -1066,6 +1179,12 @@ static int do_sign(int argc, char *argv[])
 				" --pem_signpriv\n");
 			errorcnt++;
 		}
+		if (sign_option.pem_external_persistent &&
+		    !sign_option.pem_external) {
+			ERROR("--pem_external_persistent must be used with"
+				" --pem_external\n");
+			errorcnt++;
+		}
 		/* We'll wait to read the PEM file, since the external signer
 		 * may want to read it instead. */
 		break;
@@ -1116,7 +1235,7 @@ static int do_sign(int argc, char *argv[])
 		break;
 	}
 
-	VB2_DEBUG("infile=%s\n", infile);
+	VB2_DEBUG("infile=%s\n", *infile);
 	VB2_DEBUG("sign_option.inout_file_count=%d\n",
 		  sign_option.inout_file_count);
 	VB2_DEBUG("sign_option.create_new_outfile=%d\n",
@@ -1127,9 +1246,9 @@ static int do_sign(int argc, char *argv[])
 		if (sign_option.create_new_outfile) {
 			errorcnt++;
 			ERROR("Missing output filename\n");
-			goto done;
+			return errorcnt;
 		} else {
-			sign_option.outfile = infile;
+			sign_option.outfile = *infile;
 		}
 	}
 
@@ -1140,29 +1259,479 @@ static int do_sign(int argc, char *argv[])
 		ERROR("Too many arguments left over\n");
 	}
 
-	if (errorcnt)
-		goto done;
+	return errorcnt;
+}
 
+/* Sign the file prepare_sign() settled on.  Returns the number of errors. */
+static int sign_file(char *infile)
+{
 	if (!sign_option.create_new_outfile) {
 		/* We'll read-modify-write the output file */
 		if (sign_option.inout_file_count > 1)
 			if (futil_copy_file(infile, sign_option.outfile) < 0)
-				goto done;
+				return 1;
 		infile = sign_option.outfile;
 	}
 
-	errorcnt += futil_file_type_sign(sign_option.type, infile);
+	return futil_file_type_sign(sign_option.type, infile);
+}
+
+/* One line of a batch manifest */
+struct batch_item {
+	int line;			/* Line number in the manifest */
+	char *text;			/* The line; argv points into it */
+	char **argv;
+	char *infile;
+	struct sign_option_s option;	/* Options to sign it with */
+};
+
+/* Status of an item no worker has finished */
+#define BATCH_ITEM_PENDING -1
+
+static char batch_argv0[] = "sign";
+
+/*
+ * Parse a manifest line, the same way as the command line, on top of the
+ * options given on the command line.  Returns the number of errors.
+ */
+static int prepare_batch_item(struct batch_item *item,
+			      const struct sign_option_s *defaults)
+{
+	int argc = 0, helpind = 0, errorcnt = 0;
+	char *tok, *save;
+
+	item->argv = malloc((strlen(item->text) / 2 + 3) *
+			    sizeof(*item->argv));
+	if (!item->argv)
+		FATAL("Failed to allocate argv\n");
+	item->argv[argc++] = batch_argv0;
+	for (tok = strtok_r(item->text, " \t\r\n", &save); tok;
+	     tok = strtok_r(NULL, " \t\r\n", &save))
+		item->argv[argc++] = tok;
+	item->argv[argc] = NULL;
+
+	sign_option = *defaults;
+	item->infile = NULL;
+	optind = 0;
+	errorcnt += parse_sign_args(argc, item->argv, true, &item->infile,
+				    &helpind);
+	if (!errorcnt)
+		errorcnt += prepare_sign(argc, item->argv, &item->infile);
+	item->option = sign_option;
+
+	return errorcnt;
+}
+
+static void free_batch_item(struct batch_item *item,
+			    const struct sign_option_s *defaults)
+{
+	struct sign_option_s *o = &item->option;
+
+	if (o->bootloader_data != defaults->bootloader_data)
+		free(o->bootloader_data);
+	if (o->config_data != defaults->config_data)
+		free(o->config_data);
+	if (o->prikey && o->prikey != defaults->prikey)
+		vb2_private_key_free(o->prikey);
+	free(item->argv);
+	free(item->text);
+}
+
+/* Stat the directory a path is in */
+static int stat_parent(const char *path, struct stat *info)
+{
+	const char *slash = strrchr(path, '/');
+	char *dir;
+	int rv;
+
+	if (!slash)
+		return stat(".", info);
+	dir = strndup(path, slash == path ? 1 : slash - path);
+	if (!dir)
+		FATAL("Failed to allocate path\n");
+	rv = stat(dir, info);
+	free(dir);
+	return rv;
+}
+
+/* Whether two paths name the same file, even if spelled differently */
+static bool batch_same_file(const char *a, const char *b)
+{
+	struct stat a_info, b_info;
+	const char *a_base, *b_base;
+
+	if (!strcmp(a, b))
+		return true;
+	if (!stat(a, &a_info) && !stat(b, &b_info))
+		return a_info.st_dev == b_info.st_dev &&
+		       a_info.st_ino == b_info.st_ino;
+
+	/* Outputs may not exist yet, so compare where they would go */
+	a_base = strrchr(a, '/');
+	a_base = a_base ? a_base + 1 : a;
+	b_base = strrchr(b, '/');
+	b_base = b_base ? b_base + 1 : b;
+	if (strcmp(a_base, b_base) ||
+	    stat_parent(a, &a_info) || stat_parent(b, &b_info))
+		return false;
+	return a_info.st_dev == b_info.st_dev &&
+	       a_info.st_ino == b_info.st_ino;
+}
+
+/* Read and check the whole manifest before signing anything */
+static int read_batch_manifest(const char *manifest,
+			       const struct sign_option_s *defaults,
+			       struct batch_item **items_ptr, int *count_ptr)
+{
+	struct batch_item *items = NULL, *item;
+	int count = 0, line = 0, errorcnt = 0;
+	char *text = NULL;
+	size_t text_size = 0;
+	FILE *fp;
+	char *p;
+	int i, j;
+
+	fp = fopen(manifest, "r");
+	if (!fp) {
+		ERROR("Can't open %s: %s\n", manifest, strerror(errno));
+		return 1;
+	}
+
+	while (getline(&text, &text_size, fp) != -1) {
+		line++;
+		p = text + strspn(text, " \t\r\n");
+		if (!*p || *p == '#')
+			continue;
+
+		items = realloc(items, (count + 1) * sizeof(*items));
+		if (!items)
+			FATAL("Failed to allocate batch items\n");
+		item = &items[count++];
+		memset(item, 0, sizeof(*item));
+		item->line = line;
+		item->text = text;
+		text = NULL;
+		text_size = 0;
+
+		if (prepare_batch_item(item, defaults)) {
+			ERROR("%s:%d: Can't sign this item\n", manifest, line);
+			errorcnt++;
+		}
+	}
+	free(text);
+	fclose(fp);
+
+	/*
+	 * Items are signed in parallel, so no item may write a file that
+	 * another item reads or writes.
+	 */
+	for (i = 0; !errorcnt && i < count; i++) {
+		const char *outfile = items[i].option.outfile;
+
+		for (j = 0; j < count; j++) {
+			if (j == i)
+				continue;
+			if (j < i &&
+			    batch_same_file(outfile, items[j].option.outfile)) {
+				ERROR("%s:%d: %s is also written by line %d\n",
+				      manifest, items[i].line, outfile,
+				      items[j].line);
+				errorcnt++;
+				break;
+			}
+			if (batch_same_file(outfile, items[j].infile)) {
+				ERROR("%s:%d: %s is read by line %d\n",
+				      manifest, items[i].line, outfile,
+				      items[j].line);
+				errorcnt++;
+				break;
+			}
+		}
+	}
+
+	*items_ptr = items;
+	*count_ptr = count;
+	return errorcnt;
+}
+
+/* Sign items until there are none left; may run in several processes */
+static void sign_batch_items(struct batch_item *items, int count,
+			     int *next_item, int *status)
+{
+	int i;
+
+	while ((i = __atomic_fetch_add(next_item, 1, __ATOMIC_RELAXED)) <
+	       count) {
+		/* Already signed by sign_batch_keyblocks() */
+		if (status[i] != BATCH_ITEM_PENDING)
+			continue;
+		sign_option = items[i].option;
+		status[i] = sign_file(items[i].infile);
+	}
+}
+
+/* Whether an item is a keyblock for a persistent external signer */
+static bool batch_keyblock_external(const struct sign_option_s *o)
+{
+	return o->type == FILE_TYPE_PUBKEY && o->pem_signpriv &&
+		o->pem_external && o->pem_external_persistent;
+}
+
+static bool batch_same_signer(const struct sign_option_s *a,
+			      const struct sign_option_s *b)
+{
+	return !strcmp(a->pem_signpriv, b->pem_signpriv) &&
+		a->pem_algo == b->pem_algo &&
+		!strcmp(a->pem_external, b->pem_external);
+}
+
+/* Signs the keyblocks for the items in group[] in one batch */
+static void sign_keyblock_group(struct batch_item *items, const int *group,
+				int count, int *status)
+{
+	const struct sign_option_s *o = &items[group[0]].option;
+	const struct vb2_packed_key **keys;
+	struct vb2_keyblock **blocks;
+	uint32_t *flags, *lens;
+	uint8_t **bufs;
+	int *fds, *signed_items;
+	int i, n = 0;
+
+	keys = calloc(count, sizeof(*keys));
+	blocks = calloc(count, sizeof(*blocks));
+	flags = calloc(count, sizeof(*flags));
+	lens = calloc(count, sizeof(*lens));
+	bufs = calloc(count, sizeof(*bufs));
+	fds = calloc(count, sizeof(*fds));
+	signed_items = calloc(count, sizeof(*signed_items));
+	if (!keys || !blocks || !flags || !lens || !bufs || !fds ||
+	    !signed_items)
+		FATAL("Failed to allocate keyblock batch\n");
+
+	for (i = 0; i < count; i++) {
+		struct batch_item *item = &items[group[i]];
+
+		fds[i] = -1;
+		status[group[i]] = 1;
+		if (futil_open_and_map_file(item->infile, &fds[i],
+					    FILE_MODE_SIGN(item->option),
+					    &bufs[i], &lens[i]))
+			continue;
+		if (vb2_packed_key_looks_ok((struct vb2_packed_key *)bufs[i],
+					    lens[i])) {
+			ERROR("%s: Public key looks bad.\n", item->infile);
+			continue;
+		}
+		keys[n] = (const struct vb2_packed_key *)bufs[i];
+		flags[n] = item->option.flags;
+		signed_items[n++] = i;
+	}
+
+	vb2_set_external_signer_persistent(true);
+	if (n && vb2_create_keyblocks_external(keys, flags, n, o->pem_signpriv,
+					       o->pem_algo, o->pem_external,
+					       blocks))
+		ERROR("Unable to sign keyblocks with %s\n", o->pem_external);
+
+	for (i = 0; i < n; i++) {
+		struct batch_item *item = &items[group[signed_items[i]]];
+
+		if (blocks[i])
+			status[group[signed_items[i]]] = WriteSomeParts(
+				item->option.outfile, blocks[i],
+				blocks[i]->keyblock_size, NULL, 0);
+		free(blocks[i]);
+	}
+
+	for (i = 0; i < count; i++)
+		if (bufs[i])
+			futil_unmap_and_close_file(
+				fds[i], FILE_MODE_SIGN(items[group[i]].option),
+				bufs[i], lens[i]);
+
+	free(keys);
+	free(blocks);
+	free(flags);
+	free(lens);
+	free(bufs);
+	free(fds);
+	free(signed_items);
+}
+
+/*
+ * Signs the keyblocks that go to a persistent external signer, before the
+ * workers start.  One vb2_create_keyblocks_external() call per signer and
+ * key sends the signer every request at once, instead of one per worker
+ * item.  One-shot signers are left to the workers, which run them in
+ * parallel.
+ */
+static void sign_batch_keyblocks(struct batch_item *items, int count,
+				 int *status)
+{
+	int *group = malloc(count * sizeof(*group));
+	int i, j, n;
+
+	if (!group)
+		FATAL("Failed to allocate keyblock batch\n");
+
+	for (i = 0; i < count; i++) {
+		const struct sign_option_s *first = &items[i].option;
+
+		if (status[i] != BATCH_ITEM_PENDING ||
+		    !batch_keyblock_external(first))
+			continue;
+		for (j = i, n = 0; j < count; j++) {
+			if (status[j] == BATCH_ITEM_PENDING &&
+			    batch_keyblock_external(&items[j].option) &&
+			    batch_same_signer(first, &items[j].option))
+				group[n++] = j;
+		}
+		sign_keyblock_group(items, group, n, status);
+	}
+
+	free(group);
+	/* Don't leave the workers signers they can't use */
+	vb2_stop_external_signers();
+}
+
+/*
+ * Sign everything in a batch manifest.
+ *
+ * The file type handlers keep their state in sign_option, so items can't
+ * be signed by threads in one process.  Instead, the workers are forked
+ * once the manifest has been checked and every key has been read; they
+ * share the keys with this process, and take items from a shared counter.
+ *
+ * Returns the number of items that could not be signed, or 1 if the
+ * manifest is bad.
+ */
+static int sign_batch(const char *manifest)
+{
+	const struct sign_option_s defaults = sign_option;
+	struct batch_item *items = NULL;
+	int count = 0, failed = 0;
+	int *shared = MAP_FAILED;
+	pid_t *pids = NULL;
+	uint32_t jobs = batch_jobs;
+	uint32_t started = 0;
+	int i;
+
+	if (read_batch_manifest(manifest, &defaults, &items, &count)) {
+		failed = 1;
+		goto done;
+	}
+
+	if (!jobs) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs = cpus > 0 ? cpus : 1;
+	}
+	jobs = VB2_MIN(jobs, count);
+
+	/* The next item to take, then the status of each item */
+	shared = mmap(NULL, (count + 1) * sizeof(*shared),
+		      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		ERROR("Can't allocate batch status: %s\n", strerror(errno));
+		failed = 1;
+		goto done;
+	}
+	shared[0] = 0;
+	for (i = 0; i < count; i++)
+		shared[i + 1] = BATCH_ITEM_PENDING;
+	sign_batch_keyblocks(items, count, &shared[1]);
+
+	if (jobs > 1) {
+		pids = malloc(jobs * sizeof(*pids));
+		if (!pids)
+			FATAL("Failed to allocate worker list\n");
+		fflush(NULL);
+		for (started = 0; started < jobs; started++) {
+			pids[started] = fork();
+			if (pids[started] < 0) {
+				ERROR("Can't start worker: %s\n",
+				      strerror(errno));
+				break;
+			}
+			if (!pids[started]) {
+				sign_batch_items(items, count, &shared[0],
+						 &shared[1]);
+				vb2_stop_external_signers();
+				fflush(NULL);
+				_exit(0);
+			}
+		}
+	}
+	/* With no workers, do it all here */
+	if (!started)
+		sign_batch_items(items, count, &shared[0], &shared[1]);
+	for (i = 0; i < started; i++)
+		waitpid(pids[i], NULL, 0);
+
+	for (i = 0; i < count; i++) {
+		if (shared[i + 1])
+			failed++;
+		printf("%-7s %s:%d: %s -> %s\n",
+		       shared[i + 1] ? "FAILED" : "OK", manifest,
+		       items[i].line, items[i].infile,
+		       items[i].option.outfile);
+	}
+	printf("Signed %d of %d items\n", count - failed, count);
+
+done:
+	if (shared != MAP_FAILED)
+		munmap(shared, (count + 1) * sizeof(*shared));
+	free(pids);
+	for (i = 0; i < count; i++)
+		free_batch_item(&items[i], &defaults);
+	free(items);
+	sign_option = defaults;
+	return failed;
+}
+
+static int do_sign(int argc, char *argv[])
+{
+	char *infile = 0;
+	int errorcnt = 0;
+	int failed = 0;
+	int helpind = 0;
+
+	errorcnt += parse_sign_args(argc, argv, false, &infile, &helpind);
+
+	if (helpind) {
+		/* Skip all the options we've already parsed */
+		optind--;
+		argv[optind] = argv[0];
+		argc -= optind;
+		argv += optind;
+		print_help(argc, argv);
+		return !!errorcnt;
+	}
+
+	if (batch_manifest) {
+		if (infile || sign_option.outfile || argc - optind > 0) {
+			ERROR("Files to sign go in the batch manifest\n");
+			errorcnt++;
+		}
+		if (!errorcnt)
+			failed = sign_batch(batch_manifest);
+		goto done;
+	}
+
+	errorcnt += prepare_sign(argc, argv, &infile);
+	if (errorcnt)
+		goto done;
+
+	errorcnt += sign_file(infile);
 done:
-	free(sign_option.signprivate);
-	free(sign_option.keyblock);
-	free(sign_option.kernel_subkey);
+	vb2_stop_external_signers();
+	free_key_cache();
 	if (sign_option.prikey)
 		vb2_private_key_free(sign_option.prikey);
 
 	if (errorcnt)
 		ERROR("Use --help for usage instructions\n");
 
-	return !!errorcnt;
+	return !!(errorcnt || failed);
 }
 
 DECLARE_FUTIL_COMMAND(sign, do_sign, VBOOT_VERSION_ALL,
@@ -236,6 +236,7 @@ static int do_vbutil_kernel(int argc, char *argv[])
 	uint32_t kpart_size = 0;
 	uint8_t *vmlinuz_buf = NULL;
 	uint32_t vmlinuz_size = 0;
+	int vmlinuz_fd = -1;
 	uint8_t *t_config_data;
 	uint32_t t_config_size;
 	uint8_t *t_bootloader_data;
@@ -421,48 +422,32 @@ static int do_vbutil_kernel(int argc, char *argv[])
 		if (!vmlinuz_file)
 			FATAL("Missing required vmlinuz file.\n");
 
-		VB2_DEBUG("Reading %s\n", vmlinuz_file);
-		if (VB2_SUCCESS !=
-		    vb2_read_file(vmlinuz_file, &vmlinuz_buf, &vmlinuz_size))
+		VB2_DEBUG("Mapping %s\n", vmlinuz_file);
+		if (futil_open_and_map_file(vmlinuz_file, &vmlinuz_fd, FILE_RO,
+					    &vmlinuz_buf, &vmlinuz_size))
 			FATAL("Error reading vmlinuz file.\n");
 
 		VB2_DEBUG(" vmlinuz file size=%#x\n", vmlinuz_size);
-		if (!vmlinuz_size)
-			FATAL("Empty vmlinuz file\n");
-
-		kblob_data = CreateKernelBlob(
-			vmlinuz_buf, vmlinuz_size,
-			arch, kernel_body_load_address,
-			t_config_data, t_config_size,
-			t_bootloader_data, t_bootloader_size,
-			&kblob_size);
-		if (!kblob_data)
-			FATAL("Unable to create kernel blob\n");
-
-		VB2_DEBUG("kblob_size = %#x\n", kblob_size);
-
-		vblock_data = SignKernelBlob(kblob_data, kblob_size, opt_pad,
-					     version, kernel_body_load_address,
-					     t_keyblock, signpriv_key, flags,
-					     &vblock_size);
-		if (!vblock_data)
-			FATAL("Unable to sign kernel blob\n");
-
-		VB2_DEBUG("vblock_size = %#x\n", vblock_size);
-
-		if (opt_vblockonly)
-			rv = WriteSomeParts(filename,
-					    vblock_data, vblock_size,
-					    NULL, 0);
-		else
-			rv = WriteSomeParts(filename,
-					    vblock_data, vblock_size,
-					    kblob_data, kblob_size);
 
-		free(vmlinuz_buf);
+		/* The kernel is read while the output is written */
+		if (futil_is_same_file(vmlinuz_fd, filename))
+			FATAL("Can't write the kernel partition over %s\n",
+			      vmlinuz_file);
+
+		rv = WriteKernelPartition(filename, opt_vblockonly,
+					  vmlinuz_buf, vmlinuz_size,
+					  arch, kernel_body_load_address,
+					  t_config_data, t_config_size,
+					  t_bootloader_data, t_bootloader_size,
+					  opt_pad, version, t_keyblock,
+					  signpriv_key, flags);
+		if (rv)
+			FATAL("Unable to create kernel partition\n");
+
+		futil_unmap_and_close_file(vmlinuz_fd, FILE_RO,
+					   vmlinuz_buf, vmlinuz_size);
 		free(t_config_data);
 		free(t_bootloader_data);
-		free(vblock_data);
 		vb2_free_private_key(signpriv_key);
 		return rv;
 
@@ -5,6 +5,7 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -17,6 +18,7 @@
 #include "futility.h"
 #include "futility_options.h"
 #include "host_common.h"
+#include "host_key_cache.h"
 #include "vb1_helper.h"
 
 static void fmap_limit_area(FmapAreaHeader *ah, uint32_t len)
@@ -320,6 +322,23 @@ static int write_loem(const char *ab, struct bios_area_s *vblock)
 	return 0;
 }
 
+/* One slot's preamble, which can be written by another thread */
+struct preamble_job {
+	struct bios_area_s *vblock;
+	struct bios_area_s *fw_body;
+	int retval;
+};
+
+static void *write_new_preamble_thread(void *arg)
+{
+	struct preamble_job *job = arg;
+
+	job->retval = write_new_preamble(job->vblock, job->fw_body,
+					 sign_option.signprivate,
+					 sign_option.keyblock);
+	return NULL;
+}
+
 /* This signs a full BIOS image after it's been traversed. */
 static int sign_bios_at_end(struct bios_state_s *state)
 {
@@ -327,6 +346,9 @@ static int sign_bios_at_end(struct bios_state_s *state)
 	struct bios_area_s *vblock_b = &state->area[BIOS_FMAP_VBLOCK_B];
 	struct bios_area_s *fw_a = &state->area[BIOS_FMAP_FW_MAIN_A];
 	struct bios_area_s *fw_b = &state->area[BIOS_FMAP_FW_MAIN_B];
+	struct preamble_job job_b = { .vblock = vblock_b, .fw_body = fw_b };
+	pthread_t thread_b;
+	bool threaded = false;
 	int retval = 0;
 
 	if (!vblock_a->is_valid || !fw_a->is_valid) {
@@ -334,18 +356,27 @@ static int sign_bios_at_end(struct bios_state_s *state)
 		return 1;
 	}
 
-	retval |= write_new_preamble(vblock_a, fw_a, sign_option.signprivate,
-				     sign_option.keyblock);
-
+	/*
+	 * The slots are separate parts of the image, so B is hashed and
+	 * signed in its own thread while A is done here.
+	 */
 	if (vblock_b->is_valid && fw_b->is_valid)
-		retval |= write_new_preamble(vblock_b, fw_b,
-					     sign_option.signprivate,
-					     sign_option.keyblock);
+		threaded = !pthread_create(&thread_b, NULL,
+					   write_new_preamble_thread, &job_b);
 	else
 		INFO("BIOS image does not have %s. Signing only %s\n",
 		     fmap_name[BIOS_FMAP_FW_MAIN_B],
 		     fmap_name[BIOS_FMAP_FW_MAIN_A]);
 
+	retval |= write_new_preamble(vblock_a, fw_a, sign_option.signprivate,
+				     sign_option.keyblock);
+
+	if (threaded)
+		pthread_join(thread_b, NULL);
+	else if (vblock_b->is_valid && fw_b->is_valid)
+		write_new_preamble_thread(&job_b);
+	retval |= job_b.retval;
+
 	if (sign_option.loemid) {
 		retval |= write_loem("A", vblock_a);
 		if (vblock_b->is_valid)
@@ -364,9 +395,9 @@ static int prepare_slot(uint8_t *buf, uint32_t len, enum bios_component fw_c,
 {
 	const char *fw_main_name = fmap_name[fw_c];
 	const char *vblock_name = fmap_name[vblock_c];
-	static uint8_t workbuf[VB2_FIRMWARE_WORKBUF_RECOMMENDED_SIZE]
+	uint8_t workbuf[VB2_FIRMWARE_WORKBUF_RECOMMENDED_SIZE]
 		__attribute__((aligned(VB2_WORKBUF_ALIGN)));
-	static struct vb2_workbuf wb;
+	struct vb2_workbuf wb;
 
 	FmapHeader *fmap = fmap_find(buf, len);
 	vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
@@ -424,7 +455,8 @@ static int prepare_slot(uint8_t *buf, uint32_t len, enum bios_component fw_c,
 	}
 
 	struct vb2_public_key data_key;
-	if (vb2_unpack_key(&data_key, &keyblock->data_key) != VB2_SUCCESS) {
+	if (vb2_unpack_key_cached(&data_key, &keyblock->data_key) !=
+	    VB2_SUCCESS) {
 		WARN("%s data key is invalid. Failed to parse.\n", vblock_name);
 		goto end;
 	}
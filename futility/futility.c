@@ -6,6 +6,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -15,6 +16,8 @@
 #include <unistd.h>
 
 #include "futility.h"
+#include "host_hwcrypto.h"
+#include "host_key_cache.h"
 
 /******************************************************************************/
 /* Logging stuff */
@@ -194,6 +197,9 @@ static const char *const options =
 "  --vb1        Use only vboot v1.0 binary formats\n"
 "  --vb21       Use only vboot v2.1 binary formats\n"
 "  --debug      Be noisy about what's going on\n"
+"  --crypto-backend=vboot|openssl\n"
+"               Verify with vboot's own crypto (default) or with OpenSSL.\n"
+"               Can also be set with " ENV_CRYPTO_BACKEND ".\n"
 "\n";
 
 static const struct futil_cmd_t *find_command(const char *name)
@@ -220,12 +226,20 @@ static void list_commands(void)
 
 static int run_command(const struct futil_cmd_t *cmd, int argc, char *argv[])
 {
-	int i;
+	struct vb2_key_cache_stats stats;
+	int i, rv;
 	VB2_DEBUG("\"%s\" ...\n", cmd->name);
 	for (i = 0; i < argc; i++)
 		VB2_DEBUG("  argv[%d] = \"%s\"\n", i, argv[i]);
 
-	return cmd->handler(argc, argv);
+	rv = cmd->handler(argc, argv);
+
+	vb2_key_cache_get_stats(&stats);
+	if (stats.hits || stats.misses)
+		VB2_DEBUG("key cache: %" PRIu64 " hits, %" PRIu64
+			  " misses, %u keys\n",
+			  stats.hits, stats.misses, stats.entries);
+	return rv;
 }
 
 static int do_help(int argc, char *argv[])
@@ -296,6 +310,7 @@ static char *simple_basename(char *str)
 
 /* Here we go */
 #define OPT_HELP 1000
+#define OPT_CRYPTO_BACKEND 1001
 test_mockable
 int main(int argc, char *argv[], char *envp[])
 {
@@ -304,16 +319,21 @@ int main(int argc, char *argv[], char *envp[])
 	int i, errorcnt = 0;
 	int vb_ver = VBOOT_VERSION_ALL;
 	int helpind = 0;
+	enum vb2_crypto_backend backend;
 	struct option long_opts[] = {
 		{"debug", 0, &debugging_enabled, 1},
 		{"vb1" ,  0, &vb_ver, VBOOT_VERSION_1_0},
 		{"vb21",  0, &vb_ver, VBOOT_VERSION_2_1},
 		{"help",  0, 0, OPT_HELP},
+		{"crypto-backend", 1, 0, OPT_CRYPTO_BACKEND},
 		{ 0, 0, 0, 0},
 	};
 
 	log_args(argc, argv);
 
+	if (vb2_set_crypto_backend_from_env())
+		return 1;
+
 	/* How were we invoked? */
 	progname = simple_basename(argv[0]);
 
@@ -333,6 +353,15 @@ int main(int argc, char *argv[], char *envp[])
 			/* Note: this might be GNU-specific */
 			helpind = optind - 1;
 			break;
+		case OPT_CRYPTO_BACKEND:
+			if (!vb2_lookup_crypto_backend(optarg, &backend)) {
+				fprintf(stderr, "Unknown crypto backend: %s\n",
+					optarg);
+				errorcnt++;
+				break;
+			}
+			vb2_set_crypto_backend(backend);
+			break;
 		case '?':
 			if (optopt)
 				fprintf(stderr, "Unrecognized option: -%c\n",
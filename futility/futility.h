@@ -228,6 +228,9 @@ int print_hwid_digest(struct vb2_gbb_header *gbb, const char *banner);
 /* Copies a file. */
 int futil_copy_file(const char *infile, const char *outfile);
 
+/* Returns true if path names the file that fd is open on. */
+int futil_is_same_file(int fd, const char *path);
+
 /* Possible file operation errors */
 enum futil_file_err {
 	FILE_ERR_NONE,
@@ -58,6 +58,7 @@ struct sign_option_s {
 	int pem_algo_specified;
 	uint32_t pem_algo;
 	char *pem_external;
+	int pem_external_persistent;
 	enum futil_file_type type;
 	enum vb2_hash_algorithm hash_alg;
 	uint32_t ro_size, rw_size;
@@ -251,6 +251,16 @@ int futil_copy_file(const char *infile, const char *outfile)
 	return ret;
 }
 
+int futil_is_same_file(int fd, const char *path)
+{
+	struct stat fd_info, path_info;
+
+	if (fstat(fd, &fd_info) || stat(path, &path_info))
+		return 0;
+	return fd_info.st_dev == path_info.st_dev &&
+	       fd_info.st_ino == path_info.st_ino;
+}
+
 enum futil_file_err futil_open_file(const char *infile, int *fd,
 				    enum file_mode mode)
 {
@@ -11,6 +11,7 @@
 
 #include "2rsa.h"
 #include "futility.h"
+#include "host_key_cache.h"
 #include "host_misc.h"
 #include "updater.h"
 #include "util_misc.h"
@@ -600,7 +601,7 @@ static int verify_keyblock(const struct vb2_keyblock *block,
 		return -1;
 	}
 	vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
-	if (VB2_SUCCESS != vb2_unpack_key(&key, sign_key)) {
+	if (VB2_SUCCESS != vb2_unpack_key_cached(&key, sign_key)) {
 		ERROR("Invalid signing key.\n");
 		return -1;
 	}
@@ -715,18 +716,11 @@ static int legacy_needs_update(struct updater_config *cfg)
 	int has_from, has_to;
 	const char * const tag = "cros_allow_auto_update";
 	const char *section = FMAP_RW_LEGACY;
-	const char *tmp_to, *tmp_from;
 
 	VB2_DEBUG("Checking %s contents...\n", FMAP_RW_LEGACY);
 
-	tmp_to = get_firmware_image_temp_file(&cfg->image, &cfg->tempfiles);
-	tmp_from = get_firmware_image_temp_file(&cfg->image_current,
-						&cfg->tempfiles);
-	if (!tmp_from || !tmp_to)
-		return 0;
-
-	has_to = cbfs_file_exists(tmp_to, section, tag);
-	has_from = cbfs_file_exists(tmp_from, section, tag);
+	has_to = cbfs_file_exists(&cfg->image, section, tag);
+	has_from = cbfs_file_exists(&cfg->image_current, section, tag);
 
 	if (!has_from || !has_to) {
 		VB2_DEBUG("Current legacy firmware has%s updater tag (%s) and "
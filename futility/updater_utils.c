@@ -16,6 +16,7 @@
 #endif
 
 #include "2common.h"
+#include "cbfs.h"
 #include "host_misc.h"
 #include "util_misc.h"
 #include "updater.h"
@@ -72,36 +73,32 @@ int save_file_from_stdin(const char *output)
 
 /*
  * Returns 1 if a given file (cbfs_entry_name) exists inside a particular CBFS
- * section of an image file, otherwise 0.
+ * section of a firmware image, otherwise 0.
  */
-int cbfs_file_exists(const char *image_file,
+int cbfs_file_exists(const struct firmware_image *image,
 		     const char *section_name,
 		     const char *cbfs_entry_name)
 {
-	char *cmd;
-	int r;
+	struct cbfs_file_info file;
 
-	ASPRINTF(&cmd,
-		 "cbfstool '%s' print -r %s 2>/dev/null | grep -q '^%s '",
-		 image_file, section_name, cbfs_entry_name);
-	r = system(cmd);
-	free(cmd);
-	return !r;
+	return cbfs_find_file(image->data, image->size, section_name,
+			      cbfs_entry_name, &file) == VB2_SUCCESS;
 }
 
 /*
- * Extracts files from a CBFS on given region (section) of image_file.
+ * Extracts a compressed file with cbfstool, which can decompress it.
  * Returns the path to a temporary file on success, otherwise NULL.
  */
-const char *cbfs_extract_file(const char *image_file,
-			      const char *cbfs_region,
-			      const char *cbfs_name,
-			      struct tempfile *tempfiles)
+static const char *cbfstool_extract_file(const struct firmware_image *image,
+					 const char *cbfs_region,
+					 const char *cbfs_name,
+					 struct tempfile *tempfiles)
 {
+	const char *image_file = get_firmware_image_temp_file(image, tempfiles);
 	const char *output = create_temp_file(tempfiles);
 	char *command, *result;
 
-	if (!output)
+	if (!image_file || !output)
 		return NULL;
 
 	ASPRINTF(&command, "cbfstool \"%s\" extract -r %s -n \"%s\" "
@@ -118,6 +115,44 @@ const char *cbfs_extract_file(const char *image_file,
 	return output;
 }
 
+/*
+ * Extracts a file from a CBFS on given region (section) of a firmware image.
+ * Returns the file contents, which the caller must free, and sets *size to
+ * their size; returns NULL on failure.
+ */
+uint8_t *cbfs_extract_file(const struct firmware_image *image,
+			   const char *cbfs_region,
+			   const char *cbfs_name,
+			   struct tempfile *tempfiles,
+			   uint32_t *size)
+{
+	struct cbfs_file_info file;
+	const char *path;
+	uint8_t *data = NULL;
+
+	*size = 0;
+	if (cbfs_find_file(image->data, image->size, cbfs_region, cbfs_name,
+			   &file) != VB2_SUCCESS)
+		return NULL;
+
+	if (file.compression == CBFS_COMPRESS_NONE) {
+		/* Allocate one extra byte so text files can be terminated */
+		data = malloc(file.size + 1);
+		if (!data)
+			return NULL;
+		memcpy(data, file.data, file.size);
+		data[file.size] = '\0';
+		*size = file.size;
+		return data;
+	}
+
+	VB2_DEBUG("%s is compressed, extracting with cbfstool.\n", cbfs_name);
+	path = cbfstool_extract_file(image, cbfs_region, cbfs_name, tempfiles);
+	if (!path || vb2_read_file(path, &data, size) != VB2_SUCCESS)
+		return NULL;
+	return data;
+}
+
 /*
  * Loads the firmware information from an FMAP section in loaded firmware image.
  * The section should only contain ASCIIZ string as firmware version.
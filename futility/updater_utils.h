@@ -207,20 +207,24 @@ void prepare_servo_control(const char *control_name, bool on);
 
 /*
  * Returns 1 if a given file (cbfs_entry_name) exists inside a particular CBFS
- * section of an image file, otherwise 0.
+ * section of a firmware image, otherwise 0.
  */
-int cbfs_file_exists(const char *image_file,
+int cbfs_file_exists(const struct firmware_image *image,
 		     const char *section_name,
 		     const char *cbfs_entry_name);
 
 /*
- * Extracts files from a CBFS on given region (section) of image_file.
- * Returns the path to a temporary file on success, otherwise NULL.
+ * Extracts a file from a CBFS on given region (section) of a firmware image.
+ * Uncompressed files are read straight from the image; compressed ones are
+ * extracted with cbfstool.
+ * Returns the file contents, which the caller must free, and sets *size to
+ * their size; returns NULL on failure.
  */
-const char *cbfs_extract_file(const char *image_file,
-			      const char *cbfs_region,
-			      const char *cbfs_name,
-			      struct tempfile *tempfiles);
+uint8_t *cbfs_extract_file(const struct firmware_image *image,
+			   const char *cbfs_region,
+			   const char *cbfs_name,
+			   struct tempfile *tempfiles,
+			   uint32_t *size);
 
 /* DUT related functions (implementations in updater_dut.c) */
 
@@ -7,6 +7,7 @@
 #include <inttypes.h>		/* For PRIu64 */
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <openssl/rsa.h>
 
@@ -18,6 +19,7 @@
 #include "file_type.h"
 #include "futility.h"
 #include "host_common.h"
+#include "host_key_cache.h"
 #include "kernel_blob.h"
 #include "util_misc.h"
 #include "vb1_helper.h"
@@ -142,12 +144,12 @@ static int KernelHasEfiBootStub(const uint8_t *kernel_buf,
 }
 
 /* Returns the size of the 32-bit kernel, or negative on error. */
-static int KernelSize(uint8_t *kernel_buf,
+static int KernelSize(const uint8_t *kernel_buf,
 		      uint32_t kernel_size,
 		      enum arch_t arch)
 {
 	uint32_t kernel32_start = 0;
-	struct linux_kernel_params *lh;
+	const struct linux_kernel_params *lh;
 
 	/* Except for x86, the kernel is the kernel. */
 	if (arch != ARCH_X86)
@@ -155,7 +157,7 @@ static int KernelSize(uint8_t *kernel_buf,
 
 	/* The first part of the x86 vmlinuz is a header, followed by
 	 * a real-mode boot stub. We only want the 32-bit part. */
-	lh = (struct linux_kernel_params *)kernel_buf;
+	lh = (const struct linux_kernel_params *)kernel_buf;
 	if (lh->header != VMLINUZ_HEADER_SIG) {
 		VB2_DEBUG("Not a linux kernel image\n");
 		return kernel_size;
@@ -168,15 +170,18 @@ static int KernelSize(uint8_t *kernel_buf,
 	return kernel_size - kernel32_start;
 }
 
-/* This extracts g_kernel_* and g_param_* from a standard vmlinuz file. */
-static void PickApartVmlinuz(uint8_t *kernel_buf,
+/* This fills in the kernel params from a standard vmlinuz file. */
+static void PickApartVmlinuz(const uint8_t *kernel_buf,
 			     uint32_t kernel_size,
 			     enum arch_t arch,
-			     uint64_t kernel_body_load_address)
+			     uint64_t kernel_body_load_address,
+			     uint8_t *param_data,
+			     uint8_t *config_data)
 {
 	uint32_t kernel32_start = 0;
 	uint32_t kernel32_size = kernel_size;
-	struct linux_kernel_params *lh, *params;
+	const struct linux_kernel_params *lh;
+	struct linux_kernel_params *params;
 
 	/* Except for x86, the kernel is the kernel. */
 	switch (arch) {
@@ -191,9 +196,9 @@ static void PickApartVmlinuz(uint8_t *kernel_buf,
 		VB2_DEBUG(" kernel16_size=%#x\n", kernel32_start);
 
 		/* Copy the original zeropage data from kernel_buf into
-		 * g_param_data, then tweak a few fields for our purposes */
-		lh = (struct linux_kernel_params *)kernel_buf;
-		params = (struct linux_kernel_params *)(g_param_data);
+		 * param_data, then tweak a few fields for our purposes */
+		lh = (const struct linux_kernel_params *)kernel_buf;
+		params = (struct linux_kernel_params *)param_data;
 		memcpy(&(params->setup_sects), &(lh->setup_sects),
 		       offsetof(struct linux_kernel_params, e820_entries)
 		       - offsetof(struct linux_kernel_params, setup_sects));
@@ -205,7 +210,7 @@ static void PickApartVmlinuz(uint8_t *kernel_buf,
 		 * will come right after the 32-bit part of the kernel. */
 		params->cmd_line_ptr = kernel_body_load_address +
 			roundup(kernel32_size, CROS_ALIGN) +
-			find_cmdline_start(g_config_data, g_config_size);
+			find_cmdline_start(config_data, CROS_CONFIG_SIZE);
 		VB2_DEBUG(" cmdline_addr=%#x\n", params->cmd_line_ptr);
 		VB2_DEBUG(" version=%#x\n", params->version);
 		VB2_DEBUG(" kernel_alignment=%#x\n", params->kernel_alignment);
@@ -226,13 +231,6 @@ static void PickApartVmlinuz(uint8_t *kernel_buf,
 
 	VB2_DEBUG(" kernel32_start=%#x\n", kernel32_start);
 	VB2_DEBUG(" kernel32_size=%#x\n", kernel32_size);
-
-	/* Keep just the 32-bit kernel. */
-	if (kernel32_size) {
-		g_kernel_size = kernel32_size;
-		memcpy(g_kernel_data, kernel_buf + kernel32_start,
-		       g_kernel_size);
-	}
 }
 
 /* Split a kernel blob into separate g_kernel, g_param, g_config,
@@ -517,7 +515,8 @@ int VerifyKernelBlob(uint8_t *kernel_blob,
 
 	if (signpub_key) {
 		struct vb2_public_key pubkey;
-		if (VB2_SUCCESS != vb2_unpack_key(&pubkey, signpub_key)) {
+		if (VB2_SUCCESS != vb2_unpack_key_cached(&pubkey,
+							 signpub_key)) {
 			fprintf(stderr, "Error unpacking signing key.\n");
 			goto done;
 		}
@@ -584,7 +583,7 @@ int VerifyKernelBlob(uint8_t *kernel_blob,
 	}
 
 	struct vb2_public_key pubkey;
-	if (VB2_SUCCESS != vb2_unpack_key(&pubkey, data_key)) {
+	if (VB2_SUCCESS != vb2_unpack_key_cached(&pubkey, data_key)) {
 		fprintf(stderr, "Error parsing data key.\n");
 		goto done;
 	}
@@ -650,19 +649,91 @@ done:
 }
 
 
-uint8_t *CreateKernelBlob(uint8_t *vmlinuz_buf, uint32_t vmlinuz_size,
-			  enum arch_t arch, uint64_t kernel_body_load_address,
-			  uint8_t *config_data, uint32_t config_size,
-			  uint8_t *bootloader_data, uint32_t bootloader_size,
-			  uint32_t *blob_size_ptr)
+/* Size of the pieces the kernel blob is hashed and written out in */
+#define KBLOB_CHUNK_SIZE (64 * 1024)
+
+/* A kernel blob being hashed, and maybe written out, as it is assembled. */
+struct kblob_stream {
+	struct vb2_digest_context dc;
+	FILE *f;			/* NULL if only hashing */
+	const char *outfile;
+	uint32_t offset;		/* Bytes of the blob so far */
+};
+
+/* Append one part of the kernel blob, followed by zeros up to padded_size.
+ * Returns zero on success. */
+static int StreamKernelBlobPart(struct kblob_stream *s,
+				const uint8_t *data, uint32_t size,
+				uint32_t padded_size)
+{
+	static const uint8_t zeros[CROS_ALIGN];
+	uint32_t chunk;
+
+	while (padded_size) {
+		if (size) {
+			chunk = VB2_MIN(size, KBLOB_CHUNK_SIZE);
+		} else {
+			data = zeros;
+			chunk = VB2_MIN(padded_size, sizeof(zeros));
+		}
+
+		if (VB2_SUCCESS != vb2_digest_extend(&s->dc, data, chunk)) {
+			fprintf(stderr, "Error hashing kernel blob\n");
+			return -1;
+		}
+		if (s->f && 1 != fwrite(data, chunk, 1, s->f)) {
+			fprintf(stderr, "Can't write output file %s: %s\n",
+				s->outfile, strerror(errno));
+			return -1;
+		}
+
+		if (size) {
+			data += chunk;
+			size -= chunk;
+		}
+		padded_size -= chunk;
+		s->offset += chunk;
+	}
+
+	return 0;
+}
+
+int WriteKernelPartition(const char *outfile, int vblock_only,
+			 const uint8_t *vmlinuz_buf, uint32_t vmlinuz_size,
+			 enum arch_t arch, uint64_t kernel_body_load_address,
+			 const uint8_t *config_data, uint32_t config_size,
+			 const uint8_t *bootloader_data,
+			 uint32_t bootloader_size,
+			 uint32_t padding,
+			 int version,
+			 struct vb2_keyblock *keyblock,
+			 struct vb2_private_key *signpriv_key,
+			 uint32_t flags)
 {
+	uint8_t config_buf[CROS_CONFIG_SIZE];
+	uint8_t param_buf[CROS_PARAMS_SIZE];
+	struct kblob_stream s = { .outfile = outfile };
+	struct vb2_signature *body_sig = NULL;
+	struct vb2_kernel_preamble *preamble = NULL;
+	struct vb2_hash hash;
+	uint32_t min_size, preamble_size, vblock_size;
 	uint32_t now = 0;
+	struct stat sb;
+	int remove_on_error = 0;
+	FILE *f = NULL;
+	int rv = -1;
 	int tmp;
 
+	if (config_size > CROS_CONFIG_SIZE) {
+		fprintf(stderr, "Config is too large (> %d bytes)\n",
+			CROS_CONFIG_SIZE);
+		return -1;
+	}
+
 	/* We have all the parts. How much room do we need? */
 	tmp = KernelSize(vmlinuz_buf, vmlinuz_size, arch);
 	if (tmp < 0)
-		return NULL;
+		return -1;
 
 	/* If we have an EFI stub, move it into the bootloader section. */
 	if (KernelHasEfiBootStub(vmlinuz_buf, vmlinuz_size)) {
@@ -678,7 +749,7 @@ uint8_t *CreateKernelBlob(uint8_t *vmlinuz_buf, uint32_t vmlinuz_size,
 	g_config_size = CROS_CONFIG_SIZE;
 	g_param_size = CROS_PARAMS_SIZE;
 	g_bootloader_size = roundup(bootloader_size, CROS_ALIGN);
-	g_vmlinuz_header_size = vmlinuz_size-g_kernel_size;
+	g_vmlinuz_header_size = vmlinuz_size - g_kernel_size;
 	g_kernel_blob_size =
 		roundup(g_kernel_size, CROS_ALIGN) +
 		g_config_size                      +
@@ -693,36 +764,21 @@ uint8_t *CreateKernelBlob(uint8_t *vmlinuz_buf, uint32_t vmlinuz_size,
 	g_kernel_blob_size = roundup(g_kernel_blob_size, CROS_ALIGN);
 	VB2_DEBUG("g_kernel_blob_size  %#x\n", g_kernel_blob_size);
 
-	/* Allocate space for the blob. */
-	g_kernel_blob_data = malloc(g_kernel_blob_size);
-	memset(g_kernel_blob_data, 0, g_kernel_blob_size);
-
-	/* Assign the sub-pointers */
-	g_kernel_data = g_kernel_blob_data + now;
-	VB2_DEBUG("g_kernel_size       %#x ofs %#x\n",
-		  g_kernel_size, now);
+	/* Work out where the parts go */
+	VB2_DEBUG("g_kernel_size       %#x ofs %#x\n", g_kernel_size, now);
 	now += roundup(g_kernel_size, CROS_ALIGN);
-
-	g_config_data = g_kernel_blob_data + now;
-	VB2_DEBUG("g_config_size       %#x ofs %#x\n",
-		  g_config_size, now);
+	VB2_DEBUG("g_config_size       %#x ofs %#x\n", g_config_size, now);
 	now += g_config_size;
-
-	g_param_data = g_kernel_blob_data + now;
-	VB2_DEBUG("g_param_size        %#x ofs %#x\n",
-		  g_param_size, now);
+	VB2_DEBUG("g_param_size        %#x ofs %#x\n", g_param_size, now);
 	now += g_param_size;
-
-	g_bootloader_data = g_kernel_blob_data + now;
 	VB2_DEBUG("g_bootloader_size   %#x ofs %#x\n",
 		  g_bootloader_size, now);
 	g_ondisk_bootloader_addr = kernel_body_load_address + now;
 	VB2_DEBUG("g_ondisk_bootloader_addr   0x%" PRIx64 "\n",
 		  g_ondisk_bootloader_addr);
 	now += g_bootloader_size;
-
+	g_ondisk_vmlinuz_header_addr = 0;
 	if (g_vmlinuz_header_size) {
-		g_vmlinuz_header_data = g_kernel_blob_data + now;
 		VB2_DEBUG("g_vmlinuz_header_size %#x ofs %#x\n",
 			  g_vmlinuz_header_size, now);
 		g_ondisk_vmlinuz_header_addr = kernel_body_load_address + now;
@@ -730,26 +786,136 @@ uint8_t *CreateKernelBlob(uint8_t *vmlinuz_buf, uint32_t vmlinuz_size,
 			  g_ondisk_vmlinuz_header_addr);
 	}
 
-	VB2_DEBUG("end of kern_blob at kern_blob+%#x\n", now);
-
-	/* Copy the kernel and params bits into the correct places */
+	/*
+	 * Only the config and params are built up in memory. The params are
+	 * filled in before the config is copied, as they always have been, so
+	 * the command line pointer is the start of the config.
+	 */
+	memset(config_buf, 0, sizeof(config_buf));
+	memset(param_buf, 0, sizeof(param_buf));
 	PickApartVmlinuz(vmlinuz_buf, vmlinuz_size, arch,
-			 kernel_body_load_address);
+			 kernel_body_load_address, param_buf, config_buf);
+	memcpy(config_buf, config_data, config_size);
 
-	/* Copy the other bits too */
-	memcpy(g_config_data, config_data, config_size);
-	memcpy(g_bootloader_data, bootloader_data, bootloader_size);
-	memset(g_bootloader_data + bootloader_size, 0,
-	       g_bootloader_size - bootloader_size);
-	if (g_vmlinuz_header_size) {
-		memcpy(g_vmlinuz_header_data,
-		       vmlinuz_buf,
-		       g_vmlinuz_header_size);
+	/*
+	 * The vblock comes first in the output but can't be signed until the
+	 * whole blob has been hashed, so leave room for it. Its size doesn't
+	 * depend on the blob; the preamble is checked against it below.
+	 */
+	min_size = padding > keyblock->keyblock_size
+		? padding - keyblock->keyblock_size : 0;
+	preamble_size = sizeof(struct vb2_kernel_preamble) +
+		2 * vb2_rsa_sig_size(signpriv_key->sig_alg);
+	if (preamble_size < min_size)
+		preamble_size = min_size;
+	vblock_size = keyblock->keyblock_size + preamble_size;
+	VB2_DEBUG("writing %s with %#x, %#x\n", outfile, vblock_size,
+		  vblock_only ? 0 : g_kernel_blob_size);
+
+	f = fopen(outfile, "wb");
+	if (!f) {
+		fprintf(stderr, "Can't open output file %s: %s\n",
+			outfile, strerror(errno));
+		return -1;
+	}
+	/* Don't remove a device or pipe if something goes wrong */
+	if (fstat(fileno(f), &sb) == 0 && S_ISREG(sb.st_mode))
+		remove_on_error = 1;
+	if (!vblock_only) {
+		/* The blob is written first, so the output must seek */
+		if (lseek(fileno(f), 0, SEEK_CUR) < 0) {
+			fprintf(stderr, "Can't write a kernel partition to %s,"
+				" which can't seek; only a vblock can be"
+				" written there\n", outfile);
+			goto done;
+		}
+		if (fseek(f, vblock_size, SEEK_SET)) {
+			fprintf(stderr, "Can't seek output file %s: %s\n",
+				outfile, strerror(errno));
+			goto done;
+		}
+		s.f = f;
 	}
 
-	if (blob_size_ptr)
-		*blob_size_ptr = g_kernel_blob_size;
-	return g_kernel_blob_data;
+	/* Hash (and write) the blob one part at a time */
+	if (VB2_SUCCESS != vb2_digest_init(&s.dc, false,
+					   signpriv_key->hash_alg, 0)) {
+		fprintf(stderr, "Error hashing kernel blob\n");
+		goto done;
+	}
+	if (StreamKernelBlobPart(&s, vmlinuz_buf + vmlinuz_size -
+				 g_kernel_size, g_kernel_size,
+				 roundup(g_kernel_size, CROS_ALIGN)) ||
+	    StreamKernelBlobPart(&s, config_buf, g_config_size,
+				 g_config_size) ||
+	    StreamKernelBlobPart(&s, param_buf, g_param_size,
+				 g_param_size) ||
+	    StreamKernelBlobPart(&s, bootloader_data, bootloader_size,
+				 g_bootloader_size) ||
+	    StreamKernelBlobPart(&s, vmlinuz_buf, g_vmlinuz_header_size,
+				 g_vmlinuz_header_size) ||
+	    StreamKernelBlobPart(&s, NULL, 0,
+				 g_kernel_blob_size - s.offset))
+		goto done;
+	VB2_DEBUG("end of kern_blob at kern_blob+%#x\n", s.offset);
+
+	hash.algo = signpriv_key->hash_alg;
+	if (VB2_SUCCESS != vb2_digest_finalize(&s.dc, hash.raw,
+					       vb2_digest_size(hash.algo))) {
+		fprintf(stderr, "Error hashing kernel blob\n");
+		goto done;
+	}
+
+	/* Sign the kernel data */
+	body_sig = vb2_calculate_signature_from_hash(&hash, g_kernel_blob_size,
+						     signpriv_key);
+	if (!body_sig) {
+		fprintf(stderr, "Error calculating body signature\n");
+		goto done;
+	}
+
+	/* Create preamble */
+	preamble = vb2_create_kernel_preamble(version,
+					      kernel_body_load_address,
+					      g_ondisk_bootloader_addr,
+					      g_bootloader_size,
+					      body_sig,
+					      g_ondisk_vmlinuz_header_addr,
+					      g_vmlinuz_header_size,
+					      flags,
+					      min_size,
+					      signpriv_key);
+	if (!preamble) {
+		fprintf(stderr, "Error creating preamble.\n");
+		goto done;
+	}
+	if (preamble->preamble_size != preamble_size) {
+		fprintf(stderr, "Preamble is %#x bytes, not %#x\n",
+			preamble->preamble_size, preamble_size);
+		goto done;
+	}
+
+	/* Now the vblock can go in front of the blob, if there is one */
+	if ((!vblock_only && fseek(f, 0, SEEK_SET)) ||
+	    1 != fwrite(keyblock, keyblock->keyblock_size, 1, f) ||
+	    1 != fwrite(preamble, preamble->preamble_size, 1, f)) {
+		fprintf(stderr, "Can't write output file %s: %s\n",
+			outfile, strerror(errno));
+		goto done;
+	}
+
+	rv = 0;
+done:
+	if (fclose(f) && !rv) {
+		fprintf(stderr, "Can't write output file %s: %s\n",
+			outfile, strerror(errno));
+		rv = -1;
+	}
+	if (rv && remove_on_error)
+		unlink(outfile);
+	free(preamble);
+	free(body_sig);
+	return rv;
 }
 
 enum futil_file_type ft_recognize_vblock1(uint8_t *buf, uint32_t len)
@@ -759,6 +925,11 @@ enum futil_file_type ft_recognize_vblock1(uint8_t *buf, uint32_t len)
 	struct vb2_workbuf wb;
 	vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
 
+	/* Don't bother copying something that can't be a keyblock */
+	if (len < sizeof(struct vb2_keyblock) ||
+	    memcmp(buf, VB2_KEYBLOCK_MAGIC, VB2_KEYBLOCK_MAGIC_SIZE))
+		return FILE_TYPE_UNKNOWN;
+
 	/* Vboot 2.0 signature checks destroy the buffer, so make a copy */
 	uint8_t *buf2 = malloc(len);
 	memcpy(buf2, buf, len);
@@ -16,11 +16,41 @@ void show_pubkey(const struct vb2_packed_key *pubkey, const char *sp);
 
 uint8_t *ReadConfigFile(const char *config_file, uint32_t *config_size);
 
-uint8_t *CreateKernelBlob(uint8_t *vmlinuz_buf, uint32_t vmlinuz_size,
-			  enum arch_t arch, uint64_t kernel_body_load_address,
-			  uint8_t *config_data, uint32_t config_size,
-			  uint8_t *bootloader_data, uint32_t bootloader_size,
-			  uint32_t *blob_size_ptr);
+/**
+ * Pack a vmlinuz file into a kernel blob, sign it, and write it out.
+ *
+ * The blob is hashed and written out a piece at a time as it is put
+ * together, so it is never all in memory at once.
+ *
+ * @param outfile		File to write the vblock and blob to
+ * @param vblock_only		Non-zero to write only the vblock
+ * @param vmlinuz_buf		Kernel image
+ * @param vmlinuz_size		Size of kernel image in bytes
+ * @param arch			Architecture of the kernel
+ * @param kernel_body_load_address	Where the blob is loaded in memory
+ * @param config_data		Kernel command line
+ * @param config_size		Size of the command line in bytes
+ * @param bootloader_data	Bootloader stub, or NULL
+ * @param bootloader_size	Size of the bootloader stub in bytes
+ * @param padding		Size to pad the vblock to
+ * @param version		Kernel version
+ * @param keyblock		Keyblock to put in the vblock
+ * @param signpriv_key		Key to sign the blob with
+ * @param flags			Preamble flags
+ *
+ * @return zero on success, non-zero if error.
+ */
+int WriteKernelPartition(const char *outfile, int vblock_only,
+			 const uint8_t *vmlinuz_buf, uint32_t vmlinuz_size,
+			 enum arch_t arch, uint64_t kernel_body_load_address,
+			 const uint8_t *config_data, uint32_t config_size,
+			 const uint8_t *bootloader_data,
+			 uint32_t bootloader_size,
+			 uint32_t padding,
+			 int version,
+			 struct vb2_keyblock *keyblock,
+			 struct vb2_private_key *signpriv_key,
+			 uint32_t flags);
 
 uint8_t *SignKernelBlob(uint8_t *kernel_blob,
 			uint32_t kernel_size,
@@ -103,6 +103,9 @@ typedef void (*CgptFindShowFn)(struct CgptFindParams *params,
 			       GptEntry *entry);
 typedef struct CgptFindParams {
 	const char *drive_name;
+	/* with no drive_name, search these rather than all physical drives */
+	char *const *drive_names;
+	int num_drive_names;
 	uint64_t drive_size;
 	int verbose;
 	int set_unique;
@@ -119,6 +122,8 @@ typedef struct CgptFindParams {
 	const char *label;
 	int hits;
 	int match_partnum;           /* 1-based; 0 means no match */
+	int jobs;                    /* drives to scan at once; <= 1 is serial */
+	int first_hit;               /* stop at the first match */
 	/* when working with MTD, we actually work on a temp file, but we still
 	 * need to print the device name. so this parameter is here to properly
 	 * show the correct device name in that special case. */
@@ -137,6 +142,33 @@ typedef struct CgptLegacyParams {
 	int mode;
 } CgptLegacyParams;
 
+enum {
+	CGPT_BATCH_ADD = 0,
+	CGPT_BATCH_PRIORITIZE,
+	CGPT_BATCH_BOOT,
+	CGPT_BATCH_LEGACY,
+};
+
+/* One step of a batch. The drive_name and drive_size in its params are
+ * ignored; every step works on the batch's drive. */
+typedef struct CgptBatchOp {
+	int type;
+	union {
+		CgptAddParams add;
+		CgptPrioritizeParams prioritize;
+		CgptBootParams boot;
+		CgptLegacyParams legacy;
+	};
+} CgptBatchOp;
+
+typedef struct CgptBatchParams {
+	const char *drive_name;
+	uint64_t drive_size;
+	CgptBatchOp *ops;
+	int num_ops;
+	int failed_op;               /* set to the failing op, or -1 */
+} CgptBatchParams;
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
@@ -37,6 +37,9 @@ int CgptRepair(CgptRepairParams *params);
 int CgptPrioritize(CgptPrioritizeParams *params);
 void CgptFind(CgptFindParams *params);
 int CgptLegacy(CgptLegacyParams *params);
+/* Applies all 'ops' in memory and writes the drive once, only if they all
+ * succeed and the result passes GptValidityCheck(). */
+int CgptBatch(CgptBatchParams *params);
 
 /* GUID conversion functions. Accepted format:
  *
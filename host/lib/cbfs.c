@@ -0,0 +1,372 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Read-only CBFS access for host tools, working on an image in memory.
+ *
+ * Files are found the way coreboot's cbfs_walk() finds them, so that the
+ * metadata hash matches what coreboot calculates at boot.
+ */
+
+#include "2common.h"
+#include "2sha.h"
+#include "2sysincludes.h"
+#include "cbfs.h"
+#include "fmap.h"
+
+#define CBFS_FILE_MAGIC "LARCHIVE"
+#define CBFS_ALIGNMENT 64
+/* Most header, name and attribute bytes coreboot reads for one file */
+#define CBFS_METADATA_MAX_SIZE 256
+
+/* File types that matter here */
+#define CBFS_TYPE_DELETED 0x00000000
+#define CBFS_TYPE_NULL 0xffffffff
+#define CBFS_TYPE_BOOTBLOCK 0x01
+#define CBFS_TYPE_CBFSHEADER 0x02
+#define CBFS_TYPE_INTEL_FIT 0x54
+#define CBFS_TYPE_AMDFW 0x80
+
+#define CBFS_FILE_ATTR_TAG_COMPRESSION 0x42435a4c
+#define CBFS_FILE_ATTR_TAG_HASH 0x68736148
+
+#define METADATA_HASH_ANCHOR_MAGIC "\xadMdtHsh\x15"
+#define METADATA_HASH_ANCHOR_MAGIC_SIZE 8
+#define BOOTBLOCK_REGION "BOOTBLOCK"
+#define BOOTBLOCK_FILE "bootblock"
+#define CONFIG_FILE "config"
+
+/* File header; all fields are big-endian */
+struct cbfs_file {
+	char magic[8];
+	uint32_t len;
+	uint32_t type;
+	uint32_t attributes_offset;
+	uint32_t offset;
+	char filename[];
+} __attribute__((packed));
+
+/* Attribute header; all fields are big-endian */
+struct cbfs_file_attribute {
+	uint32_t tag;
+	uint32_t len;
+} __attribute__((packed));
+
+/* A file header found while walking a CBFS */
+struct cbfs_entry {
+	uint32_t offset;	/* Offset of the header in the region */
+	const uint8_t *mdata;	/* Header, name and attributes */
+	uint32_t data_offset;	/* Size of |mdata| */
+	uint32_t len;		/* Size of the file data */
+	uint32_t type;
+	uint32_t attributes_offset;
+	const char *name;
+};
+
+struct cbfs_region {
+	const uint8_t *buf;
+	uint32_t size;
+};
+
+static uint32_t read_be32(const void *ptr)
+{
+	const uint8_t *p = ptr;
+
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | p[3];
+}
+
+static vb2_error_t find_region(const uint8_t *image, size_t image_size,
+			       const char *name, struct cbfs_region *region)
+{
+	FmapAreaHeader *ah;
+
+	if (!name)
+		name = CBFS_DEFAULT_REGION;
+
+	if (!fmap_find_by_name((uint8_t *)image, image_size, NULL, name, &ah) ||
+	    ah->area_offset > image_size ||
+	    ah->area_size > image_size - ah->area_offset) {
+		VB2_DEBUG("No FMAP area %s in image\n", name);
+		return VB2_ERROR_CBFS_REGION;
+	}
+
+	region->buf = image + ah->area_offset;
+	region->size = ah->area_size;
+	return VB2_SUCCESS;
+}
+
+/*
+ * Find the next file header at or after *offset.  Headers start on
+ * CBFS_ALIGNMENT boundaries; anything else, and headers whose sizes don't
+ * fit in the region, are skipped.  Returns false at the end of the CBFS.
+ */
+static bool next_entry(const struct cbfs_region *r, uint32_t *offset,
+		       struct cbfs_entry *e)
+{
+	uint64_t off = (*offset + CBFS_ALIGNMENT - 1) &
+		       ~(uint64_t)(CBFS_ALIGNMENT - 1);
+
+	for (; off + sizeof(struct cbfs_file) < r->size;
+	     off += CBFS_ALIGNMENT) {
+		const struct cbfs_file *f = (const void *)(r->buf + off);
+		uint32_t name_max;
+
+		if (memcmp(f->magic, CBFS_FILE_MAGIC, sizeof(f->magic)))
+			continue;
+
+		e->offset = off;
+		e->mdata = r->buf + off;
+		e->data_offset = read_be32(&f->offset);
+		e->len = read_be32(&f->len);
+		e->type = read_be32(&f->type);
+		e->attributes_offset = read_be32(&f->attributes_offset);
+
+		if (e->data_offset < sizeof(*f) ||
+		    e->data_offset > CBFS_METADATA_MAX_SIZE ||
+		    e->len > r->size ||
+		    off + e->data_offset + e->len > r->size) {
+			VB2_DEBUG("File @%#x too large\n", e->offset);
+			continue;
+		}
+
+		/* The name ends at the attributes, or else at the data */
+		name_max = e->data_offset - sizeof(*f);
+		if (e->attributes_offset > sizeof(*f) &&
+		    e->attributes_offset < e->data_offset)
+			name_max = e->attributes_offset - sizeof(*f);
+		e->name = f->filename;
+		if (strnlen(e->name, name_max) == name_max)
+			e->name = "";
+
+		*offset = off;
+		return true;
+	}
+
+	*offset = r->size;
+	return false;
+}
+
+static bool entry_is_empty(const struct cbfs_entry *e)
+{
+	return e->type == CBFS_TYPE_DELETED || e->type == CBFS_TYPE_NULL;
+}
+
+/*
+ * Find an attribute of a file.  If |size| is non-zero, the attribute must
+ * be exactly that big.  Returns NULL if it isn't there.
+ */
+static const uint8_t *find_attr(const struct cbfs_entry *e, uint32_t tag,
+				uint32_t size)
+{
+	uint32_t offset = e->attributes_offset;
+
+	if (!offset)
+		return NULL;
+
+	while (offset + sizeof(struct cbfs_file_attribute) <= e->data_offset) {
+		const uint8_t *attr = e->mdata + offset;
+		uint32_t len = read_be32(attr + 4);
+
+		if (len < sizeof(struct cbfs_file_attribute) ||
+		    len > e->data_offset - offset) {
+			VB2_DEBUG("Attribute %s[%x] invalid length: %u\n",
+				  e->name, read_be32(attr), len);
+			return NULL;
+		}
+		if (read_be32(attr) == tag)
+			return (!size || len == size) ? attr : NULL;
+		offset += len;
+	}
+
+	return NULL;
+}
+
+/* Return the data hash stored with a file, or NULL if it doesn't have one */
+static const struct vb2_hash *file_hash(const struct cbfs_entry *e)
+{
+	const uint8_t *attr = find_attr(e, CBFS_FILE_ATTR_TAG_HASH, 0);
+	const struct vb2_hash *hash;
+	uint32_t digest_size;
+
+	if (!attr)
+		return NULL;
+
+	hash = (const void *)(attr + sizeof(struct cbfs_file_attribute));
+	digest_size = vb2_digest_size(hash->algo);
+	if (!digest_size ||
+	    read_be32(attr + 4) < sizeof(struct cbfs_file_attribute) +
+				  offsetof(struct vb2_hash, raw) + digest_size)
+		return NULL;
+
+	return hash;
+}
+
+static vb2_error_t find_in_region(const struct cbfs_region *r,
+				  const char *name,
+				  struct cbfs_file_info *file)
+{
+	struct cbfs_entry e;
+	uint32_t offset = 0;
+	const uint8_t *attr;
+
+	for (; next_entry(r, &offset, &e); offset += e.data_offset + e.len) {
+		if (entry_is_empty(&e) || strcmp(e.name, name))
+			continue;
+
+		file->data = e.mdata + e.data_offset;
+		file->size = e.len;
+		file->type = e.type;
+		file->compression = CBFS_COMPRESS_NONE;
+		file->decompressed_size = 0;
+
+		/* Compression attribute: tag, len, compression, size */
+		attr = find_attr(&e, CBFS_FILE_ATTR_TAG_COMPRESSION, 16);
+		if (attr) {
+			file->compression = read_be32(attr + 8);
+			file->decompressed_size = read_be32(attr + 12);
+		}
+		return VB2_SUCCESS;
+	}
+
+	return VB2_ERROR_CBFS_FILE_NOT_FOUND;
+}
+
+vb2_error_t cbfs_find_file(const uint8_t *image, size_t image_size,
+			   const char *region, const char *name,
+			   struct cbfs_file_info *file)
+{
+	struct cbfs_region r;
+
+	VB2_TRY(find_region(image, image_size, region, &r));
+	return find_in_region(&r, name, file);
+}
+
+/*
+ * Get the metadata hash algorithm from the anchor in the bootblock.  Like
+ * cbfstool, look in the BOOTBLOCK area if there is one, and otherwise in the
+ * bootblock file of the default CBFS.
+ */
+static vb2_error_t anchor_hash_alg(const uint8_t *image, size_t image_size,
+				   enum vb2_hash_algorithm *algo)
+{
+	struct cbfs_file_info bootblock;
+	struct cbfs_region r;
+	const uint8_t *anchor;
+	const struct vb2_hash *hash;
+
+	if (find_region(image, image_size, BOOTBLOCK_REGION, &r) ==
+	    VB2_SUCCESS) {
+		bootblock.data = r.buf;
+		bootblock.size = r.size;
+	} else {
+		VB2_TRY(find_region(image, image_size, NULL, &r));
+		VB2_TRY(find_in_region(&r, BOOTBLOCK_FILE, &bootblock));
+		if (bootblock.compression != CBFS_COMPRESS_NONE)
+			return VB2_ERROR_CBFS_COMPRESSED;
+	}
+
+	anchor = memmem(bootblock.data, bootblock.size,
+			METADATA_HASH_ANCHOR_MAGIC,
+			METADATA_HASH_ANCHOR_MAGIC_SIZE);
+	if (!anchor || bootblock.data + bootblock.size - anchor <
+	    METADATA_HASH_ANCHOR_MAGIC_SIZE + offsetof(struct vb2_hash, raw))
+		return VB2_ERROR_CBFS_NO_ANCHOR;
+
+	hash = (const void *)(anchor + METADATA_HASH_ANCHOR_MAGIC_SIZE);
+	if (!vb2_digest_size(hash->algo))
+		return VB2_ERROR_CBFS_NO_ANCHOR;
+
+	*algo = hash->algo;
+	return VB2_SUCCESS;
+}
+
+/* Files coreboot never looks up by hash, as in cbfstool */
+static bool verification_exclude(uint32_t type)
+{
+	switch (type) {
+	case CBFS_TYPE_BOOTBLOCK:
+	case CBFS_TYPE_CBFSHEADER:
+	case CBFS_TYPE_INTEL_FIT:
+	case CBFS_TYPE_AMDFW:
+		return true;
+	default:
+		return false;
+	}
+}
+
+vb2_error_t cbfs_get_metadata_hash(const uint8_t *image, size_t image_size,
+				   const char *region, struct vb2_hash *hash)
+{
+	enum vb2_hash_algorithm algo;
+	struct vb2_digest_context dc;
+	const struct vb2_hash *fhash;
+	struct cbfs_region r;
+	struct cbfs_entry e;
+	uint32_t offset = 0;
+	bool found = false;
+
+	memset(hash, 0, sizeof(*hash));
+	hash->algo = VB2_HASH_INVALID;
+
+	VB2_TRY(find_region(image, image_size, region, &r));
+	VB2_TRY(anchor_hash_alg(image, image_size, &algo));
+	VB2_TRY(vb2_digest_init(&dc, false, algo, 0));
+
+	for (; next_entry(&r, &offset, &e); offset += e.data_offset + e.len) {
+		found = true;
+		if (entry_is_empty(&e))
+			continue;
+
+		VB2_TRY(vb2_digest_extend(&dc, e.mdata, e.data_offset));
+
+		if (verification_exclude(e.type))
+			continue;
+		fhash = file_hash(&e);
+		if (!fhash || vb2_hash_verify(false, e.mdata + e.data_offset,
+					      e.len, fhash)) {
+			VB2_DEBUG("File %s has %s hash\n", e.name,
+				  fhash ? "a bad" : "no");
+			return VB2_ERROR_CBFS_FILE_HASH;
+		}
+	}
+	if (!found)
+		return VB2_ERROR_CBFS_EMPTY;
+
+	VB2_TRY(vb2_digest_finalize(&dc, hash->raw, vb2_digest_size(algo)));
+	hash->algo = algo;
+	return VB2_SUCCESS;
+}
+
+vb2_error_t cbfs_get_config_value(const uint8_t *image, size_t image_size,
+				  const char *region, const char *config_field,
+				  char **value)
+{
+	struct cbfs_file_info config;
+	const char *line, *end, *next;
+	size_t field_len = strlen(config_field);
+
+	*value = NULL;
+
+	VB2_TRY(cbfs_find_file(image, image_size, region, CONFIG_FILE,
+			       &config));
+	if (config.compression != CBFS_COMPRESS_NONE)
+		return VB2_ERROR_CBFS_COMPRESSED;
+
+	line = (const char *)config.data;
+	end = line + config.size;
+	for (; line < end; line = next) {
+		next = memchr(line, '\n', end - line);
+		next = next ? next + 1 : end;
+
+		if (next - line > field_len && line[field_len] == '=' &&
+		    !memcmp(line, config_field, field_len)) {
+			line += field_len + 1;
+			*value = strndup(line, next - line -
+					 (next[-1] == '\n' ? 1 : 0));
+			break;
+		}
+	}
+
+	return VB2_SUCCESS;
+}
@@ -3,9 +3,15 @@
  * found in the LICENSE file.
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "2common.h"
 #include "2crypto.h"
 #include "2return_codes.h"
+#include "cbfs.h"
 #include "cbfstool.h"
 #include "host_misc.h"
 #include "subprocess.h"
@@ -28,12 +34,83 @@ static const char *get_cbfstool_path(void)
 	return cbfstool;
 }
 
+/* Only run cbfstool if one was asked for; otherwise read CBFS ourselves */
+static bool use_cbfstool(void)
+{
+	const char *env_cbfstool = getenv(ENV_CBFSTOOL);
+
+	return env_cbfstool && env_cbfstool[0] != '\0';
+}
+
+static vb2_error_t map_image(const char *file, uint8_t **buf, size_t *size)
+{
+	struct stat st;
+	void *ptr;
+	int fd;
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		VB2_DEBUG("Can't open %s: %m\n", file);
+		return VB2_ERROR_READ_FILE_OPEN;
+	}
+	if (fstat(fd, &st) || st.st_size <= 0) {
+		close(fd);
+		return VB2_ERROR_READ_FILE_SIZE;
+	}
+
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (ptr == MAP_FAILED) {
+		VB2_DEBUG("Can't mmap %s: %m\n", file);
+		return VB2_ERROR_READ_FILE_DATA;
+	}
+
+	*buf = ptr;
+	*size = st.st_size;
+	return VB2_SUCCESS;
+}
+
+static vb2_error_t native_get_metadata_hash(const char *file,
+					    const char *region,
+					    struct vb2_hash *hash)
+{
+	uint8_t *buf;
+	size_t size;
+	vb2_error_t rv;
+
+	memset(hash, 0, sizeof(*hash));
+	hash->algo = VB2_HASH_INVALID;
+	VB2_TRY(map_image(file, &buf, &size));
+	rv = cbfs_get_metadata_hash(buf, size, region, hash);
+	munmap(buf, size);
+	return rv;
+}
+
+static vb2_error_t native_get_config_value(const char *file,
+					   const char *region,
+					   const char *config_field,
+					   char **value)
+{
+	uint8_t *buf;
+	size_t size;
+	vb2_error_t rv;
+
+	*value = NULL;
+	VB2_TRY(map_image(file, &buf, &size));
+	rv = cbfs_get_config_value(buf, size, region, config_field, value);
+	munmap(buf, size);
+	return rv;
+}
+
 vb2_error_t cbfstool_truncate(const char *file, const char *region,
 			      size_t *new_size)
 {
 	int status;
 	char output_buffer[128];
-	const char *cbfstool = get_cbfstool_path();
+	const char *cbfstool;
+
+	/* This writes the image, so it is left to cbfstool */
+	cbfstool = get_cbfstool_path();
 
 	struct subprocess_target output = {
 		.type = TARGET_BUFFER_NULL_TERMINATED,
@@ -122,11 +199,16 @@ vb2_error_t cbfstool_get_metadata_hash(const char *file, const char *region,
 				       struct vb2_hash *hash)
 {
 	int status;
-	const char *cbfstool = get_cbfstool_path();
+	const char *cbfstool;
 	const size_t data_buffer_sz = 1024 * 1024;
-	char *data_buffer = malloc(data_buffer_sz);
+	char *data_buffer;
 	vb2_error_t rv = VB2_ERROR_CBFSTOOL;
 
+	if (!use_cbfstool())
+		return native_get_metadata_hash(file, region, hash);
+	cbfstool = get_cbfstool_path();
+	data_buffer = malloc(data_buffer_sz);
+
 	if (!data_buffer)
 		goto done;
 
@@ -193,11 +275,17 @@ vb2_error_t cbfstool_get_config_value(const char *file, const char *region,
 				      const char *config_field, char **value)
 {
 	int status;
-	const char *cbfstool = get_cbfstool_path();
+	const char *cbfstool;
 	const size_t data_buffer_sz = 1024 * 1024;
-	char *data_buffer = malloc(data_buffer_sz);
+	char *data_buffer;
 	vb2_error_t rv = VB2_ERROR_CBFSTOOL;
 
+	if (!use_cbfstool())
+		return native_get_config_value(file, region, config_field,
+					       value);
+	cbfstool = get_cbfstool_path();
+	data_buffer = malloc(data_buffer_sz);
+
 	*value = NULL;
 
 	if (!data_buffer)
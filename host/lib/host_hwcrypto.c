@@ -0,0 +1,385 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Host implementation of the vb2ex_hwcrypto_*() callbacks on top of
+ * OpenSSL, which picks the SHA extensions and its fastest bignum code for
+ * the CPU by itself.  The callbacks report HWCRYPTO_UNSUPPORTED unless the
+ * OpenSSL backend has been selected, so vboot falls back to its own code.
+ */
+
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/param_build.h>
+#endif
+#include <pthread.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#include "2api.h"
+#include "2common.h"
+#include "2packed_key.h"
+#include "2rsa.h"
+#include "2sha.h"
+#include "2sysincludes.h"
+#include "host_hwcrypto.h"
+
+/* Largest supported key, RSA-8192 */
+#define MAX_KEY_BYTES (8192 / 8)
+
+static enum vb2_crypto_backend crypto_backend;
+
+static const char *const backend_names[VB2_CRYPTO_BACKEND_COUNT] = {
+	[VB2_CRYPTO_BACKEND_VBOOT] = "vboot",
+	[VB2_CRYPTO_BACKEND_OPENSSL] = "openssl",
+};
+
+bool vb2_lookup_crypto_backend(const char *str,
+			       enum vb2_crypto_backend *backend)
+{
+	int i;
+
+	for (i = 0; i < VB2_CRYPTO_BACKEND_COUNT; i++) {
+		if (!strcasecmp(str, backend_names[i])) {
+			*backend = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void vb2_set_crypto_backend(enum vb2_crypto_backend backend)
+{
+	crypto_backend = backend;
+	vb2_host_keys_allow_hwcrypto =
+		backend == VB2_CRYPTO_BACKEND_OPENSSL;
+}
+
+vb2_error_t vb2_set_crypto_backend_from_env(void)
+{
+	const char *env = getenv(ENV_CRYPTO_BACKEND);
+	enum vb2_crypto_backend backend;
+
+	if (!env || !*env)
+		return VB2_SUCCESS;
+
+	if (!vb2_lookup_crypto_backend(env, &backend)) {
+		fprintf(stderr, "Unknown %s: %s\n", ENV_CRYPTO_BACKEND, env);
+		return VB2_ERROR_UNKNOWN;
+	}
+
+	vb2_set_crypto_backend(backend);
+	return VB2_SUCCESS;
+}
+
+static const EVP_MD *hash_to_md(enum vb2_hash_algorithm hash_alg)
+{
+	switch (hash_alg) {
+	case VB2_HASH_SHA1:
+		return EVP_sha1();
+	case VB2_HASH_SHA224:
+		return EVP_sha224();
+	case VB2_HASH_SHA256:
+		return EVP_sha256();
+	case VB2_HASH_SHA384:
+		return EVP_sha384();
+	case VB2_HASH_SHA512:
+		return EVP_sha512();
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Digests that were started and not finalized yet.  A caller may abandon a
+ * digest and reuse its context, and vb2_digest_init() then asks for the old
+ * one to be released.  The context can't say whether it holds a live
+ * digest, since it may be uninitialized memory, so look it up here.
+ */
+struct live_digest {
+	struct vb2_hwcrypto_digest_context *hc;
+	EVP_MD_CTX *ctx;
+};
+
+static struct live_digest *live_digests;
+static int num_live_digests;
+static int max_live_digests;
+static pthread_mutex_t live_digests_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool track_digest(struct vb2_hwcrypto_digest_context *hc,
+			 EVP_MD_CTX *ctx)
+{
+	bool ok = true;
+
+	pthread_mutex_lock(&live_digests_lock);
+	if (num_live_digests == max_live_digests) {
+		int max = max_live_digests ? max_live_digests * 2 : 8;
+		struct live_digest *grown =
+			realloc(live_digests, max * sizeof(*grown));
+
+		if (grown) {
+			live_digests = grown;
+			max_live_digests = max;
+		} else {
+			ok = false;
+		}
+	}
+	if (ok) {
+		live_digests[num_live_digests].hc = hc;
+		live_digests[num_live_digests].ctx = ctx;
+		num_live_digests++;
+	}
+	pthread_mutex_unlock(&live_digests_lock);
+	return ok;
+}
+
+/* Forgets the digest started on hc, returning it, or NULL if there is none */
+static EVP_MD_CTX *untrack_digest(struct vb2_hwcrypto_digest_context *hc)
+{
+	EVP_MD_CTX *ctx = NULL;
+	int i;
+
+	pthread_mutex_lock(&live_digests_lock);
+	for (i = 0; i < num_live_digests; i++) {
+		if (live_digests[i].hc == hc) {
+			ctx = live_digests[i].ctx;
+			live_digests[i] = live_digests[--num_live_digests];
+			break;
+		}
+	}
+	pthread_mutex_unlock(&live_digests_lock);
+	return ctx;
+}
+
+int vb2_hwcrypto_live_digests(void)
+{
+	int count;
+
+	pthread_mutex_lock(&live_digests_lock);
+	count = num_live_digests;
+	pthread_mutex_unlock(&live_digests_lock);
+	return count;
+}
+
+void vb2ex_hwcrypto_digest_release_ctx(struct vb2_hwcrypto_digest_context *hc)
+{
+	EVP_MD_CTX_free(untrack_digest(hc));
+}
+
+vb2_error_t vb2ex_hwcrypto_digest_init_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	enum vb2_hash_algorithm hash_alg, uint32_t data_size)
+{
+	const EVP_MD *md = hash_to_md(hash_alg);
+	EVP_MD_CTX *ctx;
+
+	if (crypto_backend != VB2_CRYPTO_BACKEND_OPENSSL || !md)
+		return VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED;
+
+	/* In case the caller didn't go through vb2_digest_init() */
+	vb2ex_hwcrypto_digest_release_ctx(hc);
+
+	ctx = EVP_MD_CTX_new();
+	if (!ctx || !EVP_DigestInit_ex(ctx, md, NULL) ||
+	    !track_digest(hc, ctx)) {
+		EVP_MD_CTX_free(ctx);
+		return VB2_ERROR_SHA_INIT_ALGORITHM;
+	}
+
+	hc->handle = ctx;
+	return VB2_SUCCESS;
+}
+
+vb2_error_t vb2ex_hwcrypto_digest_extend_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	const uint8_t *buf, uint32_t size)
+{
+	EVP_MD_CTX *ctx = hc->handle;
+
+	if (!EVP_DigestUpdate(ctx, buf, size)) {
+		/* A digest that failed won't be finalized */
+		vb2ex_hwcrypto_digest_release_ctx(hc);
+		hc->handle = NULL;
+		return VB2_ERROR_SHA_EXTEND_ALGORITHM;
+	}
+	return VB2_SUCCESS;
+}
+
+vb2_error_t vb2ex_hwcrypto_digest_finalize_ctx(
+	struct vb2_hwcrypto_digest_context *hc,
+	uint8_t *digest, uint32_t digest_size)
+{
+	EVP_MD_CTX *ctx = hc->handle;
+	uint8_t md_value[EVP_MAX_MD_SIZE];
+	unsigned int md_size;
+	vb2_error_t rv = VB2_SUCCESS;
+
+	if (!EVP_DigestFinal_ex(ctx, md_value, &md_size))
+		rv = VB2_ERROR_SHA_FINALIZE_ALGORITHM;
+	else if (digest_size < md_size)
+		rv = VB2_ERROR_SHA_FINALIZE_DIGEST_SIZE;
+	else
+		memcpy(digest, md_value, md_size);
+
+	vb2ex_hwcrypto_digest_release_ctx(hc);
+	hc->handle = NULL;
+	return rv;
+}
+
+/* Converts little-endian 32-bit words, as in vb2_public_key, to a BIGNUM */
+static BIGNUM *words_to_bn(const uint32_t *words, uint32_t count)
+{
+	uint8_t be[MAX_KEY_BYTES];
+	uint32_t i;
+
+	if (count * sizeof(uint32_t) > sizeof(be))
+		return NULL;
+
+	for (i = 0; i < count; i++) {
+		uint32_t w = words[count - 1 - i];
+
+		be[i * 4 + 0] = (uint8_t)(w >> 24);
+		be[i * 4 + 1] = (uint8_t)(w >> 16);
+		be[i * 4 + 2] = (uint8_t)(w >> 8);
+		be[i * 4 + 3] = (uint8_t)w;
+	}
+	return BN_bin2bn(be, count * sizeof(uint32_t), NULL);
+}
+
+static uint32_t key_exponent(const struct vb2_public_key *key)
+{
+	switch (key->sig_alg) {
+	case VB2_SIG_RSA2048_EXP3:
+	case VB2_SIG_RSA3072_EXP3:
+		return 3;
+	default:
+		return 65537;
+	}
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static EVP_PKEY *key_to_pkey(const struct vb2_public_key *key)
+{
+	BIGNUM *n = words_to_bn(key->n, key->arrsize);
+	BIGNUM *e = BN_new();
+	OSSL_PARAM_BLD *bld = OSSL_PARAM_BLD_new();
+	OSSL_PARAM *params = NULL;
+	EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_name(NULL, "RSA", NULL);
+	EVP_PKEY *pkey = NULL;
+
+	if (n && e && bld && ctx &&
+	    BN_set_word(e, key_exponent(key)) &&
+	    OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_RSA_N, n) &&
+	    OSSL_PARAM_BLD_push_BN(bld, OSSL_PKEY_PARAM_RSA_E, e))
+		params = OSSL_PARAM_BLD_to_param(bld);
+	if (!params || EVP_PKEY_fromdata_init(ctx) != 1 ||
+	    EVP_PKEY_fromdata(ctx, &pkey, EVP_PKEY_PUBLIC_KEY, params) != 1)
+		pkey = NULL;
+
+	OSSL_PARAM_free(params);
+	OSSL_PARAM_BLD_free(bld);
+	EVP_PKEY_CTX_free(ctx);
+	BN_free(n);
+	BN_free(e);
+	return pkey;
+}
+#else
+static EVP_PKEY *key_to_pkey(const struct vb2_public_key *key)
+{
+	BIGNUM *n = words_to_bn(key->n, key->arrsize);
+	BIGNUM *e = BN_new();
+	EVP_PKEY *pkey = EVP_PKEY_new();
+	RSA *rsa = RSA_new();
+
+	if (!n || !e || !pkey || !rsa ||
+	    !BN_set_word(e, key_exponent(key)) ||
+	    !RSA_set0_key(rsa, n, e, NULL)) {
+		BN_free(n);
+		BN_free(e);
+		EVP_PKEY_free(pkey);
+		RSA_free(rsa);
+		return NULL;
+	}
+	/* rsa owns n and e now */
+
+	if (!EVP_PKEY_assign_RSA(pkey, rsa)) {
+		EVP_PKEY_free(pkey);
+		RSA_free(rsa);
+		return NULL;
+	}
+	return pkey;
+}
+#endif
+
+vb2_error_t vb2ex_hwcrypto_rsa_verify_digest(const struct vb2_public_key *key,
+					     const uint8_t *sig,
+					     const uint8_t *digest)
+{
+	EVP_PKEY_CTX *ctx = NULL;
+	EVP_PKEY *pkey;
+	const EVP_MD *md;
+	vb2_error_t rv = VB2_ERROR_RSA_VERIFY_DIGEST;
+
+	if (crypto_backend != VB2_CRYPTO_BACKEND_OPENSSL)
+		return VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED;
+
+	/* Only the hashes vb2_check_padding() knows, to give the same answer */
+	switch (key->hash_alg) {
+	case VB2_HASH_SHA1:
+	case VB2_HASH_SHA256:
+	case VB2_HASH_SHA512:
+		md = hash_to_md(key->hash_alg);
+		break;
+	default:
+		return VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED;
+	}
+
+	pkey = key_to_pkey(key);
+	if (!pkey)
+		return VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED;
+
+	ctx = EVP_PKEY_CTX_new(pkey, NULL);
+	if (ctx &&
+	    EVP_PKEY_verify_init(ctx) == 1 &&
+	    EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) == 1 &&
+	    EVP_PKEY_CTX_set_signature_md(ctx, md) == 1 &&
+	    EVP_PKEY_verify(ctx, sig, vb2_rsa_sig_size(key->sig_alg),
+			    digest, vb2_digest_size(key->hash_alg)) == 1)
+		rv = VB2_SUCCESS;
+
+	EVP_PKEY_CTX_free(ctx);
+	EVP_PKEY_free(pkey);
+	return rv;
+}
+
+vb2_error_t vb2ex_hwcrypto_modexp(const struct vb2_public_key *key,
+				  uint8_t *inout, uint32_t *workbuf32, int exp)
+{
+	uint32_t size = key->arrsize * sizeof(uint32_t);
+	BIGNUM *n = NULL, *e = NULL, *a = NULL, *r = NULL;
+	BN_CTX *bn_ctx = NULL;
+	vb2_error_t rv = VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED;
+
+	if (crypto_backend != VB2_CRYPTO_BACKEND_OPENSSL)
+		return VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED;
+
+	n = words_to_bn(key->n, key->arrsize);
+	e = BN_new();
+	a = BN_bin2bn(inout, size, NULL);
+	r = BN_new();
+	bn_ctx = BN_CTX_new();
+	if (n && e && a && r && bn_ctx && BN_set_word(e, exp) &&
+	    BN_mod_exp_mont(r, a, e, n, bn_ctx, NULL) &&
+	    BN_bn2binpad(r, inout, size) == size)
+		rv = VB2_SUCCESS;
+
+	BN_free(n);
+	BN_free(e);
+	BN_free(a);
+	BN_free(r);
+	BN_CTX_free(bn_ctx);
+	return rv;
+}
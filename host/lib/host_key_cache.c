@@ -0,0 +1,155 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Cache of unpacked public keys for host verification loops.
+ *
+ * Entries are never replaced, since keys handed out earlier point into
+ * them; once the cache is full, further keys are unpacked in place.
+ */
+
+#include <pthread.h>
+
+#include "2common.h"
+#include "2packed_key.h"
+#include "2rsa.h"
+#include "2sha.h"
+#include "2sysincludes.h"
+#include "host_key_cache.h"
+
+struct key_cache_entry {
+	uint8_t digest[VB2_SHA256_DIGEST_SIZE];
+	struct vb2_public_key key;
+	/*
+	 * Packed key header followed by the key data.  The header is 32
+	 * bytes, so n[] and rr[] start on 64-bit boundaries.
+	 */
+	struct vb2_packed_key *packed;
+};
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct key_cache_entry cache[VB2_KEY_CACHE_MAX_ENTRIES];
+static struct vb2_key_cache_stats cache_stats;
+
+_Static_assert(sizeof(struct vb2_packed_key) % sizeof(uint64_t) == 0,
+	       "Key data copies must stay 64-bit aligned");
+
+/* Digest of what vb2_unpack_key_buffer() looks at in a packed key */
+static vb2_error_t key_digest(const struct vb2_packed_key *packed,
+			      uint8_t *digest)
+{
+	struct vb2_digest_context dc;
+
+	VB2_TRY(vb2_digest_init(&dc, false, VB2_HASH_SHA256, 0));
+	VB2_TRY(vb2_digest_extend(&dc, (const uint8_t *)&packed->algorithm,
+				  sizeof(packed->algorithm)));
+	VB2_TRY(vb2_digest_extend(&dc, (const uint8_t *)&packed->key_version,
+				  sizeof(packed->key_version)));
+	VB2_TRY(vb2_digest_extend(&dc, vb2_packed_key_data(packed),
+				  packed->key_size));
+	return vb2_digest_finalize(&dc, digest, VB2_SHA256_DIGEST_SIZE);
+}
+
+/* Called with cache_lock held */
+static vb2_error_t add_entry(struct key_cache_entry *e,
+			     const struct vb2_packed_key *packed)
+{
+	uint32_t size = sizeof(*packed) + packed->key_size;
+	struct vb2_packed_key *copy = malloc(size);
+	vb2_error_t rv;
+
+	if (!copy)
+		return VB2_ERROR_UNKNOWN;
+
+	memcpy(copy, packed, sizeof(*packed));
+	copy->key_offset = sizeof(*packed);
+	memcpy(copy + 1, vb2_packed_key_data(packed), packed->key_size);
+
+	rv = vb2_unpack_key_buffer(&e->key, (const uint8_t *)copy, size);
+	if (rv) {
+		free(copy);
+		return rv;
+	}
+	e->packed = copy;
+	cache_stats.entries++;
+	return VB2_SUCCESS;
+}
+
+vb2_error_t vb2_unpack_key_buffer_cached(struct vb2_public_key *key,
+					 const uint8_t *buf, uint32_t size)
+{
+	const struct vb2_packed_key *packed =
+		(const struct vb2_packed_key *)buf;
+	uint8_t digest[VB2_SHA256_DIGEST_SIZE];
+	struct key_cache_entry *e = NULL;
+	vb2_error_t rv;
+	uint32_t i;
+
+	/* The digest reads the key data, so check it's in the buffer first */
+	VB2_TRY(vb2_verify_packed_key_inside(buf, size, packed));
+	VB2_TRY(key_digest(packed, digest));
+
+	pthread_mutex_lock(&cache_lock);
+	for (i = 0; i < cache_stats.entries; i++) {
+		if (!memcmp(cache[i].digest, digest, sizeof(digest))) {
+			e = &cache[i];
+			break;
+		}
+	}
+
+	if (e) {
+		cache_stats.hits++;
+		rv = VB2_SUCCESS;
+	} else {
+		cache_stats.misses++;
+		if (cache_stats.entries < VB2_KEY_CACHE_MAX_ENTRIES) {
+			e = &cache[cache_stats.entries];
+			memcpy(e->digest, digest, sizeof(digest));
+			rv = add_entry(e, packed);
+			if (rv)
+				e = NULL;
+		} else {
+			rv = vb2_unpack_key_buffer(key, buf, size);
+		}
+	}
+
+	if (e) {
+		*key = e->key;
+		/* The backend may have changed since the key was cached */
+		key->allow_hwcrypto = vb2_host_keys_allow_hwcrypto;
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	return rv;
+}
+
+vb2_error_t vb2_unpack_key_cached(struct vb2_public_key *key,
+				  const struct vb2_packed_key *packed_key)
+{
+	if (!packed_key)
+		return VB2_ERROR_UNPACK_KEY_BUFFER;
+
+	return vb2_unpack_key_buffer_cached(key,
+					    (const uint8_t *)packed_key,
+					    packed_key->key_offset +
+					    packed_key->key_size);
+}
+
+void vb2_key_cache_get_stats(struct vb2_key_cache_stats *stats)
+{
+	pthread_mutex_lock(&cache_lock);
+	*stats = cache_stats;
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void vb2_key_cache_clear(void)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&cache_lock);
+	for (i = 0; i < cache_stats.entries; i++)
+		free(cache[i].packed);
+	memset(cache, 0, sizeof(cache));
+	memset(&cache_stats, 0, sizeof(cache_stats));
+	pthread_mutex_unlock(&cache_lock);
+}
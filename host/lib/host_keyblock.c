@@ -78,19 +78,12 @@ struct vb2_keyblock *vb2_create_keyblock(
 	return h;
 }
 
-/* TODO(gauravsh): This could easily be integrated into the function above
- * since the code is almost a mirror - I have kept it as such to avoid changing
- * the existing interface. */
-struct vb2_keyblock *vb2_create_keyblock_external(
+/* Allocates a keyblock with everything but the signature filled in */
+static struct vb2_keyblock *alloc_keyblock_external(
 		const struct vb2_packed_key *data_key,
-		const char *signing_key_pem_file,
 		uint32_t algorithm,
-		uint32_t flags,
-		const char *external_signer)
+		uint32_t flags)
 {
-	if (!signing_key_pem_file || !data_key || !external_signer)
-		return NULL;
-
 	uint32_t signed_size = sizeof(struct vb2_keyblock) + data_key->key_size;
 	uint32_t sig_data_size = vb2_rsa_sig_size(vb2_crypto_to_signature(algorithm));
 	uint32_t block_size =
@@ -124,16 +117,91 @@ struct vb2_keyblock *vb2_create_keyblock_external(
 	/* Calculate checksum */
 	struct vb2_signature *chk =
 		vb2_sha512_signature((uint8_t*)h, signed_size);
+	if (!chk) {
+		free(h);
+		return NULL;
+	}
 	vb2_copy_signature(&h->keyblock_hash, chk);
 	free(chk);
 
-	/* Calculate signature */
-	struct vb2_signature *sigtmp =
-		vb2_external_signature((uint8_t*)h, signed_size,
-				       signing_key_pem_file, algorithm,
-				       external_signer);
-	vb2_copy_signature(&h->keyblock_signature, sigtmp);
-	free(sigtmp);
+	return h;
+}
+
+vb2_error_t vb2_create_keyblocks_external(
+		const struct vb2_packed_key *const *data_keys,
+		const uint32_t *flags,
+		uint32_t count,
+		const char *signing_key_pem_file,
+		uint32_t algorithm,
+		const char *external_signer,
+		struct vb2_keyblock **blocks)
+{
+	const uint8_t **signed_data = NULL;
+	uint32_t *signed_sizes = NULL;
+	struct vb2_signature **sigs = NULL;
+	vb2_error_t rv = VB2_ERROR_UNKNOWN;
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		blocks[i] = NULL;
+	if (!signing_key_pem_file || !external_signer)
+		return VB2_ERROR_UNKNOWN;
+
+	signed_data = calloc(count, sizeof(*signed_data));
+	signed_sizes = calloc(count, sizeof(*signed_sizes));
+	sigs = calloc(count, sizeof(*sigs));
+	if (count && (!signed_data || !signed_sizes || !sigs))
+		goto done;
+
+	for (i = 0; i < count; i++) {
+		if (!data_keys[i])
+			goto done;
+		blocks[i] = alloc_keyblock_external(data_keys[i], algorithm,
+						    flags[i]);
+		if (!blocks[i])
+			goto done;
+		signed_data[i] = (const uint8_t *)blocks[i];
+		signed_sizes[i] = blocks[i]->keyblock_signature.data_size;
+	}
+
+	/* Calculate the signatures, all in one go */
+	rv = vb2_external_signatures(signed_data, signed_sizes, count,
+				     signing_key_pem_file, algorithm,
+				     external_signer, sigs);
+	if (rv)
+		goto done;
+
+	for (i = 0; i < count; i++) {
+		vb2_copy_signature(&blocks[i]->keyblock_signature, sigs[i]);
+		free(sigs[i]);
+	}
+
+done:
+	if (rv) {
+		for (i = 0; i < count; i++) {
+			free(blocks[i]);
+			blocks[i] = NULL;
+		}
+	}
+	free(signed_data);
+	free(signed_sizes);
+	free(sigs);
+	return rv;
+}
+
+struct vb2_keyblock *vb2_create_keyblock_external(
+		const struct vb2_packed_key *data_key,
+		const char *signing_key_pem_file,
+		uint32_t algorithm,
+		uint32_t flags,
+		const char *external_signer)
+{
+	struct vb2_keyblock *h;
+
+	if (vb2_create_keyblocks_external(&data_key, &flags, 1,
+					  signing_key_pem_file, algorithm,
+					  external_signer, &h))
+		return NULL;
 
 	/* Return the header */
 	return h;
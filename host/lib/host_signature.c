@@ -9,8 +9,10 @@
 
 #include <openssl/rsa.h>
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -108,60 +110,364 @@ static int sign_external(uint32_t size, const uint8_t *inbuf, uint8_t *outbuf,
 	return rv;
 }
 
-struct vb2_signature *vb2_external_signature(const uint8_t *data, uint32_t size,
-					     const char *key_file,
-					     uint32_t key_algorithm,
-					     const char *external_signer)
+/*
+ * External signers left running to sign many digests; see
+ * vb2_set_external_signer_persistent().
+ *
+ * Each is started as "SIGNER --persistent KEY_FILE" with a socket as its
+ * stdin and stdout.  Requests and responses are a 4-byte big-endian length
+ * followed by that many bytes; a request holds the data to sign and the
+ * response the signature, or nothing if signing failed.  Responses come
+ * back in the order of the requests.
+ */
+struct external_signer {
+	char *command;
+	char *key_file;
+	pid_t pid;
+	pid_t owner;		/* Process that started it */
+	int fd;			/* Its stdin and stdout */
+	struct external_signer *next;
+};
+
+/*
+ * Most requests queued in a signer at once.  This is small enough that
+ * its responses always fit in the socket buffer, so sending can't block
+ * on a signer that is itself blocked sending.
+ */
+#define MAX_OUTSTANDING_REQUESTS 16
+
+static bool persistent_signers;
+static struct external_signer *running_signers;
+
+void vb2_set_external_signer_persistent(bool persistent)
 {
-	struct vb2_hash hash;
+	persistent_signers = persistent;
+}
+
+static void free_signer(struct external_signer *s)
+{
+	free(s->command);
+	free(s->key_file);
+	free(s);
+}
+
+static void stop_signer(struct external_signer *s)
+{
+	/* Closing its input tells the signer to exit */
+	shutdown(s->fd, SHUT_WR);
+	close(s->fd);
+	if (waitpid(s->pid, NULL, 0) < 0)
+		VB2_DEBUG("waitpid() error\n");
+	free_signer(s);
+}
+
+/*
+ * Let go of signers a forked child inherited.  They still belong to the
+ * parent, which may be using them, so the child only closes its copy of
+ * the socket; shutting it down would stop the signer under the parent.
+ */
+static void drop_inherited_signers(void)
+{
+	struct external_signer **p = &running_signers, *s;
+
+	while ((s = *p)) {
+		if (s->owner == getpid()) {
+			p = &s->next;
+			continue;
+		}
+		*p = s->next;
+		close(s->fd);
+		free_signer(s);
+	}
+}
+
+void vb2_stop_external_signers(void)
+{
+	struct external_signer *s;
 
-	/* Calculate the digest */
-	if (VB2_SUCCESS != vb2_hash_calculate(false, data, size,
-					      vb2_crypto_to_hash(key_algorithm),
-					      &hash))
+	drop_inherited_signers();
+	while ((s = running_signers)) {
+		running_signers = s->next;
+		stop_signer(s);
+	}
+}
+
+static void remove_signer(struct external_signer *s)
+{
+	struct external_signer **p;
+
+	for (p = &running_signers; *p; p = &(*p)->next) {
+		if (*p == s) {
+			*p = s->next;
+			break;
+		}
+	}
+	stop_signer(s);
+}
+
+/* Find a running signer for the key, or start one */
+static struct external_signer *get_signer(const char *external_signer,
+					  const char *key_file)
+{
+	struct external_signer *s;
+	int sv[2];
+	pid_t pid;
+
+	/* A forked child can't share its parent's signers */
+	drop_inherited_signers();
+	for (s = running_signers; s; s = s->next)
+		if (!strcmp(s->command, external_signer) &&
+		    !strcmp(s->key_file, key_file))
+			return s;
+
+	VB2_DEBUG("Starting \"%s --persistent %s\" to perform signing.\n",
+		  external_signer, key_file);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+		VB2_DEBUG("socketpair() error\n");
 		return NULL;
+	}
+	pid = fork();
+	if (pid < 0) {
+		VB2_DEBUG("fork() error\n");
+		close(sv[0]);
+		close(sv[1]);
+		return NULL;
+	}
+	if (pid == 0) {
+		/* Child; the dup2()ed descriptors stay open across exec */
+		if (dup2(sv[1], STDIN_FILENO) < 0 ||
+		    dup2(sv[1], STDOUT_FILENO) < 0)
+			_exit(127);
+		execl(external_signer, external_signer, "--persistent",
+		      key_file, (char *)0);
+		_exit(127);
+	}
+	close(sv[1]);
 
-	uint32_t digest_info_size = 0;
-	const uint8_t *digest_info = NULL;
-	if (VB2_SUCCESS != vb2_digest_info(hash.algo,
-					   &digest_info, &digest_info_size))
+	s = calloc(1, sizeof(*s));
+	if (s) {
+		s->command = strdup(external_signer);
+		s->key_file = strdup(key_file);
+	}
+	if (!s || !s->command || !s->key_file) {
+		close(sv[0]);
+		waitpid(pid, NULL, 0);
+		if (s)
+			free_signer(s);
 		return NULL;
+	}
+	s->pid = pid;
+	s->owner = getpid();
+	s->fd = sv[0];
+	s->next = running_signers;
+	running_signers = s;
+	return s;
+}
+
+static int send_all(int fd, const uint8_t *buf, size_t size)
+{
+	ssize_t n;
 
-	int digest_size = vb2_digest_size(hash.algo);
-	uint8_t *signature_digest;
-	uint64_t signature_digest_len = digest_size + digest_info_size;
+	while (size) {
+		/* Fail rather than die of SIGPIPE if the signer has exited */
+		n = send(fd, buf, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		buf += n;
+		size -= n;
+	}
+	return 0;
+}
 
-	int rv;
+static int recv_all(int fd, uint8_t *buf, size_t size)
+{
+	ssize_t n;
 
-	/* Prepend the digest info to the digest */
-	signature_digest = calloc(signature_digest_len, 1);
-	if (!signature_digest)
-		return NULL;
+	while (size) {
+		n = read(fd, buf, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		buf += n;
+		size -= n;
+	}
+	return 0;
+}
+
+static int send_request(struct external_signer *s, const uint8_t *inbuf,
+			uint32_t size)
+{
+	uint8_t header[4] = { size >> 24, size >> 16, size >> 8, size };
+
+	if (send_all(s->fd, header, sizeof(header)) ||
+	    send_all(s->fd, inbuf, size)) {
+		VB2_DEBUG("Can't send request to external signer\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int recv_response(struct external_signer *s, uint8_t *outbuf,
+			 uint32_t outbufsize)
+{
+	uint8_t header[4];
+	uint32_t size;
 
-	memcpy(signature_digest, digest_info, digest_info_size);
-	memcpy(signature_digest + digest_info_size, hash.raw, digest_size);
+	if (recv_all(s->fd, header, sizeof(header))) {
+		VB2_DEBUG("External signer exited\n");
+		return -1;
+	}
+	size = (uint32_t)header[0] << 24 | header[1] << 16 |
+		header[2] << 8 | header[3];
+	if (size != outbufsize) {
+		VB2_DEBUG("External signer returned %u bytes, expected %u\n",
+			  size, outbufsize);
+		return -1;
+	}
+	if (recv_all(s->fd, outbuf, size)) {
+		VB2_DEBUG("External signer exited\n");
+		return -1;
+	}
+	return 0;
+}
 
-	/* Allocate output signature */
+/*
+ * Sign [count] inputs with a persistent signer, keeping several requests
+ * queued so that it doesn't wait on us between them.  Returns -1 on
+ * error, 0 on success.
+ */
+static int sign_persistent(uint32_t count, uint8_t *const *inbufs,
+			   uint32_t insize, uint8_t *const *outbufs,
+			   uint32_t outbufsize, const char *pem_file,
+			   const char *external_signer)
+{
+	struct external_signer *s;
+	uint32_t sent = 0, received = 0;
+
+	s = get_signer(external_signer, pem_file);
+	if (!s)
+		return -1;
+
+	while (received < count) {
+		while (sent < count &&
+		       sent - received < MAX_OUTSTANDING_REQUESTS) {
+			if (send_request(s, inbufs[sent], insize))
+				goto fail;
+			sent++;
+		}
+		if (recv_response(s, outbufs[received], outbufsize))
+			goto fail;
+		received++;
+	}
+	return 0;
+
+fail:
+	/* Its responses are out of step now, so start afresh next time */
+	remove_signer(s);
+	return -1;
+}
+
+vb2_error_t vb2_external_signatures(const uint8_t *const *data,
+				    const uint32_t *sizes, uint32_t count,
+				    const char *key_file,
+				    uint32_t key_algorithm,
+				    const char *external_signer,
+				    struct vb2_signature **sigs)
+{
+	enum vb2_hash_algorithm hash_alg = vb2_crypto_to_hash(key_algorithm);
 	uint32_t sig_size =
 		vb2_rsa_sig_size(vb2_crypto_to_signature(key_algorithm));
-	struct vb2_signature *sig = vb2_alloc_signature(sig_size, size);
-	if (!sig) {
-		free(signature_digest);
-		return NULL;
+	const uint8_t *digest_info = NULL;
+	uint32_t digest_info_size = 0;
+	uint32_t digest_size = vb2_digest_size(hash_alg);
+	uint32_t signature_digest_len;
+	uint8_t **signature_digests = NULL;
+	uint8_t **outbufs = NULL;
+	struct vb2_hash hash;
+	vb2_error_t rv = VB2_ERROR_EXTERNAL_SIGNER;
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		sigs[i] = NULL;
+	if (!count)
+		return VB2_SUCCESS;
+
+	if (VB2_SUCCESS != vb2_digest_info(hash_alg,
+					   &digest_info, &digest_info_size))
+		return VB2_ERROR_DIGEST_INFO;
+	signature_digest_len = digest_size + digest_info_size;
+
+	signature_digests = calloc(count, sizeof(*signature_digests));
+	outbufs = calloc(count, sizeof(*outbufs));
+	if (!signature_digests || !outbufs)
+		goto done;
+
+	for (i = 0; i < count; i++) {
+		/* Calculate the digest */
+		if (VB2_SUCCESS != vb2_hash_calculate(false, data[i], sizes[i],
+						      hash_alg, &hash))
+			goto done;
+
+		/* Prepend the digest info to the digest */
+		signature_digests[i] = calloc(signature_digest_len, 1);
+		if (!signature_digests[i])
+			goto done;
+		memcpy(signature_digests[i], digest_info, digest_info_size);
+		memcpy(signature_digests[i] + digest_info_size, hash.raw,
+		       digest_size);
+
+		/* Allocate output signature */
+		sigs[i] = vb2_alloc_signature(sig_size, sizes[i]);
+		if (!sigs[i])
+			goto done;
+		outbufs[i] = vb2_signature_data_mutable(sigs[i]);
+	}
+
+	/* Sign the signature_digests into our output buffers */
+	if (persistent_signers) {
+		if (sign_persistent(count, signature_digests,
+				    signature_digest_len, outbufs, sig_size,
+				    key_file, external_signer))
+			goto done;
+	} else {
+		for (i = 0; i < count; i++)
+			if (-1 == sign_external(signature_digest_len,
+						signature_digests[i],
+						outbufs[i], sig_size,
+						key_file, external_signer))
+				goto done;
 	}
+	rv = VB2_SUCCESS;
 
-	/* Sign the signature_digest into our output buffer */
-	rv = sign_external(signature_digest_len,    /* Input length */
-			   signature_digest,        /* Input data */
-			   vb2_signature_data_mutable(sig),  /* Output sig */
-			   sig_size,                /* Max Output sig size */
-			   key_file,                /* Key file to use */
-			   external_signer);        /* External cmd to invoke */
-	free(signature_digest);
+done:
+	for (i = 0; i < count; i++) {
+		if (signature_digests)
+			free(signature_digests[i]);
+		if (rv) {
+			free(sigs[i]);
+			sigs[i] = NULL;
+		}
+	}
+	free(signature_digests);
+	free(outbufs);
+	return rv;
+}
+
+struct vb2_signature *vb2_external_signature(const uint8_t *data, uint32_t size,
+					     const char *key_file,
+					     uint32_t key_algorithm,
+					     const char *external_signer)
+{
+	struct vb2_signature *sig;
 
-	if (-1 == rv) {
+	if (VB2_SUCCESS != vb2_external_signatures(&data, &size, 1, key_file,
+						   key_algorithm,
+						   external_signer, &sig)) {
 		VB2_DEBUG("RSA_private_encrypt() failed.\n");
-		free(sig);
 		return NULL;
 	}
 
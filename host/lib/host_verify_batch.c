@@ -0,0 +1,258 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Verifying many signatures at once on the host.
+ *
+ * Jobs are sorted by how their data gets hashed, then cut into chunks.
+ * Worker threads take one chunk at a time, hash its data together, and
+ * check each of its signatures.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "2common.h"
+#include "2rsa.h"
+#include "2sha.h"
+#include "2sysincludes.h"
+#include "host_verify_batch.h"
+
+/* Most jobs hashed together in one chunk; enough for 8-lane SHA-256 */
+#define MAX_CHUNK_JOBS 8
+
+/* How a job's data is hashed, in the order jobs are sorted */
+enum hash_class {
+	HASH_NONE,		/* Caller gave the digest */
+	HASH_HWCRYPTO,		/* One at a time, through vb2_hash_calculate() */
+	HASH_MANY,		/* Together, through vb2_hash_calculate_many() */
+};
+
+struct sort_entry {
+	uint32_t key;		/* Hash class and algorithm */
+	uint32_t index;		/* Index into the jobs array */
+};
+
+struct chunk {
+	uint32_t first;		/* First entry in the sorted order */
+	uint32_t count;		/* Number of entries */
+};
+
+struct batch {
+	struct vb2_verify_job *jobs;
+	struct sort_entry *order;
+	struct chunk *chunks;
+	uint32_t chunk_count;
+	uint32_t next_chunk;	/* Next chunk to take; updated atomically */
+};
+
+static uint32_t sort_key(const struct vb2_verify_job *job)
+{
+	enum hash_class class;
+
+	if (job->digest)
+		class = HASH_NONE;
+	else if (job->key->allow_hwcrypto)
+		class = HASH_HWCRYPTO;
+	else
+		class = HASH_MANY;
+
+	return (uint32_t)class << 16 | job->key->hash_alg;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+	const struct sort_entry *ea = a, *eb = b;
+
+	if (ea->key != eb->key)
+		return ea->key < eb->key ? -1 : 1;
+	/* Keep jobs in submission order within a group */
+	return ea->index < eb->index ? -1 : ea->index > eb->index;
+}
+
+/* Check one signature against a digest, without touching the caller's copy */
+static vb2_error_t verify_one(const struct vb2_verify_job *job,
+			      const uint8_t *digest)
+{
+	uint8_t workbuf[VB2_VERIFY_DIGEST_WORKBUF_BYTES]
+		__attribute__((aligned(VB2_WORKBUF_ALIGN)));
+	const struct vb2_signature *sig = job->sig;
+	struct vb2_signature *copy;
+	struct vb2_workbuf wb;
+	uint32_t sig_size = 0;
+	vb2_error_t rv;
+
+	/* Only copy signature data that vb2_verify_digest() will look at */
+	if (sig->sig_size == vb2_rsa_sig_size(job->key->sig_alg))
+		sig_size = sig->sig_size;
+
+	copy = malloc(sizeof(*copy) + sig_size);
+	if (!copy)
+		return VB2_ERROR_UNKNOWN;
+	*copy = *sig;
+	copy->sig_offset = sizeof(*copy);
+	memcpy(copy + 1, vb2_signature_data(sig), sig_size);
+
+	vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
+	rv = vb2_verify_digest(job->key, copy, digest, &wb);
+	free(copy);
+	return rv;
+}
+
+static void run_chunk(struct batch *b, const struct chunk *c)
+{
+	struct vb2_hash hashes[MAX_CHUNK_JOBS];
+	struct vb2_hash_job hash_jobs[MAX_CHUNK_JOBS];
+	struct vb2_verify_job *jobs[MAX_CHUNK_JOBS];
+	uint32_t hash_count = 0;
+	enum vb2_hash_algorithm hash_alg;
+	vb2_error_t rv;
+	uint32_t i;
+
+	for (i = 0; i < c->count; i++) {
+		struct vb2_verify_job *job =
+			&b->jobs[b->order[c->first + i].index];
+
+		jobs[i] = job;
+		job->result = VB2_SUCCESS;
+		if (job->digest)
+			continue;
+
+		if (job->sig->data_size > job->size) {
+			VB2_DEBUG("Data buffer smaller than length of "
+				  "signed data.\n");
+			job->result = VB2_ERROR_VDATA_NOT_ENOUGH_DATA;
+		} else if (job->key->allow_hwcrypto) {
+			job->result = vb2_hash_calculate(true, job->data,
+							 job->sig->data_size,
+							 job->key->hash_alg,
+							 &hashes[i]);
+		} else {
+			hash_jobs[hash_count].buf = job->data;
+			hash_jobs[hash_count].size = job->sig->data_size;
+			hash_jobs[hash_count].hash = &hashes[i];
+			hash_count++;
+		}
+	}
+
+	/* Every job in a chunk uses the same hash algorithm */
+	if (hash_count) {
+		hash_alg = jobs[0]->key->hash_alg;
+		rv = vb2_hash_calculate_many(hash_alg, hash_jobs, hash_count);
+		if (rv) {
+			for (i = 0; i < c->count; i++)
+				if (!jobs[i]->digest &&
+				    jobs[i]->result == VB2_SUCCESS)
+					jobs[i]->result = rv;
+		}
+	}
+
+	for (i = 0; i < c->count; i++) {
+		if (jobs[i]->result != VB2_SUCCESS)
+			continue;
+		jobs[i]->result = verify_one(jobs[i], jobs[i]->digest ?
+					     jobs[i]->digest : hashes[i].raw);
+	}
+}
+
+static void *worker(void *arg)
+{
+	struct batch *b = arg;
+	uint32_t i;
+
+	while ((i = __atomic_fetch_add(&b->next_chunk, 1, __ATOMIC_RELAXED)) <
+	       b->chunk_count)
+		run_chunk(b, &b->chunks[i]);
+
+	return NULL;
+}
+
+/*
+ * Cut the sorted jobs into chunks.  Software-hashed groups are split
+ * evenly between the threads, up to MAX_CHUNK_JOBS per chunk; everything
+ * else gains nothing from being grouped and goes one job per chunk.
+ */
+static void make_chunks(struct batch *b, uint32_t count, uint32_t threads)
+{
+	uint32_t start = 0, end, size, i;
+
+	b->chunk_count = 0;
+	while (start < count) {
+		uint32_t key = b->order[start].key;
+
+		for (end = start + 1; end < count; end++)
+			if (b->order[end].key != key)
+				break;
+
+		if (key >> 16 == HASH_MANY) {
+			size = (end - start + threads - 1) / threads;
+			size = VB2_MIN(size, MAX_CHUNK_JOBS);
+		} else {
+			size = 1;
+		}
+
+		for (i = start; i < end; i += size) {
+			b->chunks[b->chunk_count].first = i;
+			b->chunks[b->chunk_count].count =
+				VB2_MIN(size, end - i);
+			b->chunk_count++;
+		}
+		start = end;
+	}
+}
+
+vb2_error_t vb2_verify_batch(struct vb2_verify_job *jobs, uint32_t count,
+			     uint32_t threads)
+{
+	struct batch b = { .jobs = jobs };
+	pthread_t *tids = NULL;
+	uint32_t started = 0;
+	vb2_error_t rv = VB2_SUCCESS;
+	uint32_t i;
+
+	if (!count)
+		return VB2_SUCCESS;
+
+	if (!threads) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? cpus : 1;
+	}
+	threads = VB2_MIN(threads, count);
+
+	b.order = malloc(count * sizeof(*b.order));
+	b.chunks = malloc(count * sizeof(*b.chunks));
+	if (threads > 1)
+		tids = malloc((threads - 1) * sizeof(*tids));
+	if (!b.order || !b.chunks || (threads > 1 && !tids)) {
+		rv = VB2_ERROR_UNKNOWN;
+		goto done;
+	}
+
+	for (i = 0; i < count; i++) {
+		b.order[i].key = sort_key(&jobs[i]);
+		b.order[i].index = i;
+	}
+	qsort(b.order, count, sizeof(*b.order), compare_entries);
+	make_chunks(&b, count, threads);
+
+	/* The calling thread works too; if a thread won't start, carry on */
+	for (started = 0; started < threads - 1; started++)
+		if (pthread_create(&tids[started], NULL, worker, &b))
+			break;
+	worker(&b);
+	for (i = 0; i < started; i++)
+		pthread_join(tids[i], NULL);
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].result) {
+			rv = jobs[i].result;
+			break;
+		}
+	}
+
+done:
+	free(tids);
+	free(b.chunks);
+	free(b.order);
+	return rv;
+}
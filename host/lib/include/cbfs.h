@@ -0,0 +1,84 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Read-only CBFS access for host tools, working on an image in memory.
+ */
+
+#ifndef VBOOT_REFERENCE_CBFS_H_
+#define VBOOT_REFERENCE_CBFS_H_
+
+#include "2common.h"
+#include "2sha.h"
+
+/* Region used when none is given, as with cbfstool */
+#define CBFS_DEFAULT_REGION "COREBOOT"
+
+enum cbfs_compression {
+	CBFS_COMPRESS_NONE = 0,
+	CBFS_COMPRESS_LZMA = 1,
+	CBFS_COMPRESS_LZ4 = 2,
+};
+
+/* A file found in a CBFS */
+struct cbfs_file_info {
+	const uint8_t *data;	/* File data as stored in the image */
+	uint32_t size;		/* Size of |data| in bytes */
+	uint32_t type;		/* CBFS file type */
+	enum cbfs_compression compression;
+	uint32_t decompressed_size;	/* Only set if compressed */
+};
+
+/**
+ * Look up a file in a CBFS.
+ *
+ * Empty and deleted files are never found.
+ *
+ * @param image		Firmware image containing an FMAP
+ * @param image_size	Size of |image| in bytes
+ * @param region	FMAP area holding the CBFS, or NULL for COREBOOT
+ * @param name		File name to look for
+ * @param file		Filled in with the file found; |file->data| points
+ *			into |image|
+ * @return VB2_SUCCESS, or non-zero error code if error.
+ */
+vb2_error_t cbfs_find_file(const uint8_t *image, size_t image_size,
+			   const char *region, const char *name,
+			   struct cbfs_file_info *file);
+
+/**
+ * Calculate the metadata hash of a CBFS.
+ *
+ * This is the hash coreboot checks with CBFS_VERIFICATION, taken over the
+ * headers of every non-empty file, with the algorithm from the metadata
+ * hash anchor in the bootblock.  It is only returned if every file that
+ * should carry a hash of its data does, and the data matches it; this is
+ * what "cbfstool print -kv" reports as fully valid.
+ *
+ * @param image		Firmware image containing an FMAP
+ * @param image_size	Size of |image| in bytes
+ * @param region	FMAP area holding the CBFS, or NULL for COREBOOT
+ * @param hash		Filled in with the hash; algo is VB2_HASH_INVALID if
+ *			there is no valid hash
+ * @return VB2_SUCCESS, or non-zero error code if error.
+ */
+vb2_error_t cbfs_get_metadata_hash(const uint8_t *image, size_t image_size,
+				   const char *region, struct vb2_hash *hash);
+
+/**
+ * Get the value of a field from the coreboot "config" file in a CBFS.
+ *
+ * @param image		Firmware image containing an FMAP
+ * @param image_size	Size of |image| in bytes
+ * @param region	FMAP area holding the CBFS, or NULL for COREBOOT
+ * @param config_field	Field to look for, e.g. "CONFIG_FOO"
+ * @param value		Set to the value as a string which the caller must
+ *			free, or NULL if the field isn't set
+ * @return VB2_SUCCESS, or non-zero error code if there is no readable
+ *	   config file.
+ */
+vb2_error_t cbfs_get_config_value(const uint8_t *image, size_t image_size,
+				  const char *region, const char *config_field,
+				  char **value);
+
+#endif  /* VBOOT_REFERENCE_CBFS_H_ */
@@ -6,9 +6,18 @@
 #include "2return_codes.h"
 #include "2sha.h"
 
+/*
+ * These functions read the image in-process with the CBFS reader in cbfs.h,
+ * except cbfstool_truncate(), which always runs cbfstool.  If ENV_CBFSTOOL
+ * is set, that cbfstool is run to answer all of them instead.
+ */
 #define ENV_CBFSTOOL "CBFSTOOL"
 #define DEFAULT_CBFSTOOL "cbfstool"
 
+/*
+ * Run "cbfstool truncate" on the CBFS in `region` of image `file`, and get
+ * the size it was truncated to.  cbfstool rewrites the image as well.
+ */
 vb2_error_t cbfstool_truncate(const char *file, const char *region,
 			      size_t *new_size);
 
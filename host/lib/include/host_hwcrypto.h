@@ -0,0 +1,64 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Host implementation of the vb2ex_hwcrypto_*() callbacks.
+ */
+
+#ifndef VBOOT_REFERENCE_HOST_HWCRYPTO_H_
+#define VBOOT_REFERENCE_HOST_HWCRYPTO_H_
+
+#include <stdbool.h>
+
+#include "2return_codes.h"
+
+/* Environment variable that picks the crypto backend */
+#define ENV_CRYPTO_BACKEND "VB2_CRYPTO_BACKEND"
+
+enum vb2_crypto_backend {
+	/* vboot's own SHA and RSA code, as used by firmware */
+	VB2_CRYPTO_BACKEND_VBOOT = 0,
+	/* OpenSSL EVP digests and BN modexp */
+	VB2_CRYPTO_BACKEND_OPENSSL,
+
+	VB2_CRYPTO_BACKEND_COUNT,
+};
+
+/**
+ * Look up a crypto backend by name ("vboot" or "openssl").
+ *
+ * @param str		Name of the backend
+ * @param backend	Where to store the backend
+ * @return true if the name is known, false if not.
+ */
+bool vb2_lookup_crypto_backend(const char *str,
+			       enum vb2_crypto_backend *backend);
+
+/**
+ * Select the crypto backend for verification in this process.
+ *
+ * With the OpenSSL backend, keys unpacked afterwards allow hwcrypto, so
+ * vb2_verify_data() and vb2_verify_digest() hash and verify through the
+ * vb2ex_hwcrypto_*() callbacks in host_hwcrypto.c.
+ *
+ * @param backend	Backend to use
+ */
+void vb2_set_crypto_backend(enum vb2_crypto_backend backend);
+
+/**
+ * Select the crypto backend named by ENV_CRYPTO_BACKEND, if it is set.
+ *
+ * @return VB2_SUCCESS, or VB2_ERROR_UNKNOWN if the variable names an unknown
+ * backend.
+ */
+vb2_error_t vb2_set_crypto_backend_from_env(void);
+
+/**
+ * Count the OpenSSL digests that were started and not yet finalized or
+ * released.  For tests, to check that abandoned digests get freed.
+ *
+ * @return The number of live digests.
+ */
+int vb2_hwcrypto_live_digests(void);
+
+#endif  /* VBOOT_REFERENCE_HOST_HWCRYPTO_H_ */
@@ -0,0 +1,68 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Cache of unpacked public keys for host verification loops.
+ */
+
+#ifndef VBOOT_REFERENCE_HOST_KEY_CACHE_H_
+#define VBOOT_REFERENCE_HOST_KEY_CACHE_H_
+
+#include "2common.h"
+#include "2rsa.h"
+
+/* Keys past this many are unpacked every time instead of cached */
+#define VB2_KEY_CACHE_MAX_ENTRIES 64
+
+struct vb2_key_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint32_t entries;
+};
+
+/**
+ * Unpack a vboot1-format key through the key cache.
+ *
+ * Like vb2_unpack_key(), but keys are looked up by the SHA-256 digest of
+ * their algorithm, version and key data.  A key that is already cached is
+ * not validated again.  On a hit, or once a new key has been added, the
+ * elements of the unpacked key point into the cache's own copy of the key
+ * data, so the caller may free the packed key.  That copy is aligned for
+ * 64-bit Montgomery limbs.
+ *
+ * @param key		Destination for unpacked key
+ * @param packed_key	Source packed key
+ * @return VB2_SUCCESS, or non-zero error code if error.
+ */
+vb2_error_t vb2_unpack_key_cached(struct vb2_public_key *key,
+				  const struct vb2_packed_key *packed_key);
+
+/**
+ * Unpack a vboot1-format key buffer through the key cache.
+ *
+ * See vb2_unpack_key_cached().
+ *
+ * @param key		Destination for unpacked key
+ * @param buf		Source buffer containing packed key
+ * @param size		Size of buffer in bytes
+ * @return VB2_SUCCESS, or non-zero error code if error.
+ */
+vb2_error_t vb2_unpack_key_buffer_cached(struct vb2_public_key *key,
+					 const uint8_t *buf, uint32_t size);
+
+/**
+ * Read the key cache counters.
+ *
+ * @param stats		Destination for the counters
+ */
+void vb2_key_cache_get_stats(struct vb2_key_cache_stats *stats);
+
+/**
+ * Empty the key cache and reset its counters.
+ *
+ * Keys unpacked through the cache before this point must not be used
+ * afterwards.
+ */
+void vb2_key_cache_clear(void);
+
+#endif  /* VBOOT_REFERENCE_HOST_KEY_CACHE_H_ */
@@ -47,6 +47,33 @@ struct vb2_keyblock *vb2_create_keyblock_external(
 		uint32_t flags,
 		const char *external_signer);
 
+/**
+ * Create several keyblock headers, all signed by the same external signer.
+ *
+ * Like vb2_create_keyblock_external() for each data key, except that the
+ * signatures come from one vb2_external_signatures() call, so a persistent
+ * signer gets every request without waiting for each signature in turn.
+ *
+ * @param data_keys		Data key to store in each keyblock
+ * @param flags			Keyblock flags for each keyblock
+ * @param count			Number of keyblocks
+ * @param signing_key_pem_file	Filename of private key
+ * @param algorithm		Signing algorithm index
+ * @param external_signer	Path to external signer program
+ * @param blocks		Filled in with the keyblocks, which the caller
+ *				must free(); all NULL on error
+ *
+ * @return VB2_SUCCESS, or non-zero if error.
+ */
+vb2_error_t vb2_create_keyblocks_external(
+		const struct vb2_packed_key *const *data_keys,
+		const uint32_t *flags,
+		uint32_t count,
+		const char *signing_key_pem_file,
+		uint32_t algorithm,
+		const char *external_signer,
+		struct vb2_keyblock **blocks);
+
 /**
  * Read a keyblock from a .keyblock file.
  *
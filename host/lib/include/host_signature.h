@@ -69,6 +69,23 @@ struct vb2_signature *vb2_sha512_signature(const uint8_t *data, uint32_t size);
 struct vb2_signature *vb2_calculate_signature(
 	const uint8_t *data, uint32_t size, const struct vb2_private_key *key);
 
+/**
+ * Calculate a signature for data which has already been hashed.
+ *
+ * This lets callers hash data as they produce it, rather than having all of
+ * it in memory at once.  The result is the same as vb2_calculate_signature()
+ * on the data itself.
+ *
+ * @param hash		Hash of the data, using the key's hash algorithm
+ * @param size		Length of the data in bytes
+ * @param key		Private key to use to sign data
+ *
+ * @return The signature, or NULL if error.  Caller must free() it.
+ */
+struct vb2_signature *vb2_calculate_signature_from_hash(
+	const struct vb2_hash *hash, uint32_t size,
+	const struct vb2_private_key *key);
+
 /**
  * Calculate a signature for the data using an external signer.
  *
@@ -85,6 +102,51 @@ struct vb2_signature *vb2_external_signature(const uint8_t *data, uint32_t size,
 					     uint32_t key_algorithm,
 					     const char *external_signer);
 
+/**
+ * Calculate signatures for several pieces of data using an external signer.
+ *
+ * This is the same as calling vb2_external_signature() on each, except that
+ * a persistent signer is sent all of them without waiting for each
+ * signature in turn.
+ *
+ * @param data			Pointers to data to sign
+ * @param sizes			Length of each piece of data in bytes
+ * @param count			Number of pieces of data
+ * @param key_file		Name of file containing private key
+ * @param key_algorithm		Key algorithm
+ * @param external_signer	Path to external signer program
+ * @param sigs			Filled in with the signatures, which the
+ *				caller must free(); all NULL on error
+ *
+ * @return VB2_SUCCESS, or non-zero if error.
+ */
+vb2_error_t vb2_external_signatures(const uint8_t *const *data,
+				    const uint32_t *sizes, uint32_t count,
+				    const char *key_file,
+				    uint32_t key_algorithm,
+				    const char *external_signer,
+				    struct vb2_signature **sigs);
+
+/**
+ * Choose how external signers are run.
+ *
+ * By default, the signer is run once for each signature, with the data to
+ * sign on its stdin and the signature read from its stdout.  A persistent
+ * signer is instead started once, as "SIGNER --persistent KEY_FILE", and
+ * kept running until vb2_stop_external_signers().  Each request on its
+ * stdin and response on its stdout is a 4-byte big-endian length followed
+ * by that many bytes; an empty response means signing failed.  Responses
+ * must come in the order of the requests, as several may be outstanding.
+ *
+ * @param persistent	Whether to use persistent signers
+ */
+void vb2_set_external_signer_persistent(bool persistent);
+
+/**
+ * Stop any persistent external signers, waiting for them to exit.
+ */
+void vb2_stop_external_signers(void);
+
 /**
  * Create signature using the provided hash as its body. Created signature
  * contains vb2_hash trimmed to fit digest of its algorithm and nothing more.
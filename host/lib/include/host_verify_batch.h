@@ -0,0 +1,49 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Verifying many signatures at once on the host.
+ */
+
+#ifndef VBOOT_REFERENCE_HOST_VERIFY_BATCH_H_
+#define VBOOT_REFERENCE_HOST_VERIFY_BATCH_H_
+
+#include "2common.h"
+#include "2rsa.h"
+
+/* One signature check for vb2_verify_batch() */
+struct vb2_verify_job {
+	/*
+	 * Signed data, of which the first sig->data_size bytes are hashed
+	 * with the key's hash algorithm.  Ignored if |digest| is set.
+	 */
+	const uint8_t *data;
+	uint32_t size;		/* Size of |data| in bytes */
+	/* Precomputed digest of the data, or NULL to hash |data| */
+	const uint8_t *digest;
+	/* Signature to check; left untouched, unlike vb2_verify_digest() */
+	const struct vb2_signature *sig;
+	const struct vb2_public_key *key;	/* Key to check it against */
+	vb2_error_t result;	/* Filled with the result of this job */
+};
+
+/**
+ * Verify a batch of signatures across a pool of threads.
+ *
+ * Each job gets the same result as vb2_verify_data() (or vb2_verify_digest()
+ * when a digest is given) would have produced for it.  Jobs whose data is
+ * hashed in software are grouped by hash algorithm so that several buffers
+ * are hashed at once; see vb2_hash_calculate_many().  Keys which allow HW
+ * crypto are hashed and checked one at a time through the hwcrypto calls,
+ * which must then be safe to call from several threads.
+ *
+ * @param jobs		Jobs to run; each job's result is filled in
+ * @param count		Number of entries in |jobs|
+ * @param threads	Number of threads to use, or 0 for one per online CPU
+ * @return VB2_SUCCESS if every job verified, else the result of the first
+ *	   job that failed.
+ */
+vb2_error_t vb2_verify_batch(struct vb2_verify_job *jobs, uint32_t count,
+			     uint32_t threads);
+
+#endif  /* VBOOT_REFERENCE_HOST_VERIFY_BATCH_H_ */
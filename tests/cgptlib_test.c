@@ -1344,6 +1344,47 @@ static int GetNextTriesTest(void)
 	return TEST_OK;
 }
 
+static int GetNextUpdatedTest(void)
+{
+	GptData *gpt = GetEmptyGptData();
+	GptEntry *e1 = (GptEntry *)(gpt->primary_entries);
+	uint64_t start, size;
+
+	/* Priority 3, 3, 2, 3 - should boot order A, B, Y, X */
+	BuildTestGptData(gpt);
+	FillEntry(e1 + KERNEL_A, 1, 3, 1, 0);
+	FillEntry(e1 + KERNEL_B, 1, 3, 0, 1);
+	FillEntry(e1 + KERNEL_X, 1, 2, 1, 0);
+	FillEntry(e1 + KERNEL_Y, 1, 3, 1, 0);
+	RefreshCrc32(gpt);
+	GptInit(gpt);
+	EXPECT(4 == gpt->num_kernel_candidates);
+
+	EXPECT(GPT_SUCCESS == GptNextKernelEntry(gpt, &start, &size));
+	EXPECT(KERNEL_A == gpt->current_kernel);
+
+	/* Changes to entries we haven't reached yet are picked up */
+	EXPECT(GPT_SUCCESS ==
+	       GptUpdateKernelWithEntry(gpt, e1 + KERNEL_Y,
+					GPT_UPDATE_ENTRY_INVALID));
+	EXPECT(GPT_SUCCESS ==
+	       GptUpdateKernelWithEntry(gpt, e1 + KERNEL_X,
+					GPT_UPDATE_ENTRY_ACTIVE));
+	EXPECT(3 == gpt->num_kernel_candidates);
+
+	/* B uses up its last try; we still move on to X */
+	EXPECT(GPT_SUCCESS == GptNextKernelEntry(gpt, &start, &size));
+	EXPECT(KERNEL_B == gpt->current_kernel);
+	EXPECT(GPT_SUCCESS == GptUpdateKernelEntry(gpt, GPT_UPDATE_ENTRY_TRY));
+	EXPECT(0 == GetEntryPriority(e1 + KERNEL_B));
+	EXPECT(GPT_SUCCESS == GptNextKernelEntry(gpt, &start, &size));
+	EXPECT(KERNEL_X == gpt->current_kernel);
+	EXPECT(GPT_ERROR_NO_VALID_KERNEL ==
+	       GptNextKernelEntry(gpt, &start, &size));
+
+	return TEST_OK;
+}
+
 static int GptUpdateTest(void)
 {
 	GptData *gpt = GetEmptyGptData();
@@ -1638,10 +1679,14 @@ int main(int argc, char *argv[])
 		{ TEST_CASE(GetNextNormalTest), },
 		{ TEST_CASE(GetNextPrioTest), },
 		{ TEST_CASE(GetNextTriesTest), },
+		{ TEST_CASE(GetNextUpdatedTest), },
 		{ TEST_CASE(GptUpdateTest), },
 		{ TEST_CASE(UpdateInvalidKernelTypeTest), },
 		{ TEST_CASE(DuplicateUniqueGuidTest), },
 		{ TEST_CASE(TestCrc32TestVectors), },
+		{ TEST_CASE(TestCrc32Lengths), },
+		{ TEST_CASE(TestCrc32HwEngine), },
+		{ TEST_CASE(TestCrc32Patch), },
 		{ TEST_CASE(GetKernelGuidTest), },
 		{ TEST_CASE(ErrorTextTest), },
 		{ TEST_CASE(CheckHeaderOffDevice), },
@@ -0,0 +1,89 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "2sysincludes.h"
+#include "common/timer_utils.h"
+#include "crc32.h"
+
+/* One partition entry array (128 entries of 128 bytes) */
+#define ENTRIES_SIZE 16384
+#define TEST_BUFFER_SIZE 4000000
+#define ITERATIONS 100
+
+/* What Crc32() used to be, for comparison */
+static uint32_t Crc32Bytewise(const uint8_t *buffer, uint32_t len)
+{
+	static uint32_t table[256];
+	uint32_t value = ~0U;
+	uint32_t i;
+	int bit;
+
+	if (!table[1]) {
+		for (i = 0; i < 256; i++) {
+			value = i;
+			for (bit = 0; bit < 8; bit++)
+				value = (value >> 1) ^
+					(0xedb88320U & -(value & 1));
+			table[i] = value;
+		}
+		value = ~0U;
+	}
+
+	for (i = 0; i < len; i++)
+		value = table[(value ^ buffer[i]) & 0xff] ^ (value >> 8);
+	return value ^ ~0U;
+}
+
+static void report(const char *name, uint32_t size, uint64_t nsecs)
+{
+	double speed = nsecs ? ((double)size * ITERATIONS / 1e6) /
+			       (nsecs / 1e9) : 0.0;  /* Mbytes/sec */
+
+	fprintf(stderr, "# %s Time taken = %.3f ms, Speed = %f Mbytes/sec\n",
+		name, nsecs / 1e6, speed);
+	fprintf(stdout, "mbytes_per_sec_%s:%f\n", name, speed);
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t *buffer = malloc(TEST_BUFFER_SIZE);
+	uint32_t sink = 0;
+	ClockTimerState ct;
+	int i;
+
+	if (!buffer)
+		return 1;
+	for (i = 0; i < TEST_BUFFER_SIZE; i++)
+		buffer[i] = (uint8_t)(i * 131 + 7);
+
+	StartTimer(&ct);
+	for (i = 0; i < ITERATIONS; i++)
+		sink ^= Crc32Bytewise(buffer, TEST_BUFFER_SIZE);
+	StopTimer(&ct);
+	report("crc32_bytewise", TEST_BUFFER_SIZE, GetDurationNsecs(&ct));
+
+	StartTimer(&ct);
+	for (i = 0; i < ITERATIONS; i++)
+		sink ^= Crc32(buffer, TEST_BUFFER_SIZE);
+	StopTimer(&ct);
+	report("crc32", TEST_BUFFER_SIZE, GetDurationNsecs(&ct));
+
+	/* GPT-sized buffers, which is what cgpt and the firmware hash */
+	StartTimer(&ct);
+	for (i = 0; i < ITERATIONS * (TEST_BUFFER_SIZE / ENTRIES_SIZE); i++)
+		sink ^= Crc32(buffer + (i & 63), ENTRIES_SIZE);
+	StopTimer(&ct);
+	report("crc32_entries",
+	       ENTRIES_SIZE * (TEST_BUFFER_SIZE / ENTRIES_SIZE),
+	       GetDurationNsecs(&ct));
+
+	free(buffer);
+	/* Keep the compiler from dropping the loops */
+	return sink == 0x12345678 ? 2 : 0;
+}
@@ -45,3 +45,121 @@ int TestCrc32TestVectors(void) {
 	}
 	return TEST_OK;
 }
+
+/* Bit-at-a-time update of a raw CRC register */
+static uint32_t Crc32BitwiseUpdate(uint32_t value, const uint8_t *buffer,
+				   uint32_t len)
+{
+	int bit;
+
+	while (len--) {
+		value ^= *buffer++;
+		for (bit = 0; bit < 8; bit++)
+			value = (value >> 1) ^ (0xedb88320U & -(value & 1));
+	}
+	return value;
+}
+
+/* Bit-at-a-time CRC32, to check the faster implementations against */
+static uint32_t Crc32Bitwise(const uint8_t *buffer, uint32_t len)
+{
+	return Crc32BitwiseUpdate(~0U, buffer, len) ^ ~0U;
+}
+
+int TestCrc32Lengths(void) {
+	static uint8_t buffer[16384 + 64];
+	uint32_t seed = 1;
+	uint32_t len, offset;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(buffer); i++) {
+		seed = seed * 1103515245 + 12345;
+		buffer[i] = seed >> 16;
+	}
+
+	/* Every split between the fast paths and the byte-at-a-time tail */
+	for (offset = 0; offset < 16; offset++)
+		for (len = 0; len <= 1024; len++)
+			EXPECT(Crc32(buffer + offset, len) ==
+			       Crc32Bitwise(buffer + offset, len));
+
+	/* A full partition entry array, and then some */
+	for (len = 16384 - 1; len <= 16384 + 33; len++)
+		EXPECT(Crc32(buffer + 3, len) == Crc32Bitwise(buffer + 3, len));
+
+	return TEST_OK;
+}
+
+int TestCrc32HwEngine(void) {
+#if defined(X86_CRC32_EXT) || defined(ARMV8_CRC32_EXT)
+	static uint8_t buffer[4096 + 64];
+	uint32_t seed = 7;
+	uint32_t len, offset;
+	int engine_used = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(buffer); i++) {
+		seed = seed * 1103515245 + 12345;
+		buffer[i] = seed >> 16;
+	}
+
+	/*
+	 * Run the CPU engine on its own, so that Crc32()'s software tail
+	 * can't hide its mistakes, and start from a register other than ~0.
+	 */
+	for (offset = 0; offset < 16; offset++) {
+		for (len = 0; len <= 4096; len += (len < 300 ? 1 : 61)) {
+			uint32_t value = 0x12345678 ^ len;
+			uint32_t done = Crc32HwUpdate(&value, buffer + offset,
+						      len);
+
+			EXPECT(done <= len);
+			engine_used |= done > 0;
+			value = Crc32BitwiseUpdate(value, buffer + offset +
+						   done, len - done);
+			EXPECT(value == Crc32BitwiseUpdate(0x12345678 ^ len,
+							   buffer + offset,
+							   len));
+		}
+	}
+
+#ifdef X86_CRC32_EXT
+	/* The engine only steps aside if the CPU lacks PCLMULQDQ */
+	if (__builtin_cpu_supports("pclmul"))
+		EXPECT(engine_used);
+#else
+	EXPECT(engine_used);
+#endif
+#endif  /* X86_CRC32_EXT || ARMV8_CRC32_EXT */
+	return TEST_OK;
+}
+
+int TestCrc32Patch(void) {
+	static uint8_t buffer[16384];
+	uint8_t old[128];
+	uint32_t crc, offset;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(buffer); i++)
+		buffer[i] = i * 7;
+	crc = Crc32(buffer, sizeof(buffer));
+
+	/* Change one 128-byte entry at a time, first to last */
+	for (offset = 0; offset < sizeof(buffer); offset += 128 * 13) {
+		memcpy(old, buffer + offset, sizeof(old));
+		for (i = 0; i < 128; i += 5)
+			buffer[offset + i] ^= 0x5a + i;
+		crc = Crc32Patch(crc, old, buffer + offset, sizeof(old),
+				 sizeof(buffer) - offset - sizeof(old));
+		EXPECT(crc == Crc32(buffer, sizeof(buffer)));
+	}
+
+	/* The last byte, and a no-op change */
+	memcpy(old, buffer + sizeof(buffer) - 1, 1);
+	buffer[sizeof(buffer) - 1]++;
+	crc = Crc32Patch(crc, old, buffer + sizeof(buffer) - 1, 1, 0);
+	EXPECT(crc == Crc32(buffer, sizeof(buffer)));
+	EXPECT(crc == Crc32Patch(crc, buffer, buffer, 128, 100));
+
+	return TEST_OK;
+}
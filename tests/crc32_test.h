@@ -7,5 +7,8 @@
 #define VBOOT_REFERENCE_CRC32_TEST_H_
 
 int TestCrc32TestVectors(void);
+int TestCrc32Lengths(void);
+int TestCrc32HwEngine(void);
+int TestCrc32Patch(void);
 
 #endif  /* VBOOT_REFERENCE_CRC32_TEST_H_ */
@@ -0,0 +1,685 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Benchmarks for vboot's hashing, RSA and structure verification.
+ *
+ * Every case is run a few times to warm up, then timed for a number of
+ * samples.  Cases that take less than MIN_SAMPLE_NS are run in batches, so
+ * that each sample is long enough to time; a sample's time is divided by
+ * the batch size to give the time per operation.  Results go to stdout as
+ * CSV (the default) or JSON, one record per case.
+ *
+ * The "hwcrypto" variants go through the vb2ex_hwcrypto_*() callbacks,
+ * which on the host are the OpenSSL provider in host_hwcrypto.c.  The
+ * "*_engine" cases force each SHA transform this CPU has in turn, and name
+ * it in the variant column.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "2common.h"
+#include "2rsa.h"
+#include "2sha.h"
+#include "2sha_private.h"
+#include "2sysincludes.h"
+#include "common/timer_utils.h"
+#include "host_common.h"
+#include "host_hwcrypto.h"
+#include "host_key.h"
+#include "host_keyblock.h"
+#include "host_signature.h"
+
+#define MIN_SIZE 64
+#define DEFAULT_MAX_SIZE (64 * 1024 * 1024)
+#define CHUNK_SIZE 4096
+#define DEFAULT_REPS 20
+#define DEFAULT_WARMUP 3
+#define MIN_REPS 5
+/* Fewer samples of big hashes, so a full run stays under a minute */
+#define BYTE_BUDGET (256 * 1024 * 1024)
+#define MIN_SAMPLE_NS 20000
+
+enum output_format {
+	FORMAT_CSV,
+	FORMAT_JSON,
+};
+
+static struct {
+	uint32_t max_size;
+	int reps;
+	int warmup;
+	const char *filter;
+	enum output_format format;
+	int records;
+} opts = {
+	.max_size = DEFAULT_MAX_SIZE,
+	.reps = DEFAULT_REPS,
+	.warmup = DEFAULT_WARMUP,
+	.format = FORMAT_CSV,
+};
+
+/*
+ * One benchmark case.  run() is the timed operation.  If setup() is set, it
+ * runs untimed before each run(), and the case is never batched.
+ */
+struct bench {
+	const char *name;
+	const char *variant;
+	uint32_t size;		/* Bytes processed per operation, or 0 */
+	void (*setup)(void *arg);
+	vb2_error_t (*run)(void *arg);
+	void *arg;
+};
+
+struct result {
+	int reps;
+	int batch;
+	double mean_ns;
+	uint64_t min_ns;
+	uint64_t p50_ns;
+	uint64_t p90_ns;
+	uint64_t p99_ns;
+};
+
+static const char *const variant_names[] = {"sw", "hwcrypto"};
+
+/* Shared across cases, so that one setup works for both variants */
+static uint8_t workbuf[VB2_FIRMWARE_WORKBUF_RECOMMENDED_SIZE]
+	__attribute__((aligned(VB2_WORKBUF_ALIGN)));
+static struct vb2_workbuf wb;
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const uint64_t *sorted, int count, int pct)
+{
+	int i = (count * pct + 99) / 100 - 1;
+
+	return sorted[i < 0 ? 0 : i];
+}
+
+static void print_header(void)
+{
+	if (opts.format == FORMAT_CSV)
+		printf("benchmark,variant,size,reps,batch,mean_ns,min_ns,"
+		       "p50_ns,p90_ns,p99_ns,mbytes_per_sec\n");
+	else
+		printf("[\n");
+}
+
+static void print_footer(void)
+{
+	if (opts.format == FORMAT_JSON)
+		printf("\n]\n");
+}
+
+static void print_result(const struct bench *b, const struct result *r)
+{
+	/* Decimal megabytes per second, from the median */
+	double mbps = b->size && r->p50_ns ?
+		(double)b->size * 1e3 / r->p50_ns : 0.0;
+
+	if (opts.format == FORMAT_CSV) {
+		printf("%s,%s,%u,%d,%d,%.1f,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+		       ",%" PRIu64 ",%.2f\n",
+		       b->name, b->variant, b->size, r->reps, r->batch,
+		       r->mean_ns, r->min_ns, r->p50_ns, r->p90_ns, r->p99_ns,
+		       mbps);
+	} else {
+		printf("%s  {\"benchmark\": \"%s\", \"variant\": \"%s\", "
+		       "\"size\": %u, \"reps\": %d, \"batch\": %d, "
+		       "\"mean_ns\": %.1f, \"min_ns\": %" PRIu64 ", "
+		       "\"p50_ns\": %" PRIu64 ", \"p90_ns\": %" PRIu64 ", "
+		       "\"p99_ns\": %" PRIu64 ", \"mbytes_per_sec\": %.2f}",
+		       opts.records ? ",\n" : "",
+		       b->name, b->variant, b->size, r->reps, r->batch,
+		       r->mean_ns, r->min_ns, r->p50_ns, r->p90_ns, r->p99_ns,
+		       mbps);
+	}
+	opts.records++;
+	fflush(stdout);
+}
+
+/* Time one sample of 'batch' operations */
+static uint64_t time_sample(const struct bench *b, int batch,
+			    vb2_error_t *rv)
+{
+	ClockTimerState ct;
+	int i;
+
+	if (b->setup)
+		b->setup(b->arg);
+
+	StartTimer(&ct);
+	for (i = 0; i < batch; i++)
+		*rv |= b->run(b->arg);
+	StopTimer(&ct);
+
+	return GetDurationNsecs(&ct);
+}
+
+static int run_bench(const struct bench *b)
+{
+	struct result r = {0};
+	uint64_t *samples;
+	uint64_t ns = 0, total = 0;
+	vb2_error_t rv = VB2_SUCCESS;
+	int warmup, i;
+
+	if (opts.filter && !strstr(b->name, opts.filter))
+		return 0;
+
+	r.reps = opts.reps;
+	if (b->size && r.reps > BYTE_BUDGET / b->size) {
+		r.reps = BYTE_BUDGET / b->size;
+		if (r.reps < MIN_REPS)
+			r.reps = VB2_MIN(MIN_REPS, opts.reps);
+	}
+	warmup = VB2_MIN(opts.warmup, r.reps);
+
+	/* Always run at least once untimed, to size the batches */
+	for (i = 0; i < VB2_MAX(warmup, 1); i++)
+		ns = time_sample(b, 1, &rv);
+	if (rv) {
+		fprintf(stderr, "%s/%s failed: %#x\n", b->name, b->variant, rv);
+		return 1;
+	}
+
+	r.batch = 1;
+	if (!b->setup && ns < MIN_SAMPLE_NS)
+		r.batch = MIN_SAMPLE_NS / (ns ? ns : 1) + 1;
+
+	samples = malloc(r.reps * sizeof(*samples));
+	if (!samples)
+		return 1;
+	for (i = 0; i < r.reps; i++) {
+		samples[i] = time_sample(b, r.batch, &rv) / r.batch;
+		total += samples[i];
+	}
+
+	qsort(samples, r.reps, sizeof(*samples), cmp_u64);
+	r.mean_ns = (double)total / r.reps;
+	r.min_ns = samples[0];
+	r.p50_ns = percentile(samples, r.reps, 50);
+	r.p90_ns = percentile(samples, r.reps, 90);
+	r.p99_ns = percentile(samples, r.reps, 99);
+	free(samples);
+
+	print_result(b, &r);
+	return 0;
+}
+
+/* Hashing */
+
+struct hash_arg {
+	enum vb2_hash_algorithm alg;
+	bool hwcrypto;
+	bool chunked;
+	const uint8_t *buf;
+	uint32_t size;
+};
+
+static vb2_error_t run_hash(void *arg)
+{
+	struct hash_arg *h = arg;
+	struct vb2_digest_context dc;
+	uint8_t digest[VB2_MAX_DIGEST_SIZE];
+	struct vb2_hash hash;
+	uint32_t done, len;
+
+	if (!h->chunked)
+		return vb2_hash_calculate(h->hwcrypto, h->buf, h->size, h->alg,
+					  &hash);
+
+	VB2_TRY(vb2_digest_init(&dc, h->hwcrypto, h->alg, h->size));
+	for (done = 0; done < h->size; done += len) {
+		len = VB2_MIN(CHUNK_SIZE, h->size - done);
+		VB2_TRY(vb2_digest_extend(&dc, h->buf + done, len));
+	}
+	return vb2_digest_finalize(&dc, digest, sizeof(digest));
+}
+
+static int bench_hashes(void)
+{
+	static const enum vb2_hash_algorithm algs[] = {
+		VB2_HASH_SHA1, VB2_HASH_SHA256, VB2_HASH_SHA512,
+	};
+	static const char *const mode_names[] = {"oneshot", "chunked"};
+	struct hash_arg h;
+	struct bench b;
+	char name[64];
+	uint8_t *buf;
+	uint32_t size;
+	int a, mode, hw, i;
+	int errors = 0;
+
+	buf = malloc(opts.max_size);
+	if (!buf)
+		return 1;
+	for (i = 0; i < opts.max_size; i++)
+		buf[i] = (uint8_t)(i * 131 + 7);
+
+	for (a = 0; a < ARRAY_SIZE(algs); a++) {
+		for (mode = 0; mode < 2; mode++) {
+			snprintf(name, sizeof(name), "%s_%s",
+				 vb2_get_hash_algorithm_name(algs[a]),
+				 mode_names[mode]);
+			for (size = MIN_SIZE; size && size <= opts.max_size;
+			     size *= 4) {
+				for (hw = 0; hw < 2; hw++) {
+					h = (struct hash_arg){
+						.alg = algs[a],
+						.hwcrypto = hw,
+						.chunked = mode,
+						.buf = buf,
+						.size = size,
+					};
+					b = (struct bench){
+						.name = name,
+						.variant = variant_names[hw],
+						.size = size,
+						.run = run_hash,
+						.arg = &h,
+					};
+					errors += run_bench(&b);
+				}
+			}
+		}
+	}
+
+	free(buf);
+	return errors;
+}
+
+/* Each SHA transform the run-time dispatcher could pick, side by side */
+static int bench_hash_engines(void)
+{
+#ifdef SHA_RUNTIME_DISPATCH
+	static const enum vb2_hash_algorithm algs[] = {
+		VB2_HASH_SHA1, VB2_HASH_SHA256, VB2_HASH_SHA512,
+	};
+	static const struct {
+		enum vb2_sha_engine engine;
+		const char *name;
+	} engines[] = {
+		{ VB2_SHA_ENGINE_C, "c" },
+		{ VB2_SHA_ENGINE_X86_SHA, "x86_sha" },
+		{ VB2_SHA_ENGINE_X86_AVX2, "avx2" },
+		{ VB2_SHA_ENGINE_ARMV8_CE, "armv8_ce" },
+	};
+	static const uint32_t sizes[] = {4096, 1024 * 1024};
+	struct hash_arg h;
+	struct bench b;
+	char name[64];
+	uint8_t *buf;
+	uint32_t size;
+	int a, e, i;
+	int errors = 0;
+
+	buf = malloc(opts.max_size);
+	if (!buf)
+		return 1;
+	for (i = 0; i < opts.max_size; i++)
+		buf[i] = (uint8_t)(i * 131 + 7);
+
+	for (a = 0; a < ARRAY_SIZE(algs); a++) {
+		snprintf(name, sizeof(name), "%s_engine",
+			 vb2_get_hash_algorithm_name(algs[a]));
+		for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+			size = VB2_MIN(sizes[i], opts.max_size);
+			for (e = 0; e < ARRAY_SIZE(engines); e++) {
+				if (!vb2_sha_force_engine(algs[a],
+							  engines[e].engine))
+					continue;
+				h = (struct hash_arg){
+					.alg = algs[a],
+					.buf = buf,
+					.size = size,
+				};
+				b = (struct bench){
+					.name = name,
+					.variant = engines[e].name,
+					.size = size,
+					.run = run_hash,
+					.arg = &h,
+				};
+				errors += run_bench(&b);
+			}
+		}
+		vb2_sha_force_engine(algs[a], VB2_SHA_ENGINE_AUTO);
+	}
+
+	free(buf);
+	return errors;
+#else
+	return 0;
+#endif
+}
+
+/* RSA */
+
+struct verify_arg {
+	struct vb2_public_key key;
+	const uint8_t *pristine;	/* Signed data, left untouched */
+	uint8_t *work;			/* Copy that verifying destroys */
+	uint32_t size;
+	uint8_t digest[VB2_MAX_DIGEST_SIZE];
+	vb2_error_t (*verify)(struct verify_arg *v);
+};
+
+static void setup_verify(void *arg)
+{
+	struct verify_arg *v = arg;
+
+	memcpy(v->work, v->pristine, v->size);
+	vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
+}
+
+static vb2_error_t run_verify(void *arg)
+{
+	struct verify_arg *v = arg;
+
+	return v->verify(v);
+}
+
+static vb2_error_t verify_rsa_digest(struct verify_arg *v)
+{
+	return vb2_rsa_verify_digest(&v->key, v->work, v->digest, &wb);
+}
+
+static int bench_verify(const char *name, struct verify_arg *v)
+{
+	struct bench b = {
+		.name = name,
+		.setup = setup_verify,
+		.run = run_verify,
+		.arg = v,
+	};
+	int errors = 0;
+	int hw;
+
+	for (hw = 0; hw < 2; hw++) {
+		v->key.allow_hwcrypto = hw;
+		b.variant = variant_names[hw];
+		errors += run_bench(&b);
+	}
+	return errors;
+}
+
+static int bench_rsa_alg(enum vb2_crypto_algorithm alg, const char *keys_dir)
+{
+	static const uint8_t data[] = "Benchmark data";
+	struct vb2_private_key *private_key = NULL;
+	struct vb2_packed_key *packed = NULL;
+	struct vb2_signature *sig = NULL;
+	struct vb2_hash hash;
+	struct verify_arg v = {0};
+	char filename[1024];
+	char name[64];
+	int errors = 1;
+
+	snprintf(filename, sizeof(filename), "%s/key_%s.pem", keys_dir,
+		 vb2_get_crypto_algorithm_file(alg));
+	private_key = vb2_read_private_key_pem(filename, alg);
+	snprintf(filename, sizeof(filename), "%s/key_%s.keyb", keys_dir,
+		 vb2_get_crypto_algorithm_file(alg));
+	packed = vb2_read_packed_keyb(filename, alg, 1);
+	if (!private_key || !packed) {
+		fprintf(stderr, "Error reading keys for %s from %s\n",
+			vb2_get_crypto_algorithm_name(alg), keys_dir);
+		goto done;
+	}
+
+	sig = vb2_calculate_signature(data, sizeof(data), private_key);
+	if (!sig || vb2_unpack_key(&v.key, packed) ||
+	    vb2_hash_calculate(false, data, sizeof(data), v.key.hash_alg,
+			       &hash))
+		goto done;
+
+	memcpy(v.digest, hash.raw, sizeof(v.digest));
+	v.pristine = vb2_signature_data(sig);
+	v.size = sig->sig_size;
+	v.work = malloc(v.size);
+	v.verify = verify_rsa_digest;
+	if (!v.work)
+		goto done;
+
+	snprintf(name, sizeof(name), "rsa_verify_digest_%s",
+		 vb2_get_sig_algorithm_name(v.key.sig_alg));
+	errors = bench_verify(name, &v);
+
+done:
+	free(v.work);
+	free(sig);
+	free(packed);
+	free(private_key);
+	return errors;
+}
+
+static int bench_rsa(const char *keys_dir)
+{
+	/* One key of each signature algorithm; the hash doesn't matter */
+	static const enum vb2_crypto_algorithm algs[] = {
+		VB2_ALG_RSA1024_SHA256,
+		VB2_ALG_RSA2048_SHA256,
+		VB2_ALG_RSA2048_EXP3_SHA256,
+		VB2_ALG_RSA3072_EXP3_SHA256,
+		VB2_ALG_RSA4096_SHA256,
+		VB2_ALG_RSA8192_SHA256,
+	};
+	int errors = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(algs); i++)
+		errors += bench_rsa_alg(algs[i], keys_dir);
+	return errors;
+}
+
+/* Verified boot structures, signed with the dev keys */
+
+static vb2_error_t verify_keyblock(struct verify_arg *v)
+{
+	return vb2_verify_keyblock((struct vb2_keyblock *)v->work, v->size,
+				   &v->key, &wb);
+}
+
+static vb2_error_t verify_fw_preamble(struct verify_arg *v)
+{
+	return vb2_verify_fw_preamble((struct vb2_fw_preamble *)v->work,
+				      v->size, &v->key, &wb);
+}
+
+static vb2_error_t verify_kernel_preamble(struct verify_arg *v)
+{
+	return vb2_verify_kernel_preamble(
+		(struct vb2_kernel_preamble *)v->work, v->size, &v->key, &wb);
+}
+
+static int bench_struct(const char *name, const char *devkeys_dir,
+			const char *pubkey, const void *data, uint32_t size,
+			vb2_error_t (*verify)(struct verify_arg *v))
+{
+	struct vb2_packed_key *packed;
+	struct verify_arg v = {0};
+	char filename[1024];
+	int errors = 1;
+
+	snprintf(filename, sizeof(filename), "%s/%s", devkeys_dir, pubkey);
+	packed = vb2_read_packed_key(filename);
+	v.work = malloc(size);
+	if (!packed || !data || !v.work || vb2_unpack_key(&v.key, packed)) {
+		fprintf(stderr, "Error setting up %s\n", name);
+		goto done;
+	}
+
+	v.pristine = data;
+	v.size = size;
+	v.verify = verify;
+	errors = bench_verify(name, &v);
+
+done:
+	free(v.work);
+	free(packed);
+	return errors;
+}
+
+static int bench_structs(const char *devkeys_dir)
+{
+	static const uint8_t body[4096];
+	struct vb2_private_key *fw_key, *kernel_key;
+	struct vb2_packed_key *subkey;
+	struct vb2_keyblock *fw_keyblock, *kernel_keyblock;
+	struct vb2_signature *body_sig = NULL;
+	struct vb2_fw_preamble *fw_pre = NULL;
+	struct vb2_kernel_preamble *kernel_pre = NULL;
+	char filename[1024];
+	int errors = 0;
+
+	snprintf(filename, sizeof(filename), "%s/firmware.keyblock",
+		 devkeys_dir);
+	fw_keyblock = vb2_read_keyblock(filename);
+	snprintf(filename, sizeof(filename), "%s/kernel.keyblock",
+		 devkeys_dir);
+	kernel_keyblock = vb2_read_keyblock(filename);
+	snprintf(filename, sizeof(filename), "%s/firmware_data_key.vbprivk",
+		 devkeys_dir);
+	fw_key = vb2_read_private_key(filename);
+	snprintf(filename, sizeof(filename), "%s/kernel_data_key.vbprivk",
+		 devkeys_dir);
+	kernel_key = vb2_read_private_key(filename);
+	snprintf(filename, sizeof(filename), "%s/kernel_subkey.vbpubk",
+		 devkeys_dir);
+	subkey = vb2_read_packed_key(filename);
+
+	if (fw_key && subkey) {
+		body_sig = vb2_calculate_signature(body, sizeof(body), fw_key);
+		if (body_sig)
+			fw_pre = vb2_create_fw_preamble(1, subkey, body_sig,
+							fw_key, 0);
+		free(body_sig);
+	}
+	if (kernel_key) {
+		body_sig = vb2_calculate_signature(body, sizeof(body),
+						   kernel_key);
+		if (body_sig)
+			kernel_pre = vb2_create_kernel_preamble(
+				1, 0x100000, 0x100800, 0x400, body_sig, 0, 0,
+				0, 0, kernel_key);
+		free(body_sig);
+	}
+
+	errors += bench_struct("verify_keyblock_firmware", devkeys_dir,
+			       "root_key.vbpubk", fw_keyblock,
+			       fw_keyblock ? fw_keyblock->keyblock_size : 0,
+			       verify_keyblock);
+	errors += bench_struct("verify_keyblock_kernel", devkeys_dir,
+			       "kernel_subkey.vbpubk", kernel_keyblock,
+			       kernel_keyblock ?
+			       kernel_keyblock->keyblock_size : 0,
+			       verify_keyblock);
+	errors += bench_struct("verify_fw_preamble", devkeys_dir,
+			       "firmware_data_key.vbpubk", fw_pre,
+			       fw_pre ? fw_pre->preamble_size : 0,
+			       verify_fw_preamble);
+	errors += bench_struct("verify_kernel_preamble", devkeys_dir,
+			       "kernel_data_key.vbpubk", kernel_pre,
+			       kernel_pre ? kernel_pre->preamble_size : 0,
+			       verify_kernel_preamble);
+
+	free(fw_keyblock);
+	free(kernel_keyblock);
+	free(fw_key);
+	free(kernel_key);
+	free(subkey);
+	free(fw_pre);
+	free(kernel_pre);
+	return errors;
+}
+
+static void print_usage(const char *progname)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <testkeys_dir> <devkeys_dir>\n"
+		"\n"
+		"Options:\n"
+		"  --format=csv|json    Output format (default csv)\n"
+		"  --reps=N             Timed samples per case (default %d)\n"
+		"  --warmup=N           Untimed runs per case (default %d)\n"
+		"  --max-size=BYTES     Largest buffer to hash (default %d)\n"
+		"  --filter=STRING      Only run cases whose name contains "
+		"STRING\n",
+		progname, DEFAULT_REPS, DEFAULT_WARMUP, DEFAULT_MAX_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option long_opts[] = {
+		{"format", 1, NULL, 'f'},
+		{"reps", 1, NULL, 'r'},
+		{"warmup", 1, NULL, 'w'},
+		{"max-size", 1, NULL, 's'},
+		{"filter", 1, NULL, 'F'},
+		{"help", 0, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+	int errors = 0;
+	int i;
+
+	while ((i = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+		switch (i) {
+		case 'f':
+			if (!strcmp(optarg, "csv")) {
+				opts.format = FORMAT_CSV;
+			} else if (!strcmp(optarg, "json")) {
+				opts.format = FORMAT_JSON;
+			} else {
+				fprintf(stderr, "Unknown format: %s\n", optarg);
+				errors++;
+			}
+			break;
+		case 'r':
+			opts.reps = strtol(optarg, NULL, 0);
+			if (opts.reps < 1)
+				errors++;
+			break;
+		case 'w':
+			opts.warmup = strtol(optarg, NULL, 0);
+			break;
+		case 's':
+			opts.max_size = strtoul(optarg, NULL, 0);
+			if (opts.max_size < MIN_SIZE)
+				errors++;
+			break;
+		case 'F':
+			opts.filter = optarg;
+			break;
+		default:
+			errors++;
+			break;
+		}
+	}
+
+	if (errors || argc - optind != 2) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	/* The hwcrypto variants use the OpenSSL provider */
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_OPENSSL);
+
+	print_header();
+	errors += bench_hashes();
+	errors += bench_hash_engines();
+	errors += bench_rsa(argv[optind]);
+	errors += bench_structs(argv[optind + 1]);
+	print_footer();
+
+	return !!errors;
+}
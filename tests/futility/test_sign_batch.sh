@@ -0,0 +1,148 @@
+#!/bin/bash -eux
+# Copyright 2026 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+me=${0##*/}
+TMP="$me.tmp"
+
+# Work in scratch directory
+cd "$OUTDIR"
+
+DEVKEYS="${SRCDIR}/tests/devkeys"
+TESTKEYS="${SRCDIR}/tests/testkeys"
+VMLINUZ="${SCRIPT_DIR}/futility/data/vmlinuz-amd64.bin"
+
+echo "hi there" > "${TMP}.config.txt"
+for i in 1 2 3 4 5 6; do
+  dd bs=1024 count=16 if=/dev/urandom of="${TMP}.fw_main.${i}"
+done
+
+# Sign everything one at a time
+for i in 1 2 3 4 5 6; do
+  "${FUTILITY}" sign \
+    --keyset "${DEVKEYS}" \
+    --version "${i}" \
+    --fv "${TMP}.fw_main.${i}" \
+    --flags 42 \
+    "${TMP}.vblock.single.${i}"
+done
+"${FUTILITY}" sign \
+  --keyset "${DEVKEYS}/recovery_" \
+  --version 1 \
+  --config "${TMP}.config.txt" \
+  --vmlinuz "${VMLINUZ}" \
+  --arch x86 \
+  --outfile "${TMP}.kern.single"
+"${FUTILITY}" sign \
+  --pem_signpriv "${TESTKEYS}/key_rsa4096.pem" \
+  --pem_algo 8 \
+  --flags 7 \
+  "${DEVKEYS}/kernel_subkey.vbpubk" \
+  "${TMP}.keyblock.single"
+
+# And again as a batch, with some options on the command line
+cat > "${TMP}.manifest" <<EOF
+# Firmware bodies
+--version 1 --fv ${TMP}.fw_main.1 ${TMP}.vblock.batch.1
+--version 2 --fv ${TMP}.fw_main.2 ${TMP}.vblock.batch.2
+
+   --version 3 --fv ${TMP}.fw_main.3	${TMP}.vblock.batch.3
+--version 4 --fv ${TMP}.fw_main.4 --outfile ${TMP}.vblock.batch.4
+--version 5 --fv ${TMP}.fw_main.5 ${TMP}.vblock.batch.5
+--version 6 --fv ${TMP}.fw_main.6 ${TMP}.vblock.batch.6
+# Overriding the keyset
+--keyset ${DEVKEYS}/recovery_ --version 1 --config ${TMP}.config.txt --vmlinuz ${VMLINUZ} --arch x86 --flags 0 --outfile ${TMP}.kern.batch
+--pem_signpriv ${TESTKEYS}/key_rsa4096.pem --pem_algo 8 --flags 7 ${DEVKEYS}/kernel_subkey.vbpubk ${TMP}.keyblock.batch
+EOF
+
+for jobs in 1 3; do
+  rm -f "${TMP}."*.batch*
+  "${FUTILITY}" sign --keyset "${DEVKEYS}" --flags 42 \
+    --batch "${TMP}.manifest" --jobs "${jobs}" > "${TMP}.report"
+
+  # The output must be the same as signing one at a time
+  for i in 1 2 3 4 5 6; do
+    cmp "${TMP}.vblock.single.${i}" "${TMP}.vblock.batch.${i}"
+  done
+  cmp "${TMP}.kern.single" "${TMP}.kern.batch"
+  cmp "${TMP}.keyblock.single" "${TMP}.keyblock.batch"
+
+  [ "$(grep -c '^OK ' "${TMP}.report")" = 8 ]
+  grep -q "^OK .*manifest:5: ${TMP}.fw_main.3 -> ${TMP}.vblock.batch.3" \
+    "${TMP}.report"
+  grep -q "^Signed 8 of 8 items" "${TMP}.report"
+done
+
+# Keyblocks for a persistent signer are sent to one signer together
+SIGNER="${BUILD_RUN}/tests/vb2_host_external_signer_tests"
+export SIGNER_TEST_LOG="${OUTDIR}/${TMP}.signer.log"
+: > "${SIGNER_TEST_LOG}"
+rm -f "${TMP}.keyblock.ext."*
+for i in 1 2 3 4; do
+  echo "--flags ${i} ${DEVKEYS}/kernel_subkey.vbpubk ${TMP}.keyblock.ext.${i}"
+done > "${TMP}.ext.manifest"
+"${FUTILITY}" sign --pem_signpriv "${TESTKEYS}/key_rsa4096.pem" \
+  --pem_algo 8 --pem_external "${SIGNER}" --pem_external_persistent \
+  --batch "${TMP}.ext.manifest" --jobs 3 > "${TMP}.report"
+grep -q "^Signed 4 of 4 items" "${TMP}.report"
+[ "$(cat "${SIGNER_TEST_LOG}")" = "persistent" ]
+for i in 1 2 3 4; do
+  "${FUTILITY}" sign \
+    --pem_signpriv "${TESTKEYS}/key_rsa4096.pem" \
+    --pem_algo 8 \
+    --flags "${i}" \
+    "${DEVKEYS}/kernel_subkey.vbpubk" \
+    "${TMP}.keyblock.want.${i}"
+  cmp "${TMP}.keyblock.want.${i}" "${TMP}.keyblock.ext.${i}"
+done
+unset SIGNER_TEST_LOG
+
+# A bad item means nothing gets signed
+rm -f "${TMP}."*.batch*
+echo "--version 7 --fv ${TMP}.nope ${TMP}.vblock.batch.7" >> "${TMP}.manifest"
+if "${FUTILITY}" sign --keyset "${DEVKEYS}" --batch "${TMP}.manifest" \
+    > "${TMP}.report"; then false; fi
+[ ! -e "${TMP}.vblock.batch.1" ]
+
+# So does writing the same file twice
+sed -i '$d' "${TMP}.manifest"
+echo "--version 7 --fv ${TMP}.fw_main.1 ${TMP}.vblock.batch.1" \
+  >> "${TMP}.manifest"
+if "${FUTILITY}" sign --keyset "${DEVKEYS}" --batch "${TMP}.manifest" \
+    2> "${TMP}.err"; then false; fi
+grep -q "also written by line 2" "${TMP}.err"
+sed -i '$d' "${TMP}.manifest"
+echo "--version 7 --fv ${TMP}.fw_main.1 ./${TMP}.vblock.batch.1" \
+  >> "${TMP}.manifest"
+if "${FUTILITY}" sign --keyset "${DEVKEYS}" --batch "${TMP}.manifest" \
+    2> "${TMP}.err"; then false; fi
+grep -q "also written by line 2" "${TMP}.err"
+
+# Or writing a file another item reads
+sed -i '$d' "${TMP}.manifest"
+echo "--version 7 --fv ${TMP}.fw_main.2 ./${TMP}.fw_main.1" \
+  >> "${TMP}.manifest"
+if "${FUTILITY}" sign --keyset "${DEVKEYS}" --batch "${TMP}.manifest" \
+    2> "${TMP}.err"; then false; fi
+grep -q "fw_main.1 is read by line 2" "${TMP}.err"
+
+# A failure signing one item doesn't stop the others
+sed -i '$d' "${TMP}.manifest"
+cp "${TMP}.fw_main.1" "${TMP}.fw_main.7"
+echo "--version 7 --fv ${TMP}.fw_main.7 ${OUTDIR}/nonexistent/vblock" \
+  >> "${TMP}.manifest"
+if "${FUTILITY}" sign --keyset "${DEVKEYS}" --flags 42 --jobs 2 \
+    --batch "${TMP}.manifest" > "${TMP}.report"; then false; fi
+grep -q "^FAILED .*manifest:12: " "${TMP}.report"
+grep -q "^Signed 8 of 9 items" "${TMP}.report"
+cmp "${TMP}.vblock.single.6" "${TMP}.vblock.batch.6"
+
+# Input files don't go on the command line
+if "${FUTILITY}" sign --batch "${TMP}.manifest" "${TMP}.fw_main.1"; then
+  false
+fi
+
+# cleanup
+rm -rf "${TMP}"*
+exit 0
@@ -330,6 +330,50 @@ try_arch () {
 try_arch amd64
 try_arch arm
 
+# The kernel is read as the output is written, so they can't be the same file
+cp "${SCRIPT_DIR}/futility/data/vmlinuz-amd64.bin" "${TMP}.vmlinuz"
+if "${FUTILITY}" sign \
+    --keyset "${DEVKEYS}/recovery_" \
+    --config "${TMP}.config.txt" \
+    --vmlinuz "${TMP}.vmlinuz" \
+    --arch amd64 \
+    --outfile "${TMP}.vmlinuz"; then false; fi
+if "${FUTILITY}" vbutil_kernel \
+    --pack "${TMP}.vmlinuz" \
+    --keyblock "${DEVKEYS}/recovery_kernel.keyblock" \
+    --signprivate "${DEVKEYS}/recovery_kernel_data_key.vbprivk" \
+    --version 1 \
+    --config "${TMP}.config.txt" \
+    --vmlinuz "${TMP}.vmlinuz" \
+    --arch amd64; then false; fi
+cmp "${SCRIPT_DIR}/futility/data/vmlinuz-amd64.bin" "${TMP}.vmlinuz"
+
+# A vblock can be written to a pipe, but a whole partition needs to seek
+"${FUTILITY}" sign \
+  --keyset "${DEVKEYS}/recovery_" \
+  --config "${TMP}.config.txt" \
+  --vmlinuz "${TMP}.vmlinuz" \
+  --arch amd64 \
+  --vblockonly \
+  --outfile "${TMP}.vblock.file"
+"${FUTILITY}" sign \
+  --keyset "${DEVKEYS}/recovery_" \
+  --config "${TMP}.config.txt" \
+  --vmlinuz "${TMP}.vmlinuz" \
+  --arch amd64 \
+  --vblockonly \
+  --outfile /dev/stdout | cat > "${TMP}.vblock.pipe"
+[ "${PIPESTATUS[0]}" = 0 ]
+cmp "${TMP}.vblock.file" "${TMP}.vblock.pipe"
+"${FUTILITY}" sign \
+  --keyset "${DEVKEYS}/recovery_" \
+  --config "${TMP}.config.txt" \
+  --vmlinuz "${TMP}.vmlinuz" \
+  --arch amd64 \
+  --outfile /dev/stdout 2> "${TMP}.pipe.err" | cat > /dev/null
+[ "${PIPESTATUS[0]}" != 0 ]
+grep -q "can't seek" "${TMP}.pipe.err"
+
 # cleanup
 rm -rf "${TMP}"*
 exit 0
@@ -181,6 +181,35 @@ X=$("${CGPT}" boot "${MTD[@]}" ${DEV})
 Y=$("${CGPT}" show "${MTD[@]}" -u -i $KERN_NUM $DEV)
 [ "$X" = "$Y" ] || error
 
+echo "Stop cgpt find at the first match..."
+X=$("${CGPT}" find "${MTD[@]}" -n -t kernel ${DEV} ${DEV} | wc -l)
+[ "$X" = "2" ] || error
+X=$("${CGPT}" find "${MTD[@]}" -F -n -t kernel ${DEV} ${DEV})
+[ "$X" = "$KERN_NUM" ] || error
+assert_fail "${CGPT}" find "${MTD[@]}" -F -1 -t kernel ${DEV}
+
+echo "Search several drives in parallel..."
+FIND_DEVS=()
+for i in 1 2 3 4 5 6; do
+  cp ${DEV} find_$i.bin
+  FIND_DEVS+=(find_$i.bin)
+done
+# Leave the first kernel match until the third drive
+for i in 1 2 5; do
+  "${CGPT}" add "${MTD[@]}" -i ${KERN_NUM} -t data find_$i.bin
+done
+for args in "-t kernel" "-n -t kernel" "-F -t kernel" "-v -t rootfs"; do
+  X=$("${CGPT}" find "${MTD[@]}" ${args} "${FIND_DEVS[@]}")
+  for jobs in 2 4 8; do
+    Y=$("${CGPT}" find "${MTD[@]}" -j ${jobs} ${args} "${FIND_DEVS[@]}")
+    [ -n "$X" ] && [ "$X" = "$Y" ] || error
+  done
+done
+X=$("${CGPT}" find "${MTD[@]}" -j 4 -F -t kernel "${FIND_DEVS[@]}")
+[ "$X" = "find_3.bin${KERN_NUM}" ] || error
+assert_fail "${CGPT}" find "${MTD[@]}" -j 4 -t kernel find_1.bin find_2.bin
+rm -f "${FIND_DEVS[@]}"
+
 # Input: sequence of priorities
 # Output: ${DEV} has kernel partitions with the given priorities
 make_pri() {
@@ -303,6 +332,47 @@ run_prioritize_tests() {
 }
 run_prioritize_tests
 
+run_batch_tests() {
+  echo "Test the cgpt batch command..."
+  "${CGPT}" create "${MTD[@]}" ${DEV}
+  "${CGPT}" batch "${MTD[@]}" ${DEV} <<EOF
+# install, then make the second kernel the one to boot
+add -t kernel -l "kern 1" -b 102 -s 1 -P 2
+add -t kernel -l 'kern 2' -b 104 -s 1 -P 0
+
+add -t kernel -l kern3 -b 106 -s 1 -P 1
+prioritize -i 2
+boot -i 2
+EOF
+  assert_pri 2 3 1
+  [ "$("${CGPT}" show "${MTD[@]}" -l -i 2 ${DEV})" = "kern 2" ] || error
+  X=$("${CGPT}" boot "${MTD[@]}" ${DEV})
+  Y=$("${CGPT}" show "${MTD[@]}" -u -i 2 ${DEV})
+  [ "$X" = "$Y" ] || error
+
+  # A failing line leaves the drive untouched, even after earlier lines.
+  cp ${DEV} batch_before.bin
+  printf 'add -i 1 -P 9\nadd -i 2 -b 104 -s 1000000\n' > batch_bad.txt
+  assert_fail "${CGPT}" batch "${MTD[@]}" -f batch_bad.txt ${DEV}
+  cmp -s ${DEV} batch_before.bin || error
+  printf 'add -i 1 -P 9 %s\n' ${DEV} > batch_bad.txt
+  assert_fail "${CGPT}" batch "${MTD[@]}" -f batch_bad.txt ${DEV}
+  printf 'show\n' > batch_bad.txt
+  assert_fail "${CGPT}" batch "${MTD[@]}" -f batch_bad.txt ${DEV}
+  cmp -s ${DEV} batch_before.bin || error
+
+  # Prioritizing with one GPT copy invalid fails in a batch, but not alone.
+  dd if=/dev/zero of=${DEV} conv=notrunc bs=512 seek=1 count=1 2>/dev/null
+  cp ${DEV} batch_before.bin
+  printf 'prioritize -i 2\n' > batch_bad.txt
+  assert_fail "${CGPT}" batch "${MTD[@]}" -f batch_bad.txt ${DEV}
+  cmp -s ${DEV} batch_before.bin || error
+  "${CGPT}" prioritize "${MTD[@]}" -i 2 ${DEV} 2>/dev/null || error
+  cmp -s ${DEV} batch_before.bin || error
+  "${CGPT}" repair "${MTD[@]}" ${DEV}
+}
+run_batch_tests
+
 echo "Test cgpt repair command"
 "${CGPT}" repair "${MTD[@]}" ${DEV}
 ("${CGPT}" show "${MTD[@]}" ${DEV} | grep -q INVALID) && error
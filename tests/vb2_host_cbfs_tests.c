@@ -0,0 +1,360 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the in-process CBFS reader
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "2common.h"
+#include "2sha.h"
+#include "2sysincludes.h"
+#include "cbfs.h"
+#include "cbfstool.h"
+#include "common/tests.h"
+#include "fmap.h"
+#include "host_misc.h"
+
+#define IMAGE_SIZE 0x8000
+#define REGION_SIZE 0x1000
+#define ALIGN64(x) (((x) + 63) & ~63)
+
+#define TYPE_BOOTBLOCK 0x01
+#define TYPE_RAW 0x50
+#define TYPE_NULL 0xffffffff
+#define TYPE_DELETED 0
+
+#define ATTR_COMPRESSION 0x42435a4c
+#define ATTR_HASH 0x68736148
+
+enum {
+	REGION_BOOTBLOCK,
+	REGION_COREBOOT,
+	REGION_FW_MAIN_A,
+	REGION_FW_MAIN_B,
+	REGION_COUNT,
+};
+
+static const char *const region_names[REGION_COUNT] = {
+	"BOOTBLOCK", "COREBOOT", "FW_MAIN_A", "FW_MAIN_B",
+};
+
+static uint8_t image[IMAGE_SIZE];
+static const char config[] =
+	"CONFIG_FIRST=1\n"
+	"CONFIG_VBOOT_CBFS_INTEGRATION=y\n"
+	"CONFIG_EMPTY=\n"
+	"CONFIG_LAST=\"no newline\"";
+
+/* Where the next file in each region goes */
+static uint32_t next_offset[REGION_COUNT];
+/* Expected metadata hash of FW_MAIN_A */
+static struct vb2_digest_context metadata_dc;
+
+static uint8_t *region_buf(int r)
+{
+	return image + REGION_SIZE * (r + 1);
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+/* Append a file to a region the way cbfstool lays files out */
+static uint8_t *add_file(int r, const char *name, uint32_t type,
+			 const void *data, uint32_t len, bool with_hash,
+			 uint32_t compression)
+{
+	uint32_t offset = next_offset[r];
+	uint8_t *f = region_buf(r) + offset;
+	uint32_t name_size = (strlen(name) + 16) & ~15;
+	uint32_t attr = 24 + name_size, data_offset = attr;
+	struct vb2_hash hash;
+
+	memset(f, 0, 24 + name_size);
+	memcpy(f, "LARCHIVE", 8);
+	put_be32(f + 12, type);
+	strcpy((char *)f + 24, name);
+
+	if (compression) {
+		put_be32(f + data_offset, ATTR_COMPRESSION);
+		put_be32(f + data_offset + 4, 16);
+		put_be32(f + data_offset + 8, compression);
+		put_be32(f + data_offset + 12, len * 2);
+		data_offset += 16;
+	}
+	if (with_hash) {
+		uint32_t attr_len = 8 + offsetof(struct vb2_hash, raw) +
+				    VB2_SHA256_DIGEST_SIZE;
+
+		vb2_hash_calculate(false, data, len, VB2_HASH_SHA256, &hash);
+		put_be32(f + data_offset, ATTR_HASH);
+		put_be32(f + data_offset + 4, attr_len);
+		memcpy(f + data_offset + 8, &hash, attr_len - 8);
+		data_offset += attr_len;
+	}
+
+	put_be32(f + 8, len);
+	put_be32(f + 16, data_offset > attr ? attr : 0);
+	put_be32(f + 20, data_offset);
+	if (data)
+		memcpy(f + data_offset, data, len);
+
+	if (r == REGION_FW_MAIN_A && type != TYPE_NULL && type != TYPE_DELETED)
+		vb2_digest_extend(&metadata_dc, f, data_offset);
+
+	next_offset[r] = ALIGN64(offset + data_offset + len);
+	return f + data_offset;
+}
+
+/* Fill the rest of a region with an empty file */
+static void add_trailer(int r)
+{
+	uint32_t len = REGION_SIZE - next_offset[r] - 40;
+
+	add_file(r, "", TYPE_NULL, NULL, len, false, 0);
+	memset(region_buf(r) + REGION_SIZE - len, 0xff, len);
+}
+
+static void build_image(void)
+{
+	FmapHeader *fmap = (FmapHeader *)image;
+	FmapAreaHeader *ah = (FmapAreaHeader *)(fmap + 1);
+	uint8_t bootblock[200];
+	struct vb2_hash anchor_hash = { .algo = VB2_HASH_SHA256 };
+	static const uint8_t data1[100] = {1, 2, 3};
+	static const uint8_t data2[300] = {4, 5, 6};
+	int r;
+
+	memset(image, 0xff, sizeof(image));
+	memset(next_offset, 0, sizeof(next_offset));
+
+	memset(fmap, 0, sizeof(*fmap));
+	memcpy(fmap->fmap_signature, FMAP_SIGNATURE, FMAP_SIGNATURE_SIZE);
+	fmap->fmap_ver_major = FMAP_VER_MAJOR;
+	fmap->fmap_size = IMAGE_SIZE;
+	fmap->fmap_nareas = REGION_COUNT;
+	for (r = 0; r < REGION_COUNT; r++) {
+		memset(&ah[r], 0, sizeof(ah[r]));
+		ah[r].area_offset = REGION_SIZE * (r + 1);
+		ah[r].area_size = REGION_SIZE;
+		strcpy(ah[r].area_name, region_names[r]);
+	}
+
+	/* Metadata hash anchor somewhere in the bootblock */
+	memset(bootblock, 0, sizeof(bootblock));
+	memcpy(bootblock + 40, "\xadMdtHsh\x15", 8);
+	memcpy(bootblock + 48, &anchor_hash, sizeof(anchor_hash));
+	memcpy(region_buf(REGION_BOOTBLOCK), bootblock, sizeof(bootblock));
+
+	add_file(REGION_COREBOOT, "bootblock", TYPE_BOOTBLOCK, bootblock,
+		 sizeof(bootblock), false, 0);
+	add_file(REGION_COREBOOT, "config", TYPE_RAW, config, strlen(config),
+		 true, 0);
+	add_trailer(REGION_COREBOOT);
+
+	vb2_digest_init(&metadata_dc, false, VB2_HASH_SHA256, 0);
+	add_file(REGION_FW_MAIN_A, "fallback/payload", TYPE_RAW, data1,
+		 sizeof(data1), true, 0);
+	add_file(REGION_FW_MAIN_A, "old", TYPE_DELETED, data1, sizeof(data1),
+		 false, 0);
+	add_file(REGION_FW_MAIN_A, "ecrw", TYPE_RAW, data2, sizeof(data2),
+		 true, 1);
+	add_trailer(REGION_FW_MAIN_A);
+}
+
+static void find_file_tests(void)
+{
+	struct cbfs_file_info file;
+
+	build_image();
+
+	TEST_SUCC(cbfs_find_file(image, sizeof(image), "FW_MAIN_A",
+				 "fallback/payload", &file), "find file");
+	TEST_PTR_EQ(file.data, region_buf(REGION_FW_MAIN_A) + 100,
+		    "  data");
+	TEST_EQ(file.size, 100, "  size");
+	TEST_EQ(file.type, TYPE_RAW, "  type");
+	TEST_EQ(file.compression, CBFS_COMPRESS_NONE, "  not compressed");
+
+	TEST_SUCC(cbfs_find_file(image, sizeof(image), "FW_MAIN_A", "ecrw",
+				 &file), "find compressed file");
+	TEST_EQ(file.size, 300, "  size");
+	TEST_EQ(file.compression, CBFS_COMPRESS_LZMA, "  LZMA");
+	TEST_EQ(file.decompressed_size, 600, "  decompressed size");
+
+	TEST_SUCC(cbfs_find_file(image, sizeof(image), NULL, "config", &file),
+		  "default region");
+	TEST_EQ(file.size, strlen(config), "  size");
+
+	TEST_EQ(cbfs_find_file(image, sizeof(image), "FW_MAIN_A", "old",
+			       &file),
+		VB2_ERROR_CBFS_FILE_NOT_FOUND, "deleted file");
+	TEST_EQ(cbfs_find_file(image, sizeof(image), "FW_MAIN_A", "", &file),
+		VB2_ERROR_CBFS_FILE_NOT_FOUND, "empty file");
+	TEST_EQ(cbfs_find_file(image, sizeof(image), "FW_MAIN_A", "fallback",
+			       &file),
+		VB2_ERROR_CBFS_FILE_NOT_FOUND, "name prefix");
+	TEST_EQ(cbfs_find_file(image, sizeof(image), "FW_MAIN_B", "ecrw",
+			       &file),
+		VB2_ERROR_CBFS_FILE_NOT_FOUND, "no CBFS");
+	TEST_EQ(cbfs_find_file(image, sizeof(image), "RW_LEGACY", "ecrw",
+			       &file),
+		VB2_ERROR_CBFS_REGION, "no region");
+	TEST_EQ(cbfs_find_file(image, REGION_SIZE * 3, "FW_MAIN_A", "ecrw",
+			       &file),
+		VB2_ERROR_CBFS_REGION, "region past end of image");
+
+	/* Files that don't fit are skipped over */
+	put_be32(region_buf(REGION_FW_MAIN_A) + 8, REGION_SIZE);
+	TEST_EQ(cbfs_find_file(image, sizeof(image), "FW_MAIN_A",
+			       "fallback/payload", &file),
+		VB2_ERROR_CBFS_FILE_NOT_FOUND, "file too large");
+	TEST_SUCC(cbfs_find_file(image, sizeof(image), "FW_MAIN_A", "ecrw",
+				 &file), "  later file still found");
+}
+
+static void config_tests(void)
+{
+	char *value;
+
+	build_image();
+
+	TEST_SUCC(cbfs_get_config_value(image, sizeof(image), NULL,
+					"CONFIG_VBOOT_CBFS_INTEGRATION",
+					&value), "config value");
+	TEST_STR_EQ(value, "y", "  value");
+	free(value);
+
+	TEST_SUCC(cbfs_get_config_value(image, sizeof(image), NULL,
+					"CONFIG_FIRST", &value),
+		  "first line");
+	TEST_STR_EQ(value, "1", "  value");
+	free(value);
+
+	TEST_SUCC(cbfs_get_config_value(image, sizeof(image), NULL,
+					"CONFIG_LAST", &value),
+		  "last line");
+	TEST_STR_EQ(value, "\"no newline\"", "  value");
+	free(value);
+
+	TEST_SUCC(cbfs_get_config_value(image, sizeof(image), NULL,
+					"CONFIG_EMPTY", &value),
+		  "empty value");
+	TEST_STR_EQ(value, "", "  value");
+	free(value);
+
+	TEST_SUCC(cbfs_get_config_value(image, sizeof(image), NULL,
+					"CONFIG_VBOOT", &value),
+		  "field prefix");
+	TEST_PTR_EQ(value, NULL, "  not set");
+
+	TEST_NEQ(cbfs_get_config_value(image, sizeof(image), "FW_MAIN_A",
+				       "CONFIG_FIRST", &value),
+		 VB2_SUCCESS, "no config file");
+	TEST_PTR_EQ(value, NULL, "  not set");
+}
+
+static void metadata_hash_tests(void)
+{
+	uint8_t want[VB2_SHA256_DIGEST_SIZE];
+	struct vb2_hash hash;
+	struct cbfs_file_info file;
+	FmapAreaHeader *ah;
+
+	build_image();
+	vb2_digest_finalize(&metadata_dc, want, sizeof(want));
+
+	TEST_SUCC(cbfs_get_metadata_hash(image, sizeof(image), "FW_MAIN_A",
+					 &hash), "metadata hash");
+	TEST_EQ(hash.algo, VB2_HASH_SHA256, "  algorithm");
+	TEST_SUCC(memcmp(hash.raw, want, sizeof(want)), "  hash");
+
+	TEST_SUCC(cbfs_get_metadata_hash(image, sizeof(image), NULL, &hash),
+		  "bootblock file needs no hash");
+	TEST_EQ(cbfs_get_metadata_hash(image, sizeof(image), "FW_MAIN_B",
+				       &hash),
+		VB2_ERROR_CBFS_EMPTY, "no CBFS");
+	TEST_EQ(hash.algo, VB2_HASH_INVALID, "  no hash");
+
+	/* Anchor from the bootblock file, without a BOOTBLOCK area */
+	ah = (FmapAreaHeader *)((FmapHeader *)image + 1);
+	strcpy(ah[REGION_BOOTBLOCK].area_name, "RO_UNUSED");
+	TEST_SUCC(cbfs_get_metadata_hash(image, sizeof(image), "FW_MAIN_A",
+					 &hash), "anchor in bootblock file");
+	TEST_SUCC(memcmp(hash.raw, want, sizeof(want)), "  hash");
+	memset(region_buf(REGION_COREBOOT), 0xff, REGION_SIZE);
+	TEST_EQ(cbfs_get_metadata_hash(image, sizeof(image), "FW_MAIN_A",
+				       &hash),
+		VB2_ERROR_CBFS_FILE_NOT_FOUND, "no bootblock");
+
+	build_image();
+	memset(region_buf(REGION_BOOTBLOCK), 0, REGION_SIZE);
+	TEST_EQ(cbfs_get_metadata_hash(image, sizeof(image), "FW_MAIN_A",
+				       &hash),
+		VB2_ERROR_CBFS_NO_ANCHOR, "no anchor");
+
+	/* File data is checked against its hash */
+	build_image();
+	cbfs_find_file(image, sizeof(image), "FW_MAIN_A", "ecrw", &file);
+	((uint8_t *)file.data)[10] ^= 1;
+	TEST_EQ(cbfs_get_metadata_hash(image, sizeof(image), "FW_MAIN_A",
+				       &hash),
+		VB2_ERROR_CBFS_FILE_HASH, "bad file hash");
+	TEST_EQ(hash.algo, VB2_HASH_INVALID, "  no hash");
+
+	build_image();
+	add_file(REGION_FW_MAIN_B, "unhashed", TYPE_RAW, config, 10, false, 0);
+	TEST_EQ(cbfs_get_metadata_hash(image, sizeof(image), "FW_MAIN_B",
+				       &hash),
+		VB2_ERROR_CBFS_FILE_HASH, "missing file hash");
+}
+
+/* The cbfstool_*() calls read the file in-process unless asked not to */
+static void cbfstool_tests(void)
+{
+	char path[] = "/tmp/vb2_host_cbfs_tests.XXXXXX";
+	struct vb2_hash hash;
+	char *value;
+	int fd;
+
+	build_image();
+	fd = mkstemp(path);
+	TEST_TRUE(fd >= 0, "create image file");
+	if (fd < 0)
+		return;
+	close(fd);
+	TEST_SUCC(vb2_write_file(path, image, sizeof(image)),
+		  "write image file");
+
+	unsetenv(ENV_CBFSTOOL);
+	TEST_SUCC(cbfstool_get_config_value(path, NULL,
+					    "CONFIG_VBOOT_CBFS_INTEGRATION",
+					    &value), "cbfstool config value");
+	TEST_STR_EQ(value, "y", "  value");
+	free(value);
+	TEST_SUCC(cbfstool_get_metadata_hash(path, "FW_MAIN_A", &hash),
+		  "cbfstool metadata hash");
+	TEST_EQ(hash.algo, VB2_HASH_SHA256, "  algorithm");
+
+	unlink(path);
+	TEST_NEQ(cbfstool_get_metadata_hash(path, "FW_MAIN_A", &hash),
+		 VB2_SUCCESS, "missing file");
+}
+
+int main(int argc, char *argv[])
+{
+	find_file_tests();
+	config_tests();
+	metadata_hash_tests();
+	cbfstool_tests();
+
+	return gTestSuccess ? 0 : 255;
+}
@@ -0,0 +1,440 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for one-shot and persistent external signers.
+ *
+ * This program is also the external signer: when SIGNER_TEST_LOG is set,
+ * it signs with the PEM key it's given, noting each start in that file.
+ */
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "2common.h"
+#include "2rsa.h"
+#include "2sysincludes.h"
+#include "common/tests.h"
+#include "host_common.h"
+#include "host_key.h"
+#include "host_keyblock.h"
+#include "host_misc.h"
+#include "host_signature.h"
+
+#define NUM_DATA 40
+#define DATA_SIZE 1000
+
+/* File that each signer started notes its start in */
+#define ENV_LOG "SIGNER_TEST_LOG"
+/* Makes the persistent signer exit after this many signatures */
+#define ENV_EXIT_AFTER "SIGNER_TEST_EXIT_AFTER"
+/* Makes the persistent signer reply with an empty response */
+#define ENV_REFUSE "SIGNER_TEST_REFUSE"
+
+static char signer[PATH_MAX];
+static char log_file[] = "/tmp/vb2_host_external_signer_tests.XXXXXX";
+static char pem2048[PATH_MAX], pem4096[PATH_MAX], keyb2048[PATH_MAX];
+
+static uint8_t data[NUM_DATA][DATA_SIZE];
+static const uint8_t *data_ptrs[NUM_DATA];
+static uint32_t sizes[NUM_DATA];
+/* Signatures from the same keys, calculated in-process */
+static struct vb2_signature *want2048[NUM_DATA], *want4096[NUM_DATA];
+
+/*****************************************************************************/
+/* The external signer */
+
+static void note_start(const char *what)
+{
+	int fd = open(getenv(ENV_LOG), O_WRONLY | O_APPEND);
+
+	if (fd >= 0) {
+		if (write(fd, what, strlen(what)) < 0)
+			perror("write");
+		close(fd);
+	}
+}
+
+static int read_all(int fd, uint8_t *buf, size_t size)
+{
+	ssize_t n;
+
+	while (size) {
+		n = read(fd, buf, size);
+		if (n <= 0)
+			return -1;
+		buf += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/* Same as "openssl rsautl -sign"; returns the signature size, or -1 */
+static int sign_one(EVP_PKEY *key, const uint8_t *in, int size, uint8_t *out)
+{
+	EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(key, NULL);
+	size_t out_size = 1024;
+	int rv = -1;
+
+	if (ctx && EVP_PKEY_sign_init(ctx) > 0 &&
+	    EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) > 0 &&
+	    EVP_PKEY_sign(ctx, out, &out_size, in, size) > 0)
+		rv = out_size;
+	EVP_PKEY_CTX_free(ctx);
+	return rv;
+}
+
+static int run_oneshot_signer(EVP_PKEY *key)
+{
+	uint8_t in[1024], out[1024];
+	int size = 0, n, sig_size;
+
+	note_start("oneshot\n");
+	while ((n = read(STDIN_FILENO, in + size, sizeof(in) - size)) > 0)
+		size += n;
+	sig_size = sign_one(key, in, size, out);
+	if (sig_size <= 0 || write(STDOUT_FILENO, out, sig_size) != sig_size)
+		return 1;
+	return 0;
+}
+
+static int run_persistent_signer(EVP_PKEY *key)
+{
+	const char *exit_after = getenv(ENV_EXIT_AFTER);
+	int remaining = exit_after ? atoi(exit_after) : -1;
+	uint8_t header[4], in[1024], out[4 + 1024];
+	uint32_t size;
+	int sig_size;
+
+	note_start("persistent\n");
+	while (remaining-- && !read_all(STDIN_FILENO, header, 4)) {
+		size = (uint32_t)header[0] << 24 | header[1] << 16 |
+			header[2] << 8 | header[3];
+		if (size > sizeof(in) || read_all(STDIN_FILENO, in, size))
+			return 1;
+		sig_size = getenv(ENV_REFUSE) ? 0 :
+			sign_one(key, in, size, out + 4);
+		if (sig_size < 0)
+			sig_size = 0;
+		out[0] = sig_size >> 24;
+		out[1] = sig_size >> 16;
+		out[2] = sig_size >> 8;
+		out[3] = sig_size;
+		if (write(STDOUT_FILENO, out, 4 + sig_size) != 4 + sig_size)
+			return 1;
+	}
+	return 0;
+}
+
+static int run_signer(int argc, char *argv[])
+{
+	const char *pem_file = argv[argc - 1];
+	EVP_PKEY *key = NULL;
+	FILE *fp;
+	int rv;
+
+	fp = fopen(pem_file, "r");
+	if (fp) {
+		key = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
+		fclose(fp);
+	}
+	if (!key)
+		return 1;
+
+	if (argc == 3 && !strcmp(argv[1], "--persistent"))
+		rv = run_persistent_signer(key);
+	else
+		rv = run_oneshot_signer(key);
+	EVP_PKEY_free(key);
+	return rv;
+}
+
+/*****************************************************************************/
+/* The tests */
+
+static int count_starts(const char *what)
+{
+	char line[64];
+	int count = 0;
+	FILE *fp = fopen(log_file, "r");
+
+	if (!fp)
+		return -1;
+	while (fgets(line, sizeof(line), fp))
+		if (!strncmp(line, what, strlen(what)))
+			count++;
+	fclose(fp);
+	return count;
+}
+
+static int same_sig(const struct vb2_signature *a,
+		    const struct vb2_signature *b)
+{
+	return a && b && a->sig_size == b->sig_size &&
+		a->data_size == b->data_size &&
+		!memcmp(vb2_signature_data(a), vb2_signature_data(b),
+			a->sig_size);
+}
+
+static int setup(const char *keys_dir)
+{
+	struct vb2_private_key *key2048, *key4096;
+	int i, fd;
+
+	if (!realpath("/proc/self/exe", signer))
+		return 1;
+	snprintf(pem2048, sizeof(pem2048), "%s/key_rsa2048.pem", keys_dir);
+	snprintf(pem4096, sizeof(pem4096), "%s/key_rsa4096.pem", keys_dir);
+	snprintf(keyb2048, sizeof(keyb2048), "%s/key_rsa2048.keyb", keys_dir);
+
+	fd = mkstemp(log_file);
+	if (fd < 0)
+		return 1;
+	close(fd);
+	setenv(ENV_LOG, log_file, 1);
+
+	key2048 = vb2_read_private_key_pem(pem2048, VB2_ALG_RSA2048_SHA256);
+	key4096 = vb2_read_private_key_pem(pem4096, VB2_ALG_RSA4096_SHA512);
+	if (!key2048 || !key4096)
+		return 1;
+
+	for (i = 0; i < NUM_DATA; i++) {
+		memset(data[i], i, DATA_SIZE);
+		data_ptrs[i] = data[i];
+		sizes[i] = DATA_SIZE - i;
+		want2048[i] = vb2_calculate_signature(data[i], sizes[i],
+						      key2048);
+		want4096[i] = vb2_calculate_signature(data[i], sizes[i],
+						      key4096);
+		if (!want2048[i] || !want4096[i])
+			return 1;
+	}
+
+	vb2_free_private_key(key2048);
+	vb2_free_private_key(key4096);
+	return 0;
+}
+
+static void oneshot_tests(void)
+{
+	struct vb2_signature *sig;
+	struct vb2_signature *sigs[3];
+
+	sig = vb2_external_signature(data[0], sizes[0], pem2048,
+				     VB2_ALG_RSA2048_SHA256, signer);
+	TEST_TRUE(same_sig(sig, want2048[0]), "one-shot signature");
+	free(sig);
+
+	TEST_SUCC(vb2_external_signatures(data_ptrs, sizes, 3, pem2048,
+					  VB2_ALG_RSA2048_SHA256, signer,
+					  sigs), "one-shot, several");
+	TEST_TRUE(same_sig(sigs[0], want2048[0]) &&
+		  same_sig(sigs[1], want2048[1]) &&
+		  same_sig(sigs[2], want2048[2]), "  signatures");
+	free(sigs[0]);
+	free(sigs[1]);
+	free(sigs[2]);
+
+	TEST_EQ(count_starts("oneshot"), 4, "  signer run for each");
+	TEST_EQ(count_starts("persistent"), 0, "  never persistent");
+}
+
+static void persistent_tests(void)
+{
+	struct vb2_signature *sig;
+	struct vb2_signature *sigs[NUM_DATA];
+	int i, ok, status;
+	pid_t pid;
+
+	vb2_set_external_signer_persistent(true);
+
+	for (i = 0, ok = 1; i < 3; i++) {
+		sig = vb2_external_signature(data[i], sizes[i], pem2048,
+					     VB2_ALG_RSA2048_SHA256, signer);
+		ok &= same_sig(sig, want2048[i]);
+		free(sig);
+	}
+	TEST_TRUE(ok, "persistent signatures");
+	TEST_EQ(count_starts("persistent"), 1, "  signer started once");
+
+	/* More at once than are ever queued in the signer */
+	TEST_SUCC(vb2_external_signatures(data_ptrs, sizes, NUM_DATA, pem2048,
+					  VB2_ALG_RSA2048_SHA256, signer,
+					  sigs), "pipelined");
+	for (i = 0, ok = 1; i < NUM_DATA; i++) {
+		ok &= same_sig(sigs[i], want2048[i]);
+		free(sigs[i]);
+	}
+	TEST_TRUE(ok, "  signatures");
+	TEST_EQ(count_starts("persistent"), 1, "  same signer");
+
+	/* Each key gets its own signer */
+	TEST_SUCC(vb2_external_signatures(data_ptrs, sizes, NUM_DATA, pem4096,
+					  VB2_ALG_RSA4096_SHA512, signer,
+					  sigs), "second key");
+	for (i = 0, ok = 1; i < NUM_DATA; i++) {
+		ok &= same_sig(sigs[i], want4096[i]);
+		free(sigs[i]);
+	}
+	TEST_TRUE(ok, "  signatures");
+	TEST_EQ(count_starts("persistent"), 2, "  another signer");
+
+	vb2_stop_external_signers();
+	TEST_EQ(count_starts("oneshot"), 4, "  never one-shot");
+
+	sig = vb2_external_signature(data[0], sizes[0], pem2048,
+				     VB2_ALG_RSA2048_SHA256, signer);
+	TEST_TRUE(same_sig(sig, want2048[0]), "restarted after stop");
+	free(sig);
+	TEST_EQ(count_starts("persistent"), 3, "  new signer");
+
+	/* A forked child starts its own signer, and leaves the parent's be */
+	pid = fork();
+	if (pid == 0) {
+		sig = vb2_external_signature(data[1], sizes[1], pem2048,
+					     VB2_ALG_RSA2048_SHA256, signer);
+		ok = same_sig(sig, want2048[1]);
+		free(sig);
+		vb2_stop_external_signers();
+		_exit(ok ? 0 : 1);
+	}
+	TEST_TRUE(pid > 0 && waitpid(pid, &status, 0) == pid &&
+		  WIFEXITED(status) && WEXITSTATUS(status) == 0,
+		  "signature in forked child");
+	TEST_EQ(count_starts("persistent"), 4, "  child's own signer");
+	sig = vb2_external_signature(data[2], sizes[2], pem2048,
+				     VB2_ALG_RSA2048_SHA256, signer);
+	TEST_TRUE(same_sig(sig, want2048[2]), "  parent's signer still works");
+	free(sig);
+	TEST_EQ(count_starts("persistent"), 4, "  not restarted");
+	vb2_stop_external_signers();
+}
+
+static void keyblock_tests(void)
+{
+	struct vb2_packed_key *data_key;
+	struct vb2_private_key *key4096;
+	const struct vb2_packed_key *data_keys[3];
+	const uint32_t flags[3] = {0, 7, 42};
+	struct vb2_keyblock *blocks[3], *want;
+	int i, ok;
+
+	data_key = vb2_read_packed_keyb(keyb2048, VB2_ALG_RSA2048_SHA256, 1);
+	key4096 = vb2_read_private_key_pem(pem4096, VB2_ALG_RSA4096_SHA512);
+	if (!data_key || !key4096) {
+		TEST_TRUE(0, "keyblock keys");
+		return;
+	}
+	for (i = 0; i < 3; i++)
+		data_keys[i] = data_key;
+
+	vb2_set_external_signer_persistent(true);
+	TEST_SUCC(vb2_create_keyblocks_external(data_keys, flags, 3, pem4096,
+						VB2_ALG_RSA4096_SHA512, signer,
+						blocks), "keyblocks");
+	for (i = 0, ok = 1; i < 3; i++) {
+		want = vb2_create_keyblock(data_key, key4096, flags[i]);
+		ok &= want && blocks[i] &&
+			blocks[i]->keyblock_size == want->keyblock_size &&
+			!memcmp(blocks[i], want, want->keyblock_size);
+		free(want);
+		free(blocks[i]);
+	}
+	TEST_TRUE(ok, "  same as signed in-process");
+	TEST_EQ(count_starts("persistent"), 5, "  one signer");
+	vb2_stop_external_signers();
+
+	setenv(ENV_REFUSE, "1", 1);
+	TEST_EQ(vb2_create_keyblocks_external(data_keys, flags, 3, pem4096,
+					      VB2_ALG_RSA4096_SHA512, signer,
+					      blocks),
+		VB2_ERROR_EXTERNAL_SIGNER, "keyblocks refused");
+	TEST_TRUE(!blocks[0] && !blocks[1] && !blocks[2], "  no keyblocks");
+	unsetenv(ENV_REFUSE);
+
+	vb2_stop_external_signers();
+	vb2_free_private_key(key4096);
+	free(data_key);
+}
+
+static void persistent_error_tests(void)
+{
+	struct vb2_signature *sig;
+	struct vb2_signature *sigs[NUM_DATA];
+	int i, all_null;
+
+	/* Signer dies part way through */
+	setenv(ENV_EXIT_AFTER, "20", 1);
+	TEST_EQ(vb2_external_signatures(data_ptrs, sizes, NUM_DATA, pem2048,
+					VB2_ALG_RSA2048_SHA256, signer, sigs),
+		VB2_ERROR_EXTERNAL_SIGNER, "signer exits");
+	for (i = 0, all_null = 1; i < NUM_DATA; i++)
+		all_null &= !sigs[i];
+	TEST_TRUE(all_null, "  no signatures");
+	unsetenv(ENV_EXIT_AFTER);
+
+	sig = vb2_external_signature(data[1], sizes[1], pem2048,
+				     VB2_ALG_RSA2048_SHA256, signer);
+	TEST_TRUE(same_sig(sig, want2048[1]), "  replaced next time");
+	free(sig);
+	vb2_stop_external_signers();
+
+	/* Signer refuses to sign */
+	setenv(ENV_REFUSE, "1", 1);
+	sig = vb2_external_signature(data[0], sizes[0], pem2048,
+				     VB2_ALG_RSA2048_SHA256, signer);
+	TEST_PTR_EQ(sig, NULL, "signer refuses");
+	unsetenv(ENV_REFUSE);
+	vb2_stop_external_signers();
+
+	sig = vb2_external_signature(data[0], sizes[0], pem2048,
+				     VB2_ALG_RSA2048_SHA256,
+				     "/nonexistent/signer");
+	TEST_PTR_EQ(sig, NULL, "no such signer");
+	vb2_stop_external_signers();
+
+	TEST_SUCC(vb2_external_signatures(NULL, NULL, 0, pem2048,
+					  VB2_ALG_RSA2048_SHA256, signer,
+					  sigs), "nothing to sign");
+	vb2_set_external_signer_persistent(false);
+}
+
+int main(int argc, char *argv[])
+{
+	int i;
+
+	if (getenv(ENV_LOG))
+		return run_signer(argc, argv);
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <keys_dir>\n", argv[0]);
+		return -1;
+	}
+
+	if (setup(argv[1])) {
+		fprintf(stderr, "Setup failed\n");
+		unlink(log_file);
+		return 1;
+	}
+
+	oneshot_tests();
+	persistent_tests();
+	keyblock_tests();
+	persistent_error_tests();
+
+	for (i = 0; i < NUM_DATA; i++) {
+		free(want2048[i]);
+		free(want4096[i]);
+	}
+	unlink(log_file);
+
+	return gTestSuccess ? 0 : 255;
+}
@@ -0,0 +1,252 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the OpenSSL hwcrypto provider, checked against vboot's own
+ * SHA and RSA code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "2common.h"
+#include "2packed_key.h"
+#include "2rsa.h"
+#include "2rsa_private.h"
+#include "2sha.h"
+#include "2sysincludes.h"
+#include "common/tests.h"
+#include "host_hwcrypto.h"
+#include "host_key.h"
+#include "host_signature.h"
+#include "rsa_padding_test.h"
+
+static uint8_t test_data[65537];
+
+static void test_backend_names(void)
+{
+	enum vb2_crypto_backend backend;
+
+	TEST_TRUE(vb2_lookup_crypto_backend("vboot", &backend) &&
+		  backend == VB2_CRYPTO_BACKEND_VBOOT, "lookup vboot");
+	TEST_TRUE(vb2_lookup_crypto_backend("OpenSSL", &backend) &&
+		  backend == VB2_CRYPTO_BACKEND_OPENSSL, "lookup openssl");
+	TEST_FALSE(vb2_lookup_crypto_backend("nss", &backend),
+		   "lookup unknown");
+
+	setenv(ENV_CRYPTO_BACKEND, "nss", 1);
+	TEST_EQ(vb2_set_crypto_backend_from_env(), VB2_ERROR_UNKNOWN,
+		"unknown backend in env");
+	setenv(ENV_CRYPTO_BACKEND, "openssl", 1);
+	TEST_SUCC(vb2_set_crypto_backend_from_env(), "openssl from env");
+	TEST_TRUE(vb2_host_keys_allow_hwcrypto, "  keys allow hwcrypto");
+	unsetenv(ENV_CRYPTO_BACKEND);
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_VBOOT);
+	TEST_FALSE(vb2_host_keys_allow_hwcrypto, "vboot backend");
+}
+
+static void test_digests(void)
+{
+	static const uint32_t sizes[] = {0, 1, 55, 64, 127, 128, 1000,
+					 sizeof(test_data)};
+	uint32_t digest_size;
+	struct vb2_hash want, got;
+	struct vb2_digest_context dc, dc2;
+	enum vb2_hash_algorithm alg;
+	int i;
+
+	for (alg = VB2_HASH_SHA1; alg <= VB2_HASH_SHA384; alg++) {
+		int mismatch = 0;
+
+		digest_size = vb2_digest_size(alg);
+		for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+			vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_VBOOT);
+			if (vb2_hash_calculate(true, test_data, sizes[i], alg,
+					       &want))
+				mismatch++;
+			vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_OPENSSL);
+			if (vb2_hash_calculate(true, test_data, sizes[i], alg,
+					       &got))
+				mismatch++;
+			if (memcmp(want.raw, got.raw, digest_size))
+				mismatch++;
+		}
+		TEST_EQ(mismatch, 0, vb2_get_hash_algorithm_name(alg));
+	}
+
+	/* The provider is really used, and the digest is size-checked */
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_OPENSSL);
+	TEST_SUCC(vb2_digest_init(&dc, true, VB2_HASH_SHA256, 0),
+		  "digest init");
+	TEST_TRUE(dc.using_hwcrypto, "  using hwcrypto");
+	TEST_SUCC(vb2_digest_extend(&dc, test_data, 3), "  extend");
+	TEST_EQ(vb2_digest_finalize(&dc, got.raw, VB2_SHA1_DIGEST_SIZE),
+		VB2_ERROR_SHA_FINALIZE_DIGEST_SIZE, "  digest too small");
+	TEST_EQ(vb2_hwcrypto_live_digests(), 0, "  finalize frees it");
+
+	/* Abandoned digests are freed when their context is reused */
+	TEST_SUCC(vb2_digest_init(&dc, true, VB2_HASH_SHA256, 0),
+		  "abandoned digest init");
+	TEST_SUCC(vb2_digest_extend(&dc, test_data, 3), "  extend");
+	TEST_EQ(vb2_hwcrypto_live_digests(), 1, "  one live digest");
+	TEST_SUCC(vb2_digest_init(&dc2, true, VB2_HASH_SHA512, 0),
+		  "  another context");
+	TEST_EQ(vb2_hwcrypto_live_digests(), 2, "  two live digests");
+	TEST_SUCC(vb2_digest_init(&dc, true, VB2_HASH_SHA1, 0),
+		  "  reinit the first");
+	TEST_EQ(vb2_hwcrypto_live_digests(), 2, "  old digest freed");
+	TEST_SUCC(vb2_digest_extend(&dc2, test_data, sizeof(test_data)),
+		  "  other digest untouched");
+	TEST_SUCC(vb2_digest_finalize(&dc2, got.raw, VB2_SHA512_DIGEST_SIZE),
+		  "  finalize it");
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_VBOOT);
+	TEST_SUCC(vb2_hash_calculate(false, test_data, sizeof(test_data),
+				     VB2_HASH_SHA512, &want), "  expected");
+	TEST_EQ(memcmp(want.raw, got.raw, VB2_SHA512_DIGEST_SIZE), 0,
+		"  digest matches");
+	TEST_EQ(vb2_hwcrypto_live_digests(), 1, "  one left");
+
+	TEST_SUCC(vb2_digest_init(&dc, true, VB2_HASH_SHA256, 0),
+		  "vboot digest init");
+	TEST_FALSE(dc.using_hwcrypto, "  not using hwcrypto");
+	TEST_EQ(vb2_hwcrypto_live_digests(), 0, "  abandoned digest freed");
+}
+
+/* Verify with both backends; they have to agree */
+static void check_verify(struct vb2_packed_key *packed,
+			 const struct vb2_signature *sig, int expect_ok,
+			 const char *desc)
+{
+	uint8_t workbuf[VB2_VERIFY_DATA_WORKBUF_BYTES]
+		__attribute__((aligned(VB2_WORKBUF_ALIGN)));
+	uint32_t sig_total = sig->sig_offset + sig->sig_size;
+	struct vb2_signature *copy = malloc(sig_total);
+	struct vb2_workbuf wb;
+	struct vb2_public_key key;
+	int ok[VB2_CRYPTO_BACKEND_COUNT];
+	int i;
+
+	for (i = 0; i < VB2_CRYPTO_BACKEND_COUNT; i++) {
+		/* Verification destroys the signature */
+		memcpy(copy, sig, sig_total);
+		vb2_set_crypto_backend(i);
+		vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
+		ok[i] = vb2_unpack_key(&key, packed) == VB2_SUCCESS &&
+			vb2_verify_data(test_data, copy->data_size, copy,
+					&key, &wb) == VB2_SUCCESS;
+	}
+	free(copy);
+
+	TEST_EQ(ok[VB2_CRYPTO_BACKEND_OPENSSL], expect_ok, desc);
+	TEST_EQ(ok[VB2_CRYPTO_BACKEND_VBOOT], expect_ok, "  vboot agrees");
+}
+
+static void test_modexp(struct vb2_packed_key *packed)
+{
+	uint32_t workbuf32[3 * RSA8192NUMBYTES / sizeof(uint32_t)];
+	uint8_t want[RSA8192NUMBYTES];
+	uint8_t got[RSA8192NUMBYTES];
+	struct vb2_public_key key;
+	uint32_t size;
+	int exp, i, j;
+	int mismatch = 0;
+
+	if (vb2_unpack_key(&key, packed))
+		return;
+	size = key.arrsize * sizeof(uint32_t);
+	exp = (key.sig_alg == VB2_SIG_RSA2048_EXP3 ||
+	       key.sig_alg == VB2_SIG_RSA3072_EXP3) ? 3 : 65537;
+
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_OPENSSL);
+	for (i = 0; i < 8; i++) {
+		for (j = 0; j < size; j++)
+			want[j] = (uint8_t)rand();
+		/* Stay below the modulus */
+		want[0] = 0;
+		memcpy(got, want, size);
+
+		vb2_modpow(&key, want, workbuf32, exp);
+		if (vb2ex_hwcrypto_modexp(&key, got, workbuf32, exp) ||
+		    memcmp(want, got, size))
+			mismatch++;
+	}
+	TEST_EQ(mismatch, 0, "  modexp matches vb2_modpow()");
+}
+
+static void test_algorithm(enum vb2_crypto_algorithm alg,
+			   const char *keys_dir)
+{
+	char filename[1024];
+	struct vb2_private_key *private_key;
+	struct vb2_packed_key *packed;
+	struct vb2_signature *sig;
+	struct vb2_public_key key;
+	struct vb2_hash hash;
+	uint8_t *sig_data;
+
+	printf("***Testing algorithm: %s\n",
+	       vb2_get_crypto_algorithm_name(alg));
+
+	snprintf(filename, sizeof(filename), "%s/key_%s.pem", keys_dir,
+		 vb2_get_crypto_algorithm_file(alg));
+	private_key = vb2_read_private_key_pem(filename, alg);
+	snprintf(filename, sizeof(filename), "%s/key_%s.keyb", keys_dir,
+		 vb2_get_crypto_algorithm_file(alg));
+	packed = vb2_read_packed_keyb(filename, alg, 1);
+	TEST_PTR_NEQ(private_key, NULL, "read private key");
+	TEST_PTR_NEQ(packed, NULL, "read public key");
+	if (!private_key || !packed)
+		goto done;
+
+	sig = vb2_calculate_signature(test_data, 4096, private_key);
+	TEST_PTR_NEQ(sig, NULL, "calculate signature");
+	if (!sig)
+		goto done;
+	sig_data = vb2_signature_data_mutable(sig);
+
+	check_verify(packed, sig, 1, "good signature");
+	sig_data[sig->sig_size / 2] ^= 0x01;
+	check_verify(packed, sig, 0, "corrupt signature");
+	sig_data[sig->sig_size / 2] ^= 0x01;
+	sig->data_size--;
+	check_verify(packed, sig, 0, "wrong data");
+	sig->data_size++;
+
+	/* Make sure the provider verified it, rather than falling back */
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_OPENSSL);
+	if (!vb2_unpack_key(&key, packed) &&
+	    !vb2_hash_calculate(false, test_data, sig->data_size,
+				key.hash_alg, &hash))
+		TEST_SUCC(vb2ex_hwcrypto_rsa_verify_digest(&key, sig_data,
+							   hash.raw),
+			  "  provider verifies");
+
+	test_modexp(packed);
+	free(sig);
+
+done:
+	free(private_key);
+	free(packed);
+}
+
+int main(int argc, char *argv[])
+{
+	enum vb2_crypto_algorithm alg;
+	int i;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <keys_dir>\n", argv[0]);
+		return -1;
+	}
+
+	srand(0);
+	for (i = 0; i < sizeof(test_data); i++)
+		test_data[i] = (uint8_t)rand();
+
+	test_backend_names();
+	test_digests();
+	for (alg = 0; alg < VB2_ALG_COUNT; alg++)
+		test_algorithm(alg, argv[1]);
+
+	return gTestSuccess ? 0 : 255;
+}
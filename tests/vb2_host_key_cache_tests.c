@@ -0,0 +1,131 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the host unpacked key cache
+ */
+
+#include <stdio.h>
+
+#include "2common.h"
+#include "2packed_key.h"
+#include "2rsa.h"
+#include "2sysincludes.h"
+#include "common/tests.h"
+#include "host_key.h"
+#include "host_key_cache.h"
+
+static struct vb2_packed_key *read_key(const char *keys_dir,
+				       enum vb2_crypto_algorithm alg)
+{
+	char filename[1024];
+
+	snprintf(filename, sizeof(filename), "%s/key_%s.keyb", keys_dir,
+		 vb2_get_crypto_algorithm_file(alg));
+	return vb2_read_packed_keyb(filename, alg, 1);
+}
+
+static void check_same_key(const struct vb2_public_key *got,
+			   const struct vb2_public_key *want,
+			   const char *desc)
+{
+	TEST_TRUE(got->arrsize == want->arrsize &&
+		  got->n0inv == want->n0inv &&
+		  got->sig_alg == want->sig_alg &&
+		  got->hash_alg == want->hash_alg &&
+		  !memcmp(got->n, want->n, want->arrsize * sizeof(uint32_t)) &&
+		  !memcmp(got->rr, want->rr,
+			  want->arrsize * sizeof(uint32_t)), desc);
+}
+
+static void key_cache_tests(const char *keys_dir)
+{
+	struct vb2_packed_key *k1 = read_key(keys_dir, VB2_ALG_RSA2048_SHA256);
+	struct vb2_packed_key *k2 = read_key(keys_dir, VB2_ALG_RSA4096_SHA256);
+	struct vb2_packed_key *copy;
+	struct vb2_public_key want, got;
+	struct vb2_key_cache_stats stats;
+	uint32_t size;
+
+	TEST_PTR_NEQ(k1, NULL, "read key 1");
+	TEST_PTR_NEQ(k2, NULL, "read key 2");
+	if (!k1 || !k2)
+		goto done;
+	size = k1->key_offset + k1->key_size;
+
+	vb2_key_cache_clear();
+
+	/* First use is a miss; the key matches vb2_unpack_key() */
+	TEST_SUCC(vb2_unpack_key(&want, k1), "unpack key 1");
+	TEST_SUCC(vb2_unpack_key_cached(&got, k1), "cached key 1 miss");
+	check_same_key(&got, &want, "  same as vb2_unpack_key()");
+	TEST_PTR_NEQ(got.n, want.n, "  points into the cache");
+	TEST_EQ((uintptr_t)got.n % sizeof(uint64_t), 0, "  64-bit aligned");
+
+	/* Same key from another buffer is a hit */
+	copy = malloc(size);
+	memcpy(copy, k1, size);
+	TEST_SUCC(vb2_unpack_key_buffer_cached(&got, (uint8_t *)copy, size),
+		  "cached key 1 hit");
+	free(copy);
+	check_same_key(&got, &want, "  same key");
+
+	vb2_key_cache_get_stats(&stats);
+	TEST_EQ(stats.hits, 1, "  1 hit");
+	TEST_EQ(stats.misses, 1, "  1 miss");
+	TEST_EQ(stats.entries, 1, "  1 entry");
+
+	/* A different key, or the same data with another version, misses */
+	TEST_SUCC(vb2_unpack_key(&want, k2), "unpack key 2");
+	TEST_SUCC(vb2_unpack_key_cached(&got, k2), "cached key 2");
+	check_same_key(&got, &want, "  key 2");
+	k1->key_version++;
+	TEST_SUCC(vb2_unpack_key_cached(&got, k1), "key 1, new version");
+	TEST_EQ(got.version, 0, "  unused version");
+	k1->key_version--;
+	vb2_key_cache_get_stats(&stats);
+	TEST_EQ(stats.misses, 3, "  3 misses");
+	TEST_EQ(stats.entries, 3, "  3 entries");
+
+	/* The hwcrypto setting comes from when the key is handed out */
+	vb2_host_keys_allow_hwcrypto = true;
+	TEST_SUCC(vb2_unpack_key_cached(&got, k1), "cached key, hwcrypto");
+	TEST_TRUE(got.allow_hwcrypto, "  allows hwcrypto");
+	vb2_host_keys_allow_hwcrypto = false;
+	TEST_SUCC(vb2_unpack_key_cached(&got, k1), "cached key, no hwcrypto");
+	TEST_FALSE(got.allow_hwcrypto, "  forbids hwcrypto");
+
+	/* Bad keys aren't cached */
+	TEST_EQ(vb2_unpack_key_buffer_cached(&got, (uint8_t *)k1, size - 1),
+		VB2_ERROR_INSIDE_DATA_OUTSIDE, "buffer too small");
+	k1->algorithm = VB2_ALG_COUNT;
+	TEST_EQ(vb2_unpack_key_cached(&got, k1),
+		VB2_ERROR_UNPACK_KEY_SIG_ALGORITHM, "bad algorithm");
+	TEST_EQ(vb2_unpack_key_cached(&got, k1),
+		VB2_ERROR_UNPACK_KEY_SIG_ALGORITHM, "  still bad");
+	k1->algorithm = VB2_ALG_RSA2048_SHA256;
+	TEST_EQ(vb2_unpack_key_cached(&got, NULL),
+		VB2_ERROR_UNPACK_KEY_BUFFER, "NULL key");
+	vb2_key_cache_get_stats(&stats);
+	TEST_EQ(stats.entries, 3, "  still 3 entries");
+
+	vb2_key_cache_clear();
+	vb2_key_cache_get_stats(&stats);
+	TEST_EQ(stats.hits + stats.misses + stats.entries, 0, "clear");
+
+done:
+	free(k1);
+	free(k2);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <keys_dir>\n", argv[0]);
+		return -1;
+	}
+
+	key_cache_tests(argv[1]);
+
+	return gTestSuccess ? 0 : 255;
+}
@@ -0,0 +1,277 @@
+/* Copyright 2026 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Stress tests for batch signature verification, checked against
+ * verifying the same jobs one at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "2common.h"
+#include "2rsa.h"
+#include "2sha.h"
+#include "2sysincludes.h"
+#include "common/tests.h"
+#include "host_hwcrypto.h"
+#include "host_key.h"
+#include "host_signature.h"
+#include "host_verify_batch.h"
+
+#define SIGS_PER_KEY 3
+#define NUM_JOBS 600
+
+static const uint32_t sig_sizes[SIGS_PER_KEY] = {1, 4096, 65000};
+
+static uint8_t test_data[65536];
+
+static struct vb2_packed_key *packed[VB2_ALG_COUNT];
+static struct vb2_public_key keys[VB2_ALG_COUNT];
+static struct vb2_signature *sigs[VB2_ALG_COUNT][SIGS_PER_KEY];
+/* Same as sigs, with one bit flipped */
+static struct vb2_signature *bad_sigs[VB2_ALG_COUNT][SIGS_PER_KEY];
+static uint8_t digests[VB2_ALG_COUNT][SIGS_PER_KEY][VB2_MAX_DIGEST_SIZE];
+
+static struct vb2_verify_job jobs[NUM_JOBS];
+static vb2_error_t want[NUM_JOBS];
+
+static struct vb2_signature *copy_sig(const struct vb2_signature *sig)
+{
+	uint32_t size = sig->sig_offset + sig->sig_size;
+	struct vb2_signature *copy = malloc(size);
+
+	memcpy(copy, sig, size);
+	return copy;
+}
+
+static int setup_keys(const char *keys_dir)
+{
+	char filename[1024];
+	struct vb2_private_key *private_key;
+	struct vb2_hash hash;
+	int alg, i;
+
+	for (alg = 0; alg < VB2_ALG_COUNT; alg++) {
+		snprintf(filename, sizeof(filename), "%s/key_%s.pem",
+			 keys_dir, vb2_get_crypto_algorithm_file(alg));
+		private_key = vb2_read_private_key_pem(filename, alg);
+		snprintf(filename, sizeof(filename), "%s/key_%s.keyb",
+			 keys_dir, vb2_get_crypto_algorithm_file(alg));
+		packed[alg] = vb2_read_packed_keyb(filename, alg, 1);
+		if (!private_key || !packed[alg] ||
+		    vb2_unpack_key(&keys[alg], packed[alg])) {
+			fprintf(stderr, "Can't read key %s\n", filename);
+			return 1;
+		}
+
+		for (i = 0; i < SIGS_PER_KEY; i++) {
+			sigs[alg][i] = vb2_calculate_signature(
+				test_data, sig_sizes[i], private_key);
+			if (!sigs[alg][i])
+				return 1;
+			bad_sigs[alg][i] = copy_sig(sigs[alg][i]);
+			vb2_signature_data_mutable(bad_sigs[alg][i])[7] ^= 0x10;
+			vb2_hash_calculate(false, test_data, sig_sizes[i],
+					   keys[alg].hash_alg, &hash);
+			memcpy(digests[alg][i], hash.raw,
+			       vb2_digest_size(keys[alg].hash_alg));
+		}
+		free(private_key);
+	}
+	return 0;
+}
+
+/* Fill the jobs with a random mix of good and bad signatures */
+static void make_jobs(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_JOBS; i++) {
+		struct vb2_verify_job *job = &jobs[i];
+		int alg = rand() % VB2_ALG_COUNT;
+		int s = rand() % SIGS_PER_KEY;
+
+		memset(job, 0, sizeof(*job));
+		job->key = &keys[alg];
+		job->sig = sigs[alg][s];
+		job->data = test_data;
+		job->size = sizeof(test_data);
+
+		switch (rand() % 8) {
+		case 0:
+			job->digest = digests[alg][s];
+			break;
+		case 1:
+			/* Digest of other data */
+			job->digest = digests[alg][(s + 1) % SIGS_PER_KEY];
+			break;
+		case 2:
+			job->sig = bad_sigs[alg][s];
+			break;
+		case 3:
+			job->size = sig_sizes[s] - 1;
+			break;
+		case 4:
+			/* Another key's signature */
+			job->sig = sigs[(alg + 1) % VB2_ALG_COUNT][s];
+			break;
+		case 5:
+			job->data = test_data + 1;
+			job->size--;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/* What verifying each job on its own gives */
+static void serial_results(void)
+{
+	uint8_t workbuf[VB2_VERIFY_DATA_WORKBUF_BYTES]
+		__attribute__((aligned(VB2_WORKBUF_ALIGN)));
+	struct vb2_workbuf wb;
+	struct vb2_signature *sig;
+	int i;
+
+	for (i = 0; i < NUM_JOBS; i++) {
+		sig = copy_sig(jobs[i].sig);
+		vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
+		if (jobs[i].digest)
+			want[i] = vb2_verify_digest(jobs[i].key, sig,
+						    jobs[i].digest, &wb);
+		else
+			want[i] = vb2_verify_data(jobs[i].data, jobs[i].size,
+						  sig, jobs[i].key, &wb);
+		free(sig);
+	}
+}
+
+/* The batch must not destroy the signatures the way verifying does */
+static int sigs_intact(void)
+{
+	uint8_t workbuf[VB2_VERIFY_DATA_WORKBUF_BYTES]
+		__attribute__((aligned(VB2_WORKBUF_ALIGN)));
+	struct vb2_workbuf wb;
+	struct vb2_signature *sig;
+	vb2_error_t rv;
+	int alg, i;
+
+	for (alg = 0; alg < VB2_ALG_COUNT; alg++) {
+		for (i = 0; i < SIGS_PER_KEY; i++) {
+			sig = copy_sig(sigs[alg][i]);
+			vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
+			rv = vb2_verify_data(test_data, sizeof(test_data), sig,
+					     &keys[alg], &wb);
+			free(sig);
+			if (rv)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+static void check_batch(uint32_t threads, const char *desc)
+{
+	vb2_error_t first = VB2_SUCCESS;
+	int mismatch = 0, failed = 0;
+	int i;
+
+	for (i = 0; i < NUM_JOBS; i++)
+		jobs[i].result = VB2_ERROR_UNKNOWN;
+
+	for (i = 0; i < NUM_JOBS; i++) {
+		if (want[i] && !first)
+			first = want[i];
+		if (want[i])
+			failed++;
+	}
+
+	TEST_EQ(vb2_verify_batch(jobs, NUM_JOBS, threads), first, desc);
+	for (i = 0; i < NUM_JOBS; i++)
+		if (jobs[i].result != want[i])
+			mismatch++;
+	TEST_EQ(mismatch, 0, "  results match serial verification");
+	TEST_TRUE(failed > 0 && failed < NUM_JOBS, "  mix of good and bad");
+}
+
+static void batch_tests(void)
+{
+	int alg;
+
+	make_jobs();
+
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_VBOOT);
+	serial_results();
+	check_batch(1, "vboot, 1 thread");
+	check_batch(4, "vboot, 4 threads");
+	check_batch(0, "vboot, 1 thread per CPU");
+	check_batch(NUM_JOBS * 2, "vboot, more threads than jobs");
+	TEST_TRUE(sigs_intact(), "  signatures left untouched");
+
+	/* Half the keys go through the OpenSSL provider */
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_OPENSSL);
+	for (alg = 0; alg < VB2_ALG_COUNT; alg += 2)
+		keys[alg].allow_hwcrypto = true;
+	serial_results();
+	check_batch(1, "mixed, 1 thread");
+	check_batch(8, "mixed, 8 threads");
+	for (alg = 0; alg < VB2_ALG_COUNT; alg++)
+		keys[alg].allow_hwcrypto = false;
+	vb2_set_crypto_backend(VB2_CRYPTO_BACKEND_VBOOT);
+}
+
+static void edge_tests(void)
+{
+	struct vb2_verify_job job = {
+		.data = test_data,
+		.size = sizeof(test_data),
+		.sig = sigs[0][1],
+		.key = &keys[0],
+		.result = VB2_ERROR_UNKNOWN,
+	};
+
+	TEST_SUCC(vb2_verify_batch(NULL, 0, 0), "no jobs");
+	TEST_SUCC(vb2_verify_batch(&job, 1, 0), "one job");
+	TEST_SUCC(job.result, "  result");
+
+	job.sig = bad_sigs[0][1];
+	TEST_NEQ(vb2_verify_batch(&job, 1, 3), VB2_SUCCESS, "one bad job");
+	TEST_NEQ(job.result, VB2_SUCCESS, "  result");
+
+	job.sig = sigs[0][2];
+	job.size = 100;
+	TEST_EQ(vb2_verify_batch(&job, 1, 1), VB2_ERROR_VDATA_NOT_ENOUGH_DATA,
+		"data too small");
+}
+
+int main(int argc, char *argv[])
+{
+	int alg, i;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <keys_dir>\n", argv[0]);
+		return -1;
+	}
+
+	srand(0);
+	for (i = 0; i < sizeof(test_data); i++)
+		test_data[i] = (uint8_t)rand();
+
+	if (setup_keys(argv[1]))
+		return 1;
+
+	batch_tests();
+	edge_tests();
+
+	for (alg = 0; alg < VB2_ALG_COUNT; alg++) {
+		for (i = 0; i < SIGS_PER_KEY; i++) {
+			free(sigs[alg][i]);
+			free(bad_sigs[alg][i]);
+		}
+		free(packed[alg]);
+	}
+
+	return gTestSuccess ? 0 : 255;
+}
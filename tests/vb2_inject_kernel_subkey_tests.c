@@ -108,9 +108,23 @@ static void ResetMocks(void)
 vb2_error_t VbExDiskRead(vb2ex_disk_handle_t h, uint64_t lba_start,
 			 uint64_t lba_count, void *buffer)
 {
+	struct mock_part *p;
+	uint64_t size = lba_count * disk_info.bytes_per_lba;
+
 	if ((int)lba_start == disk_read_to_fail)
 		return VB2_ERROR_MOCK;
 
+	/* Kernel partitions start with the mock vblock headers */
+	for (p = mock_parts; p->size; p++) {
+		if (p->start != lba_start)
+			continue;
+		memset(buffer, 0, size);
+		if (size >= kbh.keyblock_size + sizeof(kph)) {
+			memcpy(buffer, &kbh, sizeof(kbh));
+			memcpy(buffer + kbh.keyblock_size, &kph, sizeof(kph));
+		}
+	}
+
 	return VB2_SUCCESS;
 }
 
@@ -164,6 +178,7 @@ vb2_error_t vb2_unpack_key_buffer(struct vb2_public_key *key,
 	if (--unpack_key_fail == 0)
 		return VB2_ERROR_MOCK;
 
+	key->hash_alg = VB2_HASH_SHA256;
 	return VB2_SUCCESS;
 }
 
@@ -204,10 +219,9 @@ vb2_error_t vb2_verify_kernel_preamble(struct vb2_kernel_preamble *preamble,
 	return VB2_SUCCESS;
 }
 
-vb2_error_t vb2_verify_data(const uint8_t *data, uint32_t size,
-			    struct vb2_signature *sig,
-			    const struct vb2_public_key *key,
-			    const struct vb2_workbuf *wb)
+vb2_error_t vb2_verify_digest(const struct vb2_public_key *key,
+			      struct vb2_signature *sig, const uint8_t *digest,
+			      const struct vb2_workbuf *wb)
 {
 	if (verify_data_fail)
 		return VB2_ERROR_MOCK;
@@ -360,7 +374,7 @@ static void load_kernel_tests(void)
 	test_load_kernel(VB2_SUCCESS, "Kernel tiny");
 
 	ResetMocks();
-	disk_read_to_fail = 228;
+	disk_read_to_fail = 108;
 	test_load_kernel(VB2_ERROR_LK_INVALID_KERNEL_FOUND,
 			 "Fail reading kernel data");
 
@@ -194,6 +194,7 @@ void VbExStreamClose(VbExStream_t stream)
 vb2_error_t vb2_unpack_key_buffer(struct vb2_public_key *key,
 				  const uint8_t *buf, uint32_t size)
 {
+	key->hash_alg = VB2_HASH_SHA256;
 	return cur_kernel->rv;
 }
 
@@ -227,10 +228,9 @@ vb2_error_t vb2_verify_kernel_preamble(struct vb2_kernel_preamble *preamble,
 	return cur_kernel->rv;
 }
 
-vb2_error_t vb2_verify_data(const uint8_t *data, uint32_t size,
-			    struct vb2_signature *sig,
-			    const struct vb2_public_key *key,
-			    const struct vb2_workbuf *w)
+vb2_error_t vb2_verify_digest(const struct vb2_public_key *key,
+			      struct vb2_signature *sig, const uint8_t *digest,
+			      const struct vb2_workbuf *w)
 {
 	return cur_kernel->rv;
 }
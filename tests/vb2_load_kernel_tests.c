@@ -31,6 +31,7 @@ static int mock_part_next;
 
 /* Mock data */
 static uint8_t kernel_buffer[80000];
+static uint8_t large_kernel_buffer[61440 + 600 * 512];
 static int disk_read_to_fail;
 static int gpt_init_fail;
 static int keyblock_verify_fail;  /* 0=ok, 1=sig, 2=hash */
@@ -38,6 +39,22 @@ static int preamble_verify_fail;
 static int verify_data_fail;
 static int unpack_key_fail;
 static int gpt_flag_external;
+static int gpt_marked_bad;
+static int stream_reads_pending;
+static int stream_reads_max_pending;
+static uint64_t stream_read_bytes;
+
+/* Streams over the sectors of a partition, as the stub implements them */
+static struct mock_stream {
+	vb2ex_disk_handle_t handle;
+	uint64_t sector;
+	uint64_t sectors_left;
+	int open;
+} mock_streams[8];
+static int stream_open_to_fail;
+static int streams_open;
+static int streams_max_open;
+static int stream_close_errors;
 
 static struct vb2_gbb_header gbb;
 static struct vb2_kernel_params lkp;
@@ -66,6 +83,15 @@ static void ResetMocks(void)
 	unpack_key_fail = 0;
 
 	gpt_flag_external = 0;
+	gpt_marked_bad = 0;
+	stream_reads_pending = 0;
+	stream_reads_max_pending = 0;
+	stream_read_bytes = 0;
+	memset(mock_streams, 0, sizeof(mock_streams));
+	stream_open_to_fail = -1;
+	streams_open = 0;
+	streams_max_open = 0;
+	stream_close_errors = 0;
 
 	memset(&gbb, 0, sizeof(gbb));
 	gbb.major_version = VB2_GBB_MAJOR_VER;
@@ -153,12 +179,113 @@ vb2_error_t vb2_gbb_read_recovery_key(struct vb2_context *c,
 	return VB2_SUCCESS;
 }
 
+/* Copy the part of a header at |hdr_ofs| that lands in a read at |ofs| */
+static void copy_header(uint8_t *buffer, uint64_t ofs, uint64_t size,
+			const void *hdr, uint64_t hdr_ofs, uint64_t hdr_size)
+{
+	uint64_t start = VB2_MAX(ofs, hdr_ofs);
+	uint64_t end = VB2_MIN(ofs + size, hdr_ofs + hdr_size);
+
+	if (start < end)
+		memcpy(buffer + (start - ofs),
+		       (const uint8_t *)hdr + (start - hdr_ofs), end - start);
+}
+
 vb2_error_t VbExDiskRead(vb2ex_disk_handle_t h, uint64_t lba_start,
 			 uint64_t lba_count, void *buffer)
 {
+	struct mock_part *p;
+	uint64_t size = lba_count * disk_info.bytes_per_lba;
+
 	if ((int)lba_start == disk_read_to_fail)
 		return VB2_ERROR_MOCK;
 
+	/* Kernel partitions start with the mock vblock headers */
+	for (p = mock_parts; p->size; p++) {
+		if (lba_start < p->start || lba_start >= p->start + p->size)
+			continue;
+		uint64_t ofs = (lba_start - p->start) * disk_info.bytes_per_lba;
+		if (!ofs)
+			memset(buffer, 0, size);
+		copy_header(buffer, ofs, size, &kbh, 0, sizeof(kbh));
+		copy_header(buffer, ofs, size, &kph, kbh.keyblock_size,
+			    sizeof(kph));
+	}
+
+	return VB2_SUCCESS;
+}
+
+vb2_error_t VbExStreamOpen(vb2ex_disk_handle_t handle, uint64_t lba_start,
+			   uint64_t lba_count, VbExStream_t *stream)
+{
+	struct mock_stream *ms;
+
+	if (!handle || (int)lba_start == stream_open_to_fail)
+		return VB2_ERROR_MOCK;
+
+	for (ms = mock_streams; ms->open; ms++)
+		if (ms == &mock_streams[ARRAY_SIZE(mock_streams) - 1])
+			return VB2_ERROR_MOCK;
+
+	ms->handle = handle;
+	ms->sector = lba_start;
+	ms->sectors_left = lba_count;
+	ms->open = 1;
+	if (++streams_open > streams_max_open)
+		streams_max_open = streams_open;
+	*stream = (VbExStream_t)ms;
+	return VB2_SUCCESS;
+}
+
+vb2_error_t VbExStreamRead(VbExStream_t stream, uint32_t bytes, void *buffer)
+{
+	struct mock_stream *ms = (struct mock_stream *)stream;
+	uint64_t sectors = bytes / disk_info.bytes_per_lba;
+	vb2_error_t rv;
+
+	stream_read_bytes += bytes;
+
+	if (bytes % disk_info.bytes_per_lba ||
+	    sectors > ms->sectors_left)
+		return VB2_ERROR_MOCK;
+
+	rv = VbExDiskRead(ms->handle, ms->sector, sectors, buffer);
+	if (rv)
+		return rv;
+
+	ms->sector += sectors;
+	ms->sectors_left -= sectors;
+	return VB2_SUCCESS;
+}
+
+void VbExStreamClose(VbExStream_t stream)
+{
+	struct mock_stream *ms = (struct mock_stream *)stream;
+
+	if (!ms || !ms->open) {
+		stream_close_errors++;
+		return;
+	}
+	ms->open = 0;
+	streams_open--;
+}
+
+vb2_error_t VbExStreamReadSubmit(VbExStream_t stream, uint32_t bytes,
+				 void *buffer, VbExStreamToken_t *token)
+{
+	vb2_error_t rv = VbExStreamRead(stream, bytes, buffer);
+
+	*token = buffer;
+	if (rv)
+		return rv;
+	if (++stream_reads_pending > stream_reads_max_pending)
+		stream_reads_max_pending = stream_reads_pending;
+	return VB2_SUCCESS;
+}
+
+vb2_error_t VbExStreamReadWait(VbExStream_t stream, VbExStreamToken_t token)
+{
+	stream_reads_pending--;
 	return VB2_SUCCESS;
 }
 
@@ -191,6 +318,8 @@ int GptNextKernelEntry(GptData *gpt, uint64_t *start_sector, uint64_t *size)
 
 int GptUpdateKernelEntry(GptData *gpt, uint32_t update_type)
 {
+	if (update_type == GPT_UPDATE_ENTRY_BAD)
+		gpt_marked_bad |= 1 << gpt->current_kernel;
 	return GPT_SUCCESS;
 }
 
@@ -212,6 +341,7 @@ vb2_error_t vb2_unpack_key_buffer(struct vb2_public_key *key,
 	if (--unpack_key_fail == 0)
 		return VB2_ERROR_MOCK;
 
+	key->hash_alg = VB2_HASH_SHA256;
 	return VB2_SUCCESS;
 }
 
@@ -251,10 +381,9 @@ vb2_error_t vb2_verify_kernel_preamble(struct vb2_kernel_preamble *preamble,
 	return VB2_SUCCESS;
 }
 
-vb2_error_t vb2_verify_data(const uint8_t *data, uint32_t size,
-			    struct vb2_signature *sig,
-			    const struct vb2_public_key *key,
-			    const struct vb2_workbuf *wb)
+vb2_error_t vb2_verify_digest(const struct vb2_public_key *key,
+			      struct vb2_signature *sig, const uint8_t *digest,
+			      const struct vb2_workbuf *wb)
 {
 	if (verify_data_fail)
 		return VB2_ERROR_MOCK;
@@ -304,6 +433,8 @@ static void invalid_params_tests(void)
 
 static void load_kernel_tests(void)
 {
+	int i;
+
 	ResetMocks();
 	test_load_kernel(VB2_SUCCESS, "First kernel good");
 	TEST_EQ(lkp.partition_number, 1, "  part num");
@@ -488,6 +619,46 @@ static void load_kernel_tests(void)
 	TEST_EQ(mock_part_next, 2, "  read both");
 	TEST_EQ(sd->kernel_version, 0x30001, "  SD version");
 
+	/* Rollback scan reads the other vblocks together */
+	ResetMocks();
+	kbh.data_key.key_version = 3;
+	for (i = 1; i < MOCK_PART_COUNT - 1; i++) {
+		mock_parts[i].start = 100 + 150 * i;
+		mock_parts[i].size = 150;
+	}
+	disk_read_to_fail = mock_parts[3].start;
+	stream_open_to_fail = mock_parts[4].start;
+	disk_info.flags |= VB2_DISK_FLAG_CONCURRENT_STREAMS;
+	test_load_kernel(VB2_SUCCESS, "Many kernels roll forward");
+	TEST_EQ(mock_part_next, MOCK_PART_COUNT - 1, "  read all");
+	TEST_EQ(stream_reads_max_pending, 4,
+		"  vblock reads in flight together");
+	TEST_EQ(stream_reads_pending, 0, "  all reads completed");
+	TEST_EQ(gpt_marked_bad, 1 << 3 | 1 << 4,
+		"  unreadable kernels marked bad");
+	TEST_EQ(streams_open, 0, "  streams closed");
+	TEST_EQ(stream_close_errors, 0, "  only open streams closed");
+	TEST_EQ(sd->kernel_version, 0x30001, "  SD version");
+
+	/* Without concurrent streams, they are read one at a time */
+	ResetMocks();
+	kbh.data_key.key_version = 3;
+	for (i = 1; i < MOCK_PART_COUNT - 1; i++) {
+		mock_parts[i].start = 100 + 150 * i;
+		mock_parts[i].size = 150;
+	}
+	disk_read_to_fail = mock_parts[3].start;
+	stream_open_to_fail = mock_parts[4].start;
+	test_load_kernel(VB2_SUCCESS, "Many kernels, one stream at a time");
+	TEST_EQ(mock_part_next, MOCK_PART_COUNT - 1, "  read all");
+	TEST_EQ(streams_max_open, 1, "  one stream open at a time");
+	TEST_EQ(stream_reads_max_pending, 1, "  one read in flight");
+	TEST_EQ(gpt_marked_bad, 1 << 3 | 1 << 4,
+		"  unreadable kernels marked bad");
+	TEST_EQ(streams_open, 0, "  streams closed");
+	TEST_EQ(stream_close_errors, 0, "  only open streams closed");
+	TEST_EQ(sd->kernel_version, 0x30001, "  SD version");
+
 	ResetMocks();
 	kbh.data_key.key_version = 1;
 	SET_BOOT_MODE(ctx, VB2_BOOT_MODE_DEVELOPER);
@@ -573,6 +744,37 @@ static void load_kernel_tests(void)
 	test_load_kernel(VB2_ERROR_LK_INVALID_KERNEL_FOUND,
 			 "Kernel body offset huge");
 
+	ResetMocks();
+	kph.preamble_size += 65536;
+	mock_parts[0].size = 300;
+	test_load_kernel(VB2_SUCCESS, "Skip ahead to huge kernel body offset");
+
+	/*
+	 * Unverified sizes must not make the vblock read run away. Failing
+	 * the keyblock check stops anything after the vblock being read.
+	 */
+	ResetMocks();
+	keyblock_verify_fail = 1;
+	kph.preamble_size = 0xffffff00 - kbh.keyblock_size;
+	test_load_kernel(VB2_ERROR_LK_INVALID_KERNEL_FOUND,
+			 "Kernel preamble size huge");
+	TEST_EQ(stream_read_bytes, 65536, "  vblock read bounded");
+
+	ResetMocks();
+	keyblock_verify_fail = 1;
+	kbh.keyblock_size = 0x8000;
+	kph.preamble_size = 0x100001000ULL - kbh.keyblock_size;
+	test_load_kernel(VB2_ERROR_LK_INVALID_KERNEL_FOUND,
+			 "Kernel body offset wraps");
+	TEST_EQ(stream_read_bytes, 65536, "  whole vblock read");
+
+	ResetMocks();
+	kph.preamble_size += 65536;
+	mock_parts[0].size = 300;
+	disk_read_to_fail = 228;
+	test_load_kernel(VB2_ERROR_LK_INVALID_KERNEL_FOUND,
+			 "Fail skipping ahead to kernel body");
+
 	/* Check getting kernel load address from header */
 	ResetMocks();
 	kph.body_load_address = (size_t)kernel_buffer;
@@ -600,10 +802,29 @@ static void load_kernel_tests(void)
 	test_load_kernel(VB2_SUCCESS, "Kernel tiny");
 
 	ResetMocks();
-	disk_read_to_fail = 228;
+	disk_read_to_fail = 108;
 	test_load_kernel(VB2_ERROR_LK_INVALID_KERNEL_FOUND,
 			 "Fail reading kernel data");
 
+	/* Body spanning several read-and-hash chunks */
+	ResetMocks();
+	lkp.kernel_buffer = large_kernel_buffer;
+	lkp.kernel_buffer_size = sizeof(large_kernel_buffer);
+	kph.body_signature.data_size = sizeof(large_kernel_buffer);
+	mock_parts[0].size = 750;
+	test_load_kernel(VB2_SUCCESS, "Kernel body in several chunks");
+	TEST_EQ(stream_reads_max_pending, 1, "  one read in flight at a time");
+	TEST_EQ(stream_reads_pending, 0, "  all reads completed");
+
+	ResetMocks();
+	lkp.kernel_buffer = large_kernel_buffer;
+	lkp.kernel_buffer_size = sizeof(large_kernel_buffer);
+	kph.body_signature.data_size = sizeof(large_kernel_buffer);
+	mock_parts[0].size = 750;
+	disk_read_to_fail = 108 + 512;
+	test_load_kernel(VB2_ERROR_LK_INVALID_KERNEL_FOUND,
+			 "Fail reading second kernel data chunk");
+
 	ResetMocks();
 	verify_data_fail = 1;
 	test_load_kernel(VB2_ERROR_LK_INVALID_KERNEL_FOUND, "Bad data");
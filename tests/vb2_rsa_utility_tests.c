@@ -12,6 +12,7 @@
 #include "2sysincludes.h"
 #include "common/tests.h"
 #include "file_keys.h"
+#include "host_key.h"
 #include "rsa_padding_test.h"
 #include "vboot_api.h"
 
@@ -110,10 +111,109 @@ static void test_utils(void)
 	}
 }
 
+#ifdef RSA_MONT64
+/* Big-endian n - 1, whose public exponentiation is itself for odd exp */
+static void n_minus_1(const struct vb2_public_key *key, uint8_t *out)
+{
+	uint32_t i;
+
+	for (i = 0; i < key->arrsize; i++) {
+		uint32_t w = key->n[key->arrsize - 1 - i] - (i == key->arrsize - 1);
+
+		out[i * 4 + 0] = (uint8_t)(w >> 24);
+		out[i * 4 + 1] = (uint8_t)(w >> 16);
+		out[i * 4 + 2] = (uint8_t)(w >> 8);
+		out[i * 4 + 3] = (uint8_t)w;
+	}
+}
+
+/**
+ * Test the 64-bit limb backends against the 32-bit exponentiation
+ */
+static void test_modpow64_key(const char *keys_dir, const char *name,
+			      enum vb2_crypto_algorithm alg, int exp)
+{
+	uint32_t workbuf32[3 * RSA8192NUMBYTES / sizeof(uint32_t)];
+	uint8_t in[RSA8192NUMBYTES];
+	uint8_t want[RSA8192NUMBYTES];
+	uint8_t got[RSA8192NUMBYTES];
+	struct vb2_public_key key;
+	struct vb2_packed_key *pk;
+	char filename[1024];
+	uint32_t size;
+	int impl, i, j;
+
+	snprintf(filename, sizeof(filename), "%s/key_%s.keyb", keys_dir, name);
+	pk = vb2_read_packed_keyb(filename, alg, 0);
+	TEST_PTR_NEQ(pk, NULL, filename);
+	if (!pk || vb2_unpack_key(&key, pk)) {
+		free(pk);
+		return;
+	}
+	size = key.arrsize * sizeof(uint32_t);
+
+	for (impl = VB2_MONT64_C; impl <= VB2_MONT64_ADX; impl++) {
+		int mismatch = 0;
+
+		if (!vb2_mont64_supported(impl)) {
+			printf("Skipping %s backend %d; unsupported\n",
+			       name, impl);
+			continue;
+		}
+
+		n_minus_1(&key, in);
+		memcpy(got, in, size);
+		TEST_EQ(vb2_modpow64(&key, got, workbuf32, exp, impl), 1,
+			"vb2_modpow64() n-1");
+		TEST_EQ(memcmp(got, in, size), 0, "  (n-1)^e == n-1");
+
+		memset(in, 0, size);
+		in[size - 1] = 1;
+		memcpy(got, in, size);
+		vb2_modpow64(&key, got, workbuf32, exp, impl);
+		TEST_EQ(memcmp(got, in, size), 0, "  1^e == 1");
+
+		srand(impl);
+		for (i = 0; i < 32; i++) {
+			/* Clear the top byte so the input is below n */
+			in[0] = 0;
+			for (j = 1; j < size; j++)
+				in[j] = (uint8_t)rand();
+			memcpy(want, in, size);
+			vb2_modpow(&key, want, workbuf32, exp);
+			memcpy(got, in, size);
+			vb2_modpow64(&key, got, workbuf32, exp, impl);
+			mismatch |= memcmp(got, want, size);
+		}
+		TEST_EQ(mismatch, 0, "  random inputs match vb2_modpow()");
+	}
+
+	free(pk);
+}
+
+static void test_modpow64(const char *keys_dir)
+{
+	test_modpow64_key(keys_dir, "rsa1024", VB2_ALG_RSA1024_SHA256, 65537);
+	test_modpow64_key(keys_dir, "rsa2048", VB2_ALG_RSA2048_SHA256, 65537);
+	test_modpow64_key(keys_dir, "rsa2048_exp3",
+			  VB2_ALG_RSA2048_EXP3_SHA256, 3);
+	test_modpow64_key(keys_dir, "rsa3072_exp3",
+			  VB2_ALG_RSA3072_EXP3_SHA256, 3);
+	test_modpow64_key(keys_dir, "rsa4096", VB2_ALG_RSA4096_SHA256, 65537);
+	test_modpow64_key(keys_dir, "rsa8192", VB2_ALG_RSA8192_SHA512, 65537);
+}
+#endif
+
 int main(int argc, char* argv[])
 {
 	/* Run tests */
 	test_utils();
+#ifdef RSA_MONT64
+	if (argc == 2)
+		test_modpow64(argv[1]);
+	else
+		fprintf(stderr, "Skipping modpow64 tests; no keys dir\n");
+#endif
 
 	return gTestSuccess ? 0 : 255;
 }
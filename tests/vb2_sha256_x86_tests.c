@@ -64,6 +64,30 @@ static void sha256_tests(void)
 	TEST_EQ(memcmp(digest, expect_multiple, sizeof(digest)), 0,
 		"SHA-256 multiple extends");
 
+	/* Two digests in progress at once */
+	{
+		struct vb2_hwcrypto_digest_context hc1, hc2;
+		uint8_t digest2[VB2_SHA256_DIGEST_SIZE];
+
+		vb2ex_hwcrypto_digest_init_ctx(&hc1, VB2_HASH_SHA256, 15);
+		vb2ex_hwcrypto_digest_init_ctx(&hc2, VB2_HASH_SHA256,
+					       strlen(multiblock_msg1));
+		vb2ex_hwcrypto_digest_extend_ctx(&hc1, (uint8_t *)"test1", 5);
+		vb2ex_hwcrypto_digest_extend_ctx(&hc2,
+						 (uint8_t *)multiblock_msg1,
+						 strlen(multiblock_msg1));
+		vb2ex_hwcrypto_digest_extend_ctx(&hc1, (uint8_t *)"test2", 5);
+		vb2ex_hwcrypto_digest_extend_ctx(&hc1, (uint8_t *)"test3", 5);
+		vb2ex_hwcrypto_digest_finalize_ctx(&hc2, digest2,
+						   sizeof(digest2));
+		vb2ex_hwcrypto_digest_finalize_ctx(&hc1, digest,
+						   sizeof(digest));
+		TEST_EQ(memcmp(digest, expect_multiple, sizeof(digest)), 0,
+			"SHA-256 interleaved digest 1");
+		TEST_EQ(memcmp(digest2, sha256_results[1], sizeof(digest2)),
+			0, "SHA-256 interleaved digest 2");
+	}
+
 	TEST_EQ(vb2_hash_block_size(VB2_HASH_SHA256), VB2_SHA256_BLOCK_SIZE,
 		"vb2_hash_block_size(VB2_HASH_SHA256)");
 
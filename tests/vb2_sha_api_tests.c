@@ -26,6 +26,9 @@ static enum hwcrypto_state {
 	HWCRYPTO_ABORT,
 } hwcrypto_state;
 
+/* Set when a digest is expected to run in SW even though HW is OK */
+static bool sw_expected;
+
 static vb2_error_t hwcrypto_mock(enum hwcrypto_state *state)
 {
 	switch (*state) {
@@ -46,13 +49,14 @@ static vb2_error_t hwcrypto_mock(enum hwcrypto_state *state)
 static void reset_common_data(enum hwcrypto_state state)
 {
 	hwcrypto_state = state;
+	sw_expected = false;
 	memset(&mock_hash, 0xaa, sizeof(mock_hash));
 }
 
 void vb2_sha1_init(struct vb2_sha1_context *ctx)
 {
 	TEST_TRUE(hwcrypto_state == HWCRYPTO_NOTSUPPORTED ||
-		  hwcrypto_state == HWCRYPTO_ABORT,
+		  hwcrypto_state == HWCRYPTO_ABORT || sw_expected,
 		  "    hwcrypto_state in SW init");
 }
 
@@ -61,7 +65,7 @@ void vb2_sha1_update(struct vb2_sha1_context *ctx,
 		     uint32_t size)
 {
 	TEST_TRUE(hwcrypto_state == HWCRYPTO_NOTSUPPORTED ||
-		  hwcrypto_state == HWCRYPTO_ABORT,
+		  hwcrypto_state == HWCRYPTO_ABORT || sw_expected,
 		  "    hwcrypto_state in SW extend");
 	TEST_PTR_EQ(data, mock_buffer, "    digest_extend buf");
 	TEST_EQ(size, sizeof(mock_buffer), "    digest_extend size");
@@ -70,7 +74,7 @@ void vb2_sha1_update(struct vb2_sha1_context *ctx,
 void vb2_sha1_finalize(struct vb2_sha1_context *ctx, uint8_t *digest)
 {
 	TEST_TRUE(hwcrypto_state == HWCRYPTO_NOTSUPPORTED ||
-		  hwcrypto_state == HWCRYPTO_ABORT,
+		  hwcrypto_state == HWCRYPTO_ABORT || sw_expected,
 		  "    hwcrypto_state in SW finalize");
 	memcpy(digest, mock_sha1, sizeof(mock_sha1));
 }
@@ -156,7 +160,7 @@ static void vb2_hash_verify_tests(void)
 
 static void vb2_hash_hwcrypto_tests(void)
 {
-	struct vb2_digest_context dc;
+	struct vb2_digest_context dc, dc2, dc3;
 
 	reset_common_data(HWCRYPTO_OK);
 	TEST_SUCC(vb2_digest_init(&dc, true, VB2_HASH_SHA1,
@@ -202,6 +206,70 @@ static void vb2_hash_hwcrypto_tests(void)
 	TEST_EQ(vb2_hash_verify(true, mock_buffer, sizeof(mock_buffer),
 				&mock_hash), VB2_ERROR_SHA_MISMATCH,
 		"hash_verify HW mismatch");
+
+	/* The single-state engine only takes one digest at a time */
+	reset_common_data(HWCRYPTO_OK);
+	TEST_SUCC(vb2_digest_init(&dc, true, VB2_HASH_SHA1,
+				  sizeof(mock_buffer)),
+		  "digest_init, first of two");
+	TEST_EQ(dc.using_hwcrypto, 1, "  using_hwcrypto set");
+	sw_expected = true;
+	TEST_SUCC(vb2_digest_init(&dc2, true, VB2_HASH_SHA1,
+				  sizeof(mock_buffer)),
+		  "digest_init, second of two");
+	TEST_EQ(dc2.using_hwcrypto, 0, "  second falls back to SW");
+	TEST_SUCC(vb2_digest_extend(&dc2, mock_buffer, sizeof(mock_buffer)),
+		  "digest_extend, second of two");
+	TEST_SUCC(vb2_digest_extend(&dc, mock_buffer, sizeof(mock_buffer)),
+		  "digest_extend, first of two");
+	TEST_SUCC(vb2_digest_finalize(&dc, mock_hash.raw, VB2_SHA1_DIGEST_SIZE),
+		  "digest_finalize, first of two");
+	TEST_SUCC(memcmp(mock_hash.sha1, mock_sha1, sizeof(mock_sha1)),
+		  "  got the right hash");
+	TEST_SUCC(vb2_digest_finalize(&dc2, mock_hash.raw,
+				      VB2_SHA1_DIGEST_SIZE),
+		  "digest_finalize, second of two");
+	TEST_SUCC(memcmp(mock_hash.sha1, mock_sha1, sizeof(mock_sha1)),
+		  "  got the right hash");
+	sw_expected = false;
+
+	/* Once the first is finalized, another context gets the engine */
+	TEST_SUCC(vb2_digest_init(&dc3, true, VB2_HASH_SHA1,
+				  sizeof(mock_buffer)),
+		  "digest_init after finalize");
+	TEST_EQ(dc3.using_hwcrypto, 1, "  engine is free again");
+	TEST_SUCC(vb2_digest_finalize(&dc3, mock_hash.raw,
+				      VB2_SHA1_DIGEST_SIZE),
+		  "digest_finalize, third");
+
+	/* Reinitializing an abandoned digest frees the engine */
+	reset_common_data(HWCRYPTO_OK);
+	TEST_SUCC(vb2_digest_init(&dc, true, VB2_HASH_SHA1,
+				  sizeof(mock_buffer)),
+		  "digest_init, abandoned");
+	TEST_SUCC(vb2_digest_extend(&dc, mock_buffer, sizeof(mock_buffer)),
+		  "  digest_extend");
+	sw_expected = true;
+	TEST_SUCC(vb2_digest_init(&dc, false, VB2_HASH_SHA1,
+				  sizeof(mock_buffer)),
+		  "  reinitialized in SW");
+	TEST_EQ(dc.using_hwcrypto, 0, "  not using_hwcrypto");
+	sw_expected = false;
+	TEST_SUCC(vb2_digest_init(&dc2, true, VB2_HASH_SHA1,
+				  sizeof(mock_buffer)),
+		  "digest_init, after abandoned");
+	TEST_EQ(dc2.using_hwcrypto, 1, "  engine is free again");
+	TEST_SUCC(vb2_digest_init(&dc2, true, VB2_HASH_SHA1,
+				  sizeof(mock_buffer)),
+		  "  reinitialized in HW");
+	TEST_EQ(dc2.using_hwcrypto, 1, "  still has the engine");
+	TEST_SUCC(vb2_digest_extend(&dc2, mock_buffer, sizeof(mock_buffer)),
+		  "  digest_extend");
+	TEST_SUCC(vb2_digest_finalize(&dc2, mock_hash.raw,
+				      VB2_SHA1_DIGEST_SIZE),
+		  "  digest_finalize");
+	TEST_SUCC(memcmp(mock_hash.sha1, mock_sha1, sizeof(mock_sha1)),
+		  "  got the right hash");
 }
 
 int main(int argc, char *argv[])
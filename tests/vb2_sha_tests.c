@@ -7,9 +7,11 @@
 
 #include <stdio.h>
 
+#include "2common.h"
 #include "2return_codes.h"
 #include "2rsa.h"
 #include "2sha.h"
+#include "2sha_private.h"
 #include "2sysincludes.h"
 #include "common/tests.h"
 #include "sha_test_vectors.h"
@@ -131,6 +133,183 @@ static void sha512_tests(void)
 		"vb2_hash_block_size(VB2_HASH_SHA512)");
 }
 
+/*
+ * Hashes long_msg with uneven extends, which hand the transform odd and even
+ * block counts, and partial blocks, in every combination.
+ */
+static void chunked_digest(enum vb2_hash_algorithm hash_alg,
+			   uint8_t *digest, uint32_t digest_size)
+{
+	const uint32_t chunks[] = {1, 63, 64, 65, 127, 128, 129, 255, 256,
+				   257, 384, 1000, 4096};
+	const uint8_t *msg = (const uint8_t *)long_msg;
+	const uint32_t len = strlen(long_msg);
+	struct vb2_digest_context dc;
+	uint32_t pos, size;
+	int i;
+
+	vb2_digest_init(&dc, false, hash_alg, 0);
+	for (pos = 0, i = 0; pos < len; pos += size, i++) {
+		size = VB2_MIN(chunks[i % ARRAY_SIZE(chunks)], len - pos);
+		vb2_digest_extend(&dc, msg + pos, size);
+	}
+	TEST_SUCC(vb2_digest_finalize(&dc, digest, digest_size),
+		  "vb2_digest_finalize() chunked");
+}
+
+static void chunked_tests(void)
+{
+	const uint8_t sha384_long[VB2_SHA384_DIGEST_SIZE] = {
+		0x9d, 0x0e, 0x18, 0x09, 0x71, 0x64, 0x74, 0xcb,
+		0x08, 0x6e, 0x83, 0x4e, 0x31, 0x0a, 0x4a, 0x1c,
+		0xed, 0x14, 0x9e, 0x9c, 0x00, 0xf2, 0x48, 0x52,
+		0x79, 0x72, 0xce, 0xc5, 0x70, 0x4c, 0x2a, 0x5b,
+		0x07, 0xb8, 0xb3, 0xdc, 0x38, 0xec, 0xc4, 0xeb,
+		0xae, 0x97, 0xdd, 0xd8, 0x7f, 0x3d, 0x89, 0x85 };
+	struct vb2_hash hash;
+
+	chunked_digest(VB2_HASH_SHA1, hash.sha1, sizeof(hash.sha1));
+	TEST_EQ(memcmp(hash.sha1, sha1_results[2], sizeof(sha1_results[2])),
+		0, "  SHA-1 chunked digest");
+
+	chunked_digest(VB2_HASH_SHA256, hash.sha256, sizeof(hash.sha256));
+	TEST_EQ(memcmp(hash.sha256, sha256_results[2],
+		       sizeof(sha256_results[2])), 0,
+		"  SHA-256 chunked digest");
+
+	chunked_digest(VB2_HASH_SHA512, hash.sha512, sizeof(hash.sha512));
+	TEST_EQ(memcmp(hash.sha512, sha512_results[2],
+		       sizeof(sha512_results[2])), 0,
+		"  SHA-512 chunked digest");
+
+	TEST_SUCC(vb2_hash_calculate(false, long_msg, strlen(long_msg),
+				     VB2_HASH_SHA384, &hash),
+		  "vb2_hash_calculate() SHA-384");
+	TEST_EQ(memcmp(hash.raw, sha384_long, sizeof(sha384_long)), 0,
+		"  SHA-384 digest");
+}
+
+/* Every padding case for both block sizes, then some longer jobs */
+enum { NUM_JOBS = 2 * VB2_SHA512_BLOCK_SIZE + 5 };
+
+/* Hashes the first count jobs together and compares with one at a time */
+static void check_many(enum vb2_hash_algorithm alg, uint32_t count,
+		       const char *desc)
+{
+	struct vb2_hash_job jobs[NUM_JOBS];
+	struct vb2_hash hashes[NUM_JOBS];
+	struct vb2_hash expect;
+	int j, bad;
+
+	for (j = 0; j < count; j++) {
+		jobs[j].buf = long_msg + j;
+		jobs[j].size = j < NUM_JOBS - 5 ? j : 3000 * j;
+		jobs[j].hash = &hashes[j];
+	}
+	TEST_SUCC(vb2_hash_calculate_many(alg, jobs, count), desc);
+
+	bad = 0;
+	for (j = 0; j < count; j++) {
+		vb2_hash_calculate(false, jobs[j].buf, jobs[j].size, alg,
+				   &expect);
+		if (hashes[j].algo != alg ||
+		    memcmp(hashes[j].raw, expect.raw, vb2_digest_size(alg)))
+			bad++;
+	}
+	TEST_EQ(bad, 0, "  digests match vb2_hash_calculate()");
+}
+
+static void many_tests(void)
+{
+	const enum vb2_hash_algorithm algs[] = {
+		VB2_HASH_SHA1, VB2_HASH_SHA224, VB2_HASH_SHA256,
+		VB2_HASH_SHA384, VB2_HASH_SHA512,
+	};
+	struct vb2_hash_job jobs[1];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(algs); i++)
+		check_many(algs[i], NUM_JOBS, "vb2_hash_calculate_many()");
+
+#ifdef SHA_RUNTIME_DISPATCH
+	/*
+	 * With SHA-NI the dispatcher leaves the multi-buffer engine alone,
+	 * so force it, and check it against the C transforms.  Partly filled
+	 * lane groups need covering too.
+	 */
+	if (vb2_sha_force_many_engine(VB2_SHA_ENGINE_X86_AVX2)) {
+		const uint32_t counts[] = {1, 3, 4, 5, 8, 9, 16, NUM_JOBS};
+		int j;
+
+		for (i = 0; i < ARRAY_SIZE(algs); i++) {
+			vb2_sha_force_engine(algs[i], VB2_SHA_ENGINE_C);
+			for (j = 0; j < ARRAY_SIZE(counts); j++)
+				check_many(algs[i], counts[j],
+					   "vb2_hash_calculate_many() AVX2");
+			vb2_sha_force_engine(algs[i], VB2_SHA_ENGINE_AUTO);
+		}
+		vb2_sha_force_many_engine(VB2_SHA_ENGINE_AUTO);
+	} else {
+		printf("Skipping multi-buffer AVX2 tests: not available\n");
+	}
+#endif
+
+	TEST_SUCC(vb2_hash_calculate_many(VB2_HASH_SHA256, jobs, 0),
+		  "vb2_hash_calculate_many() no jobs");
+	TEST_EQ(vb2_hash_calculate_many(VB2_HASH_INVALID, jobs, 1),
+		VB2_ERROR_SHA_INIT_ALGORITHM,
+		"vb2_hash_calculate_many() invalid alg");
+}
+
+/*
+ * Runs the known-answer tests again on each engine this CPU has, so that
+ * transforms the dispatcher wouldn't pick here get checked too.
+ */
+static void engine_tests(void)
+{
+#ifdef SHA_RUNTIME_DISPATCH
+	static const struct {
+		enum vb2_sha_engine engine;
+		const char *name;
+	} engines[] = {
+		{ VB2_SHA_ENGINE_C, "C" },
+		{ VB2_SHA_ENGINE_X86_SHA, "x86 SHA extensions" },
+		{ VB2_SHA_ENGINE_X86_AVX2, "AVX2" },
+		{ VB2_SHA_ENGINE_ARMV8_CE, "ARMv8 crypto extensions" },
+	};
+	const enum vb2_hash_algorithm algs[] = {
+		VB2_HASH_SHA1, VB2_HASH_SHA256, VB2_HASH_SHA512,
+	};
+	int i, j, forced;
+
+	for (i = 0; i < ARRAY_SIZE(engines); i++) {
+		forced = 0;
+		for (j = 0; j < ARRAY_SIZE(algs); j++) {
+			if (vb2_sha_force_engine(algs[j], engines[i].engine)) {
+				printf("Testing %s on %s\n",
+				       vb2_get_hash_algorithm_name(algs[j]),
+				       engines[i].name);
+				forced = 1;
+			} else {
+				printf("Skipping %s on %s: not available\n",
+				       vb2_get_hash_algorithm_name(algs[j]),
+				       engines[i].name);
+			}
+		}
+		if (!forced)
+			continue;
+
+		sha1_tests();
+		sha256_tests();
+		sha512_tests();
+		chunked_tests();
+
+		for (j = 0; j < ARRAY_SIZE(algs); j++)
+			vb2_sha_force_engine(algs[j], VB2_SHA_ENGINE_AUTO);
+	}
+#endif
+}
+
 static void misc_tests(void)
 {
 	uint8_t digest[VB2_SHA512_DIGEST_SIZE];
@@ -251,6 +430,9 @@ int main(int argc, char *argv[])
 	sha1_tests();
 	sha256_tests();
 	sha512_tests();
+	chunked_tests();
+	many_tests();
+	engine_tests();
 	misc_tests();
 	known_value_tests();
 